@@ -18,7 +18,7 @@ LIBRARIES=""            # What libraries do we want to include
 if platform.system()=="Linux":
     ARGUMENTS="-D LINUX" # -D is a #define sent to preprocessor
     INCLUDE_DIR="-I ./include/ -I ./../../common/thirdparty/glm/"
-    LIBRARIES="-lSDL2 -ldl"
+    LIBRARIES="-lSDL2 -ldl -pthread"
 elif platform.system()=="Darwin":
     ARGUMENTS="-D MAC" # -D is a #define sent to the preprocessor.
     INCLUDE_DIR="-I ./include/ -I/Library/Frameworks/SDL2.framework/Headers -I./../../common/thirdparty/old/glm"
@@ -27,7 +27,7 @@ elif platform.system()=="Windows":
     ARGUMENTS="-D MINGW -static-libgcc -static-libstdc++" 
     INCLUDE_DIR="-I./include/ -I./../../common/thirdparty/old/glm/"
     EXECUTABLE="prog.exe"
-    LIBRARIES="-lmingw32 -lSDL2main -lSDL2 -mwindows"
+    LIBRARIES="-lmingw32 -lSDL2main -lSDL2 -mwindows -pthread"
 # (2)=================== Platform specific configuration ===================== #
 
 # (3)====================== Building the Executable ========================== #
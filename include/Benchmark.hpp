@@ -0,0 +1,208 @@
+/** @file Benchmark.hpp
+ *  @brief Deterministic frame-timing benchmark
+ *
+ *  Replays a recorded camera path with a fixed time step per frame and
+ *  collects CPU frame times and GPU frame / pass times (measured by the
+ *  profiler). The results (averages, percentiles and per-pass breakdowns)
+ *  are written as a JSON file, together with the quality the visible
+ *  parallax objects were drawn with (ParallaxLodSettings) and, with the
+ *  texture streaming, the resident texture memory, its quality and the
+ *  quality of smaller budgets.
+ *
+ *  RunScalingBenchmark measures the CPU preparation of the draws (culling,
+ *  sort keys, per-draw uniforms) of many objects against the thread count.
+ *  RunMeshStatistics reports the vertex cache efficiency of a mesh after
+ *  every optimization pass and its levels of detail, RunMeshletStatistics
+ *  the meshlets of a mesh and how many of them are culled along a camera
+ *  path. RunSimplifyBenchmark measures the triangle throughput of the level
+ *  of detail generation on a large generated mesh against the thread count.
+ *  RunLightBenchmark measures the binning of many point lights into the
+ *  light clusters against the thread count. RunTextureBake compresses the
+ *  textures of a directory and reports their size and quality.
+ *  RunHeightMapBenchmark measures the height map conversion per instruction
+ *  set and thread count. RunVirtualTextureBuild writes the page file of a
+ *  material, RunVirtualTextureSimulation replays the feedback of a virtual
+ *  texture through its page cache.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#else // This works for Mac
+    #include <SDL.h>
+#endif
+
+#include <glad/glad.h>
+
+// STL
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "Camera.hpp"
+#include "CameraPath.hpp"
+#include "Profiler.hpp"
+
+class TextureStreamer;
+
+// summary of a series of timings (in milliseconds)
+struct TimingStatistics{
+    double average = 0.0;
+    double minimum = 0.0;
+    double maximum = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+
+    // compute the statistics of the given samples
+    static TimingStatistics Compute(std::vector<double> samples);
+};
+
+class Benchmark{
+
+public:
+
+    Benchmark(const std::string& cameraPathFile, const std::string& outputFile);
+    ~Benchmark();
+
+    // true if the camera path was loaded
+    bool IsValid() const;
+
+    // true once all frames of the path were measured
+    bool IsFinished() const;
+
+    // start a new frame - moves the camera along the path
+    // (call after the profiler started the frame)
+    void BeginFrame(Camera& camera);
+
+    // end of the CPU work of the frame (call before swapping the buffers)
+    void EndFrame();
+
+    // draw calls and CPU submit time of the object pass of the current frame
+    void RecordSubmit(unsigned int drawCalls, double submitMiliseconds);
+
+    // visible parallax objects per quality (ray marched, offset, normal mapping) and their average layer budget
+    void RecordParallax(unsigned int full, unsigned int offset, unsigned int normal, double layers);
+
+    // memory of the streamed textures and the share of the requested texels that were resident
+    void RecordTextureStreaming(double residentMB, double quality);
+
+    // read back the outstanding GPU timings and write the JSON report
+    void WriteResults();
+
+    // statistics of the written results
+    const TimingStatistics& GetFrameStatistics() const;
+    const TimingStatistics& GetGpuStatistics() const;
+
+    // average share of the visible parallax objects drawn by the ray marched methods and their layer budget
+    double GetParallaxFullShare() const;
+    double GetParallaxLayers() const;
+
+private:
+
+    // store the GPU timings of the frames the profiler resolved
+    void CollectProfilerFrames();
+    unsigned int GetPassIndex(const std::string& name);
+    void WriteStatistics(std::ofstream& file, const std::string& name,
+                         const TimingStatistics& stats, bool last) const;
+
+public:
+
+    // number of frames rendered before measuring
+    unsigned int warmupFrames = 60;
+
+    // simulated time between two frames in seconds
+    float timeStep = 1.0f / 60.0f;
+
+    // free form description of the run (scene, method...) written to the report
+    std::string description = "";
+
+    // loading until the first frame was shown
+    double timeToFirstFrameMs = 0.0;
+
+    // budget curve of the report (null = the textures are not streamed)
+    const TextureStreamer* textureStreamer = nullptr;
+
+private:
+
+    CameraPath cameraPath;
+    std::string pathFile;
+    std::string outputFile;
+
+    bool valid = false;
+    bool finished = false;
+
+    // frame counters
+    unsigned int frameIndex = 0;
+    unsigned int numberOfFrames = 0;
+    int currentRecord = -1;
+
+    // CPU timing
+    Uint64 frameStart = 0;
+    bool previousRecorded = false;
+
+    // profiler frame number of the first measured frame
+    unsigned int firstProfilerFrame = 0;
+
+    // measured values per frame in milliseconds
+    std::vector<std::string> passNames;
+    std::vector<std::vector<double>> passTimes;
+    std::vector<double> frameTimes;
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    std::vector<double> submitTimes;
+    std::vector<double> drawCalls;
+    std::vector<double> parallaxFull;
+    std::vector<double> parallaxOffset;
+    std::vector<double> parallaxNormal;
+    std::vector<double> parallaxLayers;
+    std::vector<double> textureResident;
+    std::vector<double> textureQuality;
+
+    // summary of WriteResults
+    TimingStatistics frameStatistics;
+    TimingStatistics gpuStatistics;
+
+};
+
+
+// CPU time of the draw preparation with 1..maxThreads threads (0 = all cores, no window needed)
+void RunScalingBenchmark(unsigned int numberOfObjects, unsigned int maxThreads = 0, unsigned int frames = 100);
+
+// CPU binning of numberOfLights random local lights into the light clusters with 1..maxThreads threads
+// (0 = all cores) and a check of the cluster lookup - no window needed
+void RunLightBenchmark(unsigned int numberOfLights, unsigned int maxThreads = 0, unsigned int frames = 100);
+
+// vertex cache statistics of an .obj mesh after every optimization pass and its levels of detail (no window needed)
+void RunMeshStatistics(const std::string& filePath);
+
+// meshlets of an .obj mesh and the average part culled by frustum and cone along a camera path
+// (in the object space of the mesh, empty = orbit around it) - no window needed
+void RunMeshletStatistics(const std::string& filePath, const std::string& pathFile);
+
+// compress every material texture under the directory into its KTX2 file and print the size, time and PSNR
+// (the usage comes from the file name, like the scenes load them) - no window needed
+void RunTextureBake(const std::string& directory, unsigned int maxThreads = 0);
+
+// level of detail generation of a resolution x resolution quad torus with 1..maxThreads threads (0 = all cores)
+void RunSimplifyBenchmark(unsigned int resolution, unsigned int maxThreads = 0);
+
+// height map conversion of a size x size RGB image per instruction set and thread count, checked against
+// the scalar code (0 = all cores)
+void RunHeightMapBenchmark(unsigned int size, unsigned int maxThreads = 0);
+
+// page file of the basecolor, normal and height textures of a directory magnified to size texels per side
+void RunVirtualTextureBuild(const std::string& directory, unsigned int size, const std::string& outputPath,
+                            unsigned int maxThreads = 0);
+
+// page cache of a virtual texture fed with recorded feedback (--vt-record, empty = a camera panning and
+// zooming over it) at 60 frames per second - hits, uploads, evictions and disk reads, no window needed
+void RunVirtualTextureSimulation(const std::string& filePath, const std::string& feedbackPath);
+
+
+#endif
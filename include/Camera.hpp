@@ -47,6 +47,12 @@ public:
     float GetViewYDirection();
     // Returns the Z 'view' direction
     float GetViewZDirection();
+    // Returns the eye position as a vector
+    glm::vec3 GetEyePosition() const;
+    // Returns the 'view' direction as a vector
+    glm::vec3 GetViewDirection() const;
+    // Set the 'view' direction (normalized internally)
+    void SetViewDirection(const glm::vec3& direction);
 private:
 
     // Track the old mouse position
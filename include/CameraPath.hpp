@@ -0,0 +1,72 @@
+/** @file CameraPath.hpp
+ *  @brief Recordable camera path that can be replayed through a Camera
+ *
+ *  Stores timed camera keyframes (eye position and view direction).
+ *  Paths can be recorded from an interactive session, saved to a plain
+ *  text file and sampled with a Catmull-Rom spline for smooth replay.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef CAMERAPATH_HPP
+#define CAMERAPATH_HPP
+
+#include <glm/glm.hpp>
+#include <glm/vec3.hpp>
+
+// STL
+#include <string>
+#include <vector>
+
+#include "Camera.hpp"
+
+// one sample of the camera path
+struct CameraKeyframe{
+    float time;             // seconds since the start of the path
+    glm::vec3 position;     // eye position
+    glm::vec3 direction;    // view direction
+};
+
+class CameraPath{
+
+public:
+
+    CameraPath();
+    ~CameraPath();
+
+    // load / save the path - one keyframe per line: "t px py pz dx dy dz"
+    bool LoadFromFile(const std::string& filePath);
+    bool SaveToFile(const std::string& filePath) const;
+
+    // append a keyframe (time has to be increasing)
+    void AddKeyframe(float time, const glm::vec3& position, const glm::vec3& direction);
+
+    // record the current state of the camera if enough time passed since the last keyframe
+    void Record(float time, const Camera& camera);
+
+    // sample the path at a time relative to its start (clamped to the path duration)
+    void Sample(float time, glm::vec3& position, glm::vec3& direction) const;
+
+    // move the camera to the sampled state
+    void Apply(float time, Camera& camera) const;
+
+    void Clear();
+
+    // getters
+    float GetDuration() const;
+    unsigned int GetNumberOfKeyframes() const;
+
+public:
+
+    // minimal spacing of recorded keyframes in seconds
+    float recordInterval = 0.1f;
+
+private:
+
+    std::vector<CameraKeyframe> keyframes;
+
+};
+
+
+#endif
@@ -0,0 +1,73 @@
+/** @file DepthPyramid.hpp
+ *  @brief Hierarchical depth (Hi-Z) of the last rendered frame
+ *
+ *  After the objects are drawn the depth buffer is copied into a texture and
+ *  reduced by a compute shader into a mip chain, where every texel holds the
+ *  farthest depth of the texels it covers. The next frame tests the bounding
+ *  spheres of the objects against it (occlusion culling).
+ *
+ *  Level 0 has the largest power of two size that fits the screen, so every
+ *  following level halves the previous one exactly.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef DEPTHPYRAMID_HPP
+#define DEPTHPYRAMID_HPP
+
+#include <glad/glad.h>
+
+// glm lib
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "Shader.hpp"
+
+class DepthPyramid{
+
+public:
+
+    // no GL calls - the textures are created on the first build
+    DepthPyramid();
+    ~DepthPyramid();
+
+    // copy the depth buffer of the bound framebuffer and reduce it (after the occluders are drawn)
+    void Build(const glm::mat4& viewProjection);
+
+    GLuint GetTexture() const;
+    int GetWidth() const;
+    int GetHeight() const;
+    int GetNumberOfLevels() const;
+
+    // view projection of the frame the pyramid was built from
+    const glm::mat4& GetViewProjection() const;
+
+    // false until the first build
+    bool IsValid() const;
+
+private:
+
+    // (re)create the textures for a new screen size
+    void Resize(int screenWidth, int screenHeight);
+
+private:
+
+    Shader* reduceShader = nullptr;
+
+    GLuint depthTexture = 0;      // copy of the depth buffer
+    GLuint pyramidTexture = 0;    // R32F mip chain
+
+    int screenWidth = 0;
+    int screenHeight = 0;
+    int width = 0;
+    int height = 0;
+    int numberOfLevels = 0;
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    bool valid = false;
+
+};
+
+
+#endif
@@ -0,0 +1,141 @@
+/** @file FrameCapture.hpp
+ *  @brief Screenshots and frame sequences read back through pixel pack buffers
+ *
+ *  A glReadPixels into client memory waits until the GPU has finished the
+ *  frame and copies the pixels before it returns - tens of miliseconds for
+ *  a 2560x1440 frame. The capture reads the back buffer into one of a ring
+ *  of pixel pack buffers instead: the call returns at once, a fence after it
+ *  marks when the copy is done. Update polls the fences (no wait) and hands
+ *  the pixels of a finished copy to the writer thread, which flips the rows,
+ *  drops the alpha (the buffer is free again after that) and writes the
+ *  frame as a binary P6 file.
+ *
+ *  With ARB_buffer_storage the buffers are persistently mapped for reading,
+ *  otherwise a buffer is mapped when its copy is done and unmapped when the
+ *  writer has copied it. A capture with every buffer busy is dropped, the
+ *  frame is never stalled.
+ *
+ *  Usage:
+ *      capture.Capture("frame_000120.ppm", width, height);  // after the frame is rendered
+ *      capture.Update();                   // every frame
+ *      capture.Flush();                    // before the context is destroyed
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef FRAMECAPTURE_HPP
+#define FRAMECAPTURE_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+// counters since the capture was created
+struct FrameCaptureStatistics{
+    uint64_t captured = 0;          // read backs issued
+    uint64_t written = 0;           // files written
+    uint64_t failed = 0;            // files that could not be written
+    uint64_t dropped = 0;           // captures with every buffer busy
+    double readMiliseconds = 0.0;   // spent in the read back calls
+    double maxReadMiliseconds = 0.0;
+    double writeMiliseconds = 0.0;  // spent by the writer thread
+};
+
+class FrameCapture{
+
+public:
+
+    FrameCapture(unsigned int numberOfBuffers = 3);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // read the back buffer into a free buffer, written to fileName later - false if all are busy
+    bool Capture(const std::string& fileName, unsigned int width, unsigned int height);
+
+    // hand the finished read backs to the writer, free the buffers it has copied
+    void Update();
+
+    // wait until every capture is written
+    void Flush();
+
+    // buffers with a capture the writer has not copied yet
+    unsigned int GetPending() const;
+
+    FrameCaptureStatistics GetStatistics() const;
+
+private:
+
+    enum BufferState : uint8_t{
+        BUFFER_FREE,
+        BUFFER_READING,             // read back issued, waiting for its fence
+        BUFFER_WRITING              // with the writer thread
+    };
+
+    struct CaptureBuffer{
+        GLuint bufferID = 0;
+        size_t size = 0;
+        uint8_t* pointer = nullptr;     // persistent mapping
+        bool mapped = false;            // mapped for the writer
+        BufferState state = BUFFER_FREE;
+        GLsync fence = nullptr;
+        std::string fileName;
+        unsigned int width = 0;
+        unsigned int height = 0;
+    };
+
+    // frame for the writer thread
+    struct WriteJob{
+        unsigned int buffer = 0;
+        const uint8_t* data = nullptr;
+        std::string fileName;
+        unsigned int width = 0;
+        unsigned int height = 0;
+    };
+
+    void Create(CaptureBuffer& buffer, size_t size);
+    void Destroy(CaptureBuffer& buffer);
+
+    void Unmap(CaptureBuffer& buffer);
+
+    // free the buffers the writer has copied
+    void Collect();
+
+    void WriterLoop();
+
+private:
+
+    std::vector<CaptureBuffer> buffers;
+    unsigned int nextBuffer = 0;
+    bool persistent = false;
+
+    FrameCaptureStatistics statistics;
+
+    // frames waiting for the writer and the buffers it has copied
+    std::deque<WriteJob> queue;
+    std::vector<unsigned int> written;
+    bool writing = false;               // the writer has a frame
+    uint64_t files = 0;
+    uint64_t failed = 0;
+    double writeMiliseconds = 0.0;
+
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::condition_variable done;
+    std::thread writer;
+    bool stop = false;
+
+};
+
+
+#endif
@@ -0,0 +1,76 @@
+/** @file FrameTimer.hpp
+ *  @brief Fixed-timestep accumulator and precise frame limiter
+ *
+ *  The simulation (camera movement) is advanced in fixed ticks that are
+ *  independent of the frame rate. The remaining time in the accumulator
+ *  gives the interpolation factor between the last two simulation states
+ *  for rendering. The frame limiter sleeps with SDL_Delay and spins on the
+ *  performance counter for the last milliseconds.
+ *
+ *  Usage:
+ *      timer.BeginFrame();
+ *      while (timer.ConsumeTick()){ Update(timer.GetTickTime()); }
+ *      Render(timer.GetAlpha());
+ *      timer.LimitFrameRate(60);
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef FRAMETIMER_HPP
+#define FRAMETIMER_HPP
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#else // This works for Mac
+    #include <SDL.h>
+#endif
+
+class FrameTimer{
+
+public:
+
+    FrameTimer(double tickRate);
+    ~FrameTimer();
+
+    // measure the time of the last frame and add it to the accumulator
+    void BeginFrame();
+
+    // true if a simulation tick should be executed (removes it from the accumulator)
+    bool ConsumeTick();
+
+    // interpolation factor between the previous and the current simulation state
+    float GetAlpha() const;
+
+    // length of one simulation tick in seconds
+    float GetTickTime() const;
+
+    // real time of the last frame in seconds
+    double GetFrameDelta() const;
+
+    // wait until 1 / framesPerSecond passed since BeginFrame (0 = unlimited)
+    void LimitFrameRate(unsigned int framesPerSecond) const;
+
+    // seconds from an arbitrary point, based on the performance counter
+    static double Now();
+
+    // sleep until the given time (Now() based)
+    static void SleepUntil(double time);
+
+public:
+
+    // maximal frame time that is simulated - avoids a spiral of death after a hitch
+    double maxFrameDelta = 0.25;
+
+private:
+
+    double tickTime;
+    double accumulator = 0.0;
+    double frameStart = 0.0;
+    double frameDelta = 0.0;
+    bool started = false;
+
+};
+
+
+#endif
@@ -0,0 +1,90 @@
+/** @file GBuffer.hpp
+ *  @brief Geometry buffer of the deferred render path
+ *
+ *  In the deferred path the objects are drawn with the GBUFFER variant of
+ *  their shaders: the parallax search runs there, but instead of lighting
+ *  the fragment they write the surface into a compact G-buffer (20 bytes
+ *  per pixel):
+ *
+ *      albedo      RGBA8     diffuse texture at the displaced coordinates
+ *      normal      RGBA16F   xy = octahedral world normal,
+ *                            z = parallax depth (distance along the view ray
+ *                            below the drawn surface)
+ *      draw        R32UI     per-draw record (material, key light)
+ *      depth       DEPTH24   depth of the drawn surface
+ *
+ *  A fullscreen pass then lights every pixel once (key light and the local
+ *  lights of its cluster) into the default framebuffer and writes the depth
+ *  for the draws that follow (lights, skybox).
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef GBUFFER_HPP
+#define GBUFFER_HPP
+
+#include <glad/glad.h>
+
+// glm lib
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "Shader.hpp"
+#include "RenderQueue.hpp"
+
+// which pipeline shades the objects
+enum RenderPath{
+    RENDER_FORWARD = 0,     // objects are lit while they are drawn
+    RENDER_DEFERRED = 1     // G-buffer, then one lighting pass
+};
+
+class GBuffer{
+
+public:
+
+    // no GL calls - the targets are created on the first geometry pass
+    GBuffer();
+    ~GBuffer();
+
+    // bind and clear the G-buffer (resized to the screen if needed)
+    void BeginGeometryPass(int screenWidth, int screenHeight);
+
+    // back to the default framebuffer
+    void EndGeometryPass();
+
+    // light every pixel of the G-buffer into the bound framebuffer
+    // (the per-draw records and the light buffers have to be bound)
+    void LightingPass(const FrameContext& context);
+
+    int GetWidth() const;
+    int GetHeight() const;
+
+    // memory of the targets
+    unsigned int GetBytesPerPixel() const;
+
+private:
+
+    // (re)create the targets for a new screen size
+    void Resize(int screenWidth, int screenHeight);
+
+private:
+
+    Shader* lightingShader = nullptr;
+
+    GLuint framebuffer = 0;
+    GLuint albedoTexture = 0;
+    GLuint normalTexture = 0;
+    GLuint drawTexture = 0;
+    GLuint depthTexture = 0;
+
+    // the fullscreen triangle is generated from gl_VertexID
+    GLuint emptyVAO = 0;
+
+    int width = 0;
+    int height = 0;
+
+};
+
+
+#endif
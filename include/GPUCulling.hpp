@@ -0,0 +1,122 @@
+/** @file GPUCulling.hpp
+ *  @brief Compute shader culling that writes the indirect draw commands
+ *
+ *  comp_Cull.glsl tests the bounding sphere of every draw slot against the
+ *  frustum and (optionally) against the depth pyramid of the previous frame.
+ *  Meshlet slots also have a normal cone and are culled when all of their
+ *  triangles face away from the camera.
+ *  The visible draws are compacted to the start of their batch in the output
+ *  command buffer and counted per batch, the buffers are then consumed by
+ *  glMultiDrawElementsIndirect(Count) without a read back.
+ *
+ *  CullDraws is the CPU version of the shader. It reads and writes the same
+ *  structures, so it is used when compute shaders are not supported and it
+ *  can check the results of the shader without a GPU.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef GPUCULLING_HPP
+#define GPUCULLING_HPP
+
+#include <glad/glad.h>
+
+// glm lib
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+
+// STL
+#include <vector>
+
+#include "GLExtensions.hpp"
+#include "RingBuffer.hpp"
+#include "Shader.hpp"
+#include "DepthPyramid.hpp"
+
+// shader interface of comp_Cull.glsl
+#define CULL_OBJECTS_BINDING 1
+#define CULL_COMMANDS_BINDING 2
+#define CULL_OUTPUT_BINDING 3
+#define CULL_COUNTS_BINDING 4
+#define CULL_PARAMETERS_BINDING 5
+
+// bounds of one draw slot (std430 layout of CullObject)
+struct CullObject{
+    glm::vec4 sphere = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);  // world space center, radius (negative = nothing to draw)
+    glm::vec4 cone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);     // world space axis, cutoff (>= 1 = no backface culling)
+    glm::uvec4 batch = glm::uvec4(0);                       // batch index, first slot of the batch, unused, unused
+};
+
+// values of the culling pass (std430 layout of CullParameters)
+struct CullParameters{
+    glm::mat4 occlusionViewProjection;  // frame of the depth pyramid
+    glm::vec4 frustumPlanes[6];
+    glm::vec4 pyramidSize;              // width, height, levels, unused
+    glm::uvec4 info;                    // number of draws, occlusion culling, unused, unused
+    glm::vec4 cameraPosition;           // xyz, unused (cone culling)
+};
+
+static_assert(sizeof(CullObject) == 48, "CullObject has to match the shader layout");
+static_assert(sizeof(CullParameters) == 208, "CullParameters has to match the shader layout");
+
+// depth pyramid on the CPU - level i is (width >> i) x (height >> i), row by row
+typedef std::vector<std::vector<float>> DepthLevels;
+
+
+class GPUCulling{
+
+public:
+
+    // no GL calls - the buffers are created on the first dispatch
+    GPUCulling();
+    ~GPUCulling();
+
+    // indirect commands of all slots (whenever the batches change, uploaded by the next dispatch)
+    void SetCommands(const std::vector<DrawElementsIndirectCommand>& commands, unsigned int numberOfBatches);
+
+    // cull the slots and write the output commands and counts (GL thread)
+    void Dispatch(const std::vector<CullObject>& objects, const CullParameters& parameters);
+
+    // depth of the drawn frame for the occlusion culling of the next one
+    void BuildDepthPyramid(const glm::mat4& viewProjection);
+
+    // set the pyramid part of the parameters (occlusion is disabled without a valid pyramid)
+    void SetOcclusionParameters(CullParameters& parameters, bool occlusion) const;
+
+    GLuint GetCommandBuffer() const;
+    GLuint GetCountBuffer() const;
+
+    // CPU version of comp_Cull.glsl (drawCounts has one entry per batch)
+    static void CullDraws(const std::vector<CullObject>& objects,
+                          const std::vector<DrawElementsIndirectCommand>& staticCommands,
+                          const CullParameters& parameters, const DepthLevels& pyramid,
+                          std::vector<DrawElementsIndirectCommand>& outputCommands,
+                          std::vector<GLuint>& drawCounts);
+
+    static bool IsSphereVisible(const CullParameters& parameters, const glm::vec4& sphere);
+    static bool IsConeBackfacing(const CullParameters& parameters, const glm::vec4& sphere, const glm::vec4& cone);
+    static bool IsSphereOccluded(const CullParameters& parameters, const glm::vec4& sphere, const DepthLevels& pyramid);
+
+private:
+
+    Shader* cullShader = nullptr;
+
+    GLuint commandBuffer = 0;     // static commands, one per slot
+    GLuint outputBuffer = 0;      // compacted commands of the frame
+    GLuint countBuffer = 0;       // visible draws per batch
+    GLuint parameterBuffer = 0;
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    unsigned int numberOfBatches = 0;
+    bool dirty = false;
+
+    // bounds of the slots - written every frame
+    RingBuffer* objectBuffer = nullptr;
+
+    DepthPyramid pyramid;
+
+};
+
+
+#endif
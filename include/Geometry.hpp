@@ -26,6 +26,17 @@ Object * CreatePlane(const std::string& vertexShaderPath, const std::string& fra
                      const std::string& texturePath, const std::string& normalMapPath, 
                      const std::string& heightMapPath, bool inverseH, int continousTexture);
 
+// vertices and indices of the plane (no GL calls)
+void CreatePlaneMesh(std::vector<GLfloat>& data, std::vector<GLuint>& indices);
+
+// vertices and indices of a bumpy torus of resolution x resolution quads (no GL calls)
+void CreateTorusMesh(unsigned int resolution, std::vector<GLfloat>& data, std::vector<GLuint>& indices);
+
+// create plane without textures (drawn with a layer of a MaterialArray)
+Object * CreatePlane(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+                     const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale,
+                     int continousTexture);
+
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,62 @@
+/** @file HeightMap.hpp
+ *  @brief Conversion of loaded height maps to one channel textures
+ *
+ *  The first channel of an 8 bit image with 1..4 channels is extracted to
+ *  R8 or R16 and remapped on the way: the range of the source is optionally
+ *  stretched to the full range (normalize), inverted (255 - height, the
+ *  depth maps of the parallax shaders) and mapped to [rangeMin, rangeMax].
+ *
+ *  Every row is extracted and converted with SSE2 (16 texels per step) or
+ *  AVX2 (the widest set the CPU supports, chosen at run time), the rows
+ *  are split between the threads of the job system. All instruction sets
+ *  give the same texels as the scalar code (the remap is computed in float
+ *  and rounded to nearest).
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef HEIGHTMAP_HPP
+#define HEIGHTMAP_HPP
+
+// STL
+#include <vector>
+#include <cstdint>
+
+#include "JobSystem.hpp"
+
+enum SimdLevel{
+    SIMD_SCALAR = 0,
+    SIMD_SSE2 = 1,
+    SIMD_AVX2 = 2
+};
+
+struct HeightMapOptions{
+    bool invert = false;        // 1 - height (after the normalization)
+    bool normalize = false;     // stretch the minimum and maximum of the source to [0, 1]
+    float rangeMin = 0.0f;      // output of the height 0 and 1 (as a part of the output range)
+    float rangeMax = 1.0f;
+};
+
+class HeightMapProcessor{
+
+public:
+
+    // first channel of the pixels as R8 / R16 texels (jobSystem may be null, level is clamped to the CPU)
+    static std::vector<uint8_t> ConvertR8(const uint8_t* pixels, unsigned int width, unsigned int height,
+                                          unsigned int channels, const HeightMapOptions& options,
+                                          JobSystem* jobSystem, SimdLevel level = SIMD_AVX2);
+
+    static std::vector<uint16_t> ConvertR16(const uint8_t* pixels, unsigned int width, unsigned int height,
+                                            unsigned int channels, const HeightMapOptions& options,
+                                            JobSystem* jobSystem, SimdLevel level = SIMD_AVX2);
+
+    // widest instruction set of the CPU
+    static SimdLevel GetSupportedLevel();
+
+    static const char* GetLevelName(SimdLevel level);
+
+};
+
+
+#endif
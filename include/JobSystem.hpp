@@ -0,0 +1,80 @@
+/** @file JobSystem.hpp
+ *  @brief Work-stealing job system for the CPU side of the frame
+ *
+ *  Every thread (the main thread has index 0) owns a queue of jobs. A thread
+ *  takes the newest job from its own queue and steals the oldest job from
+ *  the other queues when it runs out of work. The main thread works on the
+ *  jobs while it waits for a ParallelFor to finish.
+ *
+ *  The jobs must not call GL functions - the context is bound only to the
+ *  main thread. ParallelFor must not be nested.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+// STL
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// function(begin, end, threadIndex) processing the range [begin, end)
+typedef std::function<void(unsigned int, unsigned int, unsigned int)> JobFunction;
+
+class JobSystem{
+
+public:
+
+    // 0 = one thread per core
+    JobSystem(unsigned int numberOfThreads = 0);
+    ~JobSystem();
+
+    // split [0, count) into groups of groupSize and run them on all threads, blocks until done
+    void ParallelFor(unsigned int count, unsigned int groupSize, const JobFunction& function);
+
+    // number of threads including the main thread
+    unsigned int GetNumberOfThreads() const;
+
+private:
+
+    struct Job{
+        const JobFunction* function = nullptr;
+        unsigned int begin = 0;
+        unsigned int end = 0;
+        std::atomic<unsigned int>* counter = nullptr;
+    };
+
+    struct WorkQueue{
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // own queue first (newest job), then steal from the others (oldest job)
+    bool PopJob(unsigned int threadIndex, Job& job);
+
+    void RunJob(const Job& job, unsigned int threadIndex);
+
+    void WorkerLoop(unsigned int threadIndex);
+
+private:
+
+    std::vector<std::thread> workers;
+    std::vector<WorkQueue*> queues;     // one per thread, 0 = main thread
+
+    // sleeping workers
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<unsigned int> queuedJobs;
+    bool quit = false;
+
+};
+
+
+#endif
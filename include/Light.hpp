@@ -29,6 +29,10 @@ public:
     float diffusionStrengh = 1.0f;
     float specularStrengh = 0.5f;
 
+    // range of a local light (binned into the light clusters), 0 = key light without attenuation
+    float radius = 0.0f;
+    float intensity = 1.0f;
+
 public:
 
     void virtual Draw(){ }; 
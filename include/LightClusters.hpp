@@ -0,0 +1,151 @@
+/** @file LightClusters.hpp
+ *  @brief Clustered forward shading - point lights binned into froxels
+ *
+ *  The view frustum is split into a grid of froxels: screen tiles of
+ *  tileSize x tileSize pixels and depth slices that grow exponentially with
+ *  the distance (every slice covers the same ratio far / near). Every frame
+ *  the lights with a range are binned on the CPU into the froxels their
+ *  sphere touches and the fragment shaders loop only over the lights of the
+ *  froxel of the fragment.
+ *
+ *  The lights are stored in an SSBO (binding LIGHT_BINDING, PointLightData),
+ *  the clusters in a second one (binding CLUSTER_BINDING): a header with the
+ *  grid, then one (first index, count) pair per cluster followed by the light
+ *  indices of all clusters.
+ *
+ *  Lights with the radius 0 are the key lights of the objects (usedLight):
+ *  they light every fragment of their objects without attenuation and are
+ *  not binned.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef LIGHTCLUSTERS_HPP
+#define LIGHTCLUSTERS_HPP
+
+#include <glad/glad.h>
+
+// glm lib
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+
+// STL
+#include <vector>
+#include <cstdint>
+
+#include "RingBuffer.hpp"
+#include "RenderQueue.hpp"
+#include "JobSystem.hpp"
+
+// shader interface of the lights and clusters
+#define LIGHT_BINDING 6
+#define CLUSTER_BINDING 7
+
+// one point light (std430 layout of PointLightData in the shaders)
+struct PointLightData{
+    glm::vec4 positionRadius;   // world position, range (0 = key light without attenuation)
+    glm::vec4 color;            // rgb, w = intensity
+};
+
+// grid of the clusters (std430 header of the cluster buffer)
+struct LightClusterHeader{
+    glm::vec4 depth;            // near, far, slice scale, slice bias (slice = log(depth) * scale + bias)
+    glm::uvec4 grid;            // tiles x, tiles y, slices, tile size in pixels
+};
+
+static_assert(sizeof(PointLightData) == 32, "PointLightData has to match the shader layout");
+static_assert(sizeof(LightClusterHeader) == 32, "LightClusterHeader has to match the shader layout");
+
+struct LightClusterStatistics{
+    unsigned int lights = 0;            // lights with a range
+    unsigned int visibleLights = 0;     // binned into at least one cluster
+    unsigned int usedClusters = 0;      // clusters with at least one light
+    unsigned int maxLights = 0;         // most lights in one cluster
+    double averageLights = 0.0;         // per used cluster
+    double buildMiliseconds = 0.0;      // CPU time of the binning
+};
+
+
+class LightClusters{
+
+public:
+
+    // no GL calls - the buffers are created on the first upload
+    LightClusters();
+    ~LightClusters();
+
+    // bin the lights into the clusters of the frame (CPU only, jobSystem may be null)
+    void Build(const std::vector<PointLightData>& lights, const FrameContext& context,
+               int screenWidth, int screenHeight, JobSystem* jobSystem);
+
+    // copy the lights and clusters of the frame to the GPU (GL thread)
+    void Upload(const std::vector<PointLightData>& lights);
+
+    // bind both buffers for the draws
+    void Bind() const;
+
+    // fence the buffers after the draws that read them
+    void EndFrame();
+
+    // cluster of a view space depth and a pixel (the lookup of the shaders)
+    unsigned int GetCluster(float depth, float x, float y) const;
+
+    // light indices of a cluster (for tests and statistics)
+    unsigned int GetNumberOfLights(unsigned int cluster) const;
+    const uint32_t* GetLights(unsigned int cluster) const;
+
+    unsigned int GetNumberOfClusters() const;
+    const LightClusterStatistics& GetStatistics() const;
+
+public:
+
+    // false = one cluster with every light (plain forward shading, for comparison)
+    bool enabled = true;
+
+    // froxel grid
+    unsigned int tileSize = 64;     // pixels
+    unsigned int slices = 24;
+
+private:
+
+    // first and last slice of a light, -1 if it is outside the frustum
+    struct LightRange{
+        int firstSlice = -1;
+        int lastSlice = -1;
+        glm::vec3 viewCenter;
+        float radius = 0.0f;
+    };
+
+    // slice of a view space depth
+    int GetSlice(float depth) const;
+
+    // inclusive tile range of a view space sphere clipped to the depths [nearDepth, farDepth]
+    bool GetTileRange(const glm::vec3& center, float radius, float nearDepth, float farDepth,
+                      glm::ivec2& minTile, glm::ivec2& maxTile) const;
+
+private:
+
+    LightClusterHeader header;
+    glm::mat4 projection = glm::mat4(1.0f);
+    int screenWidth = 1;
+    int screenHeight = 1;
+
+    // header is not part of the data - (first, count) pairs, then the light indices
+    std::vector<uint32_t> clusterData;
+
+    // per frame work arrays
+    std::vector<LightRange> ranges;
+    std::vector<std::vector<uint32_t>> sliceIndices;   // (tile, light) pairs of a slice, then its indices
+
+    RingBuffer* lightBuffer = nullptr;
+    RingBuffer* clusterBuffer = nullptr;
+    GLsizeiptr lightBytes = 0;
+    GLsizeiptr clusterBytes = 0;
+
+    LightClusterStatistics statistics;
+
+};
+
+
+#endif
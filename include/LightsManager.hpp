@@ -1,8 +1,9 @@
-
 /** @file LightsManager.hpp
  *  @brief Class for maintaining lights in the scene
  *  
- *  Class for maintaining lights in the scene.
+ *  Class for maintaining lights in the scene. Every frame the lights are
+ *  packed into an SSBO and the local ones (with a range) are binned into
+ *  the light clusters read by the fragment shaders.
  *
  *  @author Adam Bosak
  *  @bug No known bugs.
@@ -15,6 +16,7 @@
 #include "Light.hpp"
 #include "PointLight.hpp"
 #include "Shader.hpp"
+#include "LightClusters.hpp"
 
 class LightsManager{
 
@@ -27,7 +29,27 @@ public:
 
     void AddLight(Light *light);
 
-    void UploadLightsToPipeline(Shader* shaderProgram);
+    // move the animated lights (fixed time step of the simulation)
+    void Animate(float deltaTime);
+
+    // the lights back to their positions when they were added (the next benchmark run)
+    void ResetAnimation();
+
+    // pack the lights of the frame, bin them into the clusters and upload both (GL thread)
+    void Update(const FrameContext& context, int screenWidth, int screenHeight, JobSystem* jobSystem);
+
+    // bind the light and cluster buffers for the draws
+    void BindLights() const;
+
+    // after the draws that read the lights of the frame
+    void EndFrame();
+
+    unsigned int GetNumberOfLights() const;
+
+    // binning of the last frame
+    const LightClusterStatistics& GetStatistics() const;
+
+    LightClusters& GetClusters();
     
 private:
     
@@ -40,9 +62,15 @@ private:
 private: 
 
     std::vector<Light *> lights;
+    std::vector<glm::vec3> startPositions;     // position of every light when it was added
+
+    // shader data of the lights (index = order of AddLight, the usedLight of the objects)
+    std::vector<PointLightData> lightData;
+
+    LightClusters clusters;
 
 };
 
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,97 @@
+/** @file MaterialTable.hpp
+ *  @brief Texture handles of the materials in a storage buffer (bindless textures)
+ *
+ *  Without bindless textures every material binds its textures to the
+ *  units 0-2, so the objects with different textures are separate batches
+ *  and draw calls. With ARB_bindless_texture each texture has a resident
+ *  64-bit handle and the handles of all materials are in one storage
+ *  buffer. The shaders (BINDLESS variant) read the handles of the material
+ *  of the draw (Kd.w of the per-draw record), so the objects of a shader
+ *  are one batch whatever textures they use.
+ *
+ *  A material is the diffuse, normal and height texture of an object, or
+ *  the three arrays of a MaterialArray. The objects with the same textures
+ *  share it. The handles are checked every frame - a streamed texture gets
+ *  a new one when the streamer reallocates it - and the buffer is uploaded
+ *  again if any changed.
+ *
+ *  Usage:
+ *      uint32_t material = table.Add(diffuse, normal, height);    // when the textures are loaded
+ *      table.Update();                     // every frame before the draws
+ *      table.Bind();                       // with the shader
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef MATERIALTABLE_HPP
+#define MATERIALTABLE_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+#include <cstdint>
+
+#include "Texture.hpp"
+#include "TextureArray.hpp"
+
+// handles of a material (MaterialTextures in the shaders), 0 = the material has no such texture
+struct MaterialTextures{
+    GLuint64 diffuse = 0;
+    GLuint64 normal = 0;
+    GLuint64 height = 0;
+    GLuint64 unused = 0;
+};
+
+static_assert(sizeof(MaterialTextures) == 32, "MaterialTextures has to match the shader layout");
+
+class MaterialTable{
+
+public:
+
+    MaterialTable();
+    ~MaterialTable();
+
+    MaterialTable(const MaterialTable&) = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+
+    // index of the material of the textures (null = none), the same textures get the same index
+    uint32_t Add(Texture* diffuse, Texture* normal, Texture* height);
+
+    // index of the material of the arrays (the layer is chosen by the per-draw record)
+    uint32_t Add(MaterialArray* array);
+
+    // handles of the textures, upload the buffer if any of them changed
+    void Update();
+
+    // bind the buffer to materialBinding
+    void Bind() const;
+
+    unsigned int GetNumberOfMaterials() const;
+
+    // true if the scene asks for bindless textures and the context supports them
+    static bool IsSupported();
+
+    static const unsigned int materialBinding = 9;
+
+private:
+
+    // textures of a material - either the textures or the arrays
+    struct Material{
+        Texture* textures[3] = {nullptr, nullptr, nullptr};
+        TextureArray* arrays[3] = {nullptr, nullptr, nullptr};
+    };
+
+private:
+
+    std::vector<Material> materials;
+    std::vector<MaterialTextures> handles;
+
+    GLuint bufferID = 0;
+    size_t bufferSize = 0;
+
+};
+
+
+#endif
@@ -0,0 +1,116 @@
+/** @file MeshBuffer.hpp
+ *  @brief One VBO / EBO shared by all static meshes
+ *
+ *  All meshes with the stride 14 vertex layout (position, normal, texture
+ *  coordinates, tangent, bitangent) are packed into one vertex buffer and
+ *  one index buffer. A mesh is addressed by its first index and base vertex,
+ *  so any number of meshes can be drawn with one VAO bind and one
+ *  multi-draw call.
+ *
+ *  The indices are relative to the base vertex, so every mesh with at most
+ *  65536 vertices stores them as 16 bit values. The index buffer mixes both
+ *  types; every mesh starts at a 4 byte boundary and records its type.
+ *
+ *  In the packed format every vertex is encoded into a PackedVertex (20
+ *  bytes instead of 56): quantized position, octahedral normal and tangent,
+ *  half float texture coordinates and the sign of the bitangent. The
+ *  positions are dequantized by the model matrix (MeshRange::quantization)
+ *  and the shaders decode the rest when compiled with PACKED_VERTICES.
+ *
+ *  The draw ID (attribute DRAW_ID_LOCATION) is either an instanced attribute
+ *  read from an identity buffer - the baseInstance of an indirect command
+ *  selects the per-draw record - or a constant attribute set per draw.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef MESHBUFFER_HPP
+#define MESHBUFFER_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+#include <string>
+
+#include "ObjectParser.hpp"
+
+// part of the shared buffers that belongs to one mesh
+struct MeshRange{
+    GLuint firstIndex = 0;              // in units of the index type
+    GLuint indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLint baseVertex = 0;
+    PositionQuantization quantization;  // identity in the float format
+};
+
+class MeshBuffer{
+
+public:
+
+    // no GL calls - the buffers are created on the first bind
+    MeshBuffer();
+    ~MeshBuffer();
+
+    // packed vertices - has to be set before the first mesh is added
+    void SetPacked(bool packed);
+    bool IsPacked() const;
+
+    // shader defines of the vertex format
+    std::string GetShaderDefines() const;
+
+    // append a mesh (interleaved stride 14 vertices, indices relative to the mesh)
+    MeshRange AddMesh(const std::vector<GLfloat>& data, const std::vector<GLuint>& indices);
+
+    // append other indices of the vertices of a mesh (level of detail) - same type and base vertex
+    MeshRange AddIndices(const MeshRange& mesh, const std::vector<GLuint>& indices);
+
+    // bind the VAO (uploads new meshes). instancedDrawID = draw ID from the baseInstance
+    void Bind(bool instancedDrawID, unsigned int numberOfDraws);
+    void Unbind();
+
+    unsigned int GetNumberOfVertices() const;
+    unsigned int GetNumberOfIndices() const;
+
+    // size of the vertex / index buffer on the GPU
+    size_t GetVertexBytes() const;
+    size_t GetIndexBytes() const;
+
+    // meshes with 16 bit indices
+    unsigned int GetNumberOfShortIndexMeshes() const;
+    unsigned int GetNumberOfMeshes() const;
+
+private:
+
+    void Upload();
+
+    // append the indices with the type (4 byte aligned), returns the first index in units of the type
+    GLuint AppendIndices(const std::vector<GLuint>& indices, GLenum indexType);
+
+private:
+
+    static const unsigned int stride = 14;
+
+    // CPU copy - the buffers are uploaded again when a mesh is added later
+    std::vector<GLfloat> vertices;
+    std::vector<PackedVertex> packedVertices;
+    std::vector<uint8_t> indexData;     // GLushort / GLuint indices of the meshes
+    unsigned int numberOfIndices = 0;
+    unsigned int numberOfMeshes = 0;
+    unsigned int numberOfShortMeshes = 0;
+    bool dirty = false;
+    bool packed = false;
+
+    GLuint VertexArrayObject = 0;
+    GLuint VertexBufferObject = 0;
+    GLuint ElementBufferObject = 0;
+
+    // 0, 1, 2, ... read with divisor 1
+    GLuint DrawIDBufferObject = 0;
+    unsigned int drawIDCapacity = 0;
+
+};
+
+
+#endif
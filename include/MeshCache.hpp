@@ -0,0 +1,49 @@
+/** @file MeshCache.hpp
+ *  @brief Binary cache of parsed and optimized meshes
+ *
+ *  Parsing an .obj file, optimizing the mesh and simplifying its levels of
+ *  detail is done once; the result (stride 14 vertices, indices, the path
+ *  of the material and the index lists and errors of the levels of detail)
+ *  is stored in a binary file next to the source (<file>.meshcache). The cache is
+ *  rebuilt when the source file changes (size or modification time) or
+ *  when the format version changes.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "MeshSimplifier.hpp"
+
+class MeshCache{
+
+public:
+
+    // false when there is no valid cache for the source file
+    static bool Load(const std::string& sourcePath, std::vector<GLfloat>& data,
+                     std::vector<GLuint>& indices, std::string& materialPath, std::vector<MeshLod>& lods);
+
+    static bool Save(const std::string& sourcePath, const std::vector<GLfloat>& data,
+                     const std::vector<GLuint>& indices, const std::string& materialPath,
+                     const std::vector<MeshLod>& lods);
+
+    static std::string GetCachePath(const std::string& sourcePath);
+
+private:
+
+    // bump when the stored data or the optimizer changes
+    static const uint32_t version = 2;
+
+};
+
+
+#endif
@@ -0,0 +1,64 @@
+/** @file MeshOptimizer.hpp
+ *  @brief Reorders the triangles and vertices of a mesh for the GPU
+ *
+ *  Runs after a mesh is parsed (the result is stored in the MeshCache):
+ *      1. vertex cache optimization - greedy triangle order of Tom Forsyth
+ *         ("Linear-Speed Vertex Cache Optimisation")
+ *      2. overdraw optimization - the cache friendly order is split into
+ *         clusters that are sorted to draw the outward facing ones first
+ *         (Sander, Nehab, Barczak "Fast Triangle Reordering for Vertex
+ *         Locality and Reduced Overdraw")
+ *      3. vertex fetch optimization - vertices renumbered in the order of
+ *         their first use
+ *
+ *  The effect is measured with a FIFO post-transform cache simulator
+ *  (ACMR = transformed vertices per triangle, ATVR = transformed vertices
+ *  per vertex), so it can be checked without a GPU.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+
+struct VertexCacheStatistics{
+    float acmr = 0.0f;      // average cache miss ratio (0.5 is the best possible on a regular grid, 3 the worst)
+    float atvr = 0.0f;      // average transformed vertex ratio (1 is the best possible)
+};
+
+class MeshOptimizer{
+
+public:
+
+    // all three passes on stride 14 vertex data, returns the cache statistics before and after
+    static void Optimize(std::vector<GLfloat>& data, std::vector<GLuint>& indices,
+                         VertexCacheStatistics* before = nullptr, VertexCacheStatistics* after = nullptr);
+
+    // reorder the triangles for the post-transform cache
+    static void OptimizeVertexCache(std::vector<GLuint>& indices, unsigned int numberOfVertices);
+
+    // reorder clusters of triangles to reduce the overdraw (threshold = allowed ACMR increase)
+    static void OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<GLfloat>& data,
+                                 unsigned int stride, float threshold = 1.05f);
+
+    // renumber the vertices in the order of their first use (unused vertices are removed)
+    static void OptimizeVertexFetch(std::vector<GLfloat>& data, std::vector<GLuint>& indices, unsigned int stride);
+
+    // simulate a FIFO cache of the given size
+    static VertexCacheStatistics AnalyzeVertexCache(const std::vector<GLuint>& indices, unsigned int numberOfVertices,
+                                                    unsigned int cacheSize = 16);
+
+public:
+
+    static const unsigned int stride = 14;
+
+};
+
+
+#endif
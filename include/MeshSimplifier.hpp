@@ -0,0 +1,62 @@
+/** @file MeshSimplifier.hpp
+ *  @brief Levels of detail by quadric error edge collapses
+ *
+ *  Simplifies the indices of a parsed mesh (stride 14 vertices) with the
+ *  quadric error metric of Garland and Heckbert. An edge is collapsed into
+ *  one of its end points, so the vertices are never modified and every
+ *  level of detail reuses the vertex buffer of the mesh - the texture
+ *  coordinates and tangent frames stay exact.
+ *
+ *  The topology is built on the positions (vertices split by UV seams or
+ *  hard normals are welded). A collapse moves every vertex of the removed
+ *  position to a vertex of the kept position that shares a triangle with
+ *  it, so the attributes come from the same side of a seam. Border and seam
+ *  edges are kept in place by extra quadrics and their vertices only move
+ *  along them; seam junctions are locked.
+ *
+ *  Every pass collapses the cheapest edges whose neighbourhoods do not
+ *  overlap. The levels of a chain are independent (each one starts from
+ *  the full mesh) and are simplified in parallel on the job system.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+
+#include "JobSystem.hpp"
+
+// one level of detail - indices into the vertices of the full mesh
+struct MeshLod{
+    std::vector<GLuint> indices;
+    float error = 0.0f;     // object space distance to the full mesh (estimated by the quadrics)
+};
+
+class MeshSimplifier{
+
+public:
+
+    // collapse edges until at most targetIndexCount indices are left, returns the error of the result
+    static float Simplify(const std::vector<GLfloat>& data, const std::vector<GLuint>& indices,
+                          unsigned int targetIndexCount, std::vector<GLuint>& result);
+
+    // levels with 1/2, 1/4, ... of the triangles, stops when the mesh can not be reduced further
+    // (jobSystem may be null)
+    static std::vector<MeshLod> BuildLods(const std::vector<GLfloat>& data, const std::vector<GLuint>& indices,
+                                          unsigned int maxLevels, JobSystem* jobSystem);
+
+public:
+
+    static const unsigned int stride = 14;
+    static const unsigned int defaultLevels = 4;
+
+};
+
+
+#endif
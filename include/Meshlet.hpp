@@ -0,0 +1,63 @@
+/** @file Meshlet.hpp
+ *  @brief Small clusters of triangles that are culled separately
+ *
+ *  A meshlet is a cluster of connected triangles with at most maxVertices
+ *  unique vertices and maxTriangles triangles. It grows from the first free
+ *  triangle of the vertex cache order by the neighbour that adds the fewest
+ *  vertices and keeps the normals closest, and the triangles are reordered
+ *  so that every meshlet is a contiguous range of the index buffer drawn by
+ *  its own indirect command. Every meshlet has a bounding sphere (frustum culling)
+ *  and a normal cone (backface culling of the whole cluster).
+ *
+ *  Backface test of the cone (bounding sphere variant of meshoptimizer):
+ *      dot(center - camera, axis) >= cutoff * length(center - camera) + radius
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef MESHLET_HPP
+#define MESHLET_HPP
+
+#include <glad/glad.h>
+
+// glm lib
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+
+// STL
+#include <vector>
+
+struct Meshlet{
+    GLuint firstIndex = 0;              // relative to the first index of the mesh
+    GLuint indexCount = 0;
+    glm::vec3 center = glm::vec3(0.0f); // bounding sphere (object space)
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f;            // >= 1 = the cone is too wide, never culled
+};
+
+class MeshletBuilder{
+
+public:
+
+    // split a stride 14 mesh into meshlets - reorders the triangles (indices)
+    static std::vector<Meshlet> Build(const std::vector<GLfloat>& data, std::vector<GLuint>& indices,
+                                      unsigned int maxVertices = 64, unsigned int maxTriangles = 124);
+
+    // true if all triangles of the cone face away from the camera
+    static bool IsBackfacing(const glm::vec3& center, float radius, const glm::vec3& coneAxis, float coneCutoff,
+                             const glm::vec3& cameraPosition);
+
+    // world space sphere (center, radius) and cone (axis, cutoff) - the cone is kept only for uniform scale
+    static void Transform(const Meshlet& meshlet, const glm::mat4& model, float maxScale, bool uniformScale,
+                          glm::vec4& sphere, glm::vec4& cone);
+
+public:
+
+    static const unsigned int stride = 14;
+
+};
+
+
+#endif
@@ -31,12 +31,29 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <memory>
 
 // our libraries
 #include <Camera.hpp>
 #include "PointLight.hpp"
 #include "Shader.hpp"
 #include "Texture.hpp"
+#include "TextureArray.hpp"
+#include "RenderQueue.hpp"
+#include "MeshBuffer.hpp"
+#include "Meshlet.hpp"
+#include "GLExtensions.hpp"
+
+// texture files of a material (a layer of a MaterialArray)
+class VirtualTexture;
+class MaterialTable;
+
+struct MaterialFiles{
+    std::string diffuse;
+    std::string normal;
+    std::string height;
+    bool inverseH = true;
+};
 
 
 class Object{
@@ -46,14 +63,53 @@ public:
     // constructor
     Object(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
 
+    // CPU only object without GL resources (used by the scaling benchmark)
+    Object();
+
     // destructor
     ~Object();
 
-    // draw object
-    void Draw();
+    // CPU part of the draw - thread safe, no GL calls. Returns false if the object is culled
+    bool Prepare(const FrameContext& context, DrawCommand& command, bool cull = true) const;
+
+    // bind shader (its G-buffer variant in the G-buffer pass) and textures -
+    // bindPipeline also uploads the uniforms shared by the frame
+    void BindMaterial(const FrameContext& context, bool bindPipeline);
+
+    // bounds (and visibility if cull) of the indirect commands of a prepared object - thread safe.
+    // Returns the number of visible commands
+    unsigned int PrepareDraws(const FrameContext& context, const DrawCommand& command,
+                              CullObject* bounds, uint8_t* visibility, bool cull) const;
+
+    // GL part of the draw from the bound mesh buffer - the per-draw data is read from the record drawID
+    // (visibility of the meshlets, null = all)
+    void Submit(unsigned int drawID, const uint8_t* visibility = nullptr);
+
+    // indirect commands of the mesh (one per meshlet), drawID is passed as the baseInstance
+    void GetIndirectCommands(unsigned int drawID, std::vector<DrawElementsIndirectCommand>& commands) const;
+
+    // number of indirect commands (meshlets or the whole mesh, then one per coarser level of detail)
+    unsigned int GetNumberOfDraws() const;
+    unsigned int GetNumberOfMeshlets() const;
+    unsigned int GetNumberOfLods() const;
+
+    // level of detail whose error stays below the allowed pixels at the distance of bounds (0 = full mesh)
+    unsigned int SelectLod(const FrameContext& context, const glm::vec4& bounds) const;
 
-    // set up pipeline
-    void SetUpPipeline();
+    // parallax method and layer budget (0 = unlimited) from the screen height of the displacement at bounds
+    int SelectParallaxMethod(const FrameContext& context, const glm::vec4& bounds, int& layerBudget) const;
+
+    // ask the texture streamer for the levels of the textures covering pixels on the screen
+    void RequestTextures(float pixels) const;
+
+    // true if both objects are drawn with the same shader program
+    bool SharesPipeline(const Object& other) const;
+
+    // objects with the same key share shader and textures - drawn by one multi-draw call
+    uint64_t GetBatchKey() const;
+
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT - a multi-draw call needs one type
+    GLenum GetIndexType() const;
 
     // load data from obj file
     void LoadData_WavefrontOBJ(unsigned int objNumber, std::string filePath);
@@ -64,12 +120,26 @@ public:
     // load texture
     void LoadTexture(const std::string& texturePath, unsigned int textureType, bool inverseH = true);
 
+    // load the normal and the height map - packed into one texture if the scene packs the materials
+    void LoadMaterial(const std::string& normalPath, const std::string& heightPath, bool inverseH);
+
+    // texture arrays with one layer per material, null if the textures differ in size or format
+    static std::shared_ptr<MaterialArray> LoadMaterialArray(const std::vector<MaterialFiles>& materials);
+
+    // draw with a layer of the material arrays instead of the own textures (shaders with MATERIAL_ARRAY)
+    void SetMaterialArray(const std::shared_ptr<MaterialArray>& materials, unsigned int layer);
+
+    // draw with the pages of a virtual texture instead of the own textures (shaders with VIRTUAL_TEXTURE)
+    void SetVirtualTexture(VirtualTexture* virtualTexture);
+
+    // add the textures (or the material arrays) to the bindless materials - after they are loaded
+    void RegisterMaterial(MaterialTable& table);
+
 
     // set affine transforms
     void SetTranslation(const glm::vec3 &translation);
     void SetRotation(const glm::vec3 &translation);
     void SetScale(const glm::vec3 &scale);
-    void Upload_Material_Pipeline(Shader* shader);
 
     // setter for numberOfElements
     void SetNumberOfElements(unsigned int numberOfElements);
@@ -79,32 +149,76 @@ public:
     void SetParallaxMethod(int parallaxMethod);
     void SetContinuousTexture(int continuousTexture);
 
+    // bounding sphere in the object space (computed from the uploaded vertices)
+    void SetBoundingSphere(const glm::vec3& center, float radius);
+
+    // split the mesh into meshlets before it is added to the mesh buffer (reorders the triangles)
+    void BuildMeshlets(const std::vector<GLfloat>& data, std::vector<GLuint>& indices);
+
     // getters
+    glm::mat4 GetModelMatrix() const;
     glm::vec3 & GetTranslation();
     glm::vec3 & GetRotation();
     glm::vec3 & GetScale(); 
+    int GetParallaxMethod() const;
 
 
 private:
 
-    // shader
-    Shader *shader;
+    // bounding sphere of the interleaved vertex data
+    void ComputeBoundingSphere(const std::vector<GLfloat>& data);
+
+    // defines of the shaders (vertex format and material layout)
+    std::string GetShaderDefines() const;
+
+    // the shaders read the textures from the bindless materials (all but the virtual texture)
+    bool UsesBindless() const;
+
+    // shader (shared by the objects with the same shader files)
+    std::shared_ptr<Shader> shader;
+
+    // the same files compiled with GBUFFER for the deferred path (created on the first use)
+    std::shared_ptr<Shader> gbufferShader;
+    std::string vertexShaderPath = "";
+    std::string fragmentShaderPath = "";
+
+    // part of the shared mesh buffer
+    MeshRange mesh;
 
-    // buffers
-    GLuint VertexArrayObject = 0;
-    GLuint VertexBufferObject = 0;
-    GLuint ElementBufferObject = 0;
+    // clusters of the mesh culled separately (empty = drawn as a whole)
+    std::vector<Meshlet> meshlets;
 
-    // textures
-    Texture * diffuseTex; 
-    Texture * normalTex;
-    Texture * heightTex;
+    // coarser levels of detail (indices of the same vertices) and their object space errors
+    std::vector<MeshRange> lods;
+    std::vector<float> lodErrors;
+
+    // textures (shared by the objects that load the same files)
+    std::shared_ptr<Texture> diffuseTex;
+    std::shared_ptr<Texture> normalTex;
+    std::shared_ptr<Texture> heightTex;
+
+    // the height is in the alpha channel of normalTex (no heightTex, shaders with PACKED_MATERIAL)
+    bool packedMaterial = false;
+
+    // layer of the shared material arrays (replaces the textures, one batch for all layers)
+    std::shared_ptr<MaterialArray> materialArray;
+    unsigned int materialLayer = 0;
+
+    // streamed virtual texture (owned by the scene, replaces the textures)
+    VirtualTexture* virtualTexture = nullptr;
+
+    // index into the bindless materials (Kd.w of the per-draw record)
+    uint32_t materialIndex = 0;
     
     // properties
     glm::vec3 translation = glm::vec3(0.0f, 0.0f, 0.0f);
     glm::vec3 rotation = glm::vec3(0.0f, 0.0f, 0.0f);
     glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
 
+    // culling volume in the object space
+    glm::vec3 boundingCenter = glm::vec3(0.0f, 0.0f, 0.0f);
+    float boundingRadius = 0.0f;
+
     // numberOfVertices
     unsigned int numberOfElements = 0;
 
@@ -120,6 +234,9 @@ public:
     // object number that is beeing rendered
     u_int8_t objectNumber = 0;
 
+    // name used by the profiler
+    std::string name = "";
+
     // phong lighting model properties
     glm::vec3 Ka = glm::vec3(0.1f, 0.1f, 0.1f);
     glm::vec3 Kd = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -12,6 +12,7 @@
 
 #include <vector>
 #include "Object.hpp"
+#include "RenderQueue.hpp"
 
 class ObjectManager{
 
@@ -20,15 +21,30 @@ public:
     ObjectManager();
     ~ObjectManager();
 
-    void RenderAllObjects();
+    // prepare the draws of the frame on the job system and replay them
+    void RenderAllObjects(const FrameContext& context);
+
+    // after the last pass that reads the per-draw records of the frame
+    void EndFrame();
 
     void AddObject(Object *object);
+
+    // draw calls, culling and submit time of the last frame
+    const RenderStatistics& GetRenderStatistics() const;
+
+    // set the parallax method of all objects that use parallax mapping
+    void OverrideParallaxMethod(int parallaxMethod);
     
 
 private: 
 
     std::vector<Object *> objects;
 
+    // objects whose materials were added to the bindless materials
+    size_t registeredMaterials = 0;
+
+    RenderQueue renderQueue;
+
 };
 
 
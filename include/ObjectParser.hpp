@@ -18,6 +18,7 @@
 #include <tuple>
 #include <vector>
 #include <fstream>
+#include <cstdint>
 #include "PPM.hpp"
 #include <glm/glm.hpp>
 #include <glm/vec3.hpp>
@@ -47,6 +48,22 @@ struct TextureCoords{
     TextureCoords(float _s, float _t): s(_s), t(_t) { } // constructor
 };
 
+// compact vertex (20 bytes instead of 56) - see Pack_Vertices
+struct PackedVertex{
+    uint16_t position[4];   // unorm16 in the bounding box of the mesh, w = bitangent sign (0 = -1, 65535 = +1)
+    int16_t normal[2];      // octahedral, snorm16
+    int16_t tangent[2];     // octahedral, snorm16
+    uint16_t texCoords[2];  // half floats
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex has to match the vertex attributes");
+
+// position = offset + scale * unorm position
+struct PositionQuantization{
+    glm::vec3 offset = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
 //////////////////////////////////////////// Class definition ////////////////////////////
 
 class ObjectParser{
@@ -63,6 +80,17 @@ public:
                                     glm::vec3 &Ka, glm::vec3 &Kd, glm::vec3 &Ks, float *shininess,
     std::vector<uint8_t> &diffuseTextureData, std::vector<uint8_t> &normalTextureData); // return values
 
+    // encode stride 14 vertices (position, normal, uv, tangent, bitangent) into the compact format
+    static PositionQuantization Pack_Vertices(const std::vector<GLfloat> &data, std::vector<PackedVertex> &packed);
+
+    // unit vector -> 2 snorm16 (octahedral mapping)
+    static void Encode_Octahedral(const glm::vec3 &vector, int16_t *encoded);
+    static glm::vec3 Decode_Octahedral(const int16_t *encoded);
+
+    // IEEE 754 half float (round to nearest)
+    static uint16_t Encode_HalfFloat(float value);
+    static float Decode_HalfFloat(uint16_t value);
+
 private:
 
     static void Compute_tangents_bitangets(std::vector<GLfloat> &data, std::vector<GLuint> &indices);
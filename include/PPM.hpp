@@ -1,7 +1,8 @@
 /** @file PPM.hpp
  *  @brief Class for working with PPM images
  *  
- *  Class for working with P3 PPM images specifically.
+ *  Class for working with PPM images - reads ASCII P3 and binary P6 images,
+ *  saves binary P6 (the header and the pixels in one buffered write).
  *
  *  @author Adam Bosak
  *  @bug No known bugs.
@@ -19,8 +20,12 @@ public:
     PPM(std::string fileName);
     // Destructor clears any memory that has been allocated
     ~PPM();
-    // Saves a PPM Image to a new file.
+    // Saves a PPM Image to a new file (binary P6).
     void savePPM(std::string outputFileName) const;
+
+    // write RGB pixels (rows from the top) as a binary P6 file - false if it can not be written
+    static bool Write(const std::string& fileName, unsigned int width, unsigned int height, const uint8_t* data,
+                      unsigned int maxValue = 255);
     // Darken halves (integer division by 2) each of the red, green
     // and blue color components of all of the pixels
     // in the PPM. Note that no values may be less than
@@ -54,7 +59,8 @@ public:
 
 private:
 
-void writePixelData(std::ofstream &outputFile) const;
+// pixels of a binary P6 file after its first line
+void readPixelData_P6(std::ifstream &ppmFile);
 
 void getAllNumbers_InPPM(std::ifstream &ppmFile, unsigned int &width, 
                             unsigned int &height, unsigned int &maxValue);
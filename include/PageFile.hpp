@@ -0,0 +1,105 @@
+/** @file PageFile.hpp
+ *  @brief Tiled mip chain of a virtual texture on disk
+ *
+ *  A virtual texture (VirtualTexture.hpp) is too large for one texture, so
+ *  it is stored as pages: squares of pageSize texels with a border of the
+ *  neighbouring texels on every side (bilinear filtering across the page
+ *  edges), from level 0 down to the level that is one page. A page holds
+ *  two RGBA8 layers - albedo with the height in alpha, and the normal (x
+ *  and y in red and green).
+ *
+ *  The file is a header followed by the pages of every level, row by row,
+ *  all of the same size. It is memory mapped - a page is read from the
+ *  disk on its first access (by the loader threads of the cache).
+ *
+ *  Build creates the file from the textures of a material magnified to the
+ *  virtual size: every page is sampled from the mip chain of the sources,
+ *  so the virtual texture never exists in memory as a whole.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef PAGEFILE_HPP
+#define PAGEFILE_HPP
+
+// STL
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "JobSystem.hpp"
+
+struct PageFileHeader{
+    char identifier[4] = {'V', 'T', 'E', 'X'};
+    uint32_t version = 1;
+    uint32_t size = 0;              // texels per side of level 0 (pageSize * power of two)
+    uint32_t pageSize = 128;        // texels per side of a page without the border
+    uint32_t border = 4;
+    uint32_t numberOfLevels = 0;    // down to one page
+    uint32_t numberOfLayers = 2;    // albedo + height, normal
+    uint32_t numberOfPages = 0;
+    uint32_t sourceSize = 0;        // texels per side of the source textures
+    uint32_t reserved[7] = {};
+};
+
+static_assert(sizeof(PageFileHeader) == 64, "PageFileHeader is written as it is");
+
+class PageFile{
+
+public:
+
+    PageFile() = default;
+    ~PageFile();
+
+    PageFile(const PageFile&) = delete;
+    PageFile& operator=(const PageFile&) = delete;
+
+    // map the file, false if it can not be read or is not a page file
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const;
+
+    // layers of a page (pageTexels^2 RGBA8 texels each) - the data is read from the disk on access
+    const uint8_t* GetPage(uint32_t pageID) const;
+
+    const PageFileHeader& GetHeader() const;
+
+    // pages per side and the first page of a level
+    uint32_t GetPagesPerSide(uint32_t level) const;
+    uint32_t GetFirstPage(uint32_t level) const;
+
+    // texels per side of a page with its borders, bytes of all layers of a page
+    uint32_t GetPageTexels() const;
+    size_t GetPageBytes() const;
+
+    // write the page file of the material textures magnified to size texels per side
+    // (the height is inverted like the ground tiles load it) - false if a source can not be read
+    static bool Build(const std::string& path, const std::string& albedoPath, const std::string& normalPath,
+                      const std::string& heightPath, uint32_t size, bool inverseH, JobSystem* jobSystem);
+
+private:
+
+    void ComputeLevels();
+
+private:
+
+    PageFileHeader header;
+    std::vector<uint32_t> firstPages;
+
+    // mapped file
+    const uint8_t* data = nullptr;
+    size_t fileSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+
+};
+
+
+#endif
@@ -25,8 +25,8 @@ public:
     // rotation
     glm::mat4 RotateAroundPoint(glm::vec3 center, float radius);
 
-    // uploads the struct to a pipeline
-    void Upload_PointLight_Pipeline(Shader* targetShader, unsigned int lightIndex);
+    // move along the orbit (fixed time step of the simulation)
+    void Animate(float deltaTime);
 
 // private functions
 private:
@@ -55,6 +55,10 @@ public:
     float linear = 0.3f;
     float quadratic = 0.4f;
 
+    // circle in the xz plane around orbitCenter, 0 = static light
+    glm::vec3 orbitCenter = glm::vec3(0.0f, 0.0f, 0.0f);
+    float orbitSpeed = 0.0f;    // degrees per second
+
 };
 
 #endif
\ No newline at end of file
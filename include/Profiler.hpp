@@ -0,0 +1,219 @@
+/** @file Profiler.hpp
+ *  @brief Lightweight CPU / GPU profiler with scopes
+ *
+ *  Scopes are measured on the CPU (performance counter) and on the GPU
+ *  (GL_TIMESTAMP queries). The queries of a frame are read back
+ *  FRAMES_IN_FLIGHT frames later so the readback does not stall the
+ *  pipeline - a frame the GPU has not finished by then is retried at the
+ *  next frames instead of waited for. Results are aggregated into rolling
+ *  statistics per scope name and can be captured and exported as a Chrome
+ *  trace (chrome://tracing).
+ *
+ *  Usage:
+ *      {
+ *          ProfileScope scope("objects");
+ *          ... render ...
+ *      }
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#else // This works for Mac
+    #include <SDL.h>
+#endif
+
+#include <glad/glad.h>
+
+// STL
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// number of frames the queries are kept before being read back
+#define FRAMES_IN_FLIGHT 4
+
+// number of samples the rolling statistics are computed from
+#define PROFILER_HISTORY 120
+
+// one measured scope of a resolved frame
+struct ProfileSample{
+    unsigned int nameIndex;
+    unsigned int depth;
+    double cpuBegin;    // ms since the start of the profiler
+    double cpuTime;     // ms
+    double gpuBegin;    // ms since the start of the profiler (converted to the CPU clock)
+    double gpuTime;     // ms
+};
+
+// all scopes of one frame, the first sample is the whole frame
+struct ProfileFrame{
+    unsigned int frameNumber;
+    std::vector<ProfileSample> samples;
+};
+
+// rolling statistics of a scope
+struct ProfileStatistics{
+    double cpuAverage = 0.0;
+    double cpuMaximum = 0.0;
+    double gpuAverage = 0.0;
+    double gpuMinimum = 0.0;
+    double gpuMaximum = 0.0;
+    double gpuLast = 0.0;
+    unsigned int depth = 0;
+};
+
+class Profiler{
+
+public:
+
+    Profiler();
+    ~Profiler();
+
+    // start / end of a frame - the frame itself is the root scope
+    void BeginFrame();
+    void EndFrame();
+
+    // scopes can be nested, use ProfileScope instead of calling these directly
+    int BeginScope(const char* name);
+    void EndScope(int scope);
+
+    // statistics of the last PROFILER_HISTORY frames
+    ProfileStatistics GetStatistics(const std::string& name) const;
+
+    // names of all scopes that were measured
+    const std::vector<std::string>& GetScopeNames() const;
+
+    // read back all frames that are still in flight (blocks until the GPU finishes them)
+    void Flush();
+
+    // frames resolved since the last call (only collected if keepFrames is true)
+    void PopResolvedFrames(std::vector<ProfileFrame>& frames);
+
+    // number of the frame that is being recorded
+    unsigned int GetFrameNumber() const;
+
+    // chrome trace capture
+    void StartTraceCapture();
+    void StopTraceCapture();
+    bool IsCapturingTrace() const;
+    bool ExportChromeTrace(const std::string& filePath) const;
+
+    // free all GL objects (has to be called before the context is destroyed)
+    void Release();
+
+private:
+
+    struct ScopeRecord{
+        unsigned int nameIndex;
+        unsigned int depth;
+        Uint64 cpuBegin;
+        Uint64 cpuEnd;
+        GLuint queryBegin;
+        GLuint queryEnd;
+    };
+
+    struct FrameRecord{
+        unsigned int frameNumber = 0;
+        bool pending = false;
+        unsigned int usedQueries = 0;
+        std::vector<GLuint> queries;
+        std::vector<ScopeRecord> scopes;
+    };
+
+    struct ScopeHistory{
+        unsigned int depth = 0;
+        unsigned int count = 0;
+        double cpuTimes[PROFILER_HISTORY] = {};
+        double gpuTimes[PROFILER_HISTORY] = {};
+    };
+
+    struct TraceEvent{
+        unsigned int nameIndex;
+        bool gpu;
+        double begin;       // ms
+        double duration;    // ms
+    };
+
+    GLuint GetQuery(FrameRecord& frame);
+
+    // read back the queries of a frame - false if the GPU has not written them yet (and wait is false)
+    bool ResolveFrame(FrameRecord& frame, bool wait);
+    void ResolveLateFrames(bool wait);
+
+    unsigned int GetNameIndex(const char* name);
+    double ToMiliseconds(Uint64 counter) const;
+
+public:
+
+    // profiling can be switched off completely
+    bool enabled = true;
+
+    // also profile every object separately (adds two queries per object)
+    bool profileObjects = false;
+
+    // keep the resolved frames for PopResolvedFrames (used by the benchmark)
+    bool keepFrames = false;
+
+    // number of frames whose queries were not ready when their slot was reused (read back later)
+    unsigned int skippedFrames = 0;
+
+    // number of skipped frames that were given up on (more than FRAMES_IN_FLIGHT waiting)
+    unsigned int droppedFrames = 0;
+
+private:
+
+    FrameRecord frames[FRAMES_IN_FLIGHT];
+
+    // skipped frames with their queries, retried at every BeginFrame
+    std::vector<FrameRecord> lateFrames;
+    unsigned int frameNumber = 0;
+    bool frameActive = false;
+
+    // stack of the open scopes of the current frame
+    std::vector<int> openScopes;
+
+    // interned scope names
+    std::vector<std::string> names;
+    std::unordered_map<std::string, unsigned int> nameToIndex;
+    std::vector<ScopeHistory> histories;
+
+    std::vector<ProfileFrame> resolvedFrames;
+
+    // clock synchronization
+    Uint64 startCounter = 0;
+    double gpuClockOffset = 0.0;    // cpu ms - gpu ms
+    bool clockSynchronized = false;
+
+    // trace capture
+    bool capturing = false;
+    std::vector<TraceEvent> traceEvents;
+
+};
+
+// RAII scope - measures the time from construction to destruction
+class ProfileScope{
+
+public:
+
+    ProfileScope(const char* name);
+    ~ProfileScope();
+
+private:
+
+    int scope;
+
+};
+
+// External linkage such that the
+// global profiler is available
+// everywhere.
+extern Profiler gProfiler;
+
+
+#endif
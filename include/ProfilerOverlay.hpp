@@ -0,0 +1,70 @@
+/** @file ProfilerOverlay.hpp
+ *  @brief On-screen overlay with the profiler results
+ *
+ *  Draws one bar per profiled pass (GPU time, rolling average) in the
+ *  corner of the screen together with 60 / 30 FPS markers. The exact
+ *  numbers are shown in the window title.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef PROFILEROVERLAY_HPP
+#define PROFILEROVERLAY_HPP
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#else // This works for Mac
+    #include <SDL.h>
+#endif
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// STL
+#include <vector>
+#include <string>
+
+#include "Shader.hpp"
+#include "Profiler.hpp"
+
+class ProfilerOverlay{
+
+public:
+
+    ProfilerOverlay();
+    ~ProfilerOverlay();
+
+    // draw the bars of the passes measured by the profiler
+    void Draw(const Profiler& profiler);
+
+    // write the timings into the title of the window (rate limited)
+    void UpdateWindowTitle(const Profiler& profiler, SDL_Window* window);
+
+private:
+
+    // append a quad given by its corners in NDC
+    void AddQuad(std::vector<GLfloat>& data, glm::vec2 min, glm::vec2 max, glm::vec4 color);
+
+public:
+
+    bool visible = true;
+
+    // frame time that corresponds to the full width of a bar
+    float maxMiliseconds = 33.3f;
+
+    // additional text at the end of the window title (draw calls...)
+    std::string status = "";
+
+private:
+
+    Shader * shader = nullptr;
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+
+    Uint32 lastTitleUpdate = 0;
+
+};
+
+
+#endif
@@ -0,0 +1,255 @@
+/** @file RenderQueue.hpp
+ *  @brief Draw commands prepared in parallel and replayed on the GL thread
+ *
+ *  The CPU work of an object (model matrix, frustum culling, sort key and
+ *  packing of the per-draw uniforms) runs on the job system. Every thread
+ *  writes into its own command list, the lists are merged and sorted, and
+ *  the main thread replays them with the GL calls only.
+ *
+ *  The per-draw records are streamed into a ring buffer that the shaders
+ *  read as an SSBO (binding PER_DRAW_BINDING) indexed by the drawID vertex
+ *  attribute (location DRAW_ID_LOCATION), so a draw needs no glUniform calls.
+ *
+ *  Objects that share shader and textures form a batch (the shader alone
+ *  with bindless textures, MaterialTable.hpp). The indirect
+ *  commands of all objects are built once (one fixed slot per object); per
+ *  frame only their instance counts (visibility) and the per-draw records
+ *  are written, and every batch is drawn by one glMultiDrawElementsIndirect.
+ *  Without multi-draw support the commands are drawn one by one.
+ *
+ *  Large meshes are split into meshlets (Meshlet.hpp). Every meshlet has its
+ *  own indirect command (reading the record of its object) and is culled
+ *  against the frustum and by its normal cone, so the commands are indexed
+ *  separately from the records: objectSlots holds the record of an object,
+ *  objectCommands its first command.
+ *
+ *  With CULLING_GPU the objects are not culled while they are prepared. A
+ *  compute shader (GPUCulling) culls the commands against the frustum and the
+ *  depth pyramid of the previous frame and compacts the commands of every
+ *  batch, the draws then read the commands (and counts) written on the GPU.
+ *
+ *  With depthPrepass the commands are drawn twice: first into the depth
+ *  buffer only (vert_Depth.glsl, the surfaces that may discard are clipped),
+ *  then with the materials, so the expensive fragment shaders of the G-buffer
+ *  pass run once per pixel.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+// glm lib
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+
+// STL
+#include <vector>
+#include <cstdint>
+
+#include "Camera.hpp"
+#include "JobSystem.hpp"
+#include "RingBuffer.hpp"
+#include "MeshBuffer.hpp"
+#include "GPUCulling.hpp"
+#include "Shader.hpp"
+
+// shader interface of the per-draw data
+#define PER_DRAW_BINDING 0
+#define DRAW_ID_LOCATION 5
+
+// where the objects are culled
+enum CullingMode{
+    CULLING_OFF = 0,
+    CULLING_CPU = 1,    // frustum culling while the draws are prepared
+    CULLING_GPU = 2     // frustum + Hi-Z occlusion in a compute shader (CPU frustum culling without multi-draw)
+};
+
+class Object;
+
+// distance based quality of the parallax mapping
+struct ParallaxLodSettings{
+
+    bool enabled = true;
+
+    // per object choice from the screen height of the displacement (CPU)
+    float normalPixels = 1.0f;      // below - normal mapping only
+    float offsetPixels = 4.0f;      // below - parallax offset instead of the ray marched methods
+    float pixelsPerLayer = 1.0f;    // layer budget of the ray marched methods
+
+    // per fragment fade with the distance (shader)
+    float fullDistance = 6.0f;      // full method up to here, then it fades to parallax offset
+    float offsetDistance = 15.0f;   // parallax offset from here, fading to normal mapping
+    float normalDistance = 30.0f;   // normal mapping only
+    float mipLevel = 3.0f;          // height map mip level that counts as far
+};
+
+// values shared by all objects of a frame - computed once
+struct FrameContext{
+
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float nearPlane = 0.1f;
+    float farPlane = 40.0f;
+
+    // left, right, bottom, top, near, far - normals point inside
+    glm::vec4 frustumPlanes[6];
+
+    // pixels per unit at the distance 1 (screen size of the levels of detail)
+    float pixelScale = 1.0f;
+    float lodPixelError = 1.0f;     // allowed screen space error of a level of detail, 0 = full detail
+
+    ParallaxLodSettings parallaxLod;
+
+    // the objects write the G-buffer of the deferred path instead of their lit color
+    bool gbufferPass = false;
+
+    static FrameContext Create(const Camera& camera, float aspectRatio, int screenHeight = 1080);
+
+    bool IsSphereVisible(const glm::vec3& center, float radius) const;
+};
+
+// per-draw uniforms of an object (std430 layout of the PerDraw struct in the shaders)
+struct PerDrawData{
+    glm::mat4 model;
+    glm::mat4 normalMatrix;     // mat3 in the upper left corner
+    glm::vec4 Ka;               // w = layer of the material arrays
+    glm::vec4 Kd;               // w = index of the bindless material
+    glm::vec4 Ks;               // w = shininess
+    glm::ivec4 flags;           // usedLight, parallaxMethod, continuousTexture, layer budget (0 = unlimited)
+};
+
+static_assert(sizeof(PerDrawData) == 192, "PerDrawData has to match the shader layout");
+
+struct DrawCommand{
+    uint64_t sortKey = 0;       // shader | texture | depth
+    Object* object = nullptr;
+    unsigned int slot = 0;      // fixed index of the per-draw record of the object
+    unsigned int firstCommand = 0;  // first indirect command of the object (one per meshlet)
+    glm::vec4 bounds;           // world space bounding sphere (center, radius)
+    PerDrawData data;
+};
+
+// objects drawn by one multi-draw call
+struct DrawBatch{
+    Object* object = nullptr;   // first object - binds shader and textures
+    unsigned int firstCommand = 0;
+    unsigned int count = 0;     // indirect commands
+    unsigned int visible = 0;   // visible commands in the current frame
+    GLenum indexType = GL_UNSIGNED_INT;
+};
+
+struct RenderStatistics{
+    unsigned int drawCalls = 0;
+    unsigned int visibleObjects = 0;
+    unsigned int culledObjects = 0;
+    unsigned int visibleDraws = 0;    // indirect commands (meshlets or whole meshes)
+    unsigned int culledDraws = 0;
+    double submitMiliseconds = 0.0;   // CPU time of Submit
+
+    // quality of the visible parallax objects (ParallaxLodSettings)
+    unsigned int parallaxFull = 0;    // ray marched methods
+    unsigned int parallaxOffset = 0;
+    unsigned int parallaxNormal = 0;
+    double parallaxLayers = 0.0;      // average layer budget of the ray marched methods (0 = unlimited)
+    bool multiDraw = false;
+    bool gpuCulling = false;          // visible / culled objects are known only on the GPU
+};
+
+
+class RenderQueue{
+
+public:
+
+    RenderQueue();
+    ~RenderQueue();
+
+    // prepare the commands of all objects in parallel (jobSystem may be null)
+    void Build(const std::vector<Object *>& objects, const FrameContext& context, JobSystem* jobSystem);
+
+    // replay the commands (GL thread only)
+    void Submit(const FrameContext& context, MeshBuffer& meshBuffer);
+
+    // after the last pass that reads the per-draw records of the frame
+    void EndFrame();
+
+    const std::vector<DrawCommand>& GetCommands() const;
+    unsigned int GetNumberOfCulled() const;
+    const RenderStatistics& GetStatistics() const;
+
+private:
+
+    // group the objects by shader and textures and build their indirect commands
+    void BuildBatches(const std::vector<Object *>& objects);
+
+    // one call per batch is possible (setting, support and no per object profiling)
+    bool UseMultiDraw() const;
+
+    // cull the commands with GPUCulling (compute shader or its CPU version)
+    void CullSlots(const FrameContext& context, bool onGPU);
+
+    void SubmitMultiDraw(const FrameContext& context, MeshBuffer& meshBuffer);
+    void SubmitSingleDraws(const FrameContext& context, MeshBuffer& meshBuffer);
+
+    // one multi-draw call of a batch from the bound command buffer
+    void SubmitBatch(unsigned int batchIndex, bool onGPU, bool compacted, GLintptr commandOffset);
+
+    // depth only state and shader of the prepass
+    void BeginDepthPrepass(const FrameContext& context, MeshBuffer& meshBuffer);
+    void EndDepthPrepass();
+
+public:
+
+    int cullingMode = CULLING_CPU;
+    bool occlusionCulling = true;   // Hi-Z test of CULLING_GPU
+
+    // one glMultiDrawElementsIndirect per batch (if supported)
+    bool multiDraw = true;
+
+    // draw the depth of the commands before their materials
+    bool depthPrepass = false;
+
+    // objects processed by one job
+    unsigned int groupSize = 64;
+
+private:
+
+    std::vector<std::vector<DrawCommand>> threadCommands;
+    std::vector<unsigned int> threadCulled;
+    std::vector<unsigned int> threadVisibleDraws;
+
+    std::vector<DrawCommand> commands;
+    unsigned int culled = 0;
+    unsigned int visibleDraws = 0;
+
+    // per-draw records of the last frames (created on the first submit)
+    RingBuffer* perDrawBuffer = nullptr;
+
+    // shader of the depth prepass (created on its first use)
+    Shader* depthShader = nullptr;
+
+    // static batches - built once, only the instance counts change
+    std::vector<unsigned int> objectSlots;
+    std::vector<unsigned int> objectCommands;
+    std::vector<unsigned int> commandBatches;
+    std::vector<DrawBatch> batches;
+    std::vector<DrawElementsIndirectCommand> staticCommands;
+    std::vector<DrawElementsIndirectCommand> frameCommands;
+    std::vector<uint8_t> commandVisibility;     // CPU culling of the frame
+    RingBuffer* indirectBuffer = nullptr;
+
+    // bounds of the commands for GPUCulling (batch part built once)
+    std::vector<CullObject> cullObjects;
+    std::vector<CullObject> frameCullObjects;
+    std::vector<GLuint> frameCounts;
+    GPUCulling gpuCulling;
+
+    RenderStatistics statistics;
+
+};
+
+
+#endif
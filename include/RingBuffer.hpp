@@ -0,0 +1,85 @@
+/** @file RingBuffer.hpp
+ *  @brief Triple buffered stream buffer for per-frame data
+ *
+ *  The buffer is split into sections, one per frame in flight. The CPU
+ *  writes the data of a frame into its own section while the GPU still
+ *  reads the previous ones. A fence after the frame protects the section
+ *  until the GPU is done with it.
+ *
+ *  With ARB_buffer_storage the whole buffer is persistently mapped
+ *  (coherent), otherwise each section is mapped unsynchronized every frame.
+ *
+ *  Usage:
+ *      void* data = ring.BeginFrame(size);
+ *      ... write the data ...
+ *      ring.Commit();                      // before the draws
+ *      ring.BindRange(binding, size);
+ *      ... draws ...
+ *      ring.EndFrame();                    // after the draws
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+
+#include "GLExtensions.hpp"
+
+class RingBuffer{
+
+public:
+
+    RingBuffer(GLenum target, GLsizeiptr sectionSize, unsigned int numberOfSections = 3);
+    ~RingBuffer();
+
+    // wait for the next section and return a pointer for writing (grows if needed)
+    void* BeginFrame(GLsizeiptr requiredSize);
+
+    // make the written data visible to the GPU
+    void Commit();
+
+    // bind the used part of the current section to an indexed binding point
+    void BindRange(GLuint binding, GLsizeiptr size) const;
+
+    // fence the current section
+    void EndFrame();
+
+    GLuint GetID() const;
+    GLintptr GetSectionOffset() const;
+    bool IsPersistent() const;
+
+    // time spent waiting for the GPU in the last BeginFrame
+    double GetWaitMiliseconds() const;
+
+private:
+
+    void Create(GLsizeiptr sectionSize);
+    void Release();
+
+private:
+
+    GLenum target;
+    GLuint bufferID = 0;
+
+    GLsizeiptr sectionSize = 0;
+    unsigned int numberOfSections;
+    unsigned int currentSection = 0;
+
+    bool persistent = false;
+    unsigned char* persistentPointer = nullptr;
+    bool mapped = false;
+
+    std::vector<GLsync> fences;
+
+    double waitMiliseconds = 0.0;
+
+};
+
+
+#endif
@@ -14,6 +14,15 @@
 #include "LightsManager.hpp"
 #include "Shader.hpp"
 #include "Skybox.hpp"
+#include "Benchmark.hpp"
+#include "Profiler.hpp"
+#include "ProfilerOverlay.hpp"
+#include "JobSystem.hpp"
+#include "MeshBuffer.hpp"
+#include "GBuffer.hpp"
+#include "VirtualTexture.hpp"
+#include "TextureStreamer.hpp"
+#include "MaterialTable.hpp"
 
 // Scene is a singleton class
 class Scene{
@@ -36,10 +45,31 @@ public:
 
         delete objManager;
         delete lightsManager;
+        delete meshBuffer;
+        delete gbuffer;
+
+        if (virtualTexture != nullptr)
+            delete virtualTexture;
         
         if (skybox != nullptr)
             delete skybox;
 
+        if (benchmark != nullptr)
+            delete benchmark;
+
+        if (profilerOverlay != nullptr)
+            delete profilerOverlay;
+
+        // after the textures it streams
+        if (textureStreamer != nullptr)
+            delete textureStreamer;
+
+        if (materialTable != nullptr)
+            delete materialTable;
+
+        if (jobSystem != nullptr)
+            delete jobSystem;
+
         // delete window
         this->GraphicsApplicationWindow = nullptr;
 
@@ -60,8 +90,15 @@ public:
                         const std::string heightMap, bool inverseH,
                         glm::vec3 pos, glm::vec3 rot, glm::vec3 scale);
 
-    // upload all lights to the pipeline
-    void UploadLightsToPipeline(Shader* shaderProgram);
+    // upload the ground materials into texture arrays and assign their layers to the ground tiles
+    // (textures per material if they can not share an array) - or the virtual texture to all tiles
+    void LoadGroundMaterials();
+
+    // bind the light buffers for the draws
+    void BindLights();
+
+    // add numberOfLights animated local lights above the ground (light stress test)
+    void AddLocalLights(unsigned int numberOfLights);
 
 // private functions
 private: 
@@ -81,6 +118,39 @@ public:
     char ** ArgsPointer = nullptr;
     int NumArgs = 0;
 
+    // settings (can be changed with command line arguments)
+    int SceneNumber = 2;                // 1 = brick walls, 2 = Parallax at Dawn
+    int ParallaxMethodOverride = -2;    // -2 = keep the methods of the objects, otherwise -1..3
+    int GroundTiles = 1;                // each ground tile is split into GroundTiles x GroundTiles tiles
+    unsigned int FrameLimit = 60;       // maximal frames per second, 0 = unlimited
+    int SwapInterval = 0;               // 0 = no vsync, 1 = vsync, -1 = adaptive vsync
+    double TickRate = 60.0;             // simulation updates per second (independent of the frame rate)
+    float CameraSpeed = 3.0f;           // units per second
+    bool MultiDrawIndirect = true;      // one glMultiDrawElementsIndirect per batch (if supported)
+    int CullingMode = 2;                // 0 = off, 1 = CPU frustum, 2 = GPU frustum + occlusion (CullingMode enum)
+    bool OcclusionCulling = true;       // Hi-Z test of the GPU culling
+    bool PackedVertices = true;         // 20 byte vertices instead of 14 floats
+    bool UseMeshCache = true;           // parsed and optimized meshes are stored next to the .obj files
+    bool Meshlets = true;               // large meshes are split into clusters culled separately
+    bool MeshLods = true;               // simplified levels of detail of the .obj meshes
+    float LodPixelError = 1.0f;         // allowed screen space error of a level of detail in pixels
+    ParallaxLodSettings ParallaxLod;    // parallax method, layers and fade distances by the screen size
+    bool ClusteredLights = true;        // local lights binned into froxels, otherwise every fragment loops over all
+    unsigned int LocalLights = 0;       // animated local lights added to the scene (scene 3 = 1024 if not set)
+    int RenderPath = RENDER_FORWARD;    // RENDER_FORWARD or RENDER_DEFERRED (G-buffer and one lighting pass)
+    bool DepthPrepass = true;           // deferred path: depth of the surfaces before the G-buffer pass
+    bool TextureCompression = true;     // BC1/BC4/BC5 material textures, compressed once into KTX2 files
+    bool PackedMaterials = false;       // height in the alpha of the normal map (one texture for the parallax),
+                                        // by default only with uncompressed textures (BC3 loses normal precision)
+    bool GroundTextureArrays = true;    // ground materials as layers of texture arrays (one batch for all tiles)
+    std::string VirtualTexturePath = ""; // page file streamed onto the ground tiles instead of their materials
+    std::string VirtualTextureRecordPath = ""; // feedback of the frames replayed by --vt-simulate
+    bool TextureStreaming = true;       // finer mip levels of the compressed textures loaded by their screen size
+    unsigned int TextureBudgetMB = 128; // memory of the streamed textures, 0 = unlimited
+    bool ImmutableTextures = true;      // glTexStorage2D/3D and uploads through pixel unpack buffers
+    float TextureAnisotropy = 8.0f;     // maximal anisotropy of the texture filtering, 1 = trilinear only
+    bool BindlessTextures = true;       // texture handles of the materials in a storage buffer (if supported)
+
     // Main loop flag
     bool Quit = false; // If this is quit = 'true' then the program terminates.
 
@@ -89,6 +159,19 @@ public:
     ObjectManager *objManager = new ObjectManager();
     LightsManager *lightsManager = new LightsManager();
 
+    // vertices and indices of all static meshes
+    MeshBuffer *meshBuffer = new MeshBuffer();
+
+    // targets of the deferred path
+    GBuffer *gbuffer = new GBuffer();
+
+
+    // pages of the ground streamed from the disk (null = the ground materials)
+    VirtualTexture *virtualTexture = nullptr;
+
+    // materials of the ground (layers of the texture arrays) and the tiles waiting for them
+    std::vector<MaterialFiles> groundMaterials;
+    std::vector<std::pair<Object*, unsigned int>> groundTiles;
 
     // Camera
     Camera MainCamera;
@@ -101,6 +184,21 @@ public:
     // skybox
     Skybox *skybox = nullptr;
 
+    // benchmark - replays a camera path, null in the interactive mode
+    Benchmark *benchmark = nullptr;
+
+    // on-screen profiler results
+    ProfilerOverlay *profilerOverlay = nullptr;
+
+    // mip levels of the textures loaded in the background (null = all levels loaded with the textures)
+    TextureStreamer *textureStreamer = nullptr;
+
+    // handles of the textures of all materials (null = the textures are bound per batch)
+    MaterialTable *materialTable = nullptr;
+
+    // worker threads for the CPU side of the frame (null = single threaded)
+    JobSystem *jobSystem = nullptr;
+
 
 };
 
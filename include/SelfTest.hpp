@@ -0,0 +1,40 @@
+/** @file SelfTest.hpp
+ *  @brief Checks of the CPU side of the renderer that run without a window
+ *
+ *  Every check builds its input, runs the code and compares the results
+ *  with known values - a failed comparison is printed with its name. The
+ *  checks need no GL context, so they run on any machine (--self-test, the
+ *  exit code is 1 if any check failed).
+ *
+ *  Checks:
+ *      indices             16 / 32 bit index selection, padding and first index of the shared mesh buffer
+ *      height maps         SSE2 / AVX2 conversion against the scalar code (odd widths, 1-4 channels)
+ *                          and known texels of invert, normalize and remap
+ *      culling             CPU version of the culling shader - frustum, empty slots, cones, occlusion,
+ *                          compaction and counts per batch
+ *      meshlets            vertex and triangle limits, every triangle in exactly one meshlet
+ *                          (one mesh and two separate ones)
+ *      levels of detail    fewer triangles and no smaller error with every level, valid triangles,
+ *                          the same levels from the job system
+ *      parallax selection  full method, parallax offset and normal mapping in this order with the
+ *                          distance, thresholds at the ratio of their pixels, layer budgets
+ *      vertex format       half floats (zero, denormals, 65504, overflow), octahedral error and the
+ *                          bitangent sign of the packed vertices
+ *      block compression   BC1 / BC3 / BC4 / BC5 blocks encoded and decoded - solid blocks exactly,
+ *                          gradients above a PSNR floor
+ *
+ *  Usage:
+ *      bool passed = RunSelfTest();
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef SELFTEST_HPP
+#define SELFTEST_HPP
+
+// run every check and print the results - true if all of them passed
+bool RunSelfTest();
+
+
+#endif
@@ -26,7 +26,13 @@ class Shader{
 
 public:
 
-    Shader(const std::string& vertexShaderSource, const std::string& fragmentShaderSource);
+    // defines are inserted after the #version line of both shaders (e.g. "#define PACKED_VERTICES\n")
+    Shader(const std::string& vertexShaderSource, const std::string& fragmentShaderSource,
+           const std::string& defines = "");
+
+    // compute pipeline (needs OpenGL 4.3)
+    Shader(const std::string& computeShaderSource);
+
     ~Shader();
 
     // binds the shader
@@ -87,12 +93,18 @@ private:
     // load shader and return it as a string
     std::string LoadShaderAsString(const std::string& filename);
 
+    // insert the defines after the #version line
+    std::string InsertDefines(const std::string& source, const std::string& defines);
+
     // compile shader
     GLuint CompileShader(GLuint type, const std::string& source);
 
     // create shader program
     GLuint CreateShaderProgram(const std::string& vertexShaderSource, const std::string& fragmentShaderSource);
 
+    // create compute program
+    GLuint CreateComputeProgram(const std::string& computeShaderSource);
+
 
 public: 
 
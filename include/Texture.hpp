@@ -2,6 +2,20 @@
  *  @brief Sets up an OpenGL texture
  *  
  * Sets up an OpenGL texture.
+ *
+ * The storage is immutable (glTexStorage2D) with a sized internal format
+ * and the levels of the mip chain, the data is copied into a pixel unpack
+ * buffer and the texture is filled from it, so the driver copies it while
+ * the CPU continues. The textures repeat and are filtered trilinearly and
+ * anisotropically (Scene::TextureAnisotropy). Without immutable storage
+ * (or with --no-texture-storage) the levels are specified one by one.
+ *
+ * With bindless textures the shaders sample the texture through its 64-bit
+ * handle (MaterialTable.hpp). The handle is created and made resident on
+ * the first request; a texture with a handle is not specified again, a new
+ * name is created for the next upload. The GL does not know which draws
+ * in flight use a handle, so a texture with a handle is deleted only after
+ * a fence shows the GPU is past the frames that could sample it.
  * 
  *  @author Adam
  *  @bug No known bugs.
@@ -31,6 +45,54 @@
 
 #include <glad/glad.h>
 
+// STL
+#include <vector>
+#include <utility>
+
+#include "TextureCompressor.hpp"
+
+class TextureStreamer;
+
+// the uploads of all textures since the start
+struct TextureUploadStatistics{
+    unsigned int textures = 0;
+    size_t bytes = 0;
+    double miliseconds = 0.0;       // CPU time of the upload calls
+};
+
+// data of one upload copied into a pixel unpack buffer - the texture calls read it by offset while the buffer is
+// bound (nothing is bound and the pointers are the data themselves without immutable storage)
+class UnpackBuffer{
+
+public:
+
+    UnpackBuffer(const std::vector<std::pair<const void*, size_t>>& parts);
+    ~UnpackBuffer();
+
+    UnpackBuffer(const UnpackBuffer&) = delete;
+    UnpackBuffer& operator=(const UnpackBuffer&) = delete;
+
+    // pointer argument of the glTex(Sub)Image calls for a part
+    const void* GetPointer(unsigned int part) const;
+
+private:
+
+    GLuint bufferID = 0;
+    std::vector<const void*> pointers;
+
+};
+
+// a loaded texture before its upload - the block compressed mip chain or the pixels of level 0
+struct TextureImage{
+    bool compressed = false;
+    CompressedTexture blocks;   // the levels without data are streamed later (TextureStreamer)
+    std::string cachePath;      // KTX2 file of the blocks
+    std::vector<uint8_t> pixels;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    GLenum format = GL_RGB;     // of the pixels (GL_RED, GL_RG, GL_RGB or GL_RGBA)
+};
+
 class Texture{
 
     public:
@@ -41,12 +103,71 @@ class Texture{
         // bind texture
         void Bind(unsigned int slot);
 
-        // load data to gpu
+        // load data to gpu (format GL_RED, GL_RG, GL_RGB or GL_RGBA) and generate the mipmaps
         void LoadData(GLuint width, GLuint height, unsigned char* data, GLenum format);
 
+        // replace a part of a level - the storage exists (data may be an offset into the bound unpack buffer)
+        void UpdateRegion(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, const void* data);
+
+        // upload the block compressed mip chain (decoded to RGBA8 if the format is not supported) - the sampling
+        // starts at the finest level with data
+        void LoadCompressed(const CompressedTexture& texture);
+
+        // upload the blocks or the pixels of the image
+        void Load(const TextureImage& image);
+
+        // OpenGL name of the texture
+        GLuint GetID() const;
+
+        // the streamer loads the finer levels (unregistered when the texture is deleted)
+        void SetStreamer(TextureStreamer* streamer, uint32_t streamID);
+        uint32_t GetStreamID() const;
+
+        // the texture was reallocated by the streamer - the old name (and its handle) is deleted
+        void ReplaceID(GLuint textureID);
+
+        // resident bindless handle (created on the first call), 0 if nothing was uploaded yet
+        GLuint64 GetHandle();
+
+        // wrapping and filtering of the texture bound to the target
+        static void SetSampling(GLenum target);
+
+        // true if the textures get immutable storage
+        static bool UseStorage();
+
+        // sized internal format of a pixel format
+        static GLenum GetSizedFormat(GLenum format);
+
+        // levels of the full mip chain
+        static unsigned int GetNumberOfLevels(unsigned int width, unsigned int height);
+
+        static void RecordUpload(size_t bytes, double miliseconds);
+        static TextureUploadStatistics GetUploadStatistics();
+
+        // resident handle of a texture
+        static GLuint64 CreateHandle(GLuint textureID);
+
+        // delete the texture - at once without a handle, otherwise after the GPU finished the submitted draws
+        // (the handle is reset to 0)
+        static void DeleteTexture(GLuint textureID, GLuint64& handle);
+
+        // delete the textures whose draws finished (once per frame)
+        static void ReleaseDeletedTextures();
+
+    private:
+
+        // a new name if the storage of this one is immutable already (or has a handle), bound
+        void PrepareStorage();
+
     private:
 
         GLuint textureID = 0;
+        bool immutable = false;
+        bool loaded = false;
+        GLuint64 handle = 0;
+
+        TextureStreamer* streamer = nullptr;
+        uint32_t streamID = UINT32_MAX;
 
 };
 
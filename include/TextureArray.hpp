@@ -0,0 +1,84 @@
+/** @file TextureArray.hpp
+ *  @brief Textures of the same size and format as the layers of one array
+ *
+ *  The layers are uploaded into one GL_TEXTURE_2D_ARRAY, so the objects
+ *  that use different layers share their textures and are drawn by one
+ *  multi-draw call - the shaders pick the layer from the per-draw record.
+ *  Block compressed layers keep their mip chains, uncompressed layers get
+ *  the mipmaps generated. The storage is immutable like the one of the
+ *  textures (Texture.hpp). The finest levels of the layers can be missing,
+ *  the TextureStreamer loads them when the array is seen up close.
+ *
+ *  A MaterialArray holds the diffuse, normal and height arrays of several
+ *  materials (the ground materials), a material is the same layer of all
+ *  three.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef TEXTUREARRAY_HPP
+#define TEXTUREARRAY_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+
+#include "Texture.hpp"
+
+class TextureStreamer;
+
+class TextureArray{
+
+public:
+
+    TextureArray();
+    ~TextureArray();
+
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    // bind the array
+    void Bind(unsigned int slot);
+
+    // upload the images as the layers - false (and nothing uploaded) if they differ in size or format
+    bool Load(const std::vector<TextureImage>& layers);
+
+    // OpenGL name of the array
+    GLuint GetID() const;
+
+    unsigned int GetNumberOfLayers() const;
+
+    // the streamer loads the finer levels (unregistered when the array is deleted)
+    void SetStreamer(TextureStreamer* streamer, uint32_t streamID);
+    uint32_t GetStreamID() const;
+
+    // the array was reallocated by the streamer - the old name (and its handle) is deleted
+    void ReplaceID(GLuint textureID);
+
+    // resident bindless handle (created on the first call), 0 if nothing was uploaded yet
+    GLuint64 GetHandle();
+
+private:
+
+    GLuint textureID = 0;
+    unsigned int numberOfLayers = 0;
+    bool immutable = false;
+    GLuint64 handle = 0;
+
+    TextureStreamer* streamer = nullptr;
+    uint32_t streamID = UINT32_MAX;
+
+};
+
+// the materials of the layers - diffuse, normal and height (packed in the alpha of normal if packed)
+struct MaterialArray{
+    TextureArray diffuse;
+    TextureArray normal;
+    TextureArray height;
+    bool packed = false;
+};
+
+
+#endif
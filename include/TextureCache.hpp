@@ -0,0 +1,67 @@
+/** @file TextureCache.hpp
+ *  @brief KTX2 files of the block compressed textures
+ *
+ *  A compressed texture is stored next to its source (<file>.ktx2, or
+ *  <file>.inverse.ktx2 for an inverted height map, <normal map>.material.ktx2
+ *  for a packed material) as a KTX 2.0 container:
+ *  the header with the Vulkan format of the blocks (BC1/BC3 as sRGB), the
+ *  level index, a basic data format descriptor and the key/value data,
+ *  followed by the levels from the smallest to the largest. No
+ *  supercompression is used.
+ *
+ *  The size and modification time of the sources and the version of the
+ *  compressor are kept in the "SourceStamp" value - the file is rebuilt when
+ *  a source or the encoder changes, like the MeshCache.
+ *
+ *  The file is the mip chain of the texture streamer (TextureStreamer.hpp):
+ *  a load can stop at the levels up to a size, the finer ones are read one
+ *  by one later.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef TEXTURECACHE_HPP
+#define TEXTURECACHE_HPP
+
+// STL
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "TextureCompressor.hpp"
+
+class TextureCache{
+
+public:
+
+    // false when there is no valid KTX2 file for the source. maxLevelSize > 0 reads only the levels up to
+    // that size (the others get their size and no data)
+    static bool Load(const std::string& sourcePath, bool inverse, CompressedTexture& texture, unsigned int maxLevelSize = 0);
+
+    static bool Save(const std::string& sourcePath, bool inverse, const CompressedTexture& texture);
+
+    static std::string GetCachePath(const std::string& sourcePath, bool inverse);
+
+    // a texture built from several sources (packed material), stale when any of them changes
+    static bool Load(const std::string& cachePath, const std::vector<std::string>& sourcePaths, CompressedTexture& texture,
+                     unsigned int maxLevelSize = 0);
+
+    // blocks of one level of a KTX2 file into size bytes (the size of the level) - no check of the sources
+    static bool LoadLevel(const std::string& cachePath, unsigned int level, uint8_t* data, size_t size);
+
+    static bool Save(const std::string& cachePath, const std::vector<std::string>& sourcePaths,
+                     const CompressedTexture& texture);
+
+    // packed normal and height of a material, named after the normal map
+    static std::string GetMaterialCachePath(const std::string& normalPath, bool inverse);
+
+private:
+
+    // bump when the encoder or the mip filter changes
+    static const uint32_t version = 2;
+
+};
+
+
+#endif
@@ -0,0 +1,118 @@
+/** @file TextureCompressor.hpp
+ *  @brief Block compression of the material textures (BC1/BC3/BC4/BC5)
+ *
+ *  A texture is compressed once, when it is loaded for the first time, and
+ *  stored in a KTX2 file next to the source (TextureCache). The format
+ *  follows what the texture is used for:
+ *
+ *      diffuse     BC1 (BC3 if the alpha is not opaque), sRGB data
+ *      normal      BC5 - x and y of the tangent space normal, z is
+ *                  reconstructed in the shaders
+ *      height      BC4 - the first channel
+ *      material    BC3 - normal x and y in the color, height in the alpha
+ *                  (one texture for the parallax search, see PackMaterial)
+ *
+ *  The mip chain is built on the CPU: diffuse texels are averaged in linear
+ *  space and converted back to sRGB, normals are averaged and renormalized.
+ *  The blocks of a level are encoded in parallel on the job system.
+ *
+ *  The BC1 endpoints are the extremes of the colors on their principal axis,
+ *  refined by a least squares fit to the chosen indices; BC4 uses the
+ *  minimum and maximum of the block with the 8 value palette.
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef TEXTURECOMPRESSOR_HPP
+#define TEXTURECOMPRESSOR_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "JobSystem.hpp"
+
+// what a texture of an object is used for (textureType of Object::LoadTexture)
+enum TextureUsage{
+    TEXTURE_DIFFUSE = 0,
+    TEXTURE_NORMAL = 1,
+    TEXTURE_HEIGHT = 2,
+    TEXTURE_MATERIAL = 3    // normal x, y in red and green, height in alpha (PackMaterial)
+};
+
+enum BlockFormat{
+    BLOCK_BC1 = 0,      // 8 bytes per 4x4 block, RGB
+    BLOCK_BC3 = 1,      // 16 bytes, RGB and alpha
+    BLOCK_BC4 = 2,      // 8 bytes, one channel
+    BLOCK_BC5 = 3       // 16 bytes, two channels
+};
+
+// blocks of one mip level, row by row
+struct CompressedLevel{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<uint8_t> data;
+};
+
+struct CompressedTexture{
+    BlockFormat format = BLOCK_BC1;
+    bool srgb = false;                      // the colors are sRGB encoded (diffuse)
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<CompressedLevel> levels;    // level 0 first
+
+    // bytes of all levels
+    size_t GetSize() const;
+};
+
+struct TextureCompressionStatistics{
+    size_t uncompressedBytes = 0;   // all levels with the channels of the source
+    size_t compressedBytes = 0;
+    double psnr = 0.0;              // of level 0 in the channels the format keeps (dB)
+    double miliseconds = 0.0;       // mip chain and encoding
+};
+
+class TextureCompressor{
+
+public:
+
+    // mip chain and blocks of 8 bit pixels with 1..4 channels (statistics may be null, jobSystem too)
+    static CompressedTexture Compress(const uint8_t* pixels, unsigned int width, unsigned int height,
+                                      unsigned int channels, TextureUsage usage, JobSystem* jobSystem,
+                                      TextureCompressionStatistics* statistics = nullptr);
+
+    // RGBA8 pixels of a level (BC4 -> red, BC5 -> red and green)
+    static std::vector<uint8_t> Decompress(const CompressedTexture& texture, unsigned int level);
+
+    // peak signal to noise ratio of level 0 against the source pixels in the channels the usage keeps
+    static double ComputePSNR(const uint8_t* pixels, unsigned int channels, const CompressedTexture& texture,
+                              TextureUsage usage);
+
+    // RGBA8 material texture of a normal map and a height map of the same size: normal x and y, 0, height
+    // (invertHeight applies the inversion of the height maps loaded with inverseH)
+    static std::vector<uint8_t> PackMaterial(const uint8_t* normalPixels, unsigned int normalChannels,
+                                             const uint8_t* heightPixels, unsigned int heightChannels,
+                                             unsigned int width, unsigned int height, bool invertHeight);
+
+    // the inversion of a height map texel (Object::LoadTexture with inverseH)
+    static uint8_t InvertHeight(uint8_t height);
+
+    // bytes of one 4x4 block
+    static unsigned int GetBlockBytes(BlockFormat format);
+
+    // internal format of glCompressedTexImage2D
+    static GLenum GetGLFormat(BlockFormat format);
+
+    // BC1 and BC3 need EXT_texture_compression_s3tc, BC4 and BC5 are core (RGTC)
+    static bool IsS3TC(BlockFormat format);
+
+    static const char* GetFormatName(BlockFormat format);
+
+};
+
+
+#endif
@@ -0,0 +1,196 @@
+/** @file TextureStreamer.hpp
+ *  @brief Mip levels of the textures streamed by their screen size within a memory budget
+ *
+ *  The textures are uploaded with the levels up to initialLevelSize only
+ *  (the rest of the mip chain stays in its KTX2 file, TextureCache.hpp),
+ *  so the first frame does not wait for the full resolution textures.
+ *
+ *  Every frame the objects request their textures with the size of their
+ *  bounding sphere on the screen - the level whose texels match the pixels
+ *  is wanted. The targets are fitted into the budget: the textures that
+ *  were not seen for the longest time give up their finest level first,
+ *  then the ones with the most texels per pixel. A texture finer than its
+ *  target is evicted at once, a coarser one gets its next finer level read
+ *  by the loader thread and uploaded in a later frame - one level at a time,
+ *  a few megabytes per frame. The loader reads the level straight into a
+ *  staging buffer of the uploader (TextureUploader.hpp), the upload is an
+ *  asynchronous copy from that buffer. The storage of a texture is immutable and
+ *  holds its resident levels only: a change of the levels allocates a new
+ *  texture, copies the levels both have on the GPU and replaces the old one.
+ *
+ *  The quality of a frame is the share of the requested texels that are
+ *  resident (weighted by the screen area of the requests). The quality the
+ *  targets of other budgets would reach is evaluated with the requests of
+ *  the same frames, so one run gives the budget-versus-quality curve.
+ *
+ *  Usage:
+ *      streamer.Update();      // at the start of the frame - requests of the last frame, loads, evictions
+ *      ... objects call Request(id, pixels) in Prepare ...
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef TEXTURESTREAMER_HPP
+#define TEXTURESTREAMER_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+#include "Texture.hpp"
+#include "TextureArray.hpp"
+#include "TextureUploader.hpp"
+
+// counters since the streamer was created (the bytes, textures and quality are current)
+struct TextureStreamingStatistics{
+    uint64_t frames = 0;
+    uint64_t uploads = 0;           // levels uploaded
+    uint64_t evictions = 0;         // levels freed
+    uint64_t bytesRead = 0;         // level data read from the files
+    size_t residentBytes = 0;
+    size_t fullBytes = 0;           // all levels of the textures
+    size_t budgetBytes = 0;
+    unsigned int textures = 0;
+    unsigned int loadingLevels = 0;
+    uint64_t stagingWaits = 0;      // levels not queued, every staging buffer was busy
+    uint64_t deferredUploads = 0;   // loaded levels left for the next frame (upload budget)
+    double uploadMiliseconds = 0.0; // of the last frame with uploads
+    double maxUploadMiliseconds = 0.0;
+    double quality = 1.0;           // of the last frame
+};
+
+// average quality of the frames with the targets of a budget
+struct BudgetQuality{
+    double fraction;                // of the full size of the textures
+    size_t budgetBytes;
+    double quality;
+};
+
+class TextureStreamer{
+
+public:
+
+    // budgetBytes = 0 keeps all levels (the textures are still streamed in)
+    TextureStreamer(size_t budgetBytes);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // levels up to this size are loaded with the texture
+    static const unsigned int initialLevelSize = 128;
+
+    // stream the missing levels of the uploaded image from its KTX2 file - false if it is not block compressed
+    bool Register(Texture& texture, const TextureImage& image);
+    bool Register(TextureArray& array, const std::vector<TextureImage>& layers);
+
+    // the texture was deleted
+    void Unregister(uint32_t streamID);
+
+    // the texture covers pixels on the screen this frame (thread safe, the largest request wins)
+    void Request(uint32_t streamID, float pixels);
+
+    // process the requests of the last frame, evict, upload the loaded levels and queue the next ones
+    void Update();
+
+    TextureStreamingStatistics GetStatistics() const;
+
+    // quality of the budgets (fractions of the full size) over the frames so far
+    std::vector<BudgetQuality> GetBudgetCurve() const;
+
+private:
+
+    struct StreamedTexture{
+        GLenum target = GL_TEXTURE_2D;
+        Texture* texture = nullptr;         // or the array
+        TextureArray* array = nullptr;
+        GLenum format = 0;
+        unsigned int width = 0;
+        unsigned int height = 0;
+        unsigned int depth = 1;
+        std::vector<std::string> files;     // KTX2 file of every layer
+        std::vector<size_t> levelBytes;     // of all layers
+        unsigned int residentLevel = 0;     // finest level uploaded
+        unsigned int minimumLevel = 0;      // coarsest level, never evicted
+        unsigned int targetLevel = 0;
+        float pixels = 0.0f;                // size of the last request
+        uint64_t lastUsed = 0;              // frame of the last request
+        bool requested = false;             // in the last frame
+        bool loading = false;
+        bool failed = false;                // a file could not be read - no finer levels
+        bool active = true;
+    };
+
+    struct LevelLoad{
+        uint32_t streamID;
+        unsigned int level;
+        std::vector<std::string> files;
+        size_t layerBytes;
+        StagingBlock staging;               // the layers one after another
+        bool loaded = false;
+    };
+
+    uint32_t Add(StreamedTexture texture, const std::vector<CompressedLevel>& levels);
+
+    // bytes of the levels from level to the coarsest
+    size_t GetBytes(const StreamedTexture& texture, unsigned int level) const;
+
+    // level whose texels match the requested pixels
+    unsigned int GetWantedLevel(const StreamedTexture& texture) const;
+
+    // coarsen the desired levels until they fit into the budget
+    void FitBudget(size_t budgetBytes, std::vector<unsigned int>& levels) const;
+
+    // screen area weighted share of the requested texels the levels provide
+    double GetQuality(const std::vector<unsigned int>& levels) const;
+
+    // new storage of the levels from level on with the resident ones copied and the staged data of level
+    // uploaded (or no data - the finer levels are evicted)
+    void Reallocate(StreamedTexture& texture, unsigned int level, StagingBlock* staging);
+
+    void LoaderLoop();
+
+private:
+
+    std::vector<StreamedTexture> textures;
+    std::deque<std::atomic<uint32_t>> requests;     // float bits of the largest request of the frame
+
+    size_t budgetBytes;
+
+    // staging buffers the loader reads into, a few megabytes uploaded per frame
+    TextureUploader uploader;
+
+    // frames a texture keeps its target when it is not requested (looking around)
+    uint64_t keepFrames = 120;
+
+    uint64_t frame = 0;
+    TextureStreamingStatistics statistics;
+
+    // budget curve - fractions of the full size and their summed quality
+    std::vector<double> curveFractions = {1.0 / 32.0, 1.0 / 16.0, 1.0 / 8.0, 1.0 / 4.0, 1.0 / 2.0, 1.0};
+    std::vector<double> curveQuality;
+    uint64_t curveFrames = 0;
+
+    // levels waiting for the loader and the loaded ones
+    std::deque<LevelLoad> queue;
+    std::vector<LevelLoad> loaded;
+
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::thread loader;
+    bool stop = false;
+
+};
+
+
+#endif
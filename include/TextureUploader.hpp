@@ -0,0 +1,130 @@
+/** @file TextureUploader.hpp
+ *  @brief Ring of pixel unpack buffers the texture data is staged in before its upload
+ *
+ *  A synchronous glTexImage2D copies the data before it returns - megabytes
+ *  of it stall the render thread. The uploader keeps a ring of pixel unpack
+ *  buffers instead: the loader threads read the data straight into a mapped
+ *  staging buffer, the GL thread only issues the texture call with the
+ *  buffer bound (an offset instead of a pointer). The driver copies the data
+ *  asynchronously, a fence after the call protects the buffer until the GPU
+ *  has read it.
+ *
+ *  With ARB_buffer_storage the buffers are persistently mapped (coherent),
+ *  otherwise a buffer is mapped unsynchronized when it is acquired and
+ *  unmapped before its upload. Acquire never waits - a buffer whose fence is
+ *  not signaled yet is busy, the caller tries again in a later frame. The
+ *  uploads of a frame are limited to maxBytesPerFrame (the first one always
+ *  goes, so a level larger than the limit still gets uploaded).
+ *
+ *  Usage:
+ *      uploader.BeginFrame();
+ *      uploader.Acquire(size, block);      // GL thread
+ *      ... a loader thread writes size bytes to block.data ...
+ *      if (uploader.HasBudget(size))
+ *          uploader.Upload(block, [&](const void* data){ glCompressedTexSubImage2D(..., data); });
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef TEXTUREUPLOADER_HPP
+#define TEXTUREUPLOADER_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+// staging memory of one upload
+struct StagingBlock{
+    int buffer = -1;                // -1 = none
+    uint8_t* data = nullptr;        // mapped, written by any thread
+    size_t size = 0;
+};
+
+// counters since the uploader was created
+struct TextureUploaderStatistics{
+    uint64_t uploads = 0;
+    uint64_t bytes = 0;
+    uint64_t deferred = 0;          // uploads over the budget of their frame
+    uint64_t starved = 0;           // acquires with every buffer busy
+    double miliseconds = 0.0;       // spent in the upload calls
+    double frameMiliseconds = 0.0;  // of the last frame with uploads
+    double maxFrameMiliseconds = 0.0;
+};
+
+class TextureUploader{
+
+public:
+
+    TextureUploader(size_t bufferSize = 4 * 1024 * 1024, unsigned int numberOfBuffers = 8,
+                    size_t maxBytesPerFrame = 8 * 1024 * 1024);
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    // a free buffer of at least size bytes mapped for writing (grows if needed) - false if all are busy
+    bool Acquire(size_t size, StagingBlock& block);
+
+    // return the block without an upload
+    void Release(StagingBlock& block);
+
+    // start the budget of the frame
+    void BeginFrame();
+
+    // true if size more bytes fit into the budget of the frame (counts the deferred uploads)
+    bool HasBudget(size_t size);
+
+    // call upload with the buffer bound to GL_PIXEL_UNPACK_BUFFER and the offset of the data,
+    // fence the buffer and release the block
+    void Upload(StagingBlock& block, const std::function<void(const void*)>& upload);
+
+    bool IsPersistent() const;
+
+    TextureUploaderStatistics GetStatistics() const;
+
+private:
+
+    enum BufferState : uint8_t{
+        BUFFER_FREE,
+        BUFFER_WRITING,             // acquired
+        BUFFER_IN_FLIGHT            // uploaded, waiting for its fence
+    };
+
+    struct StagingBuffer{
+        GLuint bufferID = 0;
+        size_t size = 0;
+        uint8_t* pointer = nullptr;     // persistent mapping
+        bool mapped = false;            // mapped for the block
+        BufferState state = BUFFER_FREE;
+        GLsync fence = nullptr;
+    };
+
+    void Create(StagingBuffer& buffer, size_t size);
+    void Destroy(StagingBuffer& buffer);
+
+    // true if the buffer is free - an in flight one becomes free once its fence is signaled
+    bool IsFree(StagingBuffer& buffer);
+
+    void Unmap(StagingBuffer& buffer);
+
+private:
+
+    std::vector<StagingBuffer> buffers;
+    unsigned int nextBuffer = 0;
+    bool persistent = false;
+
+    size_t maxBytesPerFrame;
+    size_t frameBytes = 0;
+    double frameMiliseconds = 0.0;
+
+    TextureUploaderStatistics statistics;
+
+};
+
+
+#endif
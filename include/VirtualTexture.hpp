@@ -0,0 +1,230 @@
+/** @file VirtualTexture.hpp
+ *  @brief Streaming virtual texture of a page file with a cache of resident pages
+ *
+ *  Only the pages (PageFile.hpp) the camera sees are in the GPU memory. The
+ *  parallax shader (VIRTUAL_TEXTURE variant) writes the pages it samples
+ *  into a feedback buffer - one bit per page, from one fragment of every
+ *  4x4 block, a different one each frame. The buffer is read back a few
+ *  frames later (after its fence, no stall) and the missing pages are
+ *  queued, the coarsest levels first.
+ *
+ *  VirtualTextureCache is the CPU side without GL: loader threads copy the
+ *  queued pages from the mapped file, CollectLoaded assigns them a slot of
+ *  the physical texture - a free one, or the least recently used slot whose
+ *  page was not requested this frame. The page of the coarsest level is
+ *  never evicted, so every texel has a resident ancestor. The indirection
+ *  table has a texel per page and level: the slot of the page or of its
+ *  nearest resident ancestor and the level of that page.
+ *
+ *  VirtualTexture uploads the slots into the physical textures (albedo with
+ *  height, normal) and the indirection table into a mip mapped integer
+ *  texture read by the shader.
+ *
+ *  Usage:
+ *      virtualTexture.Update();            // before the draws - feedback, loaded pages, indirection
+ *      ... draws with the VIRTUAL_TEXTURE shaders ...
+ *      virtualTexture.EndFrame();          // after the draws
+ *
+ *  @author Adam Bosak
+ *  @bug No known bugs.
+ */
+
+#ifndef VIRTUALTEXTURE_HPP
+#define VIRTUALTEXTURE_HPP
+
+#include <glad/glad.h>
+
+// STL
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <cstdint>
+
+#include "PageFile.hpp"
+#include "Shader.hpp"
+
+// counters since the cache was created (residentPages and queuedPages are current)
+struct VirtualTextureStatistics{
+    uint64_t frames = 0;
+    uint64_t requests = 0;      // pages in the feedback
+    uint64_t hits = 0;          // requested pages that were resident
+    uint64_t misses = 0;        // requested pages that were not (queued or still loading)
+    uint64_t uploads = 0;       // pages placed into a slot
+    uint64_t evictions = 0;
+    uint64_t dropped = 0;       // queued pages no longer requested when a loader got to them
+    uint64_t bytesRead = 0;     // page data copied from the file
+    unsigned int residentPages = 0;
+    unsigned int queuedPages = 0;
+};
+
+// loaded page placed into a slot of the physical texture
+struct PageUpload{
+    uint32_t pageID;
+    uint32_t slot;
+    std::vector<uint8_t> data;  // layers of the page (PageFile::GetPage)
+};
+
+class VirtualTextureCache{
+
+public:
+
+    // slotsPerSide^2 slots, loaders = 0 loads the pages in CollectLoaded (deterministic)
+    VirtualTextureCache(const PageFile* pageFile, unsigned int slotsPerSide = 24, unsigned int loaders = 2);
+    ~VirtualTextureCache();
+
+    VirtualTextureCache(const VirtualTextureCache&) = delete;
+    VirtualTextureCache& operator=(const VirtualTextureCache&) = delete;
+
+    // pages requested by a frame - marks them used and queues the missing ones with their ancestors
+    void ProcessFeedback(const std::vector<uint32_t>& pageIDs);
+
+    // place up to maxUploads loaded pages into slots
+    std::vector<PageUpload> CollectLoaded(unsigned int maxUploads);
+
+    // rebuild the indirection table if a page became resident or was evicted, false if it did not change
+    bool UpdateIndirection();
+
+    // RGBA8 texels (slot x, slot y, level, 1) per page of a level
+    const std::vector<uint8_t>& GetIndirection(uint32_t level) const;
+
+    // slot of the coarsest page (uploaded when the cache is created)
+    PageUpload GetPinnedPage() const;
+
+    unsigned int GetSlotsPerSide() const;
+
+    VirtualTextureStatistics GetStatistics() const;
+
+    // level and position of a page
+    uint32_t GetPageLevel(uint32_t pageID) const;
+    uint32_t GetPageID(uint32_t level, uint32_t x, uint32_t y) const;
+
+private:
+
+    enum PageState : uint8_t{
+        PAGE_NONE,
+        PAGE_QUEUED,
+        PAGE_LOADED,
+        PAGE_RESIDENT
+    };
+
+    struct PageEntry{
+        PageState state = PAGE_NONE;
+        uint32_t slot = 0;
+        uint64_t lastUsed = 0;  // frame of the last request
+    };
+
+    struct LoadedPage{
+        uint32_t pageID;
+        std::vector<uint8_t> data;
+    };
+
+    void LoaderLoop();
+
+    // copy the page from the file (no lock held)
+    LoadedPage LoadPage(uint32_t pageID) const;
+
+    // true if a loader should skip the page - not requested for a while (lock held)
+    bool IsStale(uint32_t pageID) const;
+
+    // a free slot or the least recently used one not requested this frame, false if all are in use (lock held)
+    bool AcquireSlot(uint32_t& slot);
+
+private:
+
+    const PageFile* pageFile;
+    uint32_t numberOfLevels;
+    uint32_t pinnedPage;
+
+    std::vector<PageEntry> pages;
+    std::vector<uint32_t> slotPages;    // page in each slot, UINT32_MAX = free
+    unsigned int slotsPerSide;
+
+    std::vector<std::vector<uint8_t>> indirection;
+    bool indirectionDirty = true;
+
+    uint64_t frame = 1;
+    VirtualTextureStatistics statistics;
+
+    // pages waiting for the loaders and the pages they loaded
+    std::deque<uint32_t> queue;
+    std::vector<LoadedPage> loaded;
+
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::thread> loaders;
+    bool stop = false;
+
+};
+
+
+class VirtualTexture{
+
+public:
+
+    VirtualTexture();
+    ~VirtualTexture();
+
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+    // open the page file and create the textures - false if it can not be read
+    bool Open(const std::string& path, unsigned int slotsPerSide = 24, unsigned int loaders = 2);
+
+    // write the feedback of every frame into the file (replayed by RunVirtualTextureSimulation)
+    bool Record(const std::string& path);
+
+    // read back the feedback of an older frame, upload the loaded pages and the indirection table,
+    // clear and bind the feedback buffer of this frame
+    void Update();
+
+    // fence the feedback buffer of the frame
+    void EndFrame();
+
+    // bind the textures - bindPipeline also uploads the uniforms of the bound shader
+    void Bind(Shader* shader, bool bindPipeline);
+
+    // physical albedo texture (batch key)
+    GLuint GetID() const;
+
+    VirtualTextureStatistics GetStatistics() const;
+
+    // feedback bits of the frames
+    static const unsigned int feedbackBinding = 8;
+
+private:
+
+    void UploadPage(const PageUpload& upload);
+
+private:
+
+    PageFile pageFile;
+    std::unique_ptr<VirtualTextureCache> cache;
+
+    // albedo + height and normal slots, indirection table
+    GLuint physicalTextures[2] = {0, 0};
+    GLuint indirectionTexture = 0;
+
+    // bit per page, written numberOfFeedbackBuffers frames before it is read
+    static const unsigned int numberOfFeedbackBuffers = 3;
+    GLuint feedbackBuffers[numberOfFeedbackBuffers] = {0, 0, 0};
+    GLsync feedbackFences[numberOfFeedbackBuffers] = {nullptr, nullptr, nullptr};
+    unsigned int currentFeedback = 0;
+    unsigned int feedbackWords = 0;
+    std::vector<uint32_t> feedbackBits;
+
+    // pages placed into the physical textures per frame
+    unsigned int maxUploadsPerFrame = 16;
+
+    unsigned int frame = 0;
+
+    std::ofstream recordFile;
+
+};
+
+
+#endif
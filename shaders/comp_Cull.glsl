@@ -0,0 +1,145 @@
+#version 430 core
+
+// frustum, meshlet cone and Hi-Z occlusion culling of the static draws
+// every visible draw is appended to the commands of its batch
+// (GPUCulling::CullDraws is the CPU version of this shader)
+
+layout(local_size_x = 64) in;
+
+// DrawElementsIndirectCommand
+struct DrawCommand{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+struct CullObject{
+    vec4 sphere;    // world space center, radius (negative = nothing to draw)
+    vec4 cone;      // world space axis, cutoff (>= 1 = no backface culling)
+    uvec4 batch;    // batch index, first slot of the batch
+};
+
+layout(std430, binding = 1) readonly buffer CullObjects{
+    CullObject objects[];
+};
+
+layout(std430, binding = 2) readonly buffer StaticCommands{
+    DrawCommand staticCommands[];
+};
+
+layout(std430, binding = 3) writeonly buffer OutputCommands{
+    DrawCommand outputCommands[];
+};
+
+layout(std430, binding = 4) buffer DrawCounts{
+    uint drawCounts[];
+};
+
+layout(std430, binding = 5) readonly buffer CullParameters{
+    mat4 occlusionViewProjection;   // frame of the depth pyramid
+    vec4 frustumPlanes[6];
+    vec4 pyramidSize;               // width, height, levels
+    uvec4 info;                     // number of draws, occlusion culling
+    vec4 cameraPosition;
+};
+
+uniform sampler2D u_DepthPyramid;
+
+
+bool IsSphereVisible(vec4 sphere){
+
+    for (int i = 0; i < 6; i++){
+        if (dot(frustumPlanes[i].xyz, sphere.xyz) + frustumPlanes[i].w < -sphere.w){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// all triangles of the meshlet face away from the camera
+bool IsConeBackfacing(vec4 sphere, vec4 cone){
+
+    if (cone.w >= 1.0){
+        return false;
+    }
+
+    vec3 toCenter = sphere.xyz - cameraPosition.xyz;
+    return dot(toCenter, cone.xyz) >= cone.w * length(toCenter) + sphere.w;
+}
+
+
+bool IsSphereOccluded(vec4 sphere){
+
+    // screen rectangle and nearest depth of the box around the sphere
+    vec2 minimum = vec2(1.0);
+    vec2 maximum = vec2(0.0);
+    float nearestDepth = 1.0;
+
+    for (int i = 0; i < 8; i++){
+
+        vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0,
+                                                   (i & 2) != 0 ? 1.0 : -1.0,
+                                                   (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = occlusionViewProjection * vec4(corner, 1.0);
+
+        if (clip.w <= 0.0){ // reaches behind the camera
+            return false;
+        }
+
+        vec3 ndc = clip.xyz / clip.w;
+        minimum = min(minimum, ndc.xy * 0.5 + 0.5);
+        maximum = max(maximum, ndc.xy * 0.5 + 0.5);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+    }
+
+    minimum = clamp(minimum, 0.0, 1.0);
+    maximum = clamp(maximum, 0.0, 1.0);
+
+    // level where the rectangle covers at most 2 x 2 texels
+    vec2 size = (maximum - minimum) * pyramidSize.xy;
+    int level = int(ceil(log2(max(max(size.x, size.y), 1.0))));
+    level = min(level, int(pyramidSize.z) - 1);
+
+    ivec2 levelSize = max(ivec2(pyramidSize.xy) >> level, ivec2(1));
+    ivec2 first = min(ivec2(minimum * vec2(levelSize)), levelSize - 1);
+    ivec2 last = min(ivec2(maximum * vec2(levelSize)), levelSize - 1);
+
+    float farthest = max(max(texelFetch(u_DepthPyramid, first, level).r,
+                             texelFetch(u_DepthPyramid, ivec2(last.x, first.y), level).r),
+                         max(texelFetch(u_DepthPyramid, ivec2(first.x, last.y), level).r,
+                             texelFetch(u_DepthPyramid, last, level).r));
+
+    return nearestDepth > farthest;
+}
+
+
+void main(){
+
+    uint slot = gl_GlobalInvocationID.x;
+
+    if (slot >= info.x){
+        return;
+    }
+
+    CullObject object = objects[slot];
+
+    if (object.sphere.w < 0.0 || !IsSphereVisible(object.sphere) || IsConeBackfacing(object.sphere, object.cone)){
+        return;
+    }
+
+    if (info.y != 0u && IsSphereOccluded(object.sphere)){
+        return;
+    }
+
+    // compact the visible draws at the start of the batch
+    uint index = atomicAdd(drawCounts[object.batch.x], 1u);
+
+    DrawCommand command = staticCommands[slot];
+    command.instanceCount = 1u;
+    outputCommands[object.batch.y + index] = command;
+
+}
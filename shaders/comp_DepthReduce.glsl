@@ -0,0 +1,35 @@
+#version 430 core
+
+// one level of the depth pyramid - farthest depth of the covered source texels
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D u_Source;     // depth copy (level 0) or the previous level of the pyramid
+uniform int u_SourceLevel;
+
+layout(r32f, binding = 0) uniform writeonly image2D u_Destination;
+
+void main(){
+
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 destinationSize = imageSize(u_Destination);
+
+    if (texel.x >= destinationSize.x || texel.y >= destinationSize.y){
+        return;
+    }
+
+    // source texels covered by the destination texel (up to 3 x 3 for level 0)
+    ivec2 sourceSize = textureSize(u_Source, u_SourceLevel);
+    ivec2 first = (texel * sourceSize) / destinationSize;
+    ivec2 last = min(((texel + 1) * sourceSize + destinationSize - 1) / destinationSize, sourceSize) - 1;
+
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++){
+        for (int x = first.x; x <= last.x; x++){
+            depth = max(depth, texelFetch(u_Source, ivec2(x, y), u_SourceLevel).r);
+        }
+    }
+
+    imageStore(u_Destination, texel, vec4(depth));
+
+}
@@ -0,0 +1,187 @@
+#version 450 core
+// Lighting pass of the deferred path - shades every pixel of the G-buffer (GBuffer.hpp) once
+
+	///////////// structs /////////////
+
+// point light (PointLightData in LightClusters.hpp)
+struct PointLightData{
+
+	vec4 positionRadius;	// world position, range (0 = key light without attenuation)
+	vec4 color;				// rgb, w = intensity
+
+};
+
+// struct for a material
+struct Material {
+
+	vec3 Ka; // ambient
+	vec3 Kd; // defuse
+	vec3 Ks; // specular
+	float shininess;
+
+};
+
+// per-draw data (PerDrawData in RenderQueue.hpp)
+struct PerDraw{
+
+	mat4 model;
+	mat4 normalMatrix;	// mat3 in the upper left corner
+	vec4 Ka;
+	vec4 Kd;
+	vec4 Ks;			// w = shininess
+	ivec4 flags;		// usedLight, parallaxMethod, continuousTexture, layer budget (0 = unlimited)
+
+};
+
+	///////////// outputs /////////////
+
+// out color for fragment
+out vec4 color;
+
+
+	///////////// uniforms /////////////
+
+// G-buffer
+uniform sampler2D gAlbedo;		// diffuse texture
+uniform sampler2D gNormal;		// xy = octahedral world normal, z = parallax depth along the view ray
+uniform usampler2D gDraw;		// per-draw record of the surface
+uniform sampler2D gDepth;
+
+// camera
+uniform mat4 u_InverseViewProjection;
+uniform mat4 u_ViewMatrix;
+uniform vec3 u_CameraPos;
+
+// records of all draws of the frame
+layout(std430, binding = 0) readonly buffer PerDrawBuffer{
+	PerDraw draws[];
+};
+
+// all lights of the scene - usedLight is the key light of the object
+layout(std430, binding = 6) readonly buffer LightBuffer{
+	PointLightData lights[];
+};
+
+// froxel grid (LightClusters.hpp) - (first, count) pairs of the clusters, then their light indices
+layout(std430, binding = 7) readonly buffer LightClusterBuffer{
+	vec4 clusterDepth;		// near, far, slice scale, slice bias
+	uvec4 clusterGrid;		// tiles x, tiles y, slices, tile size in pixels
+	uint clusterData[];
+};
+
+// material struct
+Material objectMaterial;
+
+
+// unit vector from the octahedral encoding (ObjectParser::Encode_Octahedral)
+vec3 DecodeOctahedral(vec2 e){
+
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-v.z, 0.0);
+	v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+
+	return normalize(v);
+}
+
+
+// diffuse and specular light of the local lights in the cluster of the fragment (world space)
+vec3 compute_ClusterLights(vec3 normal, vec3 position, vec3 viewDir){
+
+	// exponential depth slice and screen tile of the fragment
+	float viewDepth = max(-(u_ViewMatrix * vec4(position, 1.0f)).z, clusterDepth.x);
+	uint slice = min(uint(max(log(viewDepth) * clusterDepth.z + clusterDepth.w, 0.0f)), clusterGrid.z - 1u);
+	uvec2 tile = min(uvec2(gl_FragCoord.xy) / clusterGrid.w, clusterGrid.xy - 1u);
+	uint cluster = (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+
+	uint first = clusterData[2u * cluster];
+	uint count = clusterData[2u * cluster + 1u];
+
+	vec3 result = vec3(0.0f, 0.0f, 0.0f);
+	for (uint i = 0u; i < count; i++){
+
+		PointLightData light = lights[clusterData[first + i]];
+
+		vec3 toLight = light.positionRadius.xyz - position;
+		float distanceFromLight = max(length(toLight), 0.0001f);
+
+		// inverse square falloff windowed to zero at the range the light was binned with
+		float window = clamp(1.0f - pow(distanceFromLight / light.positionRadius.w, 4.0f), 0.0f, 1.0f);
+		float attenuation = window * window / (1.0f + distanceFromLight * distanceFromLight);
+		if (attenuation <= 0.0f)
+			continue;
+
+		vec3 lightDirection = toLight / distanceFromLight;
+		float diffuseEl = max( dot(normal, lightDirection) , 0);
+
+		float specularEl = 0.0f;
+		if ( diffuseEl != 0 ){
+			vec3 reflectionLight = reflect( -lightDirection, normal );
+			specularEl = pow( max(dot(viewDir, reflectionLight), 0) , objectMaterial.shininess );
+		}
+
+		result += attenuation * light.color.w * light.color.rgb *
+				  (diffuseEl * objectMaterial.Kd + specularEl * objectMaterial.Ks);
+	}
+
+	return result;
+}
+
+
+// Entry point of program
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+	// no surface - the skybox is drawn later
+	float depth = texelFetch(gDepth, pixel, 0).r;
+	if (depth >= 1.0f)
+		discard;
+
+	gl_FragDepth = depth;
+
+					// surface of the pixel
+	// world position of the drawn surface, moved below it by the parallax depth
+	vec2 ndc = (vec2(pixel) + 0.5f) / vec2(textureSize(gDepth, 0)) * 2.0f - 1.0f;
+	vec4 world = u_InverseViewProjection * vec4(ndc, depth * 2.0f - 1.0f, 1.0f);
+	vec3 fragPosWorld = world.xyz / world.w;
+
+	vec4 normalDepth = texelFetch(gNormal, pixel, 0);
+	vec3 viewDirection = normalize( u_CameraPos - fragPosWorld );
+	fragPosWorld -= viewDirection * normalDepth.z;
+	vec3 normalWorld = DecodeOctahedral(normalDepth.xy);
+
+	// per-draw material and light
+	PerDraw drawData = draws[texelFetch(gDraw, pixel, 0).r];
+	objectMaterial = Material(drawData.Ka.xyz, drawData.Kd.xyz, drawData.Ks.xyz, drawData.Ks.w);
+
+	// get the key light of the object
+	PointLightData currentLight = lights[drawData.flags.x];
+
+					// calculate phong ligting model (world space)
+	// ambient element
+	vec3 ambient = objectMaterial.Ka * currentLight.color.rgb;
+
+	// diffuse element
+	vec3 lightDirection = normalize( currentLight.positionRadius.xyz - fragPosWorld );
+
+	float diffuseEl = max( dot(normalWorld, lightDirection) , 0);
+	vec3 diffuse = diffuseEl * objectMaterial.Kd * currentLight.color.rgb;
+
+	// specular element
+	vec3 specular = vec3(0.0f, 0.0f, 0.0f);
+	if ( diffuseEl != 0 ){
+		vec3 reflectionLight = reflect( -lightDirection, normalWorld );
+		float specularEl = pow( max(dot(viewDirection, reflectionLight), 0) , objectMaterial.shininess );
+		specular = specularEl * objectMaterial.Ks * currentLight.color.rgb;
+	}
+
+					// final phong intensity
+	vec3 intensity = ambient + diffuse + specular;
+
+					// local lights of the cluster
+	intensity += compute_ClusterLights(normalWorld, fragPosWorld, viewDirection);
+
+	// output final color with intensity
+	color = vec4(intensity, 1.0f) * texelFetch(gAlbedo, pixel, 0);
+
+}
@@ -0,0 +1,7 @@
+#version 450 core
+// Fragment shader of the depth prepass - only the depth is written
+
+void main()
+{
+
+}
@@ -1,21 +1,16 @@
-#version 410 core
+#version 450 core
 
-	///////////// structs /////////////
-
-// struct for a point lights
-struct PointLight{
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
 
-	vec3 position;
-	vec3 lightColor;
+	///////////// structs /////////////
 
-	// attenuation
-	float constant;
-	float linear;
-	float quadratic;
+// point light (PointLightData in LightClusters.hpp)
+struct PointLightData{
 
-	float ambientStrength;
-    float diffusionStrengh;
-    float specularStrengh;	
+	vec4 positionRadius;	// world position, range (0 = key light without attenuation)
+	vec4 color;				// rgb, w = intensity
 
 };
 
@@ -29,6 +24,30 @@ struct Material {
 
 };
 
+// per-draw data (PerDrawData in RenderQueue.hpp)
+struct PerDraw{
+
+	mat4 model;
+	mat4 normalMatrix;	// mat3 in the upper left corner
+	vec4 Ka;			// w = layer of the material arrays
+	vec4 Kd;			// w = bindless material
+	vec4 Ks;			// w = shininess
+	ivec4 flags;		// usedLight, parallaxMethod, continuousTexture, layer budget (0 = unlimited)
+
+};
+
+#ifdef BINDLESS
+// handles of the textures of a material (MaterialTextures in MaterialTable.hpp)
+struct MaterialTextures{
+
+	uvec2 diffuse;
+	uvec2 normal;
+	uvec2 height;
+	uvec2 unused;
+
+};
+#endif
+
 	///////////// function declarations /////////////
 
 vec2 compute_ParallaxOffset(vec2 oldTexcoord, vec3 viewTo);
@@ -36,6 +55,17 @@ vec2 compute_Parallax_Steep(vec2 oldTexCoord, vec3 viewDir);
 vec2 compute_Parallax_Occlusion(vec2 oldTexCoord, vec3 viewDir);
 vec2 compute_Parallax_Occlusion_Binary(vec2 oldTexCoord, vec3 viewDir);
 vec2 binary_search(vec2 texCoordL, float depthL, vec2 texCoordR, float depthR, float eps);
+float compute_NumberOfLayers(float numLayersMin, float numLayersMax, vec3 viewDir);
+vec3 compute_ClusterLights(vec3 normal, vec3 position, vec3 viewDir);
+vec2 EncodeOctahedral(vec3 n);
+vec3 DecodeNormal(vec4 texel);
+float SampleHeight(vec2 texCoord);
+vec4 SampleDiffuse(vec2 texCoord);
+vec4 SampleNormal(vec2 texCoord);
+#ifdef VIRTUAL_TEXTURE
+vec2 VirtualAddress(vec2 texCoord);
+void WriteVirtualFeedback(vec2 texCoord);
+#endif
 
 
 	///////////// inputs from vertex shader /////////////
@@ -48,32 +78,122 @@ in vec3 tangentCameraPos;
 in vec3 tangentLightPos;
 in vec3 tangentFragmentPos;
 
+// world space position and tangent frame for the clustered lights
+in vec3 fragPosWorld;
+in mat3 tangentToWorld;
+
+flat in int drawID_frag;
+
 	///////////// outputs /////////////
 
+#ifdef GBUFFER
+// surface for the lighting pass (GBuffer.hpp)
+layout(location = 0) out vec4 gAlbedo;
+layout(location = 1) out vec4 gNormal;		// xy = octahedral world normal, z = parallax depth along the view ray
+layout(location = 2) out uint gDraw;
+#else
 // out color for fragment
 out vec4 color;
+#endif
 
 
 	///////////// uniforms /////////////
 
-// defined variables
-#define MAX_LIGHTS 10
+// records of all draws of the frame
+layout(std430, binding = 0) readonly buffer PerDrawBuffer{
+	PerDraw draws[];
+};
 
+// per-draw values (set at the beginning of main)
+int usedLight;
+int parallaxMethod;
+int continuousTexture; // if the texture is connected to another tile of the same texture
+int layerBudget;	   // maximum layers of the ray marched methods chosen on the CPU, 0 = unlimited
+
+// distance based quality (ParallaxLodSettings) - 0 disables the fading
+uniform int u_ParallaxLod;
+uniform float u_ParallaxFullDistance;	// full method up to here, then it fades to parallax offset
+uniform float u_ParallaxOffsetDistance;	// parallax offset from here, fading to normal mapping
+uniform float u_ParallaxNormalDistance;	// normal mapping only
+uniform float u_ParallaxMipLevel;		// height map mip level that counts as far
+
+// quality of the fragment (set at the beginning of main)
+float layerQuality = 1.0f;	// part of the layers of the ray marched methods
+float offsetWeight = 1.0f;	// weight of the parallax offset against plain normal mapping
+
+// all lights of the scene - usedLight is the key light of the object
+layout(std430, binding = 6) readonly buffer LightBuffer{
+	PointLightData lights[];
+};
 
-uniform int usedLight;
-uniform int parallaxMethod;
-uniform int continuousTexture; // if the texture is connected to another tile of the same texture
+// froxel grid (LightClusters.hpp) - (first, count) pairs of the clusters, then their light indices
+layout(std430, binding = 7) readonly buffer LightClusterBuffer{
+	vec4 clusterDepth;		// near, far, slice scale, slice bias
+	uvec4 clusterGrid;		// tiles x, tiles y, slices, tile size in pixels
+	uint clusterData[];
+};
 
-// array of lights in the scene
-uniform PointLight u_Lights[MAX_LIGHTS];
+// camera of the clustered lights
+uniform mat4 u_ViewMatrix;
+uniform vec3 u_CameraPos;
 
 // material struct
-uniform Material objectMaterial;
+Material objectMaterial;
 
 // texture sampler
+#ifdef VIRTUAL_TEXTURE
+// resident pages of the virtual texture (VirtualTexture.hpp) - albedo with the height in alpha, normal
 uniform sampler2D diffuseTexture;
 uniform sampler2D normalTexture;
+
+// slot and level of the nearest resident page, one texel per page and level
+uniform usampler2D u_VirtualPageTable;
+uniform int u_VirtualPages;			// pages per side of level 0
+uniform int u_VirtualLevels;
+uniform int u_VirtualPageSize;		// texels per side of a page without the border
+uniform int u_VirtualBorder;
+uniform int u_VirtualSlots;			// slots per side of the physical textures
+uniform float u_VirtualSourceLevel;	// log2 of the virtual size over the size of the source textures
+uniform int u_VirtualFeedbackFrame;
+
+// bit per page sampled by the frame (read back by the CPU)
+layout(std430, binding = 8) buffer VirtualFeedbackBuffer{
+	uint feedbackBits[];
+};
+
+float virtualLevel;	// level of the fragment (set at the beginning of main)
+#elif defined(BINDLESS)
+// handles of all materials, the material is per draw (Kd.w) - the arrays of the ground materials or textures
+layout(std430, binding = 9) readonly buffer MaterialBuffer{
+	MaterialTextures materials[];
+};
+
+int materialIndex;
+#ifdef MATERIAL_ARRAY
+#define diffuseTexture sampler2DArray(materials[materialIndex].diffuse)
+#define normalTexture sampler2DArray(materials[materialIndex].normal)
+#define displacementTexture sampler2DArray(materials[materialIndex].height)
+float materialLayer;
+#else
+#define diffuseTexture sampler2D(materials[materialIndex].diffuse)
+#define normalTexture sampler2D(materials[materialIndex].normal)
+#define displacementTexture sampler2D(materials[materialIndex].height)
+#endif
+#elif defined(MATERIAL_ARRAY)
+// layers of the ground materials, the layer is per draw (Ka.w)
+uniform sampler2DArray diffuseTexture;
+uniform sampler2DArray normalTexture;
+#ifndef PACKED_MATERIAL
+uniform sampler2DArray displacementTexture;
+#endif
+float materialLayer;
+#else
+uniform sampler2D diffuseTexture;
+uniform sampler2D normalTexture;
+#ifndef PACKED_MATERIAL
 uniform sampler2D displacementTexture;
+#endif
+#endif
 
 
 // debug counter
@@ -84,34 +204,97 @@ float MAX_ITER = 10;
 // Entry point of program
 void main()
 {
-	// get current light in the scene
-	PointLight currentLight = u_Lights[usedLight];
+	// per-draw material and light
+	PerDraw drawData = draws[drawID_frag];
+	objectMaterial = Material(drawData.Ka.xyz, drawData.Kd.xyz, drawData.Ks.xyz, drawData.Ks.w);
+#ifdef MATERIAL_ARRAY
+	materialLayer = drawData.Ka.w;
+#endif
+#ifdef BINDLESS
+	materialIndex = int(drawData.Kd.w);
+#endif
+	usedLight = drawData.flags.x;
+	parallaxMethod = drawData.flags.y;
+	continuousTexture = drawData.flags.z;
+	layerBudget = drawData.flags.w;
+
+	// get the key light of the object
+	PointLightData currentLight = lights[usedLight];
+
+					// fade the quality with the distance and the footprint of the height map
+	// (queried before any branch - the level of detail needs the derivatives)
+#ifdef VIRTUAL_TEXTURE
+	// the pages have no mipmaps - the level comes from the footprint of the fragment
+	vec2 virtualTexel = texcoord_frag * float(u_VirtualPages * u_VirtualPageSize);
+	float footprint = max(dot(dFdx(virtualTexel), dFdx(virtualTexel)), dot(dFdy(virtualTexel), dFdy(virtualTexel)));
+	virtualLevel = clamp(floor(0.5f * log2(max(footprint, 1.0f))), 0.0f, float(u_VirtualLevels - 1));
+	float heightMipLevel = virtualLevel - u_VirtualSourceLevel;
+	WriteVirtualFeedback(texcoord_frag);
+#elif defined(PACKED_MATERIAL)
+	float heightMipLevel = textureQueryLod(normalTexture, texcoord_frag).y;
+#else
+	float heightMipLevel = textureQueryLod(displacementTexture, texcoord_frag).y;
+#endif
+	if (u_ParallaxLod != 0){
+		float viewDistance = length( tangentCameraPos - tangentFragmentPos );
+		layerQuality = min(1.0f - smoothstep(u_ParallaxFullDistance, u_ParallaxOffsetDistance, viewDistance),
+						   1.0f - smoothstep(u_ParallaxMipLevel - 1.0f, u_ParallaxMipLevel, heightMipLevel));
+		offsetWeight = min(1.0f - smoothstep(u_ParallaxOffsetDistance, u_ParallaxNormalDistance, viewDistance),
+						   1.0f - smoothstep(u_ParallaxMipLevel, u_ParallaxMipLevel + 1.0f, heightMipLevel));
+	}
+
+#ifdef GBUFFER
+	// world units per texture unit - turns the depth in the height map into a distance
+	float texcoordArea = abs(determinant(mat2(dFdx(texcoord_frag), dFdy(texcoord_frag))));
+	float worldArea = length(cross(dFdx(fragPosWorld), dFdy(fragPosWorld)));
+	float worldPerTexcoord = texcoordArea > 0.0f ? sqrt(worldArea / texcoordArea) : 0.0f;
+#endif
 
 					// calculate the new texture coordinates based on parallax
 	vec3 viewDirection = normalize( tangentCameraPos - tangentFragmentPos );
-	vec2 displacedTexCoord = vec2(0.0f, 0.0f);
+	vec2 displacedTexCoord = texcoord_frag;
 
 	// choose parallax method
-	if (parallaxMethod == 0)
-		displacedTexCoord = compute_ParallaxOffset(texcoord_frag, viewDirection);
-	else if (parallaxMethod == 1)
-		displacedTexCoord = compute_Parallax_Steep(texcoord_frag, viewDirection);
-	else if (parallaxMethod == 2)
-		displacedTexCoord = compute_Parallax_Occlusion(texcoord_frag, viewDirection);
-	else if (parallaxMethod == 3)
-		displacedTexCoord = compute_Parallax_Occlusion_Binary(texcoord_frag, viewDirection);
+	if (parallaxMethod >= 1 && layerQuality > 0.0f){
+
+		if (parallaxMethod == 1)
+			displacedTexCoord = compute_Parallax_Steep(texcoord_frag, viewDirection);
+		else if (parallaxMethod == 2)
+			displacedTexCoord = compute_Parallax_Occlusion(texcoord_frag, viewDirection);
+		else if (parallaxMethod == 3)
+			displacedTexCoord = compute_Parallax_Occlusion_Binary(texcoord_frag, viewDirection);
+
+		// blend to the parallax offset where the layers fade out
+		if (layerQuality < 1.0f)
+			displacedTexCoord = mix(compute_ParallaxOffset(texcoord_frag, viewDirection), displacedTexCoord, layerQuality);
+	}
+	else if (parallaxMethod >= 0 && offsetWeight > 0.0f){
+		displacedTexCoord = mix(texcoord_frag, compute_ParallaxOffset(texcoord_frag, viewDirection), offsetWeight);
+	}
 
+#ifdef GBUFFER
+					// material and lighting are resolved by the lighting pass
+	// depth of the hit below the surface along the view ray (height_scale of the parallax functions)
+	float parallaxWeight = parallaxMethod >= 1 && layerQuality > 0.0f ? 1.0f : (parallaxMethod >= 0 ? offsetWeight : 0.0f);
+	float parallaxDepth = parallaxWeight * SampleHeight(displacedTexCoord) * 0.08f *
+						  worldPerTexcoord / max(viewDirection.z, 0.1f);
+
+	vec3 normalTangent = DecodeNormal(SampleNormal(displacedTexCoord));
+	gAlbedo = SampleDiffuse(displacedTexCoord);
+	gNormal = vec4(EncodeOctahedral(normalize( tangentToWorld * normalTangent )), parallaxDepth, 0.0f);
+	gDraw = uint(drawID_frag);
+#else
 					// calculate phong ligting model
 	// ambient element
-	vec3 ambient = objectMaterial.Ka * currentLight.lightColor;
+	vec3 ambient = objectMaterial.Ka * currentLight.color.rgb;
 	
 	// diffuse element
-	vec3 normal_frag = normalize( vec3(texture(normalTexture, displacedTexCoord))*2.0 - 1.0 ); 
+	vec3 normal_frag = DecodeNormal(SampleNormal(displacedTexCoord)); 
 
 	vec3 lightDirection = normalize( tangentLightPos - tangentFragmentPos );
 	
 	float diffuseEl = max( dot(normal_frag, lightDirection) , 0);
-	vec3 diffuse = diffuseEl * objectMaterial.Kd * currentLight.lightColor;
+	vec3 diffuse = diffuseEl * objectMaterial.Kd * currentLight.color.rgb;
 
 
 	// specular element
@@ -121,7 +304,7 @@ void main()
 
 		vec3 reflectionLight = reflect( -lightDirection, normal_frag );
 		float specularEl = pow( max(dot(viewDirection, reflectionLight), 0) , alpha );
-		specular = specularEl * objectMaterial.Ks * currentLight.lightColor;
+		specular = specularEl * objectMaterial.Ks * currentLight.color.rgb;
 	}
 
 					// final phong intensity
@@ -131,17 +314,20 @@ void main()
 					// add attenuation
 	// distance is not changed by orthonormal transformation - we can use tangent coordinates
 	float distanceFromLight = length( tangentLightPos - tangentFragmentPos ); 
-	float attenuation = 1 / (currentLight.constant
-							 + currentLight.linear * distanceFromLight 
-							 + currentLight.quadratic * pow(distanceFromLight, 2));
+	float attenuation = 1 / (1.0f + 0.3f * distanceFromLight + 0.4f * pow(distanceFromLight, 2)); // PointLight defaults
 	
 	attenuation = clamp(attenuation, 0, 1);
 
 	// intensity *= 2* attenuation; // uncomment to see attenuation
 
+					// local lights of the cluster
+	vec3 normalWorld = normalize( tangentToWorld * normal_frag );
+	intensity += compute_ClusterLights(normalWorld, fragPosWorld, normalize( u_CameraPos - fragPosWorld ));
+
 	// output final color with intensity
-	color = vec4(intensity, 1.0f) * texture(diffuseTexture, displacedTexCoord);	
+	color = vec4(intensity, 1.0f) * SampleDiffuse(displacedTexCoord);	
 	// color = vec4(intensity, 1.0f) * vec4(counter / MAX_ITER, 0, 0, 1); // uncomment to see number of iterations per fragment
+#endif
 
 	
 }
@@ -153,7 +339,7 @@ void main()
 vec2 compute_ParallaxOffset(vec2 oldTexcoord, vec3 viewDir){
 
 	const float height_scale = 0.08f;
-	float height = texture(displacementTexture, oldTexcoord).r;
+	float height = SampleHeight(oldTexcoord);
 
 	// displace the texture coordinate based on the current height
 	vec2 displacement = (height * height_scale) * viewDir.xy / viewDir.z;
@@ -161,7 +347,8 @@ vec2 compute_ParallaxOffset(vec2 oldTexcoord, vec3 viewDir){
 
 	// discard the fragment if we get out of texture
 	if (newCoords.x > 1.0f || newCoords.x < 0.0f || newCoords.y > 1.0f || newCoords.y < 0.0f){
-		discard;
+		if (continuousTexture == 0)
+			discard;
 	}
 
 	return newCoords; 
@@ -177,12 +364,11 @@ vec2 compute_Parallax_Steep(vec2 oldTexCoord, vec3 viewDir){
 	const float numLayerMax  = 35.0f;
 
 	// define number of layers depending what direction we view the object
-	vec3 tangentObjNormal = vec3(0.0f, 0.0f, 1.0f); // normal is always e3 since we are in tangent space
-	float numberOfLayers = mix(numLayersMin, numLayerMax, max(dot(viewDir, tangentObjNormal), 0.0));
+	float numberOfLayers = compute_NumberOfLayers(numLayersMin, numLayerMax, viewDir);
 
 	// alloc initial current
 	float currentDepth = 0.0f;
-	float currentDepthMap = texture(displacementTexture, oldTexCoord).r;
+	float currentDepthMap = SampleHeight(oldTexCoord);
 	vec2 currentTexCoord = oldTexCoord;
 
 	// alloc variables for the method
@@ -199,7 +385,7 @@ vec2 compute_Parallax_Steep(vec2 oldTexCoord, vec3 viewDir){
 
 		// update the heights
 		currentDepth += depthPerLayer;
-		currentDepthMap = texture(displacementTexture, currentTexCoord).r;
+		currentDepthMap = SampleHeight(currentTexCoord);
 
 		// debug
 		counter++;
@@ -225,12 +411,11 @@ vec2 compute_Parallax_Occlusion(vec2 oldTexCoord, vec3 viewDir){
 	const float numLayerMax  = 30.0f;
 
 	// define number of layers depending what direction we view the object
-	vec3 tangentObjNormal = vec3(0.0f, 0.0f, 1.0f); // normal is always e3 since we are in tangent space
-	float numberOfLayers = mix(numLayersMin, numLayerMax, max(dot(viewDir, tangentObjNormal), 0.0));
+	float numberOfLayers = compute_NumberOfLayers(numLayersMin, numLayerMax, viewDir);
 
 	// alloc initial current
 	float currentDepth = 0.0f;
-	float currentDepthMap = texture(displacementTexture, oldTexCoord).r;
+	float currentDepthMap = SampleHeight(oldTexCoord);
 	vec2 currentTexCoord = oldTexCoord;
 
 	// alloc variables for the method
@@ -247,7 +432,7 @@ vec2 compute_Parallax_Occlusion(vec2 oldTexCoord, vec3 viewDir){
 
 		// update the heights
 		currentDepth += depthPerLayer;
-		currentDepthMap = texture(displacementTexture, currentTexCoord).r;
+		currentDepthMap = SampleHeight(currentTexCoord);
 
 		// debug
 		counter++;
@@ -261,7 +446,7 @@ vec2 compute_Parallax_Occlusion(vec2 oldTexCoord, vec3 viewDir){
 	
 	vec2  coordsBefore = currentTexCoord - deltaCoords; // reverse the step
 	float depthBefore = currentDepth - depthPerLayer;
-	float depthBeforeDiff = texture(displacementTexture, coordsBefore).r - depthBefore;
+	float depthBeforeDiff = SampleHeight(coordsBefore) - depthBefore;
 
 	// compute the weight
 	float w = depthAfterDiff / (depthAfterDiff + depthBeforeDiff);
@@ -288,12 +473,11 @@ vec2 compute_Parallax_Occlusion_Binary(vec2 oldTexCoord, vec3 viewDir){
 	const float eps 	     = 0.001f; // convergence check for binary search
 
 	// define number of layers depending what direction we view the object
-	vec3 tangentObjNormal = vec3(0.0f, 0.0f, 1.0f); // normal is always e3 since we are in tangent space
-	float numberOfLayers = mix(numLayersMin, numLayerMax, max(dot(viewDir, tangentObjNormal), 0.0));
+	float numberOfLayers = compute_NumberOfLayers(numLayersMin, numLayerMax, viewDir);
 
 	// alloc initial current
 	float currentDepth = 0.0f;
-	float currentDepthMap = texture(displacementTexture, oldTexCoord).r;
+	float currentDepthMap = SampleHeight(oldTexCoord);
 	vec2 currentTexCoord = oldTexCoord;
 
 	// alloc variables for the method
@@ -310,7 +494,7 @@ vec2 compute_Parallax_Occlusion_Binary(vec2 oldTexCoord, vec3 viewDir){
 
 		// update the heights
 		currentDepth += depthPerLayer;
-		currentDepthMap = texture(displacementTexture, currentTexCoord).r;
+		currentDepthMap = SampleHeight(currentTexCoord);
 
 		// debug
 		counter++;
@@ -353,7 +537,7 @@ vec2 binary_search(vec2 texCoordL, float depthL, vec2 texCoordR, float depthR, f
 
 		// get middle
 		midCoord = (texCoordL + texCoordR) / 2;
-		midDepthMap = texture(displacementTexture, midCoord).r;
+		midDepthMap = SampleHeight(midCoord);
 		midDepth = (depthL + depthR) / 2;
 
 		if (midDepthMap > midDepth){ // solution is in the left interval
@@ -381,8 +565,8 @@ vec2 binary_search(vec2 texCoordL, float depthL, vec2 texCoordR, float depthR, f
 								// compute occlusion mapping part
 
 	// compute the depth differences before and after the last step
-	float depthAfterDiff = depthL - texture(displacementTexture, texCoordL).r;
-	float depthBeforeDiff = texture(displacementTexture, texCoordR).r - depthR;
+	float depthAfterDiff = depthL - SampleHeight(texCoordL);
+	float depthBeforeDiff = SampleHeight(texCoordR) - depthR;
 
 	// compute the weight
 	float w = depthAfterDiff / (depthAfterDiff + depthBeforeDiff);
@@ -391,3 +575,153 @@ vec2 binary_search(vec2 texCoordL, float depthL, vec2 texCoordR, float depthR, f
 	return newTexCoord;
 
 }
+
+// number of layers of the ray marched methods - limited by the budget of the draw and the distance fade
+float compute_NumberOfLayers(float numLayersMin, float numLayersMax, vec3 viewDir){
+
+	// define number of layers depending what direction we view the object
+	vec3 tangentObjNormal = vec3(0.0f, 0.0f, 1.0f); // normal is always e3 since we are in tangent space
+	float numberOfLayers = mix(numLayersMin, numLayersMax, max(dot(viewDir, tangentObjNormal), 0.0));
+
+	if (layerBudget > 0)
+		numberOfLayers = min(numberOfLayers, float(layerBudget));
+
+	return max(numberOfLayers * layerQuality, 4.0f);
+}
+
+// diffuse and specular light of the local lights in the cluster of the fragment (world space)
+vec3 compute_ClusterLights(vec3 normal, vec3 position, vec3 viewDir){
+
+	// exponential depth slice and screen tile of the fragment
+	float viewDepth = max(-(u_ViewMatrix * vec4(position, 1.0f)).z, clusterDepth.x);
+	uint slice = min(uint(max(log(viewDepth) * clusterDepth.z + clusterDepth.w, 0.0f)), clusterGrid.z - 1u);
+	uvec2 tile = min(uvec2(gl_FragCoord.xy) / clusterGrid.w, clusterGrid.xy - 1u);
+	uint cluster = (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+
+	uint first = clusterData[2u * cluster];
+	uint count = clusterData[2u * cluster + 1u];
+
+	vec3 result = vec3(0.0f, 0.0f, 0.0f);
+	for (uint i = 0u; i < count; i++){
+
+		PointLightData light = lights[clusterData[first + i]];
+
+		vec3 toLight = light.positionRadius.xyz - position;
+		float distanceFromLight = max(length(toLight), 0.0001f);
+
+		// inverse square falloff windowed to zero at the range the light was binned with
+		float window = clamp(1.0f - pow(distanceFromLight / light.positionRadius.w, 4.0f), 0.0f, 1.0f);
+		float attenuation = window * window / (1.0f + distanceFromLight * distanceFromLight);
+		if (attenuation <= 0.0f)
+			continue;
+
+		vec3 lightDirection = toLight / distanceFromLight;
+		float diffuseEl = max( dot(normal, lightDirection) , 0);
+
+		float specularEl = 0.0f;
+		if ( diffuseEl != 0 ){
+			vec3 reflectionLight = reflect( -lightDirection, normal );
+			specularEl = pow( max(dot(viewDir, reflectionLight), 0) , objectMaterial.shininess );
+		}
+
+		result += attenuation * light.color.w * light.color.rgb *
+				  (diffuseEl * objectMaterial.Kd + specularEl * objectMaterial.Ks);
+	}
+
+	return result;
+}
+
+// octahedral encoding of a unit vector (inverse of DecodeOctahedral of the lighting pass)
+vec2 EncodeOctahedral(vec3 n){
+
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 e = n.xy;
+	if (n.z < 0.0f)
+		e = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+
+	return e;
+}
+
+// tangent space normal of the normal map - z is rebuilt from x and y (BC5 textures keep only red and green)
+vec3 DecodeNormal(vec4 texel){
+
+	vec2 xy = texel.rg * 2.0f - 1.0f;
+	return normalize(vec3(xy, sqrt(max(1.0f - dot(xy, xy), 0.0f))));
+}
+
+// depth of the height map - in the alpha of the normal map for a packed material
+float SampleHeight(vec2 texCoord){
+
+#ifdef VIRTUAL_TEXTURE
+	return textureLod(diffuseTexture, VirtualAddress(texCoord), 0.0f).a;
+#elif defined(PACKED_MATERIAL)
+	return SampleNormal(texCoord).a;
+#elif defined(MATERIAL_ARRAY)
+	return texture(displacementTexture, vec3(texCoord, materialLayer)).r;
+#else
+	return texture(displacementTexture, texCoord).r;
+#endif
+}
+
+// texels of the material - from its layer of the arrays
+vec4 SampleDiffuse(vec2 texCoord){
+
+#ifdef VIRTUAL_TEXTURE
+	return vec4(textureLod(diffuseTexture, VirtualAddress(texCoord), 0.0f).rgb, 1.0f);
+#elif defined(MATERIAL_ARRAY)
+	return texture(diffuseTexture, vec3(texCoord, materialLayer));
+#else
+	return texture(diffuseTexture, texCoord);
+#endif
+}
+
+vec4 SampleNormal(vec2 texCoord){
+
+#ifdef VIRTUAL_TEXTURE
+	return textureLod(normalTexture, VirtualAddress(texCoord), 0.0f);
+#elif defined(MATERIAL_ARRAY)
+	return texture(normalTexture, vec3(texCoord, materialLayer));
+#else
+	return texture(normalTexture, texCoord);
+#endif
+}
+
+#ifdef VIRTUAL_TEXTURE
+// position in the physical textures of a texel of the virtual texture - in the nearest resident page
+vec2 VirtualAddress(vec2 texCoord){
+
+	vec2 uv = fract(texCoord);
+	int level = int(virtualLevel);
+	int pages = max(u_VirtualPages >> level, 1);
+	uvec4 entry = texelFetch(u_VirtualPageTable, min(ivec2(uv * float(pages)), ivec2(pages - 1)), level);
+
+	// a coarser resident page covers more pages of the level
+	float residentPages = float(max(u_VirtualPages >> int(entry.z), 1));
+	vec2 inPage = fract(uv * residentPages);
+
+	float pageTexels = float(u_VirtualPageSize + 2 * u_VirtualBorder);
+	return (vec2(entry.xy) * pageTexels + float(u_VirtualBorder) + inPage * float(u_VirtualPageSize)) /
+		   (float(u_VirtualSlots) * pageTexels);
+}
+
+// request the page of the fragment - one fragment of every 4x4 block, a different one each frame
+void WriteVirtualFeedback(vec2 texCoord){
+
+	ivec2 block = ivec2(gl_FragCoord.xy) & 3;
+	if (block.x + 4 * block.y != (u_VirtualFeedbackFrame & 15))
+		return;
+
+	int level = int(virtualLevel);
+	int pages = max(u_VirtualPages >> level, 1);
+	ivec2 page = min(ivec2(fract(texCoord) * float(pages)), ivec2(pages - 1));
+
+	// the pages are stored level by level (PageFile.hpp)
+	uint pageID = uint(page.y * pages + page.x);
+	for (int i = 0; i < level; i++){
+		uint levelPages = uint(max(u_VirtualPages >> i, 1));
+		pageID += levelPages * levelPages;
+	}
+
+	atomicOr(feedbackBits[pageID >> 5], 1u << (pageID & 31u));
+}
+#endif
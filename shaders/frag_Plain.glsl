@@ -1,19 +1,10 @@
 #version 450 core
 
-// struct for a point lights
-struct PointLight{
+// point light (PointLightData in LightClusters.hpp)
+struct PointLightData{
 
-	vec3 position;
-	vec3 lightColor;
-
-	// attenuation
-	float constant;
-	float linear;
-	float quadratic;
-
-	float ambientStrength;
-    float diffusionStrengh;
-    float specularStrengh;	
+	vec4 positionRadius;	// world position, range (0 = key light without attenuation)
+	vec4 color;				// rgb, w = intensity
 
 };
 
@@ -27,6 +18,18 @@ struct Material {
 
 };
 
+// per-draw data (PerDrawData in RenderQueue.hpp)
+struct PerDraw{
+
+	mat4 model;
+	mat4 normalMatrix;	// mat3 in the upper left corner
+	vec4 Ka;
+	vec4 Kd;
+	vec4 Ks;			// w = shininess
+	ivec4 flags;		// usedLight, parallaxMethod, continuousTexture, unused
+
+};
+
 
 
 	///////////// inputs from vertex shader /////////////
@@ -35,51 +38,139 @@ struct Material {
 in vec2 texcoord_frag;
 in vec3 normalWorld;
 in vec3 fragPosWorld; 
+flat in int drawID_frag;
 
 	///////////// outputs /////////////
 
+#ifdef GBUFFER
+// surface for the lighting pass (GBuffer.hpp)
+layout(location = 0) out vec4 gAlbedo;
+layout(location = 1) out vec4 gNormal;		// xy = octahedral world normal, z = parallax depth along the view ray
+layout(location = 2) out uint gDraw;
+#else
 // out color for fragment
 out vec4 color;
+#endif
 
 
 	///////////// uniforms ////////////	
 
-uniform int usedLight;
-
-// defined variables
-#define MAX_LIGHTS 10
-
 // Uniform variables: other
 uniform vec3 u_CameraPos;
 
-// array of lights in the scene
-uniform PointLight u_Lights[MAX_LIGHTS];
+// all lights of the scene - usedLight is the key light of the object
+layout(std430, binding = 6) readonly buffer LightBuffer{
+	PointLightData lights[];
+};
 
-// material struct
-uniform Material objectMaterial;
+// froxel grid (LightClusters.hpp) - (first, count) pairs of the clusters, then their light indices
+layout(std430, binding = 7) readonly buffer LightClusterBuffer{
+	vec4 clusterDepth;		// near, far, slice scale, slice bias
+	uvec4 clusterGrid;		// tiles x, tiles y, slices, tile size in pixels
+	uint clusterData[];
+};
+
+// camera of the clustered lights
+uniform mat4 u_ViewMatrix;
+
+// records of all draws of the frame
+layout(std430, binding = 0) readonly buffer PerDrawBuffer{
+	PerDraw draws[];
+};
+
+// per-draw values (set at the beginning of main)
+int usedLight;
+Material objectMaterial;
 
 // texture sampler
 uniform sampler2D diffuseTexture;
 
 
+#ifdef GBUFFER
+// octahedral encoding of a unit vector (inverse of DecodeOctahedral of the lighting pass)
+vec2 EncodeOctahedral(vec3 n){
+
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 e = n.xy;
+	if (n.z < 0.0f)
+		e = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+
+	return e;
+}
+#endif
+
+
+// diffuse and specular light of the local lights in the cluster of the fragment (world space)
+vec3 compute_ClusterLights(vec3 normal, vec3 position, vec3 viewDir){
+
+	// exponential depth slice and screen tile of the fragment
+	float viewDepth = max(-(u_ViewMatrix * vec4(position, 1.0f)).z, clusterDepth.x);
+	uint slice = min(uint(max(log(viewDepth) * clusterDepth.z + clusterDepth.w, 0.0f)), clusterGrid.z - 1u);
+	uvec2 tile = min(uvec2(gl_FragCoord.xy) / clusterGrid.w, clusterGrid.xy - 1u);
+	uint cluster = (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+
+	uint first = clusterData[2u * cluster];
+	uint count = clusterData[2u * cluster + 1u];
+
+	vec3 result = vec3(0.0f, 0.0f, 0.0f);
+	for (uint i = 0u; i < count; i++){
+
+		PointLightData light = lights[clusterData[first + i]];
+
+		vec3 toLight = light.positionRadius.xyz - position;
+		float distanceFromLight = max(length(toLight), 0.0001f);
+
+		// inverse square falloff windowed to zero at the range the light was binned with
+		float window = clamp(1.0f - pow(distanceFromLight / light.positionRadius.w, 4.0f), 0.0f, 1.0f);
+		float attenuation = window * window / (1.0f + distanceFromLight * distanceFromLight);
+		if (attenuation <= 0.0f)
+			continue;
+
+		vec3 lightDirection = toLight / distanceFromLight;
+		float diffuseEl = max( dot(normal, lightDirection) , 0);
+
+		float specularEl = 0.0f;
+		if ( diffuseEl != 0 ){
+			vec3 reflectionLight = reflect( -lightDirection, normal );
+			specularEl = pow( max(dot(viewDir, reflectionLight), 0) , objectMaterial.shininess );
+		}
+
+		result += attenuation * light.color.w * light.color.rgb *
+				  (diffuseEl * objectMaterial.Kd + specularEl * objectMaterial.Ks);
+	}
+
+	return result;
+}
+
+
 // Entry point of program
 void main()
 {
+	// per-draw material and light
+	PerDraw drawData = draws[drawID_frag];
+	objectMaterial = Material(drawData.Ka.xyz, drawData.Kd.xyz, drawData.Ks.xyz, drawData.Ks.w);
+	usedLight = drawData.flags.x;
 
-	// get current light in the scene
-	PointLight currentLight = u_Lights[usedLight];
+#ifdef GBUFFER
+					// material and lighting are resolved by the lighting pass
+	gAlbedo = texture(diffuseTexture, texcoord_frag);
+	gNormal = vec4(EncodeOctahedral(normalize( normalWorld )), 0.0f, 0.0f);
+	gDraw = uint(drawID_frag);
+#else
+	// get the key light of the object
+	PointLightData currentLight = lights[usedLight];
 
 
 					// calculate phong ligting model
 	// ambient element
-	vec3 ambient = objectMaterial.Ka * currentLight.lightColor;
+	vec3 ambient = objectMaterial.Ka * currentLight.color.rgb;
 	
 	// diffuse element
 
-	vec3 lightDirection = normalize( currentLight.position -  fragPosWorld );
+	vec3 lightDirection = normalize( currentLight.positionRadius.xyz -  fragPosWorld );
 	
 	float diffuseEl = max( dot(normalWorld, lightDirection) , 0);
-	vec3 diffuse = diffuseEl * objectMaterial.Kd * currentLight.lightColor;
+	vec3 diffuse = diffuseEl * objectMaterial.Kd * currentLight.color.rgb;
 
 
 	// specular element
@@ -91,7 +182,7 @@ void main()
 		vec3 viewDirection = normalize( u_CameraPos - fragPosWorld );
 		vec3 reflectionLight = reflect( -lightDirection, normalWorld );
 		float specularEl = pow( max(dot(viewDirection, reflectionLight), 0) , alpha );
-		specular = specularEl * objectMaterial.Ks * currentLight.lightColor;
+		specular = specularEl * objectMaterial.Ks * currentLight.color.rgb;
 	}
 
 					// final phong intensity
@@ -100,17 +191,19 @@ void main()
 
 					// add attenuation
 	// distance is not changed by orthonormal transformation - we can use tangent coordinates
-	float distanceFromLight = length( currentLight.position - fragPosWorld ); 
-	float attenuation = 1 / (currentLight.constant
-							 + currentLight.linear * distanceFromLight 
-							 + currentLight.quadratic * pow(distanceFromLight, 2));
+	float distanceFromLight = length( currentLight.positionRadius.xyz - fragPosWorld ); 
+	float attenuation = 1 / (1.0f + 0.3f * distanceFromLight + 0.4f * pow(distanceFromLight, 2)); // PointLight defaults
 	
 	attenuation = clamp(attenuation, 0, 1);
 
 	// intensity *= 2* attenuation; // uncomment to see attenuation
 
+					// local lights of the cluster
+	intensity += compute_ClusterLights(normalize( normalWorld ), fragPosWorld, normalize( u_CameraPos - fragPosWorld ));
+
 	// output final color with intensity
 	color = vec4(intensity, 1.0f) * texture(diffuseTexture, texcoord_frag);	
+#endif
 	
 }
 
@@ -0,0 +1,12 @@
+#version 450 core
+
+in vec4 color_v;
+
+out vec4 color;
+
+// Entry point of program
+void main()
+{
+
+	color = color_v;
+}
@@ -0,0 +1,54 @@
+#version 450 core
+// Vertex shader of the depth prepass of the deferred path - same position as the shaders of the objects
+
+// per-draw data (PerDrawData in RenderQueue.hpp)
+struct PerDraw{
+
+	mat4 model;
+	mat4 normalMatrix;	// mat3 in the upper left corner
+	vec4 Ka;
+	vec4 Kd;
+	vec4 Ks;			// w = shininess
+	ivec4 flags;		// usedLight, parallaxMethod, continuousTexture, layer budget (0 = unlimited)
+
+};
+
+// inputs to graphics pipeline
+#ifdef PACKED_VERTICES
+layout(location=0) in vec4 packedPosition;  // quantized (dequantized by the model matrix)
+#else
+layout(location=0) in vec3 position;
+#endif
+layout(location=5) in int drawID;        // index of the per-draw record
+
+// Uniform variables: matrices
+uniform mat4 u_ViewMatrix;
+uniform mat4 u_ProjectionMatrix; // We'll use a perspective projection
+
+// records of all draws of the frame
+layout(std430, binding = 0) readonly buffer PerDrawBuffer{
+	PerDraw draws[];
+};
+
+// the depth has to match the G-buffer pass exactly
+invariant gl_Position;
+
+void main()
+{
+  mat4 u_ModelMatrix = draws[drawID].model;
+
+#ifdef PACKED_VERTICES
+  vec3 position = packedPosition.xyz;
+#endif
+
+                        // compute projected vertex
+  vec4 newPosition = u_ProjectionMatrix * u_ViewMatrix * u_ModelMatrix * vec4(position,1.0f);
+	gl_Position = vec4(newPosition.x, newPosition.y, newPosition.z, newPosition.w); 
+
+  // parallax that may discard fragments outside its texture is left to the G-buffer pass (clipped here)
+  int parallaxMethod = draws[drawID].flags.y;
+  int continuousTexture = draws[drawID].flags.z;
+  bool mayDiscard = parallaxMethod >= 0 && (continuousTexture == 0 || parallaxMethod == 1 || parallaxMethod == 2);
+  gl_ClipDistance[0] = mayDiscard ? -1.0f : 1.0f;
+
+}
@@ -0,0 +1,11 @@
+#version 450 core
+// Vertex shader of the fullscreen passes - one triangle that covers the screen, no vertex buffer
+
+void main()
+{
+
+  // (-1,-1), (3,-1), (-1,3) counter clockwise
+  vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0f - 1.0f;
+  gl_Position = vec4(position, 0.0f, 1.0f);
+
+}
@@ -1,57 +1,99 @@
 #version 450 core
 
-// struct for a point lights
-struct PointLight{
+// point light (PointLightData in LightClusters.hpp)
+struct PointLightData{
 
-	vec3 position;
-	vec3 lightColor;
+	vec4 positionRadius;	// world position, range (0 = key light without attenuation)
+	vec4 color;				// rgb, w = intensity
 
-	// attenuation
-	float constant;
-	float linear;
-	float quadratic;
+};
 
-  float ambientStrength;
-  float diffusionStrengh;
-  float specularStrengh;	
 
-};
+// per-draw data (PerDrawData in RenderQueue.hpp)
+struct PerDraw{
 
+	mat4 model;
+	mat4 normalMatrix;	// mat3 in the upper left corner
+	vec4 Ka;
+	vec4 Kd;
+	vec4 Ks;			// w = shininess
+	ivec4 flags;		// usedLight, parallaxMethod, continuousTexture, unused
+
+};
 
 // inputs to graphics pipeline
+#ifdef PACKED_VERTICES
+layout(location=0) in vec4 packedPosition;  // quantized (dequantized by the model matrix), w = bitangent sign
+layout(location=1) in vec2 packedNormal;    // octahedral
+layout(location=2) in vec2 texcoord;
+layout(location=3) in vec2 packedTangent;   // octahedral
+#else
 layout(location=0) in vec3 position;
 layout(location=1) in vec3 normal;
 layout(location=2) in vec2 texcoord;
 layout(location=3) in vec3 tangent;
 layout(location=4) in vec3 bitangent;
-
-// defined variables
-#define MAX_LIGHTS 10
+#endif
+layout(location=5) in int drawID;        // index of the per-draw record
 
 // Uniform variables: matrices
-uniform mat4 u_ModelMatrix;
 uniform mat4 u_ViewMatrix;
 uniform mat4 u_ProjectionMatrix; // We'll use a perspective projection
-uniform mat3 u_NormalMatrix; // matrix that transforms normals according to the objects rotation / scale
+
+// records of all draws of the frame
+layout(std430, binding = 0) readonly buffer PerDrawBuffer{
+	PerDraw draws[];
+};
 
 // Uniform variables: other
 uniform vec3 u_CameraPos;
-uniform PointLight u_Lights[MAX_LIGHTS];
 
-// specify the used light
-uniform int usedLight;
+// all lights of the scene - usedLight is the key light of the object
+layout(std430, binding = 6) readonly buffer LightBuffer{
+	PointLightData lights[];
+};
+
+// the depth prepass (vert_Depth.glsl) computes the same position
+invariant gl_Position;
 
 // outputs to fragment shader
 out vec2 texcoord_frag;
+flat out int drawID_frag;
 
 out vec3 tangentCameraPos;
 out vec3 tangentLightPos;
 out vec3 tangentFragmentPos;
 
+// world space position and tangent frame for the clustered lights
+out vec3 fragPosWorld;
+out mat3 tangentToWorld;
+
+#ifdef PACKED_VERTICES
+// unit vector from the octahedral encoding (ObjectParser::Encode_Octahedral)
+vec3 DecodeOctahedral(vec2 e){
+
+  vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-v.z, 0.0);
+  v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+
+  return normalize(v);
+}
+#endif
 
 
 void main()
 {
+  // model matrix, normal matrix (transforms normals according to the objects rotation / scale) and light
+  mat4 u_ModelMatrix  = draws[drawID].model;
+  mat3 u_NormalMatrix = mat3(draws[drawID].normalMatrix);
+  int usedLight       = draws[drawID].flags.x;
+
+#ifdef PACKED_VERTICES
+  vec3 position  = packedPosition.xyz;
+  vec3 normal    = DecodeOctahedral(packedNormal);
+  vec3 tangent   = DecodeOctahedral(packedTangent);
+  vec3 bitangent = cross(normal, tangent) * (packedPosition.w * 2.0 - 1.0);
+#endif
 
                         // compute projected vertex
   vec4 newPosition = u_ProjectionMatrix * u_ViewMatrix * u_ModelMatrix * vec4(position,1.0f);
@@ -68,14 +110,17 @@ void main()
   mat3 worldToTangent = transpose(mat3(tangentWorld, bitangentWorld, normalWorld));  
 
   // transform camera, fragment, light into tangent space
-  tangentFragmentPos = worldToTangent * vec3((u_ModelMatrix * vec4(position, 1.0f)));
+  fragPosWorld       = vec3(u_ModelMatrix * vec4(position, 1.0f));
+  tangentFragmentPos = worldToTangent * fragPosWorld;
   tangentCameraPos   = worldToTangent * u_CameraPos;
-  tangentLightPos    = worldToTangent * u_Lights[usedLight].position;
+  tangentLightPos    = worldToTangent * lights[usedLight].positionRadius.xyz;
+  tangentToWorld     = mat3(tangentWorld, bitangentWorld, normalWorld);
 
                             // Pass texture coordinates
 
   // pass the texture coordinates
   texcoord_frag = texcoord;
+  drawID_frag = drawID;
 
 }
 
@@ -1,43 +1,70 @@
 #version 450 core
 
-// struct for a point lights
-struct PointLight{
+// per-draw data (PerDrawData in RenderQueue.hpp)
+struct PerDraw{
 
-	vec3 position;
-	vec3 lightColor;
-
-	// attenuation
-	float constant;
-	float linear;
-	float quadratic;
-
-  float ambientStrength;
-  float diffusionStrengh;
-  float specularStrengh;	
+	mat4 model;
+	mat4 normalMatrix;	// mat3 in the upper left corner
+	vec4 Ka;
+	vec4 Kd;
+	vec4 Ks;			// w = shininess
+	ivec4 flags;		// usedLight, parallaxMethod, continuousTexture, unused
 
 };
 
-
 // inputs to graphics pipeline
+#ifdef PACKED_VERTICES
+layout(location=0) in vec4 packedPosition;  // quantized (dequantized by the model matrix)
+layout(location=1) in vec2 packedNormal;    // octahedral
+layout(location=2) in vec2 texcoord;
+#else
 layout(location=0) in vec3 position;
 layout(location=1) in vec3 normal;
 layout(location=2) in vec2 texcoord;
+#endif
+layout(location=5) in int drawID;        // index of the per-draw record
 
 // Uniform variables: matrices
-uniform mat4 u_ModelMatrix;
 uniform mat4 u_ViewMatrix;
 uniform mat4 u_ProjectionMatrix; // We'll use a perspective projection
-uniform mat3 u_NormalMatrix; // matrix that transforms normals according to the objects rotation / scale
+
+// records of all draws of the frame
+layout(std430, binding = 0) readonly buffer PerDrawBuffer{
+	PerDraw draws[];
+};
 
 
+// the depth prepass (vert_Depth.glsl) computes the same position
+invariant gl_Position;
+
 // outputs to fragment shader
 out vec2 texcoord_frag;
 out vec3 normalWorld;
 out vec3 fragPosWorld; 
+flat out int drawID_frag;
+
+#ifdef PACKED_VERTICES
+// unit vector from the octahedral encoding (ObjectParser::Encode_Octahedral)
+vec3 DecodeOctahedral(vec2 e){
 
+  vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-v.z, 0.0);
+  v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+
+  return normalize(v);
+}
+#endif
 
 void main()
 {
+  // model matrix and normal matrix (transforms normals according to the objects rotation / scale)
+  mat4 u_ModelMatrix  = draws[drawID].model;
+  mat3 u_NormalMatrix = mat3(draws[drawID].normalMatrix);
+
+#ifdef PACKED_VERTICES
+  vec3 position = packedPosition.xyz;
+  vec3 normal   = DecodeOctahedral(packedNormal);
+#endif
 
                         // compute projected vertex
   vec4 newPosition = u_ProjectionMatrix * u_ViewMatrix * u_ModelMatrix * vec4(position,1.0f);
@@ -49,6 +76,7 @@ void main()
   
   // pass the texture coordinates
   texcoord_frag = texcoord;
+  drawID_frag = drawID;
 
   // get the fragment position in world space
   fragPosWorld = vec3(u_ModelMatrix * vec4(position, 1.0f));
@@ -0,0 +1,17 @@
+#version 450 core
+// Vertex shader of the profiler overlay - positions are already in NDC
+
+layout(location=0) in vec2 position;
+layout(location=1) in vec4 color;
+
+out vec4 color_v;
+
+void main()
+{
+
+	gl_Position = vec4(position, 0.0f, 1.0f);
+
+  // pass the color of the bar
+  color_v = color;
+
+}
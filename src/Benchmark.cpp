@@ -0,0 +1,1215 @@
+#include "Benchmark.hpp"
+#include "Object.hpp"
+#include "RenderQueue.hpp"
+#include "JobSystem.hpp"
+#include "ObjectParser.hpp"
+#include "Geometry.hpp"
+#include "MeshOptimizer.hpp"
+#include "Meshlet.hpp"
+#include "MeshSimplifier.hpp"
+#include "LightClusters.hpp"
+#include "TextureCompressor.hpp"
+#include "TextureCache.hpp"
+#include "HeightMap.hpp"
+#include "PageFile.hpp"
+#include "VirtualTexture.hpp"
+#include "TextureStreamer.hpp"
+
+// glm lib
+#include <glm/gtc/constants.hpp>
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <random>
+#include <filesystem>
+#include <cctype>
+#include <map>
+#include <chrono>
+#include <fstream>
+
+
+// nearest-rank percentile of sorted samples
+static double Percentile(const std::vector<double>& sorted, double percentile){
+
+    if (sorted.empty()){
+        return 0.0;
+    }
+
+    unsigned int rank = static_cast<unsigned int>(std::ceil(percentile / 100.0 * sorted.size()));
+    rank = std::min(std::max(rank, 1u), static_cast<unsigned int>(sorted.size()));
+
+    return sorted[rank - 1];
+}
+
+
+// string for a JSON value or key - quotes, backslashes and control characters escaped
+static std::string EscapeJson(const std::string& text){
+
+    std::string escaped;
+    escaped.reserve(text.size());
+
+    for (char c : text){
+        switch (c){
+            case '"':  escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20){
+                    char code[8];
+                    std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned char>(c));
+                    escaped += code;
+                }
+                else{
+                    escaped += c;
+                }
+        }
+    }
+
+    return escaped;
+}
+
+
+TimingStatistics TimingStatistics::Compute(std::vector<double> samples){
+
+    TimingStatistics stats;
+
+    if (samples.empty()){
+        return stats;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (double sample : samples){
+        sum += sample;
+    }
+
+    stats.average = sum / samples.size();
+    stats.minimum = samples.front();
+    stats.maximum = samples.back();
+    stats.p50 = Percentile(samples, 50.0);
+    stats.p95 = Percentile(samples, 95.0);
+    stats.p99 = Percentile(samples, 99.0);
+
+    return stats;
+}
+
+
+Benchmark::Benchmark(const std::string& cameraPathFile, const std::string& outputFile){
+
+    this->pathFile = cameraPathFile;
+    this->outputFile = outputFile;
+
+    this->valid = this->cameraPath.LoadFromFile(cameraPathFile);
+
+    if (!this->valid){
+        std::cerr << "Error: Benchmark could not load the camera path!" << std::endl;
+        this->finished = true;
+        return;
+    }
+
+    // one measured frame per time step of the path (including both end points)
+    this->numberOfFrames = static_cast<unsigned int>(this->cameraPath.GetDuration() / this->timeStep) + 1;
+
+}
+
+
+Benchmark::~Benchmark(){ }
+
+
+bool Benchmark::IsValid() const{
+    return this->valid;
+}
+
+
+bool Benchmark::IsFinished() const{
+    return this->finished;
+}
+
+
+void Benchmark::BeginFrame(Camera& camera){
+
+    if (this->finished){
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    double toMiliseconds = 1000.0 / SDL_GetPerformanceFrequency();
+
+    // frame time is measured from the start of a frame to the start of the next one
+    if (this->previousRecorded){
+        this->frameTimes.push_back((now - this->frameStart) * toMiliseconds);
+    }
+    this->frameStart = now;
+
+    // all frames were measured
+    if (this->frameTimes.size() == this->numberOfFrames){
+        this->finished = true;
+        return;
+    }
+
+    // warm up frames stay at the beginning of the path
+    float time = 0.0f;
+    this->currentRecord = -1;
+    if (this->frameIndex >= this->warmupFrames){
+        this->currentRecord = this->frameIndex - this->warmupFrames;
+        time = this->currentRecord * this->timeStep;
+    }
+    this->previousRecorded = this->currentRecord >= 0;
+
+    this->cameraPath.Apply(time, camera);
+
+    if (this->currentRecord == 0){
+        this->firstProfilerFrame = gProfiler.GetFrameNumber();
+    }
+
+    if (this->currentRecord >= 0){
+        this->cpuTimes.push_back(0.0);
+        this->gpuTimes.push_back(0.0);
+        this->submitTimes.push_back(0.0);
+        this->drawCalls.push_back(0.0);
+        this->parallaxFull.push_back(0.0);
+        this->parallaxOffset.push_back(0.0);
+        this->parallaxNormal.push_back(0.0);
+        this->parallaxLayers.push_back(0.0);
+        this->textureResident.push_back(0.0);
+        this->textureQuality.push_back(1.0);
+    }
+
+    CollectProfilerFrames();
+
+    this->frameIndex++;
+
+}
+
+
+void Benchmark::EndFrame(){
+
+    if (this->finished || this->currentRecord < 0){
+        return;
+    }
+
+    double toMiliseconds = 1000.0 / SDL_GetPerformanceFrequency();
+    this->cpuTimes[this->currentRecord] = (SDL_GetPerformanceCounter() - this->frameStart) * toMiliseconds;
+
+}
+
+
+void Benchmark::RecordSubmit(unsigned int drawCalls, double submitMiliseconds){
+
+    if (this->finished || this->currentRecord < 0){
+        return;
+    }
+
+    this->drawCalls[this->currentRecord] = drawCalls;
+    this->submitTimes[this->currentRecord] = submitMiliseconds;
+
+}
+
+
+void Benchmark::RecordParallax(unsigned int full, unsigned int offset, unsigned int normal, double layers){
+
+    if (this->finished || this->currentRecord < 0){
+        return;
+    }
+
+    this->parallaxFull[this->currentRecord] = full;
+    this->parallaxOffset[this->currentRecord] = offset;
+    this->parallaxNormal[this->currentRecord] = normal;
+    this->parallaxLayers[this->currentRecord] = layers;
+
+}
+
+
+void Benchmark::RecordTextureStreaming(double residentMB, double quality){
+
+    if (this->finished || this->currentRecord < 0){
+        return;
+    }
+
+    this->textureResident[this->currentRecord] = residentMB;
+    this->textureQuality[this->currentRecord] = quality;
+
+}
+
+
+void Benchmark::CollectProfilerFrames(){
+
+    std::vector<ProfileFrame> frames;
+    gProfiler.PopResolvedFrames(frames);
+
+    const std::vector<std::string>& names = gProfiler.GetScopeNames();
+
+    for (const ProfileFrame& frame : frames){
+
+        // skip the warm up frames
+        if (frame.frameNumber < this->firstProfilerFrame || this->cpuTimes.empty()){
+            continue;
+        }
+
+        unsigned int recordIndex = frame.frameNumber - this->firstProfilerFrame;
+        if (recordIndex >= this->gpuTimes.size()){
+            continue;
+        }
+
+        for (const ProfileSample& sample : frame.samples){
+
+            if (sample.depth == 0){ // whole frame
+                this->gpuTimes[recordIndex] = sample.gpuTime;
+            }
+            else if (sample.depth == 1){ // render pass
+                unsigned int passIndex = GetPassIndex(names[sample.nameIndex]);
+
+                // passes that appeared later have shorter vectors
+                if (this->passTimes[passIndex].size() <= recordIndex){
+                    this->passTimes[passIndex].resize(recordIndex + 1, 0.0);
+                }
+
+                this->passTimes[passIndex][recordIndex] += sample.gpuTime;
+            }
+        }
+    }
+
+}
+
+
+unsigned int Benchmark::GetPassIndex(const std::string& name){
+
+    for (unsigned int i = 0; i < this->passNames.size(); i++){
+        if (this->passNames[i] == name){
+            return i;
+        }
+    }
+
+    this->passNames.push_back(name);
+    this->passTimes.push_back(std::vector<double>());
+
+    return this->passNames.size() - 1;
+}
+
+
+void Benchmark::WriteStatistics(std::ofstream& file, const std::string& name,
+                                const TimingStatistics& stats, bool last) const{
+
+    file << "    \"" << EscapeJson(name) << "\": { "
+         << "\"avg\": " << stats.average << ", "
+         << "\"min\": " << stats.minimum << ", "
+         << "\"max\": " << stats.maximum << ", "
+         << "\"p50\": " << stats.p50 << ", "
+         << "\"p95\": " << stats.p95 << ", "
+         << "\"p99\": " << stats.p99 << " }"
+         << (last ? "\n" : ",\n");
+
+}
+
+
+void Benchmark::WriteResults(){
+
+    if (!this->valid){
+        return;
+    }
+
+    // read back everything that is still in flight
+    gProfiler.Flush();
+    CollectProfilerFrames();
+
+    unsigned int frames = this->frameTimes.size();
+    for (std::vector<double>& times : this->passTimes){
+        times.resize(frames, 0.0);
+    }
+    this->cpuTimes.resize(frames);
+    this->gpuTimes.resize(frames);
+    this->submitTimes.resize(frames);
+    this->drawCalls.resize(frames);
+    this->parallaxFull.resize(frames);
+    this->parallaxOffset.resize(frames);
+    this->parallaxNormal.resize(frames);
+    this->parallaxLayers.resize(frames);
+    this->textureResident.resize(frames);
+    this->textureQuality.resize(frames, 1.0);
+
+    TimingStatistics frameStats = TimingStatistics::Compute(this->frameTimes);
+    TimingStatistics cpuStats = TimingStatistics::Compute(this->cpuTimes);
+    TimingStatistics gpuStats = TimingStatistics::Compute(this->gpuTimes);
+    TimingStatistics submitStats = TimingStatistics::Compute(this->submitTimes);
+    TimingStatistics drawCallStats = TimingStatistics::Compute(this->drawCalls);
+    this->frameStatistics = frameStats;
+    this->gpuStatistics = gpuStats;
+
+    std::ofstream file(this->outputFile);
+
+    if (!file.is_open()){
+        std::cerr << "Error: Benchmark results could not be written to " << this->outputFile << std::endl;
+        return;
+    }
+
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+
+    file << "{\n";
+    file << "  \"description\": \"" << EscapeJson(this->description) << "\",\n";
+    file << "  \"renderer\": \"" << EscapeJson(renderer ? reinterpret_cast<const char*>(renderer) : "unknown") << "\",\n";
+    file << "  \"cameraPath\": \"" << EscapeJson(this->pathFile) << "\",\n";
+    file << "  \"frames\": " << frames << ",\n";
+    file << "  \"warmupFrames\": " << this->warmupFrames << ",\n";
+    file << "  \"timeStep\": " << this->timeStep << ",\n";
+    file << "  \"averageFPS\": " << (frameStats.average > 0.0 ? 1000.0 / frameStats.average : 0.0) << ",\n";
+    file << "  \"timeToFirstFrameMs\": " << this->timeToFirstFrameMs << ",\n";
+    file << "  \"drawCalls\": " << drawCallStats.average << ",\n";
+    file << "  \"timings\": {\n";
+    WriteStatistics(file, "frameTimeMs", frameStats, false);
+    WriteStatistics(file, "cpuTimeMs", cpuStats, false);
+    WriteStatistics(file, "gpuTimeMs", gpuStats, false);
+    WriteStatistics(file, "submitCpuMs", submitStats, true);
+    file << "  },\n";
+
+    file << "  \"parallax\": { "
+         << "\"full\": " << TimingStatistics::Compute(this->parallaxFull).average << ", "
+         << "\"offset\": " << TimingStatistics::Compute(this->parallaxOffset).average << ", "
+         << "\"normal\": " << TimingStatistics::Compute(this->parallaxNormal).average << ", "
+         << "\"layerBudget\": " << GetParallaxLayers() << " },\n";
+
+    // quality of the resident levels and what the targets of smaller budgets would reach on the same frames
+    std::vector<BudgetQuality> budgetCurve;
+    if (this->textureStreamer != nullptr){
+
+        TextureStreamingStatistics streaming = this->textureStreamer->GetStatistics();
+        budgetCurve = this->textureStreamer->GetBudgetCurve();
+
+        file << "  \"textureStreaming\": { "
+             << "\"budgetMB\": " << streaming.budgetBytes / 1048576.0 << ", "
+             << "\"fullMB\": " << streaming.fullBytes / 1048576.0 << ", "
+             << "\"residentMB\": " << TimingStatistics::Compute(this->textureResident).average << ", "
+             << "\"quality\": " << TimingStatistics::Compute(this->textureQuality).average << ", "
+             << "\"uploads\": " << streaming.uploads << ", "
+             << "\"evictions\": " << streaming.evictions << ", "
+             << "\"readMB\": " << streaming.bytesRead / 1048576.0 << ", "
+             << "\"maxUploadMs\": " << streaming.maxUploadMiliseconds << ", "
+             << "\"deferredUploads\": " << streaming.deferredUploads << ", "
+             << "\"stagingWaits\": " << streaming.stagingWaits << ",\n";
+        file << "    \"budgetCurve\": [";
+        for (unsigned int i = 0; i < budgetCurve.size(); i++){
+            file << (i > 0 ? ", " : "") << "{ \"budgetMB\": " << budgetCurve[i].budgetBytes / 1048576.0
+                 << ", \"quality\": " << budgetCurve[i].quality << " }";
+        }
+        file << "] },\n";
+    }
+
+    file << "  \"passes\": {\n";
+    for (unsigned int i = 0; i < this->passNames.size(); i++){
+        WriteStatistics(file, this->passNames[i], TimingStatistics::Compute(this->passTimes[i]),
+                        i + 1 == this->passNames.size());
+    }
+    file << "  }\n";
+    file << "}\n";
+
+    file.close();
+
+    // short summary to the console
+    std::cout << "Benchmark finished: " << frames << " frames\n";
+    std::cout << "  frame avg " << frameStats.average << " ms, p95 " << frameStats.p95
+              << " ms, p99 " << frameStats.p99 << " ms\n";
+    std::cout << "  cpu avg " << cpuStats.average << " ms, gpu avg " << gpuStats.average << " ms\n";
+    std::cout << "  draw calls " << drawCallStats.average << ", submit avg " << submitStats.average << " ms\n";
+    if (this->textureStreamer != nullptr){
+        std::cout << "  textures " << TimingStatistics::Compute(this->textureResident).average << " MB resident, quality "
+                  << TimingStatistics::Compute(this->textureQuality).average << ", budget curve";
+        for (const BudgetQuality& point : budgetCurve){
+            std::cout << " " << point.budgetBytes / 1048576.0 << " MB " << point.quality;
+        }
+        std::cout << "\n";
+    }
+    std::cout << "  results written to " << this->outputFile << std::endl;
+
+}
+
+
+const TimingStatistics& Benchmark::GetFrameStatistics() const{
+    return this->frameStatistics;
+}
+
+
+const TimingStatistics& Benchmark::GetGpuStatistics() const{
+    return this->gpuStatistics;
+}
+
+
+double Benchmark::GetParallaxFullShare() const{
+
+    double full = 0.0;
+    double total = 0.0;
+    for (unsigned int i = 0; i < this->parallaxFull.size(); i++){
+        full += this->parallaxFull[i];
+        total += this->parallaxFull[i] + this->parallaxOffset[i] + this->parallaxNormal[i];
+    }
+
+    return total > 0.0 ? full / total : 0.0;
+}
+
+
+double Benchmark::GetParallaxLayers() const{
+    return TimingStatistics::Compute(this->parallaxLayers).average;
+}
+
+
+void RunScalingBenchmark(unsigned int numberOfObjects, unsigned int maxThreads, unsigned int frames){
+
+    // grid of CPU only quads around the camera - part of them is culled
+    std::vector<Object *> objects;
+    unsigned int side = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(numberOfObjects))));
+    float spacing = 80.0f / side;
+
+    for (unsigned int i = 0; i < numberOfObjects; i++){
+
+        Object* object = new Object();
+        object->SetTranslation(glm::vec3((i % side) * spacing - 40.0f, -1.0f, (i / side) * spacing - 40.0f));
+        object->SetRotation(glm::vec3(-90.0f, 0.0f, 0.0f));
+        object->SetScale(glm::vec3(spacing * 0.5f));
+        object->SetBoundingSphere(glm::vec3(0.0f), std::sqrt(2.0f));
+        object->SetNumberOfElements(6);
+        objects.push_back(object);
+    }
+
+    Camera camera;
+    FrameContext context = FrameContext::Create(camera, 16.0f / 9.0f);
+
+    // 1, 2, 4, ... threads and all cores
+    if (maxThreads == 0){
+        maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2){
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "Scaling benchmark: " << numberOfObjects << " objects, " << frames << " frames\n";
+    std::cout << "threads   avg ms   p95 ms   speedup   drawn\n";
+
+    double singleThreaded = 0.0;
+    double toMiliseconds = 1000.0 / SDL_GetPerformanceFrequency();
+
+    for (unsigned int threads : threadCounts){
+
+        JobSystem jobSystem(threads);
+        RenderQueue queue;
+
+        // first frame allocates the command lists
+        queue.Build(objects, context, &jobSystem);
+
+        std::vector<double> times;
+        for (unsigned int frame = 0; frame < frames; frame++){
+            Uint64 start = SDL_GetPerformanceCounter();
+            queue.Build(objects, context, &jobSystem);
+            times.push_back((SDL_GetPerformanceCounter() - start) * toMiliseconds);
+        }
+
+        TimingStatistics stats = TimingStatistics::Compute(times);
+        if (threads == 1){
+            singleThreaded = stats.average;
+        }
+
+        std::printf("%7u %8.3f %8.3f %9.2f %7zu\n", threads, stats.average, stats.p95,
+                    stats.average > 0.0 ? singleThreaded / stats.average : 0.0, queue.GetCommands().size());
+    }
+
+    for (Object* object : objects){
+        delete object;
+    }
+
+}
+
+
+void RunLightBenchmark(unsigned int numberOfLights, unsigned int maxThreads, unsigned int frames){
+
+    // random local lights in front of the default camera
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::vector<PointLightData> lights(numberOfLights);
+    for (PointLightData& light : lights){
+        light.positionRadius = glm::vec4(-20.0f + 40.0f * unit(random), -1.0f + 3.0f * unit(random),
+                                         -40.0f * unit(random), 1.0f + 1.5f * unit(random));
+        light.color = glm::vec4(1.0f);
+    }
+
+    const int width = 1920;
+    const int height = 1080;
+    Camera camera;
+    FrameContext context = FrameContext::Create(camera, static_cast<float>(width) / height, height);
+
+    if (maxThreads == 0){
+        maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2){
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "Light cluster benchmark: " << numberOfLights << " lights, " << width << "x" << height << ", "
+              << frames << " frames\n";
+    std::cout << "threads   avg ms   p95 ms   speedup\n";
+
+    double singleThreaded = 0.0;
+    LightClusters clusters;
+
+    for (unsigned int threads : threadCounts){
+
+        JobSystem jobSystem(threads);
+
+        // first frame allocates the work arrays
+        clusters.Build(lights, context, width, height, &jobSystem);
+
+        std::vector<double> times;
+        for (unsigned int frame = 0; frame < frames; frame++){
+            clusters.Build(lights, context, width, height, &jobSystem);
+            times.push_back(clusters.GetStatistics().buildMiliseconds);
+        }
+
+        TimingStatistics stats = TimingStatistics::Compute(times);
+        if (threads == 1){
+            singleThreaded = stats.average;
+        }
+
+        std::printf("%7u %8.3f %8.3f %9.2f\n", threads, stats.average, stats.p95,
+                    stats.average > 0.0 ? singleThreaded / stats.average : 0.0);
+    }
+
+    const LightClusterStatistics& statistics = clusters.GetStatistics();
+    std::printf("%u of %u lights visible, %u of %u clusters used, %.1f lights per used cluster (max %u)\n",
+                statistics.visibleLights, statistics.lights, statistics.usedClusters, clusters.GetNumberOfClusters(),
+                statistics.averageLights, statistics.maxLights);
+
+    // every point inside a light has to find the light in its cluster (the lookup of the shaders)
+    unsigned int samples = 0;
+    unsigned int missed = 0;
+    for (unsigned int i = 0; i < lights.size(); i++){
+
+        glm::vec3 center = glm::vec3(lights[i].positionRadius);
+        float radius = lights[i].positionRadius.w;
+
+        for (unsigned int s = 0; s < 64; s++){
+
+            glm::vec3 direction = glm::vec3(unit(random), unit(random), unit(random)) * 2.0f - 1.0f;
+            glm::vec3 point = center + direction * (radius * 0.999f / std::sqrt(3.0f));
+            glm::vec4 clip = context.viewProjection * glm::vec4(point, 1.0f);
+            float depth = clip.w;
+
+            if (depth < context.nearPlane || depth > context.farPlane ||
+                std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w){
+                continue;
+            }
+
+            float x = (clip.x / clip.w * 0.5f + 0.5f) * width;
+            float y = (clip.y / clip.w * 0.5f + 0.5f) * height;
+            unsigned int cluster = clusters.GetCluster(depth, x, y);
+
+            const uint32_t* indices = clusters.GetLights(cluster);
+            unsigned int count = clusters.GetNumberOfLights(cluster);
+            missed += std::find(indices, indices + count, i) == indices + count;
+            samples++;
+        }
+    }
+
+    std::printf("%u points inside the lights checked, %u not found in their cluster\n", samples, missed);
+
+}
+
+
+// usage of a texture by its file name - height maps are inverted into depth maps like the scenes
+// load them, displacement maps already are depth maps
+static TextureUsage GetTextureUsage(std::string name, bool& inverse){
+
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c){ return std::tolower(c); });
+    inverse = false;
+
+    if (name.find("normal") != std::string::npos){
+        return TEXTURE_NORMAL;
+    }
+    if (name.find("height") != std::string::npos){
+        inverse = true;
+        return TEXTURE_HEIGHT;
+    }
+    if (name.find("displacement") != std::string::npos){
+        return TEXTURE_HEIGHT;
+    }
+
+    return TEXTURE_DIFFUSE;
+}
+
+
+void RunTextureBake(const std::string& directory, unsigned int maxThreads){
+
+    // images under the directory (the skybox faces are cube maps, not material textures)
+    std::vector<std::string> files;
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(directory, error), end; it != end && !error; it.increment(error)){
+
+        std::string extension = it->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c){ return std::tolower(c); });
+
+        if (it->is_regular_file() && it->path().string().find("skybox") == std::string::npos &&
+            (extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp")){
+            files.push_back(it->path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    if (files.empty()){
+        std::cout << "No textures found in " << directory << "\n";
+        return;
+    }
+
+    JobSystem jobSystem(maxThreads);
+
+    std::cout << "Texture bake: " << files.size() << " textures, " << jobSystem.GetNumberOfThreads() << " threads\n";
+    std::cout << "format       size  source MB  BC MB  ratio  PSNR dB      ms  file\n";
+
+    size_t totalSource = 0;
+    size_t totalCompressed = 0;
+    double totalMiliseconds = 0.0;
+
+    auto report = [&](const CompressedTexture& texture, const TextureCompressionStatistics& statistics,
+                      const std::string& cachePath){
+        std::printf("%-6s %5ux%-5u %9.2f %6.2f %6.1f %8.2f %7.1f  %s\n", TextureCompressor::GetFormatName(texture.format),
+                    texture.width, texture.height, statistics.uncompressedBytes / 1048576.0,
+                    statistics.compressedBytes / 1048576.0,
+                    static_cast<double>(statistics.uncompressedBytes) / statistics.compressedBytes, statistics.psnr,
+                    statistics.miliseconds, cachePath.c_str());
+
+        totalSource += statistics.uncompressedBytes;
+        totalCompressed += statistics.compressedBytes;
+        totalMiliseconds += statistics.miliseconds;
+    };
+
+    // normal and height maps of each directory, packed into one material if there is one of both
+    std::map<std::string, std::vector<std::string>> normalMaps, heightMaps;
+
+    for (const std::string& file : files){
+
+        bool inverse;
+        TextureUsage usage = GetTextureUsage(std::filesystem::path(file).filename().string(), inverse);
+
+        int width, height, nrComponents;
+        unsigned char* data = stbi_load(file.c_str(), &width, &height, &nrComponents, 0);
+        if (data == nullptr){
+            std::cout << "Texture failed to load at path: " << file << "\n";
+            continue;
+        }
+
+        // the same conversion as Object::LoadTexture - the height maps are one channel
+        std::vector<uint8_t> heights;
+        unsigned int channels = nrComponents;
+        if (usage == TEXTURE_HEIGHT){
+            HeightMapOptions options;
+            options.invert = inverse;
+            heights = HeightMapProcessor::ConvertR8(data, width, height, nrComponents, options, &jobSystem);
+            channels = 1;
+        }
+
+        TextureCompressionStatistics statistics;
+        CompressedTexture texture = TextureCompressor::Compress(heights.empty() ? data : heights.data(), width, height,
+                                                                channels, usage, &jobSystem, &statistics);
+        TextureCache::Save(file, inverse, texture);
+        stbi_image_free(data);
+
+        report(texture, statistics, TextureCache::GetCachePath(file, inverse));
+
+        std::string parent = std::filesystem::path(file).parent_path().string();
+        if (usage == TEXTURE_NORMAL){
+            normalMaps[parent].push_back(file);
+        }
+        else if (usage == TEXTURE_HEIGHT){
+            heightMaps[parent].push_back(file);
+        }
+    }
+
+    // the packed materials of Object::LoadMaterial (the height inverted as the single texture was)
+    for (const auto& [parent, normals] : normalMaps){
+
+        auto heights = heightMaps.find(parent);
+        if (normals.size() != 1 || heights == heightMaps.end() || heights->second.size() != 1){
+            continue;
+        }
+
+        const std::string& normalFile = normals[0];
+        const std::string& heightFile = heights->second[0];
+
+        bool inverse;
+        GetTextureUsage(std::filesystem::path(heightFile).filename().string(), inverse);
+
+        int normalWidth, normalHeight, normalComponents;
+        int heightWidth, heightHeight, heightComponents;
+        unsigned char* normalData = stbi_load(normalFile.c_str(), &normalWidth, &normalHeight, &normalComponents, 0);
+        unsigned char* heightData = stbi_load(heightFile.c_str(), &heightWidth, &heightHeight, &heightComponents, 0);
+
+        if (normalData != nullptr && heightData != nullptr && normalWidth == heightWidth && normalHeight == heightHeight){
+
+            std::vector<uint8_t> rgba = TextureCompressor::PackMaterial(normalData, normalComponents,
+                                                                        heightData, heightComponents,
+                                                                        normalWidth, normalHeight, inverse);
+
+            TextureCompressionStatistics statistics;
+            CompressedTexture texture = TextureCompressor::Compress(rgba.data(), normalWidth, normalHeight, 4,
+                                                                    TEXTURE_MATERIAL, &jobSystem, &statistics);
+            std::string cachePath = TextureCache::GetMaterialCachePath(normalFile, inverse);
+            TextureCache::Save(cachePath, {normalFile, heightFile}, texture);
+
+            report(texture, statistics, cachePath);
+        }
+
+        stbi_image_free(normalData);
+        stbi_image_free(heightData);
+    }
+
+    std::printf("total %.2f MB -> %.2f MB (%.1f : 1) in %.0f ms\n", totalSource / 1048576.0, totalCompressed / 1048576.0,
+                totalCompressed > 0 ? static_cast<double>(totalSource) / totalCompressed : 0.0, totalMiliseconds);
+
+}
+
+
+void RunMeshStatistics(const std::string& filePath){
+
+    std::vector<GLfloat> data;
+    std::vector<GLuint> indices;
+    std::string path = filePath;
+    std::string materialPath;
+
+    ObjectParser::Parse_WavefrontOBJ(data, indices, path, materialPath);
+
+    const unsigned int stride = MeshOptimizer::stride;
+    std::cout << "Mesh " << filePath << ": " << data.size() / stride << " vertices, "
+              << indices.size() / 3 << " triangles\n";
+    std::cout << "pass              ACMR(16)  ATVR(16)  ACMR(32)  ATVR(32)\n";
+
+    auto report = [&](const char* pass){
+        VertexCacheStatistics small = MeshOptimizer::AnalyzeVertexCache(indices, data.size() / stride, 16);
+        VertexCacheStatistics large = MeshOptimizer::AnalyzeVertexCache(indices, data.size() / stride, 32);
+        std::printf("%-16s %9.3f %9.3f %9.3f %9.3f\n", pass, small.acmr, small.atvr, large.acmr, large.atvr);
+    };
+
+    report("file order");
+
+    MeshOptimizer::OptimizeVertexCache(indices, data.size() / stride);
+    report("vertex cache");
+
+    MeshOptimizer::OptimizeOverdraw(indices, data, stride);
+    report("overdraw");
+
+    MeshOptimizer::OptimizeVertexFetch(data, indices, stride);
+    report("vertex fetch");
+
+    // levels of detail of the optimized mesh
+    std::vector<MeshLod> lods = MeshSimplifier::BuildLods(data, indices, MeshSimplifier::defaultLevels, nullptr);
+    for (unsigned int i = 0; i < lods.size(); i++){
+        std::printf("LOD %u: %zu triangles, error %.5f\n", i + 1, lods[i].indices.size() / 3, lods[i].error);
+    }
+
+}
+
+
+void RunSimplifyBenchmark(unsigned int resolution, unsigned int maxThreads){
+
+    std::vector<GLfloat> data;
+    std::vector<GLuint> indices;
+    CreateTorusMesh(resolution, data, indices);
+
+    unsigned int numberOfTriangles = indices.size() / 3;
+    unsigned int levels = MeshSimplifier::defaultLevels;
+
+    if (maxThreads == 0){
+        maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2){
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "Simplification benchmark: torus with " << numberOfTriangles << " triangles, " << levels << " levels\n";
+    std::cout << "threads       ms   Mtri/s   speedup\n";
+
+    double singleThreaded = 0.0;
+    double toMiliseconds = 1000.0 / SDL_GetPerformanceFrequency();
+    std::vector<MeshLod> lods;
+
+    for (unsigned int threads : threadCounts){
+
+        JobSystem jobSystem(threads);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        lods = MeshSimplifier::BuildLods(data, indices, levels, &jobSystem);
+        double miliseconds = (SDL_GetPerformanceCounter() - start) * toMiliseconds;
+
+        if (threads == 1){
+            singleThreaded = miliseconds;
+        }
+
+        // every level reads the full mesh
+        double throughput = static_cast<double>(numberOfTriangles) * levels / (miliseconds * 1000.0);
+        std::printf("%7u %8.1f %8.2f %9.2f\n", threads, miliseconds, throughput,
+                    miliseconds > 0.0 ? singleThreaded / miliseconds : 0.0);
+    }
+
+    for (unsigned int i = 0; i < lods.size(); i++){
+        std::printf("LOD %u: %zu triangles, error %.5f\n", i + 1, lods[i].indices.size() / 3, lods[i].error);
+    }
+
+}
+
+
+void RunHeightMapBenchmark(unsigned int size, unsigned int maxThreads){
+
+    // RGB noise - the channel extraction of the height maps saved as color images
+    std::mt19937 random(1234);
+    std::vector<uint8_t> pixels(static_cast<size_t>(size) * size * 3);
+    for (uint8_t& pixel : pixels){
+        pixel = static_cast<uint8_t>(random() % 200 + 20);
+    }
+
+    if (maxThreads == 0){
+        maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2){
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    // the inversion of the scene loading and a normalized 16 bit copy
+    HeightMapOptions invert;
+    invert.invert = true;
+    HeightMapOptions normalize;
+    normalize.normalize = true;
+    normalize.invert = true;
+
+    std::vector<uint8_t> referenceR8 = HeightMapProcessor::ConvertR8(pixels.data(), size, size, 3, invert, nullptr, SIMD_SCALAR);
+    std::vector<uint16_t> referenceR16 = HeightMapProcessor::ConvertR16(pixels.data(), size, size, 3, normalize,
+                                                                        nullptr, SIMD_SCALAR);
+
+    std::cout << "Height map benchmark: " << size << "x" << size << " RGB, best of 5 runs\n";
+    std::cout << "set     threads  R8 inv ms  Mtex/s  R16 norm ms  Mtex/s  match\n";
+
+    const unsigned int runs = 5;
+    double toMiliseconds = 1000.0 / SDL_GetPerformanceFrequency();
+    double megaTexels = static_cast<double>(size) * size / 1000000.0;
+
+    for (int level = SIMD_SCALAR; level <= HeightMapProcessor::GetSupportedLevel(); level++){
+        for (unsigned int threads : threadCounts){
+
+            JobSystem jobSystem(threads);
+            SimdLevel simd = static_cast<SimdLevel>(level);
+
+            double bestR8 = 1e30, bestR16 = 1e30;
+            bool match = true;
+            for (unsigned int run = 0; run < runs; run++){
+
+                Uint64 start = SDL_GetPerformanceCounter();
+                std::vector<uint8_t> r8 = HeightMapProcessor::ConvertR8(pixels.data(), size, size, 3, invert, &jobSystem, simd);
+                Uint64 middle = SDL_GetPerformanceCounter();
+                std::vector<uint16_t> r16 = HeightMapProcessor::ConvertR16(pixels.data(), size, size, 3, normalize,
+                                                                           &jobSystem, simd);
+                Uint64 end = SDL_GetPerformanceCounter();
+
+                bestR8 = std::min(bestR8, (middle - start) * toMiliseconds);
+                bestR16 = std::min(bestR16, (end - middle) * toMiliseconds);
+                match = match && r8 == referenceR8 && r16 == referenceR16;
+            }
+
+            std::printf("%-7s %7u %10.2f %7.0f %12.2f %7.0f  %s\n", HeightMapProcessor::GetLevelName(simd), threads,
+                        bestR8, megaTexels / (bestR8 / 1000.0), bestR16, megaTexels / (bestR16 / 1000.0),
+                        match ? "yes" : "NO");
+        }
+    }
+
+}
+
+
+void RunMeshletStatistics(const std::string& filePath, const std::string& pathFile){
+
+    std::vector<GLfloat> data;
+    std::vector<GLuint> indices;
+    std::string path = filePath;
+    std::string materialPath;
+
+    ObjectParser::Parse_WavefrontOBJ(data, indices, path, materialPath);
+    MeshOptimizer::Optimize(data, indices, nullptr, nullptr);
+
+    // the meshlet order costs some of the vertex cache efficiency
+    unsigned int numberOfVertices = data.size() / MeshletBuilder::stride;
+    float optimizedACMR = MeshOptimizer::AnalyzeVertexCache(indices, numberOfVertices).acmr;
+    std::vector<Meshlet> meshlets = MeshletBuilder::Build(data, indices);
+    float meshletACMR = MeshOptimizer::AnalyzeVertexCache(indices, numberOfVertices).acmr;
+    if (meshlets.empty()){
+        std::cout << "Mesh " << filePath << " has no triangles\n";
+        return;
+    }
+
+    // the camera path is in the object space of the mesh - otherwise orbit around it
+    CameraPath cameraPath;
+    bool orbit = pathFile == "" || !cameraPath.LoadFromFile(pathFile) || cameraPath.GetNumberOfKeyframes() == 0;
+
+    glm::vec3 minimum(data[0], data[1], data[2]);
+    glm::vec3 maximum = minimum;
+    for (unsigned int i = 0; i < data.size(); i += MeshletBuilder::stride){
+        minimum = glm::min(minimum, glm::vec3(data[i], data[i + 1], data[i + 2]));
+        maximum = glm::max(maximum, glm::vec3(data[i], data[i + 1], data[i + 2]));
+    }
+    glm::vec3 center = (minimum + maximum) * 0.5f;
+    float radius = glm::length(maximum - center);
+
+    unsigned int withCone = 0;
+    for (const Meshlet& meshlet : meshlets){
+        withCone += meshlet.coneCutoff < 1.0f ? 1 : 0;
+    }
+
+    std::cout << "Mesh " << filePath << ": " << indices.size() / 3 << " triangles, " << meshlets.size()
+              << " meshlets (" << static_cast<double>(indices.size() / 3) / meshlets.size() << " triangles each), "
+              << withCone << " with a normal cone, ACMR " << optimizedACMR << " -> " << meshletACMR << "\n";
+
+    const unsigned int samples = 240;
+    double frustumCulled = 0.0, coneCulled = 0.0, trianglesCulled = 0.0;
+
+    for (unsigned int s = 0; s < samples; s++){
+
+        glm::vec3 position, direction;
+        if (orbit){
+            // two rings around the mesh - the camera keeps the mesh at the left edge of the view
+            float angle = glm::two_pi<float>() * s / samples * 2.0f;
+            float height = s < samples / 2 ? 0.3f : 1.0f;
+            position = center + radius * glm::vec3(2.0f * std::cos(angle), height, 2.0f * std::sin(angle));
+            direction = glm::normalize(center - position) + glm::vec3(-std::sin(angle), 0.0f, std::cos(angle)) * 0.3f;
+        }
+        else{
+            cameraPath.Sample(cameraPath.GetDuration() * s / (samples - 1), position, direction);
+        }
+
+        Camera camera;
+        camera.SetCameraEyePosition(position.x, position.y, position.z);
+        camera.SetViewDirection(direction);
+        FrameContext context = FrameContext::Create(camera, 16.0f / 9.0f);
+
+        unsigned int outside = 0, backfacing = 0, culledIndices = 0;
+        for (const Meshlet& meshlet : meshlets){
+            if (!context.IsSphereVisible(meshlet.center, meshlet.radius)){
+                outside++;
+                culledIndices += meshlet.indexCount;
+            }
+            else if (meshlet.coneCutoff < 1.0f &&
+                     MeshletBuilder::IsBackfacing(meshlet.center, meshlet.radius, meshlet.coneAxis,
+                                                  meshlet.coneCutoff, context.cameraPosition)){
+                backfacing++;
+                culledIndices += meshlet.indexCount;
+            }
+        }
+
+        frustumCulled += 100.0 * outside / meshlets.size();
+        coneCulled += 100.0 * backfacing / meshlets.size();
+        trianglesCulled += 100.0 * culledIndices / indices.size();
+    }
+
+    std::printf("%s, %u views: culled meshlets %.1f %% (frustum %.1f %%, cone %.1f %%), culled triangles %.1f %%\n",
+                orbit ? "orbit" : pathFile.c_str(), samples, (frustumCulled + coneCulled) / samples,
+                frustumCulled / samples, coneCulled / samples, trianglesCulled / samples);
+
+}
+
+
+void RunVirtualTextureBuild(const std::string& directory, unsigned int size, const std::string& outputPath,
+                            unsigned int maxThreads){
+
+    // the material of the directory by the file names (like RunTextureBake)
+    std::string albedo, normal, height;
+    bool inverse = true;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; it != end && !error; it.increment(error)){
+
+        if (!it->is_regular_file()){
+            continue;
+        }
+
+        bool fileInverse;
+        TextureUsage usage = GetTextureUsage(it->path().filename().string(), fileInverse);
+        if (usage == TEXTURE_NORMAL){
+            normal = it->path().string();
+        }
+        else if (usage == TEXTURE_HEIGHT){
+            height = it->path().string();
+            inverse = fileInverse;
+        }
+        else if (it->path().filename().string().find("basecolor") != std::string::npos ||
+                 it->path().filename().string().find("diffuse") != std::string::npos){
+            albedo = it->path().string();
+        }
+    }
+
+    if (albedo.empty() || normal.empty() || height.empty()){
+        std::cout << "No basecolor, normal and height texture found in " << directory << "\n";
+        return;
+    }
+
+    JobSystem jobSystem(maxThreads);
+
+    std::cout << "Virtual texture: " << size << "x" << size << " from " << albedo << ", " << normal << ", " << height
+              << " (" << jobSystem.GetNumberOfThreads() << " threads)\n";
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (!PageFile::Build(outputPath, albedo, normal, height, size, inverse, &jobSystem)){
+        return;
+    }
+    double miliseconds = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+    PageFile pageFile;
+    if (pageFile.Open(outputPath)){
+        const PageFileHeader& header = pageFile.GetHeader();
+        std::printf("%u levels, %u pages of %ux%u texels, %.1f MB in %.0f ms -> %s\n", header.numberOfLevels,
+                    header.numberOfPages, pageFile.GetPageTexels(), pageFile.GetPageTexels(),
+                    header.numberOfPages * pageFile.GetPageBytes() / 1048576.0, miliseconds, outputPath.c_str());
+    }
+
+}
+
+
+// pages of a ground plane seen by a camera panning and zooming over the virtual texture - sampled every
+// 4x4 pixels of a 1920x1080 view like the feedback of the shader, the footprint grows towards the horizon
+static void SyntheticFeedback(const PageFile& pageFile, unsigned int frame, std::vector<uint8_t>& requested,
+                              std::vector<uint32_t>& pageIDs){
+
+    const PageFileHeader& header = pageFile.GetHeader();
+    const unsigned int width = 1920, height = 1080;
+
+    float time = frame / 60.0f;
+    float centerU = 0.5f + 0.35f * std::sin(0.21f * time);
+    float centerV = 0.5f + 0.35f * std::cos(0.13f * time);
+    float nearFootprint = std::exp2(4.0f * (0.5f + 0.5f * std::sin(0.4f * time)) - 1.0f);   // 0.5 - 8 texels
+
+    std::fill(requested.begin(), requested.end(), 0);
+    pageIDs.clear();
+
+    for (unsigned int y = 0; y < height; y += 4){
+
+        float distance = 1.0f - static_cast<float>(y) / height;
+        float footprint = nearFootprint * (1.0f + 7.0f * distance * distance);
+        uint32_t level = std::min(static_cast<uint32_t>(std::max(std::floor(std::log2(std::max(footprint, 1.0f))), 0.0f)),
+                                  header.numberOfLevels - 1);
+        uint32_t pages = pageFile.GetPagesPerSide(level);
+
+        float v = centerV + (height - y) * footprint / header.size;
+        v -= std::floor(v);
+
+        for (unsigned int x = 0; x < width; x += 4){
+
+            float u = centerU + (static_cast<float>(x) - width / 2.0f) * footprint / header.size;
+            u -= std::floor(u);
+
+            uint32_t pageX = std::min(static_cast<uint32_t>(u * pages), pages - 1);
+            uint32_t pageY = std::min(static_cast<uint32_t>(v * pages), pages - 1);
+            uint32_t pageID = pageFile.GetFirstPage(level) + pageY * pages + pageX;
+
+            if (!requested[pageID]){
+                requested[pageID] = 1;
+                pageIDs.push_back(pageID);
+            }
+        }
+    }
+
+}
+
+
+void RunVirtualTextureSimulation(const std::string& filePath, const std::string& feedbackPath){
+
+    PageFile pageFile;
+    if (!pageFile.Open(filePath)){
+        std::cout << "Can not open the page file " << filePath << "\n";
+        return;
+    }
+
+    // recorded feedback: per frame the number of pages and their IDs
+    std::vector<std::vector<uint32_t>> recorded;
+    if (!feedbackPath.empty()){
+        std::ifstream file(feedbackPath, std::ios::binary);
+        uint32_t count;
+        while (file.read(reinterpret_cast<char*>(&count), sizeof(count))){
+            std::vector<uint32_t> pageIDs(count);
+            file.read(reinterpret_cast<char*>(pageIDs.data()), count * sizeof(uint32_t));
+            recorded.push_back(std::move(pageIDs));
+        }
+        if (recorded.empty()){
+            std::cout << "No feedback frames in " << feedbackPath << "\n";
+            return;
+        }
+    }
+
+    const unsigned int maxUploads = 16;
+    const unsigned int frames = recorded.empty() ? 600 : recorded.size();
+    const std::chrono::nanoseconds frameTime(16666667);
+
+    VirtualTextureCache cache(&pageFile);
+    unsigned int slotsPerSide = cache.GetSlotsPerSide();
+
+    const PageFileHeader& header = pageFile.GetHeader();
+    std::cout << "Virtual texture simulation: " << header.size << "x" << header.size << ", " << header.numberOfPages
+              << " pages, " << slotsPerSide * slotsPerSide << " slots, " << maxUploads << " uploads per frame, "
+              << frames << " frames of " << (recorded.empty() ? "pan and zoom" : feedbackPath) << "\n";
+    std::cout << "second  requests  hit %  uploads  evictions  resident  queued  MB read\n";
+
+    std::vector<uint8_t> requested(header.numberOfPages);
+    std::vector<uint32_t> pageIDs;
+    std::vector<double> cpuMiliseconds;
+    VirtualTextureStatistics previous = cache.GetStatistics();
+
+    double toMiliseconds = 1000.0 / SDL_GetPerformanceFrequency();
+    auto frameStart = std::chrono::steady_clock::now();
+
+    for (unsigned int frame = 0; frame < frames; frame++){
+
+        if (recorded.empty()){
+            SyntheticFeedback(pageFile, frame, requested, pageIDs);
+        }
+
+        // the work of VirtualTexture::Update without the GL calls
+        Uint64 start = SDL_GetPerformanceCounter();
+        cache.ProcessFeedback(recorded.empty() ? pageIDs : recorded[frame]);
+        cache.CollectLoaded(maxUploads);
+        cache.UpdateIndirection();
+        cpuMiliseconds.push_back((SDL_GetPerformanceCounter() - start) * toMiliseconds);
+
+        // the loaders work while the frame is drawn
+        frameStart += frameTime;
+        std::this_thread::sleep_until(frameStart);
+
+        if ((frame + 1) % 60 == 0 || frame + 1 == frames){
+            VirtualTextureStatistics current = cache.GetStatistics();
+            uint64_t requests = current.requests - previous.requests;
+            std::printf("%6u %9llu %6.1f %8llu %10llu %9u %7u %8.1f\n", (frame + 1 + 59) / 60,
+                        static_cast<unsigned long long>(requests),
+                        requests > 0 ? 100.0 * (current.hits - previous.hits) / requests : 100.0,
+                        static_cast<unsigned long long>(current.uploads - previous.uploads),
+                        static_cast<unsigned long long>(current.evictions - previous.evictions),
+                        current.residentPages, current.queuedPages, (current.bytesRead - previous.bytesRead) / 1048576.0);
+            previous = current;
+        }
+    }
+
+    VirtualTextureStatistics total = cache.GetStatistics();
+    std::sort(cpuMiliseconds.begin(), cpuMiliseconds.end());
+    double sum = 0.0;
+    for (double miliseconds : cpuMiliseconds){
+        sum += miliseconds;
+    }
+
+    std::printf("total: %.1f%% hits of %llu requests, %llu uploads, %llu evictions, %llu dropped, %.1f MB read\n",
+                total.requests > 0 ? 100.0 * total.hits / total.requests : 100.0,
+                static_cast<unsigned long long>(total.requests), static_cast<unsigned long long>(total.uploads),
+                static_cast<unsigned long long>(total.evictions), static_cast<unsigned long long>(total.dropped),
+                total.bytesRead / 1048576.0);
+    std::printf("CPU per frame: average %.3f ms, p99 %.3f ms, max %.3f ms\n", sum / cpuMiliseconds.size(),
+                Percentile(cpuMiliseconds, 99.0), cpuMiliseconds.back());
+
+}
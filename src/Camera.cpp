@@ -102,6 +102,18 @@ float Camera::GetViewZDirection(){
     return m_viewDirection.z;
 }
 
+glm::vec3 Camera::GetEyePosition() const{
+    return m_eyePosition;
+}
+
+glm::vec3 Camera::GetViewDirection() const{
+    return m_viewDirection;
+}
+
+void Camera::SetViewDirection(const glm::vec3& direction){
+    m_viewDirection = glm::normalize(direction);
+}
+
 
 Camera::Camera(){
     
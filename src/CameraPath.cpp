@@ -0,0 +1,194 @@
+#include "CameraPath.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+CameraPath::CameraPath(){ }
+
+CameraPath::~CameraPath(){ }
+
+
+// load the keyframes from a text file, lines starting with '#' are comments
+bool CameraPath::LoadFromFile(const std::string& filePath){
+
+    std::ifstream pathFile(filePath);
+
+    // check if file is open
+    if (!pathFile.is_open()){
+        std::cerr << "Error: Camera path " << filePath << " could not be opened!" << std::endl;
+        return false;
+    }
+
+    this->keyframes.clear();
+
+    std::string line;
+    while (std::getline(pathFile, line)){
+
+        if (line.empty() || line[0] == '#') continue; // skip empty lines and comments
+
+        std::istringstream lineStream(line);
+        CameraKeyframe key;
+
+        lineStream >> key.time
+                   >> key.position.x >> key.position.y >> key.position.z
+                   >> key.direction.x >> key.direction.y >> key.direction.z;
+
+        if (lineStream.fail()){
+            std::cerr << "Error: Invalid keyframe in camera path: " << line << std::endl;
+            return false;
+        }
+
+        AddKeyframe(key.time, key.position, key.direction);
+    }
+
+    pathFile.close();
+
+    return !this->keyframes.empty();
+}
+
+
+bool CameraPath::SaveToFile(const std::string& filePath) const{
+
+    std::ofstream pathFile(filePath);
+
+    // check if file is open
+    if (!pathFile.is_open()){
+        std::cerr << "Error: Camera path " << filePath << " could not be created!" << std::endl;
+        return false;
+    }
+
+    pathFile << "# time posX posY posZ dirX dirY dirZ\n";
+
+    for (const CameraKeyframe& key : this->keyframes){
+        pathFile << key.time << " "
+                 << key.position.x << " " << key.position.y << " " << key.position.z << " "
+                 << key.direction.x << " " << key.direction.y << " " << key.direction.z << "\n";
+    }
+
+    pathFile.close();
+
+    return true;
+}
+
+
+void CameraPath::AddKeyframe(float time, const glm::vec3& position, const glm::vec3& direction){
+
+    // keep the keyframes sorted by time - ignore out of order keys
+    if (!this->keyframes.empty() && time <= this->keyframes.back().time){
+        return;
+    }
+
+    this->keyframes.push_back({ time, position, glm::normalize(direction) });
+
+}
+
+
+void CameraPath::Record(float time, const Camera& camera){
+
+    if (!this->keyframes.empty() && time - this->keyframes.back().time < this->recordInterval){
+        return;
+    }
+
+    AddKeyframe(time, camera.GetEyePosition(), camera.GetViewDirection());
+
+}
+
+
+// Catmull-Rom interpolation of 4 control points for t in [0, 1]
+static glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1,
+                            const glm::vec3& p2, const glm::vec3& p3, float t){
+
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    return 0.5f * ( (2.0f * p1) +
+                    (-p0 + p2) * t +
+                    (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                    (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3 );
+}
+
+
+void CameraPath::Sample(float time, glm::vec3& position, glm::vec3& direction) const{
+
+    if (this->keyframes.empty()){
+        return;
+    }
+
+    // time is relative to the first keyframe
+    time += this->keyframes.front().time;
+
+    // clamp to the start / end of the path
+    if (time <= this->keyframes.front().time || this->keyframes.size() == 1){
+        position = this->keyframes.front().position;
+        direction = this->keyframes.front().direction;
+        return;
+    }
+    if (time >= this->keyframes.back().time){
+        position = this->keyframes.back().position;
+        direction = this->keyframes.back().direction;
+        return;
+    }
+
+    // find the segment [i1, i2] that contains the time
+    auto upper = std::upper_bound(this->keyframes.begin(), this->keyframes.end(), time,
+                        [](float t, const CameraKeyframe& key){ return t < key.time; });
+
+    int i2 = static_cast<int>(upper - this->keyframes.begin());
+    int i1 = i2 - 1;
+    int i0 = std::max(i1 - 1, 0);
+    int i3 = std::min(i2 + 1, static_cast<int>(this->keyframes.size()) - 1);
+
+    const CameraKeyframe& k0 = this->keyframes[i0];
+    const CameraKeyframe& k1 = this->keyframes[i1];
+    const CameraKeyframe& k2 = this->keyframes[i2];
+    const CameraKeyframe& k3 = this->keyframes[i3];
+
+    float t = (time - k1.time) / (k2.time - k1.time);
+
+    position = CatmullRom(k0.position, k1.position, k2.position, k3.position, t);
+    direction = CatmullRom(k0.direction, k1.direction, k2.direction, k3.direction, t);
+
+    // the spline of unit vectors does not have to be a unit vector
+    if (glm::length(direction) < 1e-5f){
+        direction = k1.direction;
+    }
+    direction = glm::normalize(direction);
+
+}
+
+
+void CameraPath::Apply(float time, Camera& camera) const{
+
+    if (this->keyframes.empty()){
+        return;
+    }
+
+    glm::vec3 position, direction;
+    Sample(time, position, direction);
+
+    camera.SetCameraEyePosition(position.x, position.y, position.z);
+    camera.SetViewDirection(direction);
+
+}
+
+
+void CameraPath::Clear(){
+    this->keyframes.clear();
+}
+
+
+float CameraPath::GetDuration() const{
+
+    if (this->keyframes.empty()){
+        return 0.0f;
+    }
+
+    return this->keyframes.back().time - this->keyframes.front().time;
+}
+
+
+unsigned int CameraPath::GetNumberOfKeyframes() const{
+    return this->keyframes.size();
+}
@@ -0,0 +1,152 @@
+#include "DepthPyramid.hpp"
+#include "GLExtensions.hpp"
+
+#include <algorithm>
+
+// largest power of two that is not larger than the value
+static int PreviousPowerOfTwo(int value){
+
+    int result = 1;
+    while (result * 2 <= value){
+        result *= 2;
+    }
+
+    return result;
+}
+
+
+DepthPyramid::DepthPyramid(){ }
+
+
+DepthPyramid::~DepthPyramid(){
+
+    if (this->reduceShader != nullptr){
+        delete this->reduceShader;
+    }
+
+    if (this->depthTexture != 0){
+        glDeleteTextures(1, &this->depthTexture);
+        glDeleteTextures(1, &this->pyramidTexture);
+    }
+
+}
+
+
+void DepthPyramid::Resize(int screenWidth, int screenHeight){
+
+    if (this->depthTexture == 0){
+        glGenTextures(1, &this->depthTexture);
+        glGenTextures(1, &this->pyramidTexture);
+    }
+
+    this->screenWidth = screenWidth;
+    this->screenHeight = screenHeight;
+    this->width = PreviousPowerOfTwo(screenWidth);
+    this->height = PreviousPowerOfTwo(screenHeight);
+
+    this->numberOfLevels = 1;
+    while ((std::max(this->width, this->height) >> this->numberOfLevels) > 0){
+        this->numberOfLevels++;
+    }
+
+    // full resolution copy of the depth buffer
+    glBindTexture(GL_TEXTURE_2D, this->depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, screenWidth, screenHeight, 0,
+                 GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    // every level is read with texelFetch - no filtering
+    glBindTexture(GL_TEXTURE_2D, this->pyramidTexture);
+    for (int level = 0; level < this->numberOfLevels; level++){
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(this->width >> level, 1), std::max(this->height >> level, 1), 0,
+                     GL_RED, GL_FLOAT, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, this->numberOfLevels - 1);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+}
+
+
+void DepthPyramid::Build(const glm::mat4& viewProjection){
+
+    if (this->reduceShader == nullptr){
+        this->reduceShader = new Shader("./shaders/comp_DepthReduce.glsl");
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    if (viewport[2] != this->screenWidth || viewport[3] != this->screenHeight){
+        Resize(viewport[2], viewport[3]);
+    }
+
+    // depth buffer of the bound framebuffer (default or G-buffer) -> texture
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, this->depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], this->screenWidth, this->screenHeight);
+
+    this->reduceShader->Bind();
+    this->reduceShader->Upload_Uniform1i_Pipeline("u_Source", 0);
+
+    // each level is the maximum of the texels it covers in the previous one
+    for (int level = 0; level < this->numberOfLevels; level++){
+
+        int sourceLevel = level == 0 ? 0 : level - 1;
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? this->depthTexture : this->pyramidTexture);
+        this->reduceShader->Upload_Uniform1i_Pipeline("u_SourceLevel", sourceLevel);
+
+        glBindImageTexture(0, this->pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        int levelWidth = std::max(this->width >> level, 1);
+        int levelHeight = std::max(this->height >> level, 1);
+        glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+
+        // the next level reads this one
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    this->reduceShader->Unbind();
+
+    this->viewProjection = viewProjection;
+    this->valid = true;
+
+}
+
+
+GLuint DepthPyramid::GetTexture() const{
+    return this->pyramidTexture;
+}
+
+
+int DepthPyramid::GetWidth() const{
+    return this->width;
+}
+
+
+int DepthPyramid::GetHeight() const{
+    return this->height;
+}
+
+
+int DepthPyramid::GetNumberOfLevels() const{
+    return this->numberOfLevels;
+}
+
+
+const glm::mat4& DepthPyramid::GetViewProjection() const{
+    return this->viewProjection;
+}
+
+
+bool DepthPyramid::IsValid() const{
+    return this->valid;
+}
@@ -0,0 +1,322 @@
+#include "FrameCapture.hpp"
+#include "GLExtensions.hpp"
+#include "FrameTimer.hpp"
+#include "PPM.hpp"
+
+// STL
+#include <algorithm>
+
+
+FrameCapture::FrameCapture(unsigned int numberOfBuffers){
+
+    this->persistent = gGLCapabilities.bufferStorage;
+    this->buffers.resize(std::max(numberOfBuffers, 1u));
+
+    this->writer = std::thread(&FrameCapture::WriterLoop, this);
+
+}
+
+
+FrameCapture::~FrameCapture(){
+
+    Flush();
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+    this->condition.notify_all();
+
+    this->writer.join();
+
+    for (CaptureBuffer& buffer : this->buffers){
+        Destroy(buffer);
+    }
+
+}
+
+
+void FrameCapture::Create(CaptureBuffer& buffer, size_t size){
+
+    buffer.size = size;
+    buffer.state = BUFFER_FREE;
+
+    glGenBuffers(1, &buffer.bufferID);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.bufferID);
+
+    if (this->persistent){
+        // read by the CPU - client storage asks for cached memory
+        GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_PACK_BUFFER, size, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+        buffer.pointer = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags));
+    }
+    else{
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+}
+
+
+void FrameCapture::Destroy(CaptureBuffer& buffer){
+
+    if (buffer.bufferID == 0){
+        return;
+    }
+
+    if (buffer.fence != nullptr){
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+
+    if (buffer.pointer != nullptr || buffer.mapped){
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.bufferID);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    glDeleteBuffers(1, &buffer.bufferID);
+
+    buffer.bufferID = 0;
+    buffer.size = 0;
+    buffer.pointer = nullptr;
+    buffer.mapped = false;
+
+}
+
+
+void FrameCapture::Unmap(CaptureBuffer& buffer){
+
+    if (!buffer.mapped){
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.bufferID);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    buffer.mapped = false;
+
+}
+
+
+bool FrameCapture::Capture(const std::string& fileName, unsigned int width, unsigned int height){
+
+    if (width == 0 || height == 0){
+        return false;
+    }
+
+    Collect();
+
+    int found = -1;
+    for (unsigned int i = 0; i < this->buffers.size() && found < 0; i++){
+        unsigned int index = (this->nextBuffer + i) % this->buffers.size();
+        if (this->buffers[index].state == BUFFER_FREE){
+            found = index;
+        }
+    }
+
+    if (found < 0){
+        this->statistics.dropped++;
+        return false;
+    }
+
+    this->nextBuffer = (found + 1) % this->buffers.size();
+    CaptureBuffer& buffer = this->buffers[found];
+
+    // RGBA rows are 4 byte aligned whatever the width
+    size_t size = static_cast<size_t>(width) * height * 4;
+    if (size != buffer.size){
+        Destroy(buffer);
+        Create(buffer, size);
+    }
+
+    double start = FrameTimer::Now();
+
+    // the back buffer of the window into the buffer at offset 0
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.bufferID);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    buffer.state = BUFFER_READING;
+    buffer.fileName = fileName;
+    buffer.width = width;
+    buffer.height = height;
+
+    double miliseconds = (FrameTimer::Now() - start) * 1000.0;
+    this->statistics.captured++;
+    this->statistics.readMiliseconds += miliseconds;
+    this->statistics.maxReadMiliseconds = std::max(this->statistics.maxReadMiliseconds, miliseconds);
+
+    return true;
+}
+
+
+void FrameCapture::Collect(){
+
+    std::vector<unsigned int> finished;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        finished.swap(this->written);
+        this->statistics.written = this->files;
+        this->statistics.failed = this->failed;
+        this->statistics.writeMiliseconds = this->writeMiliseconds;
+    }
+
+    for (unsigned int index : finished){
+        CaptureBuffer& buffer = this->buffers[index];
+        Unmap(buffer);
+        buffer.state = BUFFER_FREE;
+    }
+
+}
+
+
+void FrameCapture::Update(){
+
+    Collect();
+
+    std::vector<WriteJob> jobs;
+    for (unsigned int i = 0; i < this->buffers.size(); i++){
+
+        CaptureBuffer& buffer = this->buffers[i];
+        if (buffer.state != BUFFER_READING || glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED){
+            continue;
+        }
+
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+
+        // the copy is done - mapping does not wait any more
+        const uint8_t* data = buffer.pointer;
+        if (!this->persistent){
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.bufferID);
+            data = static_cast<const uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer.size, GL_MAP_READ_BIT));
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            buffer.mapped = data != nullptr;
+        }
+
+        if (data == nullptr){
+            buffer.state = BUFFER_FREE;
+            this->statistics.dropped++;
+            continue;
+        }
+
+        WriteJob job;
+        job.buffer = i;
+        job.data = data;
+        job.fileName = buffer.fileName;
+        job.width = buffer.width;
+        job.height = buffer.height;
+        jobs.push_back(job);
+
+        buffer.state = BUFFER_WRITING;
+    }
+
+    if (jobs.empty()){
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->queue.insert(this->queue.end(), jobs.begin(), jobs.end());
+    }
+    this->condition.notify_one();
+
+}
+
+
+void FrameCapture::Flush(){
+
+    // the copies first, then the writer
+    for (CaptureBuffer& buffer : this->buffers){
+        if (buffer.state == BUFFER_READING){
+            glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+    }
+
+    Update();
+
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->done.wait(lock, [this]{ return this->queue.empty() && !this->writing; });
+    }
+
+    Collect();
+
+}
+
+
+unsigned int FrameCapture::GetPending() const{
+
+    unsigned int pending = 0;
+    for (const CaptureBuffer& buffer : this->buffers){
+        pending += buffer.state != BUFFER_FREE;
+    }
+
+    return pending;
+}
+
+
+FrameCaptureStatistics FrameCapture::GetStatistics() const{
+    return this->statistics;
+}
+
+
+void FrameCapture::WriterLoop(){
+
+    std::vector<uint8_t> rgb;
+    while (true){
+
+        WriteJob job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this]{ return this->stop || !this->queue.empty(); });
+            if (this->stop){
+                return;
+            }
+
+            job = this->queue.front();
+            this->queue.pop_front();
+            this->writing = true;
+        }
+
+        double start = FrameTimer::Now();
+
+        // GL rows start at the bottom, ppm rows at the top - flip and drop the alpha
+        rgb.resize(static_cast<size_t>(job.width) * job.height * 3);
+        for (unsigned int y = 0; y < job.height; y++){
+            const uint8_t* source = job.data + static_cast<size_t>(job.height - 1 - y) * job.width * 4;
+            uint8_t* target = rgb.data() + static_cast<size_t>(y) * job.width * 3;
+            for (unsigned int x = 0; x < job.width; x++){
+                target[x * 3] = source[x * 4];
+                target[x * 3 + 1] = source[x * 4 + 1];
+                target[x * 3 + 2] = source[x * 4 + 2];
+            }
+        }
+
+        // the buffer can take the next capture while the file is written
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->written.push_back(job.buffer);
+        }
+
+        bool saved = PPM::Write(job.fileName, job.width, job.height, rgb.data());
+        double miliseconds = (FrameTimer::Now() - start) * 1000.0;
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->files += saved;
+            this->failed += !saved;
+            this->writeMiliseconds += miliseconds;
+            this->writing = false;
+        }
+        this->done.notify_all();
+    }
+
+}
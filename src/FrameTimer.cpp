@@ -0,0 +1,88 @@
+#include "FrameTimer.hpp"
+
+#include <algorithm>
+
+FrameTimer::FrameTimer(double tickRate){
+    this->tickTime = 1.0 / tickRate;
+}
+
+FrameTimer::~FrameTimer(){ }
+
+
+void FrameTimer::BeginFrame(){
+
+    double now = Now();
+
+    // first frame does not simulate anything
+    if (!this->started){
+        this->frameStart = now;
+        this->started = true;
+    }
+
+    this->frameDelta = std::min(now - this->frameStart, this->maxFrameDelta);
+    this->frameStart = now;
+
+    this->accumulator += this->frameDelta;
+
+}
+
+
+bool FrameTimer::ConsumeTick(){
+
+    if (this->accumulator < this->tickTime){
+        return false;
+    }
+
+    this->accumulator -= this->tickTime;
+
+    return true;
+}
+
+
+float FrameTimer::GetAlpha() const{
+    return static_cast<float>(this->accumulator / this->tickTime);
+}
+
+
+float FrameTimer::GetTickTime() const{
+    return static_cast<float>(this->tickTime);
+}
+
+
+double FrameTimer::GetFrameDelta() const{
+    return this->frameDelta;
+}
+
+
+void FrameTimer::LimitFrameRate(unsigned int framesPerSecond) const{
+
+    if (framesPerSecond == 0){ // unlimited
+        return;
+    }
+
+    SleepUntil(this->frameStart + 1.0 / framesPerSecond);
+
+}
+
+
+double FrameTimer::Now(){
+    return static_cast<double>(SDL_GetPerformanceCounter()) / SDL_GetPerformanceFrequency();
+}
+
+
+void FrameTimer::SleepUntil(double time){
+
+    // SDL_Delay can oversleep by about a millisecond - spin for the rest
+    const double spinTime = 0.002;
+
+    double remaining = time - Now();
+
+    if (remaining > spinTime){
+        SDL_Delay(static_cast<Uint32>((remaining - spinTime) * 1000.0));
+    }
+
+    while (Now() < time){
+        // busy wait
+    }
+
+}
@@ -0,0 +1,173 @@
+#include "GBuffer.hpp"
+#include "Scene.hpp"
+
+#include <iostream>
+
+GBuffer::GBuffer(){ }
+
+
+GBuffer::~GBuffer(){
+
+    if (this->lightingShader != nullptr){
+        delete this->lightingShader;
+    }
+
+    if (this->framebuffer != 0){
+        glDeleteFramebuffers(1, &this->framebuffer);
+        glDeleteTextures(1, &this->albedoTexture);
+        glDeleteTextures(1, &this->normalTexture);
+        glDeleteTextures(1, &this->drawTexture);
+        glDeleteTextures(1, &this->depthTexture);
+        glDeleteVertexArrays(1, &this->emptyVAO);
+    }
+
+}
+
+
+// texture of one target - every target is read with texelFetch, no filtering
+static void CreateTarget(GLuint texture, GLint internalFormat, GLenum format, GLenum type, int width, int height){
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+}
+
+
+void GBuffer::Resize(int screenWidth, int screenHeight){
+
+    if (this->framebuffer == 0){
+        glGenFramebuffers(1, &this->framebuffer);
+        glGenTextures(1, &this->albedoTexture);
+        glGenTextures(1, &this->normalTexture);
+        glGenTextures(1, &this->drawTexture);
+        glGenTextures(1, &this->depthTexture);
+        glGenVertexArrays(1, &this->emptyVAO);
+    }
+
+    this->width = screenWidth;
+    this->height = screenHeight;
+
+    CreateTarget(this->albedoTexture, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, screenWidth, screenHeight);
+    CreateTarget(this->normalTexture, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, screenWidth, screenHeight);
+    CreateTarget(this->drawTexture, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, screenWidth, screenHeight);
+    CreateTarget(this->depthTexture, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, screenWidth, screenHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->albedoTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, this->normalTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, this->drawTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->depthTexture, 0);
+
+    const GLenum drawBuffers[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+    glDrawBuffers(3, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+        std::cout << "G-buffer framebuffer is not complete" << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+}
+
+
+void GBuffer::BeginGeometryPass(int screenWidth, int screenHeight){
+
+    if (screenWidth != this->width || screenHeight != this->height){
+        Resize(screenWidth, screenHeight);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glViewport(0, 0, this->width, this->height);
+
+    // draw 0 of the cleared pixels is never read - the lighting pass skips the far depth
+    const GLfloat zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const GLuint zeroDraw[4] = {0, 0, 0, 0};
+    const GLfloat farDepth = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glClearBufferfv(GL_COLOR, 1, zero);
+    glClearBufferuiv(GL_COLOR, 2, zeroDraw);
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+}
+
+
+void GBuffer::EndGeometryPass(){
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+}
+
+
+void GBuffer::LightingPass(const FrameContext& context){
+
+    if (this->lightingShader == nullptr){
+        this->lightingShader = new Shader("./shaders/vert_Fullscreen.glsl", "./shaders/frag_DeferredLighting.glsl");
+    }
+
+    this->lightingShader->Bind();
+
+    this->lightingShader->Upload_Uniform1i_Pipeline("gAlbedo", 0);
+    this->lightingShader->Upload_Uniform1i_Pipeline("gNormal", 1);
+    this->lightingShader->Upload_Uniform1i_Pipeline("gDraw", 2);
+    this->lightingShader->Upload_Uniform1i_Pipeline("gDepth", 3);
+
+    glm::mat4 view = context.view;
+    glm::mat4 inverseViewProjection = glm::inverse(context.viewProjection);
+    this->lightingShader->Upload_Uniform_MAT4fv_Pipeline("u_ViewMatrix", view);
+    this->lightingShader->Upload_Uniform_MAT4fv_Pipeline("u_InverseViewProjection", inverseViewProjection);
+    this->lightingShader->Upload_Uniform3f_Pipeline("u_CameraPos", context.cameraPosition.x,
+                                                    context.cameraPosition.y, context.cameraPosition.z);
+
+    GLuint targets[4] = {this->albedoTexture, this->normalTexture, this->drawTexture, this->depthTexture};
+    for (int i = 0; i < 4; i++){
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, targets[i]);
+    }
+
+    // point lights and their clusters
+    gScene.BindLights();
+
+    // every pixel is shaded once, the depth of the G-buffer is written for the following draws
+    GLint polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthFunc(GL_ALWAYS);
+
+    glBindVertexArray(this->emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glDepthFunc(GL_LEQUAL);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+
+    for (int i = 3; i >= 0; i--){
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    this->lightingShader->Unbind();
+
+}
+
+
+int GBuffer::GetWidth() const{
+    return this->width;
+}
+
+
+int GBuffer::GetHeight() const{
+    return this->height;
+}
+
+
+unsigned int GBuffer::GetBytesPerPixel() const{
+
+    // albedo, normal and parallax depth, draw, depth
+    return 4 + 8 + 4 + 4;
+}
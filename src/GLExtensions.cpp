@@ -0,0 +1,142 @@
+#include "GLExtensions.hpp"
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#else // This works for Mac
+    #include <SDL.h>
+#endif
+
+#include <iostream>
+#include <cstring>
+
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage = nullptr;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect = nullptr;
+PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute = nullptr;
+PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier = nullptr;
+PFNGLBINDIMAGETEXTUREPROC glad_glBindImageTexture = nullptr;
+PFNGLCLEARBUFFERDATAPROC glad_glClearBufferData = nullptr;
+PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC glad_glMultiDrawElementsIndirectCount = nullptr;
+PFNGLTEXSTORAGE2DPROC glad_glTexStorage2D = nullptr;
+PFNGLTEXSTORAGE3DPROC glad_glTexStorage3D = nullptr;
+PFNGLCOPYIMAGESUBDATAPROC glad_glCopyImageSubData = nullptr;
+PFNGLGETTEXTUREHANDLEARBPROC glad_glGetTextureHandleARB = nullptr;
+PFNGLMAKETEXTUREHANDLERESIDENTARBPROC glad_glMakeTextureHandleResidentARB = nullptr;
+PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC glad_glMakeTextureHandleNonResidentARB = nullptr;
+
+GLCapabilities gGLCapabilities;
+
+
+// true if the context version is at least major.minor
+static bool HasVersion(int major, int minor){
+    return gGLCapabilities.majorVersion > major ||
+           (gGLCapabilities.majorVersion == major && gGLCapabilities.minorVersion >= minor);
+}
+
+
+bool IsGLExtensionSupported(const char* name){
+
+    GLint numberOfExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numberOfExtensions);
+
+    for (GLint i = 0; i < numberOfExtensions; i++){
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension != nullptr && std::strcmp(extension, name) == 0){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void LoadGLExtensions(){
+
+    glGetIntegerv(GL_MAJOR_VERSION, &gGLCapabilities.majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &gGLCapabilities.minorVersion);
+
+    // persistent mapped buffers
+    glad_glBufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(SDL_GL_GetProcAddress("glBufferStorage"));
+    gGLCapabilities.bufferStorage = glad_glBufferStorage != nullptr &&
+                                    (HasVersion(4, 4) || IsGLExtensionSupported("GL_ARB_buffer_storage"));
+
+    // shader storage buffers
+    gGLCapabilities.shaderStorageBuffer = HasVersion(4, 3) ||
+                                          IsGLExtensionSupported("GL_ARB_shader_storage_buffer_object");
+    if (gGLCapabilities.shaderStorageBuffer){
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &gGLCapabilities.storageBufferAlignment);
+    }
+
+    // multi draw indirect - the draw ID comes from the baseInstance
+    glad_glMultiDrawElementsIndirect = reinterpret_cast<PFNGLMULTIDRAWELEMENTSINDIRECTPROC>(
+                                            SDL_GL_GetProcAddress("glMultiDrawElementsIndirect"));
+    gGLCapabilities.multiDrawIndirect = glad_glMultiDrawElementsIndirect != nullptr &&
+                                        (HasVersion(4, 3) || (IsGLExtensionSupported("GL_ARB_multi_draw_indirect") &&
+                                                              IsGLExtensionSupported("GL_ARB_base_instance")));
+
+    // compute shaders (GPU culling)
+    glad_glDispatchCompute = reinterpret_cast<PFNGLDISPATCHCOMPUTEPROC>(SDL_GL_GetProcAddress("glDispatchCompute"));
+    glad_glMemoryBarrier = reinterpret_cast<PFNGLMEMORYBARRIERPROC>(SDL_GL_GetProcAddress("glMemoryBarrier"));
+    glad_glBindImageTexture = reinterpret_cast<PFNGLBINDIMAGETEXTUREPROC>(SDL_GL_GetProcAddress("glBindImageTexture"));
+    glad_glClearBufferData = reinterpret_cast<PFNGLCLEARBUFFERDATAPROC>(SDL_GL_GetProcAddress("glClearBufferData"));
+    gGLCapabilities.computeShader = glad_glDispatchCompute != nullptr && glad_glMemoryBarrier != nullptr &&
+                                    glad_glBindImageTexture != nullptr && glad_glClearBufferData != nullptr &&
+                                    HasVersion(4, 3);
+
+    // draw count from a buffer - core in 4.6, the ARB function has the same signature
+    glad_glMultiDrawElementsIndirectCount = reinterpret_cast<PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC>(
+                                                SDL_GL_GetProcAddress(HasVersion(4, 6) ? "glMultiDrawElementsIndirectCount"
+                                                                                       : "glMultiDrawElementsIndirectCountARB"));
+    gGLCapabilities.indirectCount = glad_glMultiDrawElementsIndirectCount != nullptr &&
+                                    (HasVersion(4, 6) || IsGLExtensionSupported("GL_ARB_indirect_parameters"));
+
+    // BC1 / BC3 textures - not core, but exposed by all desktop drivers
+    gGLCapabilities.textureCompressionS3TC = IsGLExtensionSupported("GL_EXT_texture_compression_s3tc");
+
+    // immutable texture storage and copies between textures (the streamed textures are reallocated)
+    glad_glTexStorage2D = reinterpret_cast<PFNGLTEXSTORAGE2DPROC>(SDL_GL_GetProcAddress("glTexStorage2D"));
+    glad_glTexStorage3D = reinterpret_cast<PFNGLTEXSTORAGE3DPROC>(SDL_GL_GetProcAddress("glTexStorage3D"));
+    gGLCapabilities.textureStorage = glad_glTexStorage2D != nullptr && glad_glTexStorage3D != nullptr &&
+                                     (HasVersion(4, 2) || IsGLExtensionSupported("GL_ARB_texture_storage"));
+
+    glad_glCopyImageSubData = reinterpret_cast<PFNGLCOPYIMAGESUBDATAPROC>(SDL_GL_GetProcAddress("glCopyImageSubData"));
+    gGLCapabilities.copyImage = glad_glCopyImageSubData != nullptr &&
+                                (HasVersion(4, 3) || IsGLExtensionSupported("GL_ARB_copy_image"));
+
+    // core in 4.6, the extensions use the same constants
+    gGLCapabilities.anisotropicFiltering = HasVersion(4, 6) ||
+                                           IsGLExtensionSupported("GL_ARB_texture_filter_anisotropic") ||
+                                           IsGLExtensionSupported("GL_EXT_texture_filter_anisotropic");
+    if (gGLCapabilities.anisotropicFiltering){
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &gGLCapabilities.maxAnisotropy);
+    }
+
+    // texture handles in the material buffer - not core, the materials are read from SSBOs
+    glad_glGetTextureHandleARB = reinterpret_cast<PFNGLGETTEXTUREHANDLEARBPROC>(
+                                     SDL_GL_GetProcAddress("glGetTextureHandleARB"));
+    glad_glMakeTextureHandleResidentARB = reinterpret_cast<PFNGLMAKETEXTUREHANDLERESIDENTARBPROC>(
+                                              SDL_GL_GetProcAddress("glMakeTextureHandleResidentARB"));
+    glad_glMakeTextureHandleNonResidentARB = reinterpret_cast<PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC>(
+                                                 SDL_GL_GetProcAddress("glMakeTextureHandleNonResidentARB"));
+    gGLCapabilities.bindlessTexture = glad_glGetTextureHandleARB != nullptr &&
+                                      glad_glMakeTextureHandleResidentARB != nullptr &&
+                                      glad_glMakeTextureHandleNonResidentARB != nullptr &&
+                                      gGLCapabilities.shaderStorageBuffer &&
+                                      IsGLExtensionSupported("GL_ARB_bindless_texture");
+
+    std::cout << "Persistent mapped buffers: " << (gGLCapabilities.bufferStorage ? "yes" : "no") << "\n";
+    std::cout << "Shader storage buffers: " << (gGLCapabilities.shaderStorageBuffer ? "yes" : "no") << "\n";
+    std::cout << "Multi draw indirect: " << (gGLCapabilities.multiDrawIndirect ? "yes" : "no") << "\n";
+    std::cout << "Compute shaders: " << (gGLCapabilities.computeShader ? "yes" : "no") << "\n";
+    std::cout << "Indirect draw count: " << (gGLCapabilities.indirectCount ? "yes" : "no") << "\n";
+    std::cout << "S3TC texture compression: " << (gGLCapabilities.textureCompressionS3TC ? "yes" : "no") << "\n";
+    std::cout << "Immutable texture storage: " << (gGLCapabilities.textureStorage ? "yes" : "no") << "\n";
+    std::cout << "Bindless textures: " << (gGLCapabilities.bindlessTexture ? "yes" : "no") << "\n";
+    std::cout << "Anisotropic filtering: ";
+    if (gGLCapabilities.anisotropicFiltering){
+        std::cout << gGLCapabilities.maxAnisotropy << "x\n";
+    }
+    else{
+        std::cout << "no\n";
+    }
+
+}
@@ -0,0 +1,249 @@
+#include "GPUCulling.hpp"
+#include "Meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+GPUCulling::GPUCulling(){ }
+
+
+GPUCulling::~GPUCulling(){
+
+    if (this->cullShader != nullptr){
+        delete this->cullShader;
+    }
+
+    if (this->objectBuffer != nullptr){
+        delete this->objectBuffer;
+    }
+
+    if (this->commandBuffer != 0){
+        glDeleteBuffers(1, &this->commandBuffer);
+        glDeleteBuffers(1, &this->outputBuffer);
+        glDeleteBuffers(1, &this->countBuffer);
+        glDeleteBuffers(1, &this->parameterBuffer);
+    }
+
+}
+
+
+void GPUCulling::SetCommands(const std::vector<DrawElementsIndirectCommand>& commands, unsigned int numberOfBatches){
+
+    this->commands = commands;
+    this->numberOfBatches = numberOfBatches;
+    this->dirty = true;
+
+}
+
+
+void GPUCulling::Dispatch(const std::vector<CullObject>& objects, const CullParameters& parameters){
+
+    if (this->cullShader == nullptr){
+
+        this->cullShader = new Shader("./shaders/comp_Cull.glsl");
+        this->objectBuffer = new RingBuffer(GL_SHADER_STORAGE_BUFFER, 1024 * sizeof(CullObject));
+
+        glGenBuffers(1, &this->commandBuffer);
+        glGenBuffers(1, &this->outputBuffer);
+        glGenBuffers(1, &this->countBuffer);
+        glGenBuffers(1, &this->parameterBuffer);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->parameterBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(CullParameters), nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    // static commands - only when the batches changed
+    if (this->dirty){
+
+        GLsizeiptr commandsSize = std::max<size_t>(this->commands.size(), 1) * sizeof(DrawElementsIndirectCommand);
+        GLsizeiptr countsSize = std::max(this->numberOfBatches, 1u) * sizeof(GLuint);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->commandBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, commandsSize, nullptr, GL_STATIC_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, this->commands.size() * sizeof(DrawElementsIndirectCommand), this->commands.data());
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->outputBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, commandsSize, nullptr, GL_DYNAMIC_COPY);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->countBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, countsSize, nullptr, GL_DYNAMIC_COPY);
+
+        this->dirty = false;
+    }
+
+    // bounds of the frame
+    GLsizeiptr objectsSize = objects.size() * sizeof(CullObject);
+    void* data = this->objectBuffer->BeginFrame(objectsSize);
+    std::memcpy(data, objects.data(), objectsSize);
+    this->objectBuffer->Commit();
+    this->objectBuffer->BindRange(CULL_OBJECTS_BINDING, objectsSize);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->parameterBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(CullParameters), &parameters);
+
+    // empty commands (instance count 0) after the compacted ones, counts start at 0
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->outputBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->countBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COMMANDS_BINDING, this->commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_OUTPUT_BINDING, this->outputBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COUNTS_BINDING, this->countBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_PARAMETERS_BINDING, this->parameterBuffer);
+
+    this->cullShader->Bind();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, this->pyramid.GetTexture());
+    this->cullShader->Upload_Uniform1i_Pipeline("u_DepthPyramid", 0);
+
+    glDispatchCompute((objects.size() + 63) / 64, 1, 1);
+
+    // the draws read the commands and counts written by the shader
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    this->cullShader->Unbind();
+
+    this->objectBuffer->EndFrame();
+
+}
+
+
+void GPUCulling::BuildDepthPyramid(const glm::mat4& viewProjection){
+    this->pyramid.Build(viewProjection);
+}
+
+
+void GPUCulling::SetOcclusionParameters(CullParameters& parameters, bool occlusion) const{
+
+    occlusion = occlusion && this->pyramid.IsValid();
+
+    parameters.occlusionViewProjection = this->pyramid.GetViewProjection();
+    parameters.pyramidSize = glm::vec4(this->pyramid.GetWidth(), this->pyramid.GetHeight(), this->pyramid.GetNumberOfLevels(), 0.0f);
+    parameters.info.y = occlusion ? 1 : 0;
+
+}
+
+
+GLuint GPUCulling::GetCommandBuffer() const{
+    return this->outputBuffer;
+}
+
+
+GLuint GPUCulling::GetCountBuffer() const{
+    return this->countBuffer;
+}
+
+
+void GPUCulling::CullDraws(const std::vector<CullObject>& objects,
+                           const std::vector<DrawElementsIndirectCommand>& staticCommands,
+                           const CullParameters& parameters, const DepthLevels& pyramid,
+                           std::vector<DrawElementsIndirectCommand>& outputCommands,
+                           std::vector<GLuint>& drawCounts){
+
+    DrawElementsIndirectCommand empty = {0, 0, 0, 0, 0};
+    outputCommands.assign(staticCommands.size(), empty);
+    std::fill(drawCounts.begin(), drawCounts.end(), 0);
+
+    bool occlusion = parameters.info.y != 0 && !pyramid.empty();
+    unsigned int numberOfDraws = std::min<size_t>(parameters.info.x, objects.size());
+
+    for (unsigned int slot = 0; slot < numberOfDraws; slot++){
+
+        const CullObject& object = objects[slot];
+
+        if (object.sphere.w < 0.0f || !IsSphereVisible(parameters, object.sphere) ||
+            IsConeBackfacing(parameters, object.sphere, object.cone)){
+            continue;
+        }
+
+        if (occlusion && IsSphereOccluded(parameters, object.sphere, pyramid)){
+            continue;
+        }
+
+        // compact the visible draws at the start of the batch
+        GLuint index = drawCounts[object.batch.x]++;
+
+        DrawElementsIndirectCommand command = staticCommands[slot];
+        command.instanceCount = 1;
+        outputCommands[object.batch.y + index] = command;
+    }
+
+}
+
+
+bool GPUCulling::IsConeBackfacing(const CullParameters& parameters, const glm::vec4& sphere, const glm::vec4& cone){
+
+    if (cone.w >= 1.0f){    // no cone
+        return false;
+    }
+
+    return MeshletBuilder::IsBackfacing(glm::vec3(sphere), sphere.w, glm::vec3(cone), cone.w,
+                                        glm::vec3(parameters.cameraPosition));
+}
+
+
+bool GPUCulling::IsSphereVisible(const CullParameters& parameters, const glm::vec4& sphere){
+
+    for (const glm::vec4& plane : parameters.frustumPlanes){
+        if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool GPUCulling::IsSphereOccluded(const CullParameters& parameters, const glm::vec4& sphere, const DepthLevels& pyramid){
+
+    // screen rectangle and nearest depth of the box around the sphere
+    glm::vec2 minimum = glm::vec2(1.0f);
+    glm::vec2 maximum = glm::vec2(0.0f);
+    float nearestDepth = 1.0f;
+
+    for (int i = 0; i < 8; i++){
+
+        glm::vec3 corner = glm::vec3(sphere) + sphere.w * glm::vec3((i & 1) != 0 ? 1.0f : -1.0f,
+                                                                    (i & 2) != 0 ? 1.0f : -1.0f,
+                                                                    (i & 4) != 0 ? 1.0f : -1.0f);
+        glm::vec4 clip = parameters.occlusionViewProjection * glm::vec4(corner, 1.0f);
+
+        if (clip.w <= 0.0f){ // reaches behind the camera
+            return false;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        minimum = glm::min(minimum, glm::vec2(ndc) * 0.5f + 0.5f);
+        maximum = glm::max(maximum, glm::vec2(ndc) * 0.5f + 0.5f);
+        nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    minimum = glm::clamp(minimum, 0.0f, 1.0f);
+    maximum = glm::clamp(maximum, 0.0f, 1.0f);
+
+    // level where the rectangle covers at most 2 x 2 texels
+    glm::vec2 size = (maximum - minimum) * glm::vec2(parameters.pyramidSize);
+    int level = static_cast<int>(std::ceil(std::log2(std::max(std::max(size.x, size.y), 1.0f))));
+    level = std::min(level, static_cast<int>(parameters.pyramidSize.z) - 1);
+    level = std::min(level, static_cast<int>(pyramid.size()) - 1);
+
+    int levelWidth = std::max(static_cast<int>(parameters.pyramidSize.x) >> level, 1);
+    int levelHeight = std::max(static_cast<int>(parameters.pyramidSize.y) >> level, 1);
+    const std::vector<float>& depth = pyramid[level];
+
+    int firstX = std::min(static_cast<int>(minimum.x * levelWidth), levelWidth - 1);
+    int firstY = std::min(static_cast<int>(minimum.y * levelHeight), levelHeight - 1);
+    int lastX = std::min(static_cast<int>(maximum.x * levelWidth), levelWidth - 1);
+    int lastY = std::min(static_cast<int>(maximum.y * levelHeight), levelHeight - 1);
+
+    float farthest = std::max(std::max(depth[firstY * levelWidth + firstX], depth[firstY * levelWidth + lastX]),
+                              std::max(depth[lastY * levelWidth + firstX], depth[lastY * levelWidth + lastX]));
+
+    return nearestDepth > farthest;
+}
@@ -1,5 +1,8 @@
 #include "Geometry.hpp"
 
+// glm lib
+#include <glm/gtc/constants.hpp>
+
 /**
  * @brief      Constructs the plane object.
  * 
@@ -22,6 +25,25 @@ Object * CreatePlane(const std::string& vertexShaderPath, const std::string& fra
                      const std::string& diffuseMapPath, const std::string& normalMapPath, 
                      const std::string& heightMapPath, bool inverseH, int continousTexture){
 
+                        Object * plane = CreatePlane(vertexShaderPath, fragmentShaderPath, translation, rotation, scale,
+                                                     continousTexture);
+
+                        // load texture
+                        plane->LoadTexture(diffuseMapPath, 0, false);
+                        plane->LoadMaterial(normalMapPath, heightMapPath, inverseH);
+
+                        return plane;
+                     }
+
+
+/**
+ * @brief      Vertices and indices of the plane (a quad of two triangles in the xy plane).
+ *
+ * @param[out] data     Interleaved stride 14 vertices
+ * @param[out] indices  The indices
+*/
+void CreatePlaneMesh(std::vector<GLfloat>& data, std::vector<GLuint>& indices){
+
                         // positions
                         glm::vec3 pos1(-1.0f,  1.0f, 0.0f);
                         glm::vec3 pos2(-1.0f, -1.0f, 0.0f);
@@ -82,7 +104,7 @@ Object * CreatePlane(const std::string& vertexShaderPath, const std::string& fra
                         tangent1 = glm::normalize(tangent1);
                         tangent2 = glm::normalize(tangent2);
 
-                        std::vector<GLfloat> data = {
+                        data = {
                             // positions            // normal         // texcoords  // tangent                          // bitangent
                             pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
                             pos2.x, pos2.y, pos2.z, nm.x, nm.y, nm.z, uv2.x, uv2.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
@@ -91,7 +113,29 @@ Object * CreatePlane(const std::string& vertexShaderPath, const std::string& fra
                         };
 
                         // define indices
-                        std::vector<GLuint> indices = {0, 1, 2, 0, 2, 3};
+                        indices = {0, 1, 2, 0, 2, 3};
+                     }
+
+
+/**
+ * @brief      Constructs the plane object without textures.
+ *
+ * @param[in]  vertexShaderPath  The vertex shader path
+ * @param[in]  fragmentShaderPath  The fragment shader path
+ * @param[in]  translation       The translation
+ * @param[in]  rotation          The rotation
+ * @param[in]  scale             The scale
+ * @param[in]  continousTexture  The texture continues on the neighbouring tiles
+ *
+ * @return     The plane object.
+*/
+Object * CreatePlane(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+                     const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale,
+                     int continousTexture){
+
+                        std::vector<GLfloat> data;
+                        std::vector<GLuint> indices;
+                        CreatePlaneMesh(data, indices);
 
                         // create object 
 
@@ -100,11 +144,6 @@ Object * CreatePlane(const std::string& vertexShaderPath, const std::string& fra
                         // upload data to GPU
                         plane->UploadVertices(data, indices);
 
-                        // load texture
-                        plane->LoadTexture(diffuseMapPath, 0, false);
-                        plane->LoadTexture(normalMapPath, 1, false);
-                        plane->LoadTexture(heightMapPath, 2, inverseH);
-
                         // set affine transformation
                         plane->SetTranslation(translation);
                         plane->SetRotation(rotation);
@@ -117,4 +156,49 @@ Object * CreatePlane(const std::string& vertexShaderPath, const std::string& fra
                         plane->SetContinuousTexture(continousTexture);
 
                         return plane;
-                     }
\ No newline at end of file
+                     }
+
+
+/**
+ * @brief      Vertices and indices of a bumpy torus with a UV seam in both directions
+ *             (resolution x resolution quads, no GL calls).
+ *
+ * @param[in]  resolution  Quads around both circles
+ * @param[out] data        Interleaved stride 14 vertices
+ * @param[out] indices     The indices
+*/
+void CreateTorusMesh(unsigned int resolution, std::vector<GLfloat>& data, std::vector<GLuint>& indices){
+
+    const float majorRadius = 1.0f, minorRadius = 0.4f;
+
+    data.clear();
+    indices.clear();
+
+    for (unsigned int j = 0; j <= resolution; j++){
+        for (unsigned int i = 0; i <= resolution; i++){
+
+            float u = static_cast<float>(i) / resolution, v = static_cast<float>(j) / resolution;
+            float theta = glm::two_pi<float>() * u, phi = glm::two_pi<float>() * v;
+            float radius = minorRadius * (1.0f + 0.05f * std::sin(16.0f * theta) * std::sin(12.0f * phi));
+
+            glm::vec3 normal(std::cos(phi) * std::cos(theta), std::sin(phi), std::cos(phi) * std::sin(theta));
+            glm::vec3 position = glm::vec3(majorRadius * std::cos(theta), 0.0f, majorRadius * std::sin(theta)) +
+                                 radius * normal;
+            glm::vec3 tangent(-std::sin(theta), 0.0f, std::cos(theta));
+            glm::vec3 bitangent = glm::cross(normal, tangent);
+
+            GLfloat vertex[14] = {position.x, position.y, position.z, normal.x, normal.y, normal.z, u, v,
+                                  tangent.x, tangent.y, tangent.z, bitangent.x, bitangent.y, bitangent.z};
+            data.insert(data.end(), vertex, vertex + 14);
+        }
+    }
+
+    for (unsigned int j = 0; j < resolution; j++){
+        for (unsigned int i = 0; i < resolution; i++){
+            GLuint a = j * (resolution + 1) + i, b = a + 1, c = a + resolution + 1, d = c + 1;
+            GLuint quad[6] = {a, c, b, b, c, d};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+}
@@ -0,0 +1,499 @@
+#include "HeightMap.hpp"
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+// the SSE2 and AVX2 rows are compiled for their target only, the CPU is checked before they run
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define HEIGHTMAP_X86
+    #include <immintrin.h>
+#endif
+
+
+// split the rows between the threads of the job system (or run them on the calling thread)
+static void RunParallel(JobSystem* jobSystem, unsigned int count, unsigned int groupSize, const JobFunction& function){
+
+    if (jobSystem != nullptr){
+        jobSystem->ParallelFor(count, groupSize, function);
+    }
+    else{
+        function(0, count, 0);
+    }
+
+}
+
+
+// out = clamp(height * scale + bias, 0, maximum) rounded to nearest, or the bytes as they are / inverted
+struct HeightTransform{
+    float scale = 1.0f;
+    float bias = 0.0f;
+    float maximum = 255.0f;
+    bool bytes = false;         // R8 without a remap - copy or invert the bytes
+    bool invert = false;
+};
+
+
+    ///////////// scalar rows /////////////
+
+static void ExtractRowScalar(const uint8_t* source, unsigned int channels, unsigned int begin, unsigned int width,
+                             uint8_t* heights){
+
+    for (unsigned int x = begin; x < width; x++){
+        heights[x] = source[x * channels];
+    }
+
+}
+
+
+static void RangeRowScalar(const uint8_t* heights, unsigned int begin, unsigned int width,
+                           uint8_t& minimum, uint8_t& maximum){
+
+    for (unsigned int x = begin; x < width; x++){
+        minimum = std::min(minimum, heights[x]);
+        maximum = std::max(maximum, heights[x]);
+    }
+
+}
+
+
+template <typename T>
+static void ConvertRowScalar(const uint8_t* heights, unsigned int begin, unsigned int width,
+                             const HeightTransform& transform, T* texels){
+
+    if (transform.bytes){
+        for (unsigned int x = begin; x < width; x++){
+            texels[x] = transform.invert ? static_cast<uint8_t>(255 - heights[x]) : heights[x];
+        }
+        return;
+    }
+
+    for (unsigned int x = begin; x < width; x++){
+        float value = static_cast<float>(heights[x]) * transform.scale + transform.bias;
+        texels[x] = static_cast<T>(std::nearbyint(std::min(std::max(value, 0.0f), transform.maximum)));
+    }
+
+}
+
+
+#ifdef HEIGHTMAP_X86
+
+    ///////////// SSE2 rows /////////////
+
+__attribute__((target("sse2")))
+static unsigned int ExtractRowSSE2(const uint8_t* source, unsigned int channels, unsigned int width, uint8_t* heights){
+
+    unsigned int x = 0;
+
+    if (channels == 2){
+        const __m128i mask = _mm_set1_epi16(0x00FF);
+        for (; x + 16 <= width; x += 16){
+            __m128i a = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * x)), mask);
+            __m128i b = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * x + 16)), mask);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(heights + x), _mm_packus_epi16(a, b));
+        }
+    }
+    else if (channels == 4){
+        const __m128i mask = _mm_set1_epi32(0x000000FF);
+        for (; x + 16 <= width; x += 16){
+            const __m128i* texels = reinterpret_cast<const __m128i*>(source + 4 * x);
+            __m128i a = _mm_and_si128(_mm_loadu_si128(texels + 0), mask);
+            __m128i b = _mm_and_si128(_mm_loadu_si128(texels + 1), mask);
+            __m128i c = _mm_and_si128(_mm_loadu_si128(texels + 2), mask);
+            __m128i d = _mm_and_si128(_mm_loadu_si128(texels + 3), mask);
+            __m128i ab = _mm_packs_epi32(a, b);
+            __m128i cd = _mm_packs_epi32(c, d);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(heights + x), _mm_packus_epi16(ab, cd));
+        }
+    }
+
+    // RGB needs a byte shuffle (SSSE3) - left to the scalar loop
+    return x;
+}
+
+
+__attribute__((target("sse2")))
+static unsigned int RangeRowSSE2(const uint8_t* heights, unsigned int width, uint8_t& minimum, uint8_t& maximum){
+
+    if (width < 16){
+        return 0;
+    }
+
+    __m128i low = _mm_set1_epi8(static_cast<char>(minimum));
+    __m128i high = _mm_set1_epi8(static_cast<char>(maximum));
+
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16){
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(heights + x));
+        low = _mm_min_epu8(low, value);
+        high = _mm_max_epu8(high, value);
+    }
+
+    alignas(16) uint8_t lows[16], highs[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lows), low);
+    _mm_store_si128(reinterpret_cast<__m128i*>(highs), high);
+    for (unsigned int i = 0; i < 16; i++){
+        minimum = std::min(minimum, lows[i]);
+        maximum = std::max(maximum, highs[i]);
+    }
+
+    return x;
+}
+
+
+// 16 heights -> 4 x 4 clamped and rounded integers
+__attribute__((target("sse2")))
+static void TransformSSE2(__m128i heights, const HeightTransform& transform, __m128i result[4]){
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(transform.scale);
+    const __m128 bias = _mm_set1_ps(transform.bias);
+    const __m128 maximum = _mm_set1_ps(transform.maximum);
+
+    __m128i words[2] = {_mm_unpacklo_epi8(heights, zero), _mm_unpackhi_epi8(heights, zero)};
+    for (unsigned int i = 0; i < 4; i++){
+        __m128i integers = i % 2 == 0 ? _mm_unpacklo_epi16(words[i / 2], zero) : _mm_unpackhi_epi16(words[i / 2], zero);
+        __m128 value = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(integers), scale), bias);
+        value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), maximum);
+        result[i] = _mm_cvtps_epi32(value);
+    }
+
+}
+
+
+__attribute__((target("sse2")))
+static unsigned int ConvertRowSSE2(const uint8_t* heights, unsigned int width, const HeightTransform& transform,
+                                   uint8_t* texels){
+
+    unsigned int x = 0;
+
+    if (transform.bytes){
+        const __m128i flip = _mm_set1_epi8(transform.invert ? static_cast<char>(0xFF) : 0);
+        for (; x + 16 <= width; x += 16){
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(heights + x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(texels + x), _mm_xor_si128(value, flip));
+        }
+        return x;
+    }
+
+    for (; x + 16 <= width; x += 16){
+        __m128i result[4];
+        TransformSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(heights + x)), transform, result);
+        __m128i words = _mm_packus_epi16(_mm_packs_epi32(result[0], result[1]), _mm_packs_epi32(result[2], result[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(texels + x), words);
+    }
+
+    return x;
+}
+
+
+__attribute__((target("sse2")))
+static unsigned int ConvertRowSSE2(const uint8_t* heights, unsigned int width, const HeightTransform& transform,
+                                   uint16_t* texels){
+
+    // no unsigned 32 -> 16 bit pack in SSE2: shift to the signed range and back
+    const __m128i offset = _mm_set1_epi32(32768);
+    const __m128i sign = _mm_set1_epi16(static_cast<short>(0x8000));
+
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16){
+        __m128i result[4];
+        TransformSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(heights + x)), transform, result);
+        for (unsigned int i = 0; i < 2; i++){
+            __m128i words = _mm_packs_epi32(_mm_sub_epi32(result[2 * i], offset), _mm_sub_epi32(result[2 * i + 1], offset));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(texels + x + 8 * i), _mm_xor_si128(words, sign));
+        }
+    }
+
+    return x;
+}
+
+
+    ///////////// AVX2 rows /////////////
+
+__attribute__((target("avx2")))
+static unsigned int ExtractRowAVX2(const uint8_t* source, unsigned int channels, unsigned int width, uint8_t* heights){
+
+    unsigned int x = 0;
+
+    if (channels == 2){
+        const __m256i mask = _mm256_set1_epi16(0x00FF);
+        for (; x + 32 <= width; x += 32){
+            const __m256i* texels = reinterpret_cast<const __m256i*>(source + 2 * x);
+            __m256i a = _mm256_and_si256(_mm256_loadu_si256(texels + 0), mask);
+            __m256i b = _mm256_and_si256(_mm256_loadu_si256(texels + 1), mask);
+            // the pack works per 128 bit lane
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(heights + x), packed);
+        }
+    }
+    else if (channels == 3){
+        const __m128i first = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i second = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+        const __m128i third = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+        for (; x + 16 <= width; x += 16){
+            const __m128i* texels = reinterpret_cast<const __m128i*>(source + 3 * x);
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(texels + 0), first);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(texels + 1), second);
+            __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(texels + 2), third);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(heights + x), _mm_or_si128(_mm_or_si128(a, b), c));
+        }
+    }
+    else if (channels == 4){
+        const __m256i mask = _mm256_set1_epi32(0x000000FF);
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        for (; x + 32 <= width; x += 32){
+            const __m256i* texels = reinterpret_cast<const __m256i*>(source + 4 * x);
+            __m256i a = _mm256_and_si256(_mm256_loadu_si256(texels + 0), mask);
+            __m256i b = _mm256_and_si256(_mm256_loadu_si256(texels + 1), mask);
+            __m256i c = _mm256_and_si256(_mm256_loadu_si256(texels + 2), mask);
+            __m256i d = _mm256_and_si256(_mm256_loadu_si256(texels + 3), mask);
+            __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(heights + x), _mm256_permutevar8x32_epi32(packed, order));
+        }
+    }
+
+    return x;
+}
+
+
+__attribute__((target("avx2")))
+static unsigned int RangeRowAVX2(const uint8_t* heights, unsigned int width, uint8_t& minimum, uint8_t& maximum){
+
+    if (width < 32){
+        return 0;
+    }
+
+    __m256i low = _mm256_set1_epi8(static_cast<char>(minimum));
+    __m256i high = _mm256_set1_epi8(static_cast<char>(maximum));
+
+    unsigned int x = 0;
+    for (; x + 32 <= width; x += 32){
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(heights + x));
+        low = _mm256_min_epu8(low, value);
+        high = _mm256_max_epu8(high, value);
+    }
+
+    alignas(32) uint8_t lows[32], highs[32];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lows), low);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(highs), high);
+    for (unsigned int i = 0; i < 32; i++){
+        minimum = std::min(minimum, lows[i]);
+        maximum = std::max(maximum, highs[i]);
+    }
+
+    return x;
+}
+
+
+// 16 heights -> 16 clamped and rounded integers as 16 bit words in order
+__attribute__((target("avx2")))
+static __m256i TransformAVX2(__m128i heights, const HeightTransform& transform){
+
+    const __m256 scale = _mm256_set1_ps(transform.scale);
+    const __m256 bias = _mm256_set1_ps(transform.bias);
+    const __m256 maximum = _mm256_set1_ps(transform.maximum);
+
+    __m256i result[2];
+    for (unsigned int i = 0; i < 2; i++){
+        __m256i integers = _mm256_cvtepu8_epi32(i == 0 ? heights : _mm_unpackhi_epi64(heights, heights));
+        __m256 value = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(integers), scale), bias);
+        value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), maximum);
+        result[i] = _mm256_cvtps_epi32(value);
+    }
+
+    return _mm256_permute4x64_epi64(_mm256_packus_epi32(result[0], result[1]), 0xD8);
+}
+
+
+__attribute__((target("avx2")))
+static unsigned int ConvertRowAVX2(const uint8_t* heights, unsigned int width, const HeightTransform& transform,
+                                   uint8_t* texels){
+
+    unsigned int x = 0;
+
+    if (transform.bytes){
+        const __m256i flip = _mm256_set1_epi8(transform.invert ? static_cast<char>(0xFF) : 0);
+        for (; x + 32 <= width; x += 32){
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(heights + x));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(texels + x), _mm256_xor_si256(value, flip));
+        }
+        return x;
+    }
+
+    for (; x + 16 <= width; x += 16){
+        __m256i words = TransformAVX2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(heights + x)), transform);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(texels + x), bytes);
+    }
+
+    return x;
+}
+
+
+__attribute__((target("avx2")))
+static unsigned int ConvertRowAVX2(const uint8_t* heights, unsigned int width, const HeightTransform& transform,
+                                   uint16_t* texels){
+
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16){
+        __m256i words = TransformAVX2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(heights + x)), transform);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(texels + x), words);
+    }
+
+    return x;
+}
+
+#endif
+
+
+    ///////////// dispatch /////////////
+
+// first channel of a row, returns the heights (the source row itself for one channel)
+static const uint8_t* ExtractRow(const uint8_t* source, unsigned int channels, unsigned int width, SimdLevel level,
+                                 uint8_t* scratch){
+
+    if (channels == 1){
+        return source;
+    }
+
+    unsigned int done = 0;
+#ifdef HEIGHTMAP_X86
+    if (level == SIMD_AVX2){
+        done = ExtractRowAVX2(source, channels, width, scratch);
+    }
+    else if (level == SIMD_SSE2){
+        done = ExtractRowSSE2(source, channels, width, scratch);
+    }
+#endif
+    ExtractRowScalar(source, channels, done, width, scratch);
+
+    return scratch;
+}
+
+
+static void RangeRow(const uint8_t* heights, unsigned int width, SimdLevel level, uint8_t& minimum, uint8_t& maximum){
+
+    unsigned int done = 0;
+#ifdef HEIGHTMAP_X86
+    if (level == SIMD_AVX2){
+        done = RangeRowAVX2(heights, width, minimum, maximum);
+    }
+    else if (level == SIMD_SSE2){
+        done = RangeRowSSE2(heights, width, minimum, maximum);
+    }
+#endif
+    RangeRowScalar(heights, done, width, minimum, maximum);
+
+}
+
+
+template <typename T>
+static void ConvertRow(const uint8_t* heights, unsigned int width, const HeightTransform& transform, SimdLevel level,
+                       T* texels){
+
+    unsigned int done = 0;
+#ifdef HEIGHTMAP_X86
+    if (level == SIMD_AVX2){
+        done = ConvertRowAVX2(heights, width, transform, texels);
+    }
+    else if (level == SIMD_SSE2){
+        done = ConvertRowSSE2(heights, width, transform, texels);
+    }
+#endif
+    ConvertRowScalar(heights, done, width, transform, texels);
+
+}
+
+
+template <typename T>
+static std::vector<T> Convert(const uint8_t* pixels, unsigned int width, unsigned int height, unsigned int channels,
+                              const HeightMapOptions& options, JobSystem* jobSystem, SimdLevel level){
+
+    level = std::min(level, HeightMapProcessor::GetSupportedLevel());
+    size_t stride = static_cast<size_t>(width) * channels;
+    const unsigned int rowsPerJob = 16;
+
+    // range of the source (0..255 without the normalization)
+    uint8_t low = 0, high = 255;
+    if (options.normalize && width > 0 && height > 0){
+
+        std::vector<uint8_t> lows(height, 255), highs(height, 0);
+        RunParallel(jobSystem, height, rowsPerJob, [&](unsigned int begin, unsigned int end, unsigned int){
+            std::vector<uint8_t> scratch(width);
+            for (unsigned int y = begin; y < end; y++){
+                const uint8_t* heights = ExtractRow(pixels + y * stride, channels, width, level, scratch.data());
+                RangeRow(heights, width, level, lows[y], highs[y]);
+            }
+        });
+
+        low = *std::min_element(lows.begin(), lows.end());
+        high = *std::max_element(highs.begin(), highs.end());
+    }
+
+    // height in [0, 1] = a * texel + b, then to the range of the output
+    double maximum = sizeof(T) == 1 ? 255.0 : 65535.0;
+    double a = high > low ? 1.0 / (high - low) : 0.0;
+    double b = -low * a;
+    if (options.invert){
+        a = -a;
+        b = 1.0 - b;
+    }
+    double range = options.rangeMax - options.rangeMin;
+
+    HeightTransform transform;
+    transform.scale = static_cast<float>(maximum * range * a);
+    transform.bias = static_cast<float>(maximum * (options.rangeMin + range * b));
+    transform.maximum = static_cast<float>(maximum);
+    transform.bytes = sizeof(T) == 1 && low == 0 && high == 255 && options.rangeMin == 0.0f && options.rangeMax == 1.0f;
+    transform.invert = options.invert;
+
+    std::vector<T> texels(static_cast<size_t>(width) * height);
+    RunParallel(jobSystem, height, rowsPerJob, [&](unsigned int begin, unsigned int end, unsigned int){
+        std::vector<uint8_t> scratch(width);
+        for (unsigned int y = begin; y < end; y++){
+            const uint8_t* heights = ExtractRow(pixels + y * stride, channels, width, level, scratch.data());
+            ConvertRow(heights, width, transform, level, texels.data() + static_cast<size_t>(y) * width);
+        }
+    });
+
+    return texels;
+}
+
+
+std::vector<uint8_t> HeightMapProcessor::ConvertR8(const uint8_t* pixels, unsigned int width, unsigned int height,
+                                                   unsigned int channels, const HeightMapOptions& options,
+                                                   JobSystem* jobSystem, SimdLevel level){
+    return Convert<uint8_t>(pixels, width, height, channels, options, jobSystem, level);
+}
+
+
+std::vector<uint16_t> HeightMapProcessor::ConvertR16(const uint8_t* pixels, unsigned int width, unsigned int height,
+                                                     unsigned int channels, const HeightMapOptions& options,
+                                                     JobSystem* jobSystem, SimdLevel level){
+    return Convert<uint16_t>(pixels, width, height, channels, options, jobSystem, level);
+}
+
+
+SimdLevel HeightMapProcessor::GetSupportedLevel(){
+
+#ifdef HEIGHTMAP_X86
+    static const SimdLevel level = __builtin_cpu_supports("avx2") ? SIMD_AVX2 :
+                                   (__builtin_cpu_supports("sse2") ? SIMD_SSE2 : SIMD_SCALAR);
+    return level;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+
+const char* HeightMapProcessor::GetLevelName(SimdLevel level){
+
+    switch (level){
+        case SIMD_SCALAR: return "scalar";
+        case SIMD_SSE2: return "SSE2";
+        case SIMD_AVX2: return "AVX2";
+    }
+
+    return "scalar";
+}
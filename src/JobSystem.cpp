@@ -0,0 +1,159 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+
+JobSystem::JobSystem(unsigned int numberOfThreads){
+
+    if (numberOfThreads == 0){
+        numberOfThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    this->queuedJobs = 0;
+
+    for (unsigned int i = 0; i < numberOfThreads; i++){
+        this->queues.push_back(new WorkQueue());
+    }
+
+    // the main thread is the thread 0
+    for (unsigned int i = 1; i < numberOfThreads; i++){
+        this->workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+    }
+
+}
+
+
+JobSystem::~JobSystem(){
+
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->quit = true;
+    }
+    this->wakeUp.notify_all();
+
+    for (std::thread& worker : this->workers){
+        worker.join();
+    }
+
+    for (WorkQueue* queue : this->queues){
+        delete queue;
+    }
+
+}
+
+
+unsigned int JobSystem::GetNumberOfThreads() const{
+    return this->queues.size();
+}
+
+
+void JobSystem::ParallelFor(unsigned int count, unsigned int groupSize, const JobFunction& function){
+
+    if (count == 0){
+        return;
+    }
+
+    groupSize = std::max(groupSize, 1u);
+    unsigned int numberOfGroups = (count + groupSize - 1) / groupSize;
+
+    // nothing to share
+    if (numberOfGroups == 1 || this->queues.size() == 1){
+        function(0, count, 0);
+        return;
+    }
+
+    std::atomic<unsigned int> counter(numberOfGroups);
+
+    // spread the groups over the queues, stealing balances the rest
+    for (unsigned int group = 0; group < numberOfGroups; group++){
+
+        Job job;
+        job.function = &function;
+        job.begin = group * groupSize;
+        job.end = std::min(job.begin + groupSize, count);
+        job.counter = &counter;
+
+        WorkQueue* queue = this->queues[group % this->queues.size()];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->jobs.push_back(job);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->queuedJobs += numberOfGroups;
+    }
+    this->wakeUp.notify_all();
+
+    // help with the work until every group is done
+    while (counter.load(std::memory_order_acquire) > 0){
+
+        Job job;
+        if (PopJob(0, job)){
+            RunJob(job, 0);
+        }
+        else{
+            std::this_thread::yield();
+        }
+    }
+
+}
+
+
+bool JobSystem::PopJob(unsigned int threadIndex, Job& job){
+
+    unsigned int numberOfQueues = this->queues.size();
+
+    for (unsigned int i = 0; i < numberOfQueues; i++){
+
+        WorkQueue* queue = this->queues[(threadIndex + i) % numberOfQueues];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+
+        if (queue->jobs.empty()){
+            continue;
+        }
+
+        if (i == 0){ // own queue - newest job is still in the cache
+            job = queue->jobs.back();
+            queue->jobs.pop_back();
+        }
+        else{       // steal the oldest job
+            job = queue->jobs.front();
+            queue->jobs.pop_front();
+        }
+
+        this->queuedJobs--;
+        return true;
+    }
+
+    return false;
+}
+
+
+void JobSystem::RunJob(const Job& job, unsigned int threadIndex){
+
+    (*job.function)(job.begin, job.end, threadIndex);
+
+    job.counter->fetch_sub(1, std::memory_order_release);
+
+}
+
+
+void JobSystem::WorkerLoop(unsigned int threadIndex){
+
+    while (true){
+
+        Job job;
+        if (PopJob(threadIndex, job)){
+            RunJob(job, threadIndex);
+            continue;
+        }
+
+        // sleep until new jobs are pushed
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->wakeUp.wait(lock, [this]{ return this->quit || this->queuedJobs > 0; });
+
+        if (this->quit){
+            return;
+        }
+    }
+
+}
@@ -0,0 +1,297 @@
+#include "LightClusters.hpp"
+#include "FrameTimer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+LightClusters::LightClusters(){ }
+
+
+LightClusters::~LightClusters(){
+
+    if (this->lightBuffer != nullptr){
+        delete this->lightBuffer;
+    }
+
+    if (this->clusterBuffer != nullptr){
+        delete this->clusterBuffer;
+    }
+
+}
+
+
+void LightClusters::Build(const std::vector<PointLightData>& lights, const FrameContext& context,
+                          int screenWidth, int screenHeight, JobSystem* jobSystem){
+
+    double start = FrameTimer::Now();
+
+    this->projection = context.projection;
+    this->screenWidth = std::max(screenWidth, 1);
+    this->screenHeight = std::max(screenHeight, 1);
+
+    // without clustering one cluster covers the whole frustum
+    unsigned int tile = this->enabled ? std::max(this->tileSize, 1u)
+                                      : static_cast<unsigned int>(std::max(this->screenWidth, this->screenHeight));
+    unsigned int numberOfSlices = this->enabled ? std::max(this->slices, 1u) : 1;
+
+    float nearPlane = context.nearPlane;
+    float farPlane = context.farPlane;
+    float sliceScale = numberOfSlices / std::log(farPlane / nearPlane);
+
+    this->header.depth = glm::vec4(nearPlane, farPlane, sliceScale, -std::log(nearPlane) * sliceScale);
+    this->header.grid = glm::uvec4((this->screenWidth + tile - 1) / tile, (this->screenHeight + tile - 1) / tile,
+                                   numberOfSlices, tile);
+
+    unsigned int tilesX = this->header.grid.x;
+    unsigned int tilesPerSlice = tilesX * this->header.grid.y;
+    unsigned int numberOfClusters = GetNumberOfClusters();
+
+    // depth range of every light (lights without a range are not binned)
+    this->ranges.resize(lights.size());
+
+    JobFunction rangeJob = [&](unsigned int begin, unsigned int end, unsigned int){
+
+        for (unsigned int i = begin; i < end; i++){
+
+            LightRange& range = this->ranges[i];
+            range.firstSlice = -1;
+            range.lastSlice = -1;
+
+            glm::vec3 center = glm::vec3(lights[i].positionRadius);
+            float radius = lights[i].positionRadius.w;
+            if (radius <= 0.0f || !context.IsSphereVisible(center, radius)){
+                continue;
+            }
+
+            range.viewCenter = glm::vec3(context.view * glm::vec4(center, 1.0f));
+            range.radius = radius;
+
+            float depth = -range.viewCenter.z;
+            range.firstSlice = GetSlice(std::max(depth - radius, nearPlane));
+            range.lastSlice = GetSlice(std::min(depth + radius, farPlane));
+        }
+    };
+
+    // every slice collects the (tile, light) pairs of its clusters
+    this->clusterData.assign(2 * numberOfClusters, 0);
+    this->sliceIndices.resize(numberOfSlices);
+
+    JobFunction sliceJob = [&](unsigned int begin, unsigned int end, unsigned int){
+
+        std::vector<uint32_t> counts(tilesPerSlice);
+
+        for (unsigned int slice = begin; slice < end; slice++){
+
+            std::vector<uint32_t>& indices = this->sliceIndices[slice];
+            indices.clear();
+
+            float sliceNear = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice) / numberOfSlices);
+            float sliceFar = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice + 1) / numberOfSlices);
+
+            for (unsigned int i = 0; i < this->ranges.size(); i++){
+
+                const LightRange& range = this->ranges[i];
+                if (range.firstSlice > static_cast<int>(slice) || range.lastSlice < static_cast<int>(slice)){
+                    continue;
+                }
+
+                // the largest cross section of the sphere inside the slice
+                float depth = -range.viewCenter.z;
+                float nearDepth = std::max(sliceNear, depth - range.radius);
+                float farDepth = std::min(sliceFar, depth + range.radius);
+                float offset = depth < nearDepth ? nearDepth - depth : (depth > farDepth ? depth - farDepth : 0.0f);
+                float radius = std::sqrt(std::max(range.radius * range.radius - offset * offset, 0.0f));
+
+                glm::ivec2 minTile, maxTile;
+                if (!GetTileRange(range.viewCenter, radius, nearDepth, farDepth, minTile, maxTile)){
+                    continue;
+                }
+
+                for (int y = minTile.y; y <= maxTile.y; y++){
+                    for (int x = minTile.x; x <= maxTile.x; x++){
+                        indices.push_back(y * tilesX + x);
+                        indices.push_back(i);
+                    }
+                }
+            }
+
+            // counting sort of the pairs by the tile
+            std::fill(counts.begin(), counts.end(), 0);
+            for (unsigned int p = 0; p < indices.size(); p += 2){
+                counts[indices[p]]++;
+            }
+
+            uint32_t first = 0;
+            for (unsigned int t = 0; t < tilesPerSlice; t++){
+                unsigned int cluster = slice * tilesPerSlice + t;
+                this->clusterData[2 * cluster] = first;     // relative to the slice, made absolute later
+                this->clusterData[2 * cluster + 1] = counts[t];
+                first += counts[t];
+            }
+
+            std::vector<uint32_t> sorted(indices.size() / 2);
+            for (unsigned int p = 0; p < indices.size(); p += 2){
+                unsigned int cluster = slice * tilesPerSlice + indices[p];
+                uint32_t& next = counts[indices[p]];
+                next--;
+                sorted[this->clusterData[2 * cluster] + next] = indices[p + 1];
+            }
+            indices.swap(sorted);
+        }
+    };
+
+    if (jobSystem != nullptr){
+        jobSystem->ParallelFor(lights.size(), 256, rangeJob);
+        jobSystem->ParallelFor(numberOfSlices, 1, sliceJob);
+    }
+    else{
+        rangeJob(0, lights.size(), 0);
+        sliceJob(0, numberOfSlices, 0);
+    }
+
+    // the slices one after another behind the (first, count) pairs
+    this->statistics = LightClusterStatistics();
+    for (unsigned int slice = 0; slice < numberOfSlices; slice++){
+
+        uint32_t base = this->clusterData.size();
+        for (unsigned int t = 0; t < tilesPerSlice; t++){
+
+            unsigned int cluster = slice * tilesPerSlice + t;
+            this->clusterData[2 * cluster] += base;
+
+            uint32_t count = this->clusterData[2 * cluster + 1];
+            if (count > 0){
+                this->statistics.usedClusters++;
+                this->statistics.maxLights = std::max(this->statistics.maxLights, count);
+            }
+        }
+
+        this->clusterData.insert(this->clusterData.end(), this->sliceIndices[slice].begin(), this->sliceIndices[slice].end());
+    }
+
+    for (unsigned int i = 0; i < lights.size(); i++){
+        this->statistics.lights += lights[i].positionRadius.w > 0.0f;
+        this->statistics.visibleLights += this->ranges[i].firstSlice >= 0;
+    }
+
+    unsigned int binned = this->clusterData.size() - 2 * numberOfClusters;
+    this->statistics.averageLights = this->statistics.usedClusters > 0 ?
+                                     static_cast<double>(binned) / this->statistics.usedClusters : 0.0;
+    this->statistics.buildMiliseconds = (FrameTimer::Now() - start) * 1000.0;
+
+}
+
+
+void LightClusters::Upload(const std::vector<PointLightData>& lights){
+
+    if (this->lightBuffer == nullptr){
+        this->lightBuffer = new RingBuffer(GL_SHADER_STORAGE_BUFFER, 256 * sizeof(PointLightData));
+        this->clusterBuffer = new RingBuffer(GL_SHADER_STORAGE_BUFFER, 64 * 1024);
+    }
+
+    // an empty buffer can not be bound
+    this->lightBytes = std::max<size_t>(lights.size(), 1) * sizeof(PointLightData);
+    void* lightData = this->lightBuffer->BeginFrame(this->lightBytes);
+    std::memcpy(lightData, lights.data(), lights.size() * sizeof(PointLightData));
+    this->lightBuffer->Commit();
+
+    this->clusterBytes = sizeof(LightClusterHeader) + this->clusterData.size() * sizeof(uint32_t);
+    unsigned char* clusters = static_cast<unsigned char*>(this->clusterBuffer->BeginFrame(this->clusterBytes));
+    std::memcpy(clusters, &this->header, sizeof(LightClusterHeader));
+    std::memcpy(clusters + sizeof(LightClusterHeader), this->clusterData.data(), this->clusterData.size() * sizeof(uint32_t));
+    this->clusterBuffer->Commit();
+
+}
+
+
+void LightClusters::Bind() const{
+
+    if (this->lightBuffer == nullptr){
+        return;
+    }
+
+    this->lightBuffer->BindRange(LIGHT_BINDING, this->lightBytes);
+    this->clusterBuffer->BindRange(CLUSTER_BINDING, this->clusterBytes);
+
+}
+
+
+void LightClusters::EndFrame(){
+
+    if (this->lightBuffer == nullptr){
+        return;
+    }
+
+    this->lightBuffer->EndFrame();
+    this->clusterBuffer->EndFrame();
+
+}
+
+
+int LightClusters::GetSlice(float depth) const{
+
+    int slice = static_cast<int>(std::floor(std::log(depth) * this->header.depth.z + this->header.depth.w));
+    return std::min(std::max(slice, 0), static_cast<int>(this->header.grid.z) - 1);
+}
+
+
+bool LightClusters::GetTileRange(const glm::vec3& center, float radius, float nearDepth, float farDepth,
+                                 glm::ivec2& minTile, glm::ivec2& maxTile) const{
+
+    // the sphere part between the depths lies in a box - its corners bound the projection
+    glm::vec2 minNDC = glm::vec2(1e30f);
+    glm::vec2 maxNDC = glm::vec2(-1e30f);
+    float depths[2] = {nearDepth, farDepth};
+
+    for (float depth : depths){
+        for (float side = -1.0f; side <= 1.0f; side += 2.0f){
+            glm::vec2 ndc = glm::vec2(this->projection[0][0], this->projection[1][1]) *
+                            (glm::vec2(center) + side * radius) / depth;
+            minNDC = glm::min(minNDC, ndc);
+            maxNDC = glm::max(maxNDC, ndc);
+        }
+    }
+
+    glm::vec2 screen = glm::vec2(this->screenWidth, this->screenHeight);
+    glm::vec2 minPixel = (minNDC * 0.5f + 0.5f) * screen;
+    glm::vec2 maxPixel = (maxNDC * 0.5f + 0.5f) * screen;
+
+    glm::ivec2 tiles = glm::ivec2(this->header.grid.x, this->header.grid.y);
+    float tile = static_cast<float>(this->header.grid.w);
+
+    minTile = glm::max(glm::ivec2(glm::floor(minPixel / tile)), glm::ivec2(0));
+    maxTile = glm::min(glm::ivec2(glm::floor(maxPixel / tile)), tiles - 1);
+
+    return minTile.x <= maxTile.x && minTile.y <= maxTile.y;
+}
+
+
+unsigned int LightClusters::GetCluster(float depth, float x, float y) const{
+
+    unsigned int slice = GetSlice(std::max(depth, this->header.depth.x));
+    unsigned int tileX = std::min(static_cast<unsigned int>(std::max(x, 0.0f)) / this->header.grid.w, this->header.grid.x - 1);
+    unsigned int tileY = std::min(static_cast<unsigned int>(std::max(y, 0.0f)) / this->header.grid.w, this->header.grid.y - 1);
+
+    return (slice * this->header.grid.y + tileY) * this->header.grid.x + tileX;
+}
+
+
+unsigned int LightClusters::GetNumberOfLights(unsigned int cluster) const{
+    return this->clusterData[2 * cluster + 1];
+}
+
+
+const uint32_t* LightClusters::GetLights(unsigned int cluster) const{
+    return this->clusterData.data() + this->clusterData[2 * cluster];
+}
+
+
+unsigned int LightClusters::GetNumberOfClusters() const{
+    return this->header.grid.x * this->header.grid.y * this->header.grid.z;
+}
+
+
+const LightClusterStatistics& LightClusters::GetStatistics() const{
+    return this->statistics;
+}
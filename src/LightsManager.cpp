@@ -24,21 +24,68 @@ void LightsManager::RenderAllLights(){
 void LightsManager::AddLight(Light *light){
 
     lights.push_back(light);
+    startPositions.push_back(light->position);
 }
 
 
+void LightsManager::Animate(float deltaTime){
 
-void LightsManager::UploadLightsToPipeline(Shader* shaderProgram){
-
-    unsigned int lightIndex = 0;
-
-    for (auto &light : lights){   // upload all lights to the pipeline
+    for (auto &light : lights){
         
         if ( instanceof<PointLight>(light) ){
-            ((PointLight *)light)->Upload_PointLight_Pipeline(shaderProgram, lightIndex); 
+            ((PointLight *)light)->Animate(deltaTime);
         }
+    }
+
+}
+
+
+void LightsManager::ResetAnimation(){
+
+    for (unsigned int i = 0; i < this->lights.size(); i++){
+        this->lights[i]->position = this->startPositions[i];
+    }
+
+}
+
 
-        lightIndex++;
+void LightsManager::Update(const FrameContext& context, int screenWidth, int screenHeight, JobSystem* jobSystem){
+
+    this->lightData.resize(this->lights.size());
+
+    for (unsigned int i = 0; i < this->lights.size(); i++){   // pack all lights
+        
+        const Light* light = this->lights[i];
+        this->lightData[i].positionRadius = glm::vec4(light->position, light->radius);
+        this->lightData[i].color = glm::vec4(light->color, light->intensity);
     }
 
+    this->clusters.Build(this->lightData, context, screenWidth, screenHeight, jobSystem);
+    this->clusters.Upload(this->lightData);
+
+}
+
+
+void LightsManager::BindLights() const{
+    this->clusters.Bind();
+}
+
+
+void LightsManager::EndFrame(){
+    this->clusters.EndFrame();
+}
+
+
+unsigned int LightsManager::GetNumberOfLights() const{
+    return this->lights.size();
+}
+
+
+const LightClusterStatistics& LightsManager::GetStatistics() const{
+    return this->clusters.GetStatistics();
+}
+
+
+LightClusters& LightsManager::GetClusters(){
+    return this->clusters;
 }
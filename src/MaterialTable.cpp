@@ -0,0 +1,123 @@
+#include "MaterialTable.hpp"
+#include "GLExtensions.hpp"
+#include "Scene.hpp"
+
+
+MaterialTable::MaterialTable(){
+
+    glGenBuffers(1, &this->bufferID);
+
+}
+
+
+MaterialTable::~MaterialTable(){
+
+    glDeleteBuffers(1, &this->bufferID);
+
+}
+
+
+uint32_t MaterialTable::Add(Texture* diffuse, Texture* normal, Texture* height){
+
+    for (unsigned int i = 0; i < this->materials.size(); i++){
+        const Material& material = this->materials[i];
+        if (material.textures[0] == diffuse && material.textures[1] == normal && material.textures[2] == height){
+            return i;
+        }
+    }
+
+    Material material;
+    material.textures[0] = diffuse;
+    material.textures[1] = normal;
+    material.textures[2] = height;
+    this->materials.push_back(material);
+
+    return this->materials.size() - 1;
+}
+
+
+uint32_t MaterialTable::Add(MaterialArray* array){
+
+    TextureArray* height = array->packed ? nullptr : &array->height;
+
+    for (unsigned int i = 0; i < this->materials.size(); i++){
+        const Material& material = this->materials[i];
+        if (material.arrays[0] == &array->diffuse && material.arrays[1] == &array->normal &&
+            material.arrays[2] == height){
+            return i;
+        }
+    }
+
+    Material material;
+    material.arrays[0] = &array->diffuse;
+    material.arrays[1] = &array->normal;
+    material.arrays[2] = height;
+    this->materials.push_back(material);
+
+    return this->materials.size() - 1;
+}
+
+
+void MaterialTable::Update(){
+
+    // textures replaced in earlier frames whose draws finished
+    Texture::ReleaseDeletedTextures();
+
+    bool changed = this->handles.size() != this->materials.size();
+    this->handles.resize(this->materials.size());
+
+    for (unsigned int i = 0; i < this->materials.size(); i++){
+
+        Material& material = this->materials[i];
+        GLuint64 current[3] = {0, 0, 0};
+        for (unsigned int j = 0; j < 3; j++){
+            if (material.textures[j] != nullptr){
+                current[j] = material.textures[j]->GetHandle();
+            }
+            else if (material.arrays[j] != nullptr){
+                current[j] = material.arrays[j]->GetHandle();
+            }
+        }
+
+        MaterialTextures& textures = this->handles[i];
+        changed = changed || textures.diffuse != current[0] || textures.normal != current[1] ||
+                  textures.height != current[2];
+        textures.diffuse = current[0];
+        textures.normal = current[1];
+        textures.height = current[2];
+    }
+
+    if (!changed || this->handles.empty()){
+        return;
+    }
+
+    // the draws of the earlier frames keep reading the old contents (the driver orphans or copies the data)
+    size_t size = this->handles.size() * sizeof(MaterialTextures);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->bufferID);
+    if (size > this->bufferSize){
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, this->handles.data(), GL_DYNAMIC_DRAW);
+        this->bufferSize = size;
+    }
+    else{
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, this->handles.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+}
+
+
+void MaterialTable::Bind() const{
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, materialBinding, this->bufferID);
+
+}
+
+
+unsigned int MaterialTable::GetNumberOfMaterials() const{
+    return this->materials.size();
+}
+
+
+bool MaterialTable::IsSupported(){
+    return gScene.BindlessTextures && gGLCapabilities.bindlessTexture;
+}
@@ -0,0 +1,258 @@
+#include "MeshBuffer.hpp"
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+MeshBuffer::MeshBuffer(){ }
+
+
+MeshBuffer::~MeshBuffer(){
+
+    if (this->VertexArrayObject != 0){
+        glDeleteVertexArrays(1, &this->VertexArrayObject);
+        glDeleteBuffers(1, &this->VertexBufferObject);
+        glDeleteBuffers(1, &this->ElementBufferObject);
+        glDeleteBuffers(1, &this->DrawIDBufferObject);
+    }
+
+}
+
+
+void MeshBuffer::SetPacked(bool packed){
+
+    if (GetNumberOfVertices() > 0){
+        std::cout << "The vertex format can not change after the meshes are added" << std::endl;
+        return;
+    }
+
+    this->packed = packed;
+}
+
+
+bool MeshBuffer::IsPacked() const{
+    return this->packed;
+}
+
+
+std::string MeshBuffer::GetShaderDefines() const{
+    return this->packed ? "#define PACKED_VERTICES\n" : "";
+}
+
+
+MeshRange MeshBuffer::AddMesh(const std::vector<GLfloat>& data, const std::vector<GLuint>& indices){
+
+    MeshRange range;
+    range.indexCount = indices.size();
+    range.baseVertex = GetNumberOfVertices();
+
+    // 16 bit indices whenever the vertices of the mesh allow it
+    unsigned int numberOfVertices = data.size() / stride;
+    range.indexType = numberOfVertices <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    range.firstIndex = AppendIndices(indices, range.indexType);
+    if (range.indexType == GL_UNSIGNED_SHORT){
+        this->numberOfShortMeshes++;
+    }
+
+    this->numberOfMeshes++;
+
+    if (this->packed){
+        std::vector<PackedVertex> packedData;
+        range.quantization = ObjectParser::Pack_Vertices(data, packedData);
+        this->packedVertices.insert(this->packedVertices.end(), packedData.begin(), packedData.end());
+    }
+    else{
+        this->vertices.insert(this->vertices.end(), data.begin(), data.end());
+    }
+    this->dirty = true;
+
+    return range;
+}
+
+
+MeshRange MeshBuffer::AddIndices(const MeshRange& mesh, const std::vector<GLuint>& indices){
+
+    MeshRange range = mesh;
+    range.indexCount = indices.size();
+    range.firstIndex = AppendIndices(indices, mesh.indexType);
+    this->dirty = true;
+
+    return range;
+}
+
+
+GLuint MeshBuffer::AppendIndices(const std::vector<GLuint>& indices, GLenum indexType){
+
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+    // the offset has to be a multiple of the index size
+    this->indexData.resize((this->indexData.size() + 3) & ~static_cast<size_t>(3), 0);
+    GLuint firstIndex = this->indexData.size() / indexSize;
+
+    size_t offset = this->indexData.size();
+    this->indexData.resize(offset + indices.size() * indexSize);
+
+    if (indexType == GL_UNSIGNED_SHORT){
+        GLushort* destination = reinterpret_cast<GLushort*>(&this->indexData[offset]);
+        for (unsigned int i = 0; i < indices.size(); i++){
+            destination[i] = static_cast<GLushort>(indices[i]);
+        }
+    }
+    else if (!indices.empty()){
+        std::memcpy(&this->indexData[offset], indices.data(), indices.size() * sizeof(GLuint));
+    }
+
+    this->numberOfIndices += indices.size();
+
+    return firstIndex;
+}
+
+
+void MeshBuffer::Upload(){
+
+    if (this->VertexArrayObject == 0){
+
+        glGenVertexArrays(1, &this->VertexArrayObject);
+        glGenBuffers(1, &this->VertexBufferObject);
+        glGenBuffers(1, &this->ElementBufferObject);
+        glGenBuffers(1, &this->DrawIDBufferObject);
+
+        // connect attributes to VAO and VBO
+        glBindVertexArray(this->VertexArrayObject);
+        glBindBuffer(GL_ARRAY_BUFFER, this->VertexBufferObject);
+
+        if (this->packed){
+
+            GLsizei packedStride = sizeof(PackedVertex);
+
+            glEnableVertexAttribArray(0);   // quantized position + bitangent sign
+            glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, packedStride, (void *) offsetof(PackedVertex, position));
+
+            glEnableVertexAttribArray(1);   // octahedral normal
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, packedStride, (void *) offsetof(PackedVertex, normal));
+
+            glEnableVertexAttribArray(2);   // half float texture coords
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, packedStride, (void *) offsetof(PackedVertex, texCoords));
+
+            glEnableVertexAttribArray(3);   // octahedral tangent
+            glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, packedStride, (void *) offsetof(PackedVertex, tangent));
+
+            // the bitangent is computed in the shader
+        }
+        else{
+
+            glEnableVertexAttribArray(0);   // vertex attrib
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride*sizeof(GLfloat), (void *)0);
+
+            glEnableVertexAttribArray(1);   // normals attrib
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride*sizeof(GLfloat), (void *) (3*sizeof(GLfloat)));
+
+            glEnableVertexAttribArray(2);   // texture attrib
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride*sizeof(GLfloat), (void *) (6*sizeof(GLfloat)));
+
+            glEnableVertexAttribArray(3);   // tanget attrib
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride*sizeof(GLfloat), (void *) (8*sizeof(GLfloat)));
+
+            glEnableVertexAttribArray(4);   // bitanget attrib
+            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride*sizeof(GLfloat), (void *) (11*sizeof(GLfloat)));
+        }
+
+        // draw ID - one value per instance, offset by baseInstance
+        glBindBuffer(GL_ARRAY_BUFFER, this->DrawIDBufferObject);
+        glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_INT, sizeof(GLint), (void *)0);
+        glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ElementBufferObject);
+
+        glBindVertexArray(0);   // unbind for clean code
+    }
+
+    // load data (vertices, normals and textures) to GPU
+    glBindBuffer(GL_ARRAY_BUFFER, this->VertexBufferObject);
+    if (this->packed){
+        glBufferData(GL_ARRAY_BUFFER, GetVertexBytes(), this->packedVertices.data(), GL_STATIC_DRAW);
+    }
+    else{
+        glBufferData(GL_ARRAY_BUFFER, GetVertexBytes(), this->vertices.data(), GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // load indices to GPU (the element buffer is part of the VAO state)
+    glBindVertexArray(this->VertexArrayObject);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indexData.size(), this->indexData.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    this->dirty = false;
+
+}
+
+
+void MeshBuffer::Bind(bool instancedDrawID, unsigned int numberOfDraws){
+
+    if (this->dirty || this->VertexArrayObject == 0){
+        Upload();
+    }
+
+    // identity buffer large enough for every draw of the frame
+    if (instancedDrawID && numberOfDraws > this->drawIDCapacity){
+
+        this->drawIDCapacity = std::max(numberOfDraws, this->drawIDCapacity * 2);
+
+        std::vector<GLint> identity(this->drawIDCapacity);
+        for (unsigned int i = 0; i < this->drawIDCapacity; i++){
+            identity[i] = i;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, this->DrawIDBufferObject);
+        glBufferData(GL_ARRAY_BUFFER, identity.size() * sizeof(GLint), identity.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    glBindVertexArray(this->VertexArrayObject);
+
+    // disabled array = constant attribute set with glVertexAttribI1i
+    if (instancedDrawID){
+        glEnableVertexAttribArray(DRAW_ID_LOCATION);
+    }
+    else{
+        glDisableVertexAttribArray(DRAW_ID_LOCATION);
+    }
+
+}
+
+
+void MeshBuffer::Unbind(){
+    glBindVertexArray(0);
+}
+
+
+unsigned int MeshBuffer::GetNumberOfVertices() const{
+    return this->packed ? this->packedVertices.size() : this->vertices.size() / stride;
+}
+
+
+size_t MeshBuffer::GetVertexBytes() const{
+    return this->packed ? this->packedVertices.size() * sizeof(PackedVertex) : this->vertices.size() * sizeof(GLfloat);
+}
+
+
+unsigned int MeshBuffer::GetNumberOfIndices() const{
+    return this->numberOfIndices;
+}
+
+
+size_t MeshBuffer::GetIndexBytes() const{
+    return this->indexData.size();
+}
+
+
+unsigned int MeshBuffer::GetNumberOfShortIndexMeshes() const{
+    return this->numberOfShortMeshes;
+}
+
+
+unsigned int MeshBuffer::GetNumberOfMeshes() const{
+    return this->numberOfMeshes;
+}
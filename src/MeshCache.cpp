@@ -0,0 +1,137 @@
+#include "MeshCache.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <cstdint>
+
+// identifies the source file the cache was built from
+struct MeshCacheHeader{
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t numberOfFloats;
+    uint64_t numberOfIndices;
+    uint64_t materialPathLength;
+    uint64_t numberOfLods;
+};
+
+// followed by the indices of the level
+struct MeshCacheLod{
+    uint64_t numberOfIndices;
+    float error;
+    uint32_t padding;
+};
+
+
+// size and modification time of the source file, false if it does not exist
+static bool GetSourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& time){
+
+    std::error_code error;
+
+    size = std::filesystem::file_size(sourcePath, error);
+    if (error){
+        return false;
+    }
+
+    time = std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+    return !error;
+}
+
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath){
+    return sourcePath + ".meshcache";
+}
+
+
+bool MeshCache::Load(const std::string& sourcePath, std::vector<GLfloat>& data,
+                     std::vector<GLuint>& indices, std::string& materialPath, std::vector<MeshLod>& lods){
+
+    std::ifstream file(GetCachePath(sourcePath), std::ios::binary);
+    if (!file.is_open()){
+        return false;
+    }
+
+    MeshCacheHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    uint64_t size;
+    int64_t time;
+    if (!file || std::string(header.magic, 4) != "MSHC" || header.version != version ||
+        !GetSourceStamp(sourcePath, size, time) || header.sourceSize != size || header.sourceTime != time){
+        return false;   // stale - parsed again
+    }
+
+    data.resize(header.numberOfFloats);
+    indices.resize(header.numberOfIndices);
+    materialPath.resize(header.materialPathLength);
+
+    file.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(GLfloat));
+    file.read(reinterpret_cast<char*>(indices.data()), indices.size() * sizeof(GLuint));
+    file.read(&materialPath[0], materialPath.size());
+
+    lods.clear();
+    for (uint64_t i = 0; i < header.numberOfLods && file; i++){
+
+        MeshCacheLod lodHeader;
+        file.read(reinterpret_cast<char*>(&lodHeader), sizeof(lodHeader));
+        if (!file){
+            break;
+        }
+
+        MeshLod lod;
+        lod.error = lodHeader.error;
+        lod.indices.resize(lodHeader.numberOfIndices);
+        file.read(reinterpret_cast<char*>(lod.indices.data()), lod.indices.size() * sizeof(GLuint));
+        lods.push_back(std::move(lod));
+    }
+
+    if (!file){
+        std::cout << "Mesh cache " << GetCachePath(sourcePath) << " is corrupted" << std::endl;
+        data.clear();
+        indices.clear();
+        materialPath = "";
+        lods.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool MeshCache::Save(const std::string& sourcePath, const std::vector<GLfloat>& data,
+                     const std::vector<GLuint>& indices, const std::string& materialPath,
+                     const std::vector<MeshLod>& lods){
+
+    MeshCacheHeader header;
+    header.magic[0] = 'M'; header.magic[1] = 'S'; header.magic[2] = 'H'; header.magic[3] = 'C';
+    header.version = version;
+    header.numberOfFloats = data.size();
+    header.numberOfIndices = indices.size();
+    header.materialPathLength = materialPath.size();
+    header.numberOfLods = lods.size();
+
+    if (!GetSourceStamp(sourcePath, header.sourceSize, header.sourceTime)){
+        return false;
+    }
+
+    std::ofstream file(GetCachePath(sourcePath), std::ios::binary);
+    if (!file.is_open()){
+        std::cout << "Could not write the mesh cache " << GetCachePath(sourcePath) << std::endl;
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(GLfloat));
+    file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(GLuint));
+    file.write(materialPath.data(), materialPath.size());
+
+    for (const MeshLod& lod : lods){
+        MeshCacheLod lodHeader = {lod.indices.size(), lod.error, 0};
+        file.write(reinterpret_cast<const char*>(&lodHeader), sizeof(lodHeader));
+        file.write(reinterpret_cast<const char*>(lod.indices.data()), lod.indices.size() * sizeof(GLuint));
+    }
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,402 @@
+#include "MeshOptimizer.hpp"
+
+// glm lib
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// scoring of Tom Forsyth
+static const int kMaxCacheSize = 32;
+static const float kCacheDecayPower = 1.5f;
+static const float kLastTriangleScore = 0.75f;
+static const float kValenceBoostScale = 2.0f;
+static const float kValenceBoostPower = 0.5f;
+
+// size of the simulated cache used to split the clusters
+static const unsigned int kClusterCacheSize = 16;
+
+
+// score of a vertex - high when it is recent in the cache and has few triangles left
+static float VertexScore(int cachePosition, unsigned int remainingTriangles){
+
+    if (remainingTriangles == 0){   // no triangle uses it anymore
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+
+    if (cachePosition >= 0){
+        if (cachePosition < 3){     // used by the last triangle - fixed score so it is not used right away again
+            score = kLastTriangleScore;
+        }
+        else{
+            float scaler = 1.0f / (kMaxCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+        }
+    }
+
+    // prefer vertices with few remaining triangles - gets rid of lone triangles
+    score += kValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -kValenceBoostPower);
+
+    return score;
+}
+
+
+// FIFO post-transform cache with timestamps - a vertex is in the cache when it was added less than size misses ago
+class CacheSimulator{
+
+public:
+
+    CacheSimulator(unsigned int numberOfVertices, unsigned int cacheSize)
+        : timestamps(numberOfVertices, 0), size(cacheSize), time(cacheSize + 1) { }
+
+    // number of misses of the triangle
+    unsigned int Process(const GLuint* triangle){
+
+        unsigned int misses = 0;
+
+        for (int i = 0; i < 3; i++){
+            if (this->time - this->timestamps[triangle[i]] > this->size){
+                this->timestamps[triangle[i]] = this->time++;
+                misses++;
+            }
+        }
+
+        return misses;
+    }
+
+    // empty the cache
+    void Reset(){
+        this->time += this->size + 1;
+    }
+
+private:
+
+    std::vector<unsigned int> timestamps;
+    unsigned int size;
+    unsigned int time;
+
+};
+
+
+void MeshOptimizer::Optimize(std::vector<GLfloat>& data, std::vector<GLuint>& indices,
+                             VertexCacheStatistics* before, VertexCacheStatistics* after){
+
+    unsigned int numberOfVertices = data.size() / stride;
+
+    if (before != nullptr){
+        *before = AnalyzeVertexCache(indices, numberOfVertices);
+    }
+
+    OptimizeVertexCache(indices, numberOfVertices);
+    OptimizeOverdraw(indices, data, stride);
+    OptimizeVertexFetch(data, indices, stride);
+
+    if (after != nullptr){
+        *after = AnalyzeVertexCache(indices, data.size() / stride);
+    }
+
+}
+
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<GLuint>& indices, unsigned int numberOfVertices){
+
+    unsigned int numberOfTriangles = indices.size() / 3;
+
+    if (numberOfTriangles == 0){
+        return;
+    }
+
+    // triangles of every vertex - the live ones are kept at the start of the list
+    std::vector<unsigned int> remaining(numberOfVertices, 0);
+    for (GLuint index : indices){
+        remaining[index]++;
+    }
+
+    std::vector<unsigned int> offsets(numberOfVertices + 1, 0);
+    for (unsigned int v = 0; v < numberOfVertices; v++){
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> filled(numberOfVertices, 0);
+    for (unsigned int t = 0; t < numberOfTriangles; t++){
+        for (int i = 0; i < 3; i++){
+            GLuint v = indices[t*3 + i];
+            adjacency[offsets[v] + filled[v]++] = t;
+        }
+    }
+
+    std::vector<int> cachePosition(numberOfVertices, -1);
+    std::vector<float> vertexScore(numberOfVertices);
+    for (unsigned int v = 0; v < numberOfVertices; v++){
+        vertexScore[v] = VertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(numberOfTriangles);
+    for (unsigned int t = 0; t < numberOfTriangles; t++){
+        triangleScore[t] = vertexScore[indices[t*3]] + vertexScore[indices[t*3 + 1]] + vertexScore[indices[t*3 + 2]];
+    }
+
+    std::vector<bool> emitted(numberOfTriangles, false);
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+
+    std::vector<GLuint> cache;
+    std::vector<GLuint> newCache;
+    cache.reserve(kMaxCacheSize + 3);
+    newCache.reserve(kMaxCacheSize + 3);
+
+    int bestTriangle = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+    unsigned int scanCursor = 0;
+
+    for (unsigned int emittedTriangles = 0; emittedTriangles < numberOfTriangles; emittedTriangles++){
+
+        // nothing useful in the cache - take the next triangle in the input order
+        if (bestTriangle < 0){
+            while (emitted[scanCursor]){
+                scanCursor++;
+            }
+            bestTriangle = scanCursor;
+        }
+
+        const GLuint* triangle = &indices[bestTriangle * 3];
+        emitted[bestTriangle] = true;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // remove the triangle from the live lists of its vertices
+        for (int i = 0; i < 3; i++){
+
+            GLuint v = triangle[i];
+            unsigned int* list = &adjacency[offsets[v]];
+
+            for (unsigned int j = 0; j < remaining[v]; j++){
+                if (list[j] == static_cast<unsigned int>(bestTriangle)){
+                    std::swap(list[j], list[remaining[v] - 1]);
+                    break;
+                }
+            }
+
+            remaining[v]--;
+        }
+
+        // the vertices of the triangle move to the front of the cache (LRU)
+        newCache.assign(triangle, triangle + 3);
+        for (GLuint v : cache){
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]){
+                newCache.push_back(v);
+            }
+        }
+
+        // new positions and scores, vertices past the end fall out
+        for (unsigned int i = 0; i < newCache.size(); i++){
+            GLuint v = newCache[i];
+            cachePosition[v] = i < static_cast<unsigned int>(kMaxCacheSize) ? i : -1;
+            vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // rescore the triangles around the cache and pick the best one
+        bestTriangle = -1;
+        float bestScore = 0.0f;
+
+        for (GLuint v : newCache){
+            for (unsigned int j = 0; j < remaining[v]; j++){
+
+                unsigned int t = adjacency[offsets[v] + j];
+                triangleScore[t] = vertexScore[indices[t*3]] + vertexScore[indices[t*3 + 1]] + vertexScore[indices[t*3 + 2]];
+
+                if (triangleScore[t] > bestScore){
+                    bestScore = triangleScore[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if (newCache.size() > static_cast<unsigned int>(kMaxCacheSize)){
+            newCache.resize(kMaxCacheSize);
+        }
+        std::swap(cache, newCache);
+    }
+
+    indices.swap(result);
+
+}
+
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<GLfloat>& data,
+                                     unsigned int stride, float threshold){
+
+    unsigned int numberOfTriangles = indices.size() / 3;
+    unsigned int numberOfVertices = data.size() / stride;
+
+    if (numberOfTriangles == 0){
+        return;
+    }
+
+    CacheSimulator cache(numberOfVertices, kClusterCacheSize);
+
+    // hard boundaries - triangles that miss the cache with all vertices start a new cluster
+    std::vector<unsigned int> hardClusters;
+    for (unsigned int t = 0; t < numberOfTriangles; t++){
+        if (cache.Process(&indices[t*3]) == 3){
+            hardClusters.push_back(t);
+        }
+    }
+    hardClusters.push_back(numberOfTriangles);
+
+    // soft boundaries - split a cluster wherever its ACMR is within the threshold
+    std::vector<unsigned int> clusters;
+    for (unsigned int c = 0; c + 1 < hardClusters.size(); c++){
+
+        unsigned int start = hardClusters[c];
+        unsigned int end = hardClusters[c + 1];
+
+        cache.Reset();
+        unsigned int misses = 0;
+        for (unsigned int t = start; t < end; t++){
+            misses += cache.Process(&indices[t*3]);
+        }
+        float clusterACMR = static_cast<float>(misses) / (end - start);
+
+        cache.Reset();
+        clusters.push_back(start);
+        unsigned int clusterStart = start;
+        misses = 0;
+
+        for (unsigned int t = start; t < end; t++){
+
+            misses += cache.Process(&indices[t*3]);
+            float acmr = static_cast<float>(misses) / (t - clusterStart + 1);
+
+            if (t + 1 < end && acmr <= clusterACMR * threshold){
+                clusters.push_back(t + 1);
+                clusterStart = t + 1;
+                misses = 0;
+                cache.Reset();
+            }
+        }
+    }
+    clusters.push_back(numberOfTriangles);
+
+    // centroid of the mesh
+    glm::vec3 meshCentroid(0.0f);
+    for (unsigned int v = 0; v < numberOfVertices; v++){
+        meshCentroid += glm::vec3(data[v*stride], data[v*stride + 1], data[v*stride + 2]);
+    }
+    meshCentroid /= static_cast<float>(std::max(numberOfVertices, 1u));
+
+    // clusters facing away from the center are drawn first - they occlude the inner ones
+    unsigned int numberOfClusters = clusters.size() - 1;
+    std::vector<float> sortKeys(numberOfClusters);
+    std::vector<unsigned int> order(numberOfClusters);
+
+    for (unsigned int c = 0; c < numberOfClusters; c++){
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+
+        for (unsigned int t = clusters[c]; t < clusters[c + 1]; t++){
+
+            const GLfloat* a = &data[indices[t*3] * stride];
+            const GLfloat* b = &data[indices[t*3 + 1] * stride];
+            const GLfloat* d = &data[indices[t*3 + 2] * stride];
+
+            glm::vec3 p0(a[0], a[1], a[2]);
+            glm::vec3 p1(b[0], b[1], b[2]);
+            glm::vec3 p2(d[0], d[1], d[2]);
+
+            // length of the cross product = 2 x area
+            glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(triangleNormal);
+
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+
+        if (area > 0.0f){
+            centroid /= area;
+        }
+
+        float normalLength = glm::length(normal);
+        if (normalLength > 0.0f){
+            normal /= normalLength;
+        }
+
+        sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+        order[c] = c;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b){
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    for (unsigned int c : order){
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    }
+
+    indices.swap(result);
+
+}
+
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<GLfloat>& data, std::vector<GLuint>& indices, unsigned int stride){
+
+    unsigned int numberOfVertices = data.size() / stride;
+
+    const GLuint unused = ~0u;
+    std::vector<GLuint> remap(numberOfVertices, unused);
+    std::vector<GLfloat> result;
+    result.reserve(data.size());
+
+    // vertices in the order the GPU reads them
+    for (GLuint& index : indices){
+
+        if (remap[index] == unused){
+            remap[index] = result.size() / stride;
+            result.insert(result.end(), data.begin() + index * stride, data.begin() + (index + 1) * stride);
+        }
+
+        index = remap[index];
+    }
+
+    data.swap(result);
+
+}
+
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<GLuint>& indices, unsigned int numberOfVertices,
+                                                        unsigned int cacheSize){
+
+    VertexCacheStatistics statistics;
+    unsigned int numberOfTriangles = indices.size() / 3;
+
+    if (numberOfTriangles == 0){
+        return statistics;
+    }
+
+    CacheSimulator cache(numberOfVertices, cacheSize);
+    unsigned int misses = 0;
+    for (unsigned int t = 0; t < numberOfTriangles; t++){
+        misses += cache.Process(&indices[t*3]);
+    }
+
+    // only the vertices used by the triangles
+    std::vector<bool> used(numberOfVertices, false);
+    unsigned int numberOfUsed = 0;
+    for (GLuint index : indices){
+        if (!used[index]){
+            used[index] = true;
+            numberOfUsed++;
+        }
+    }
+
+    statistics.acmr = static_cast<float>(misses) / numberOfTriangles;
+    statistics.atvr = static_cast<float>(misses) / numberOfUsed;
+
+    return statistics;
+}
@@ -0,0 +1,466 @@
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+
+// glm lib
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+// quadrics of the open (border and seam) edges are weighted more than the surface
+static const double kBorderWeight = 10.0;
+
+// a collapse may not turn a triangle more than this (cosine)
+static const float kMinimalNormalDot = 0.2f;
+
+
+// symmetric 4x4 matrix of the plane equations, weight = sum of the plane weights
+struct Quadric{
+
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+    double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+    double a22 = 0.0, a23 = 0.0;
+    double a33 = 0.0;
+    double weight = 0.0;
+
+    // plane dot(normal, p) + d = 0
+    void AddPlane(const glm::dvec3& normal, double d, double planeWeight){
+        a00 += planeWeight * normal.x * normal.x; a01 += planeWeight * normal.x * normal.y;
+        a02 += planeWeight * normal.x * normal.z; a03 += planeWeight * normal.x * d;
+        a11 += planeWeight * normal.y * normal.y; a12 += planeWeight * normal.y * normal.z;
+        a13 += planeWeight * normal.y * d;
+        a22 += planeWeight * normal.z * normal.z; a23 += planeWeight * normal.z * d;
+        a33 += planeWeight * d * d;
+        weight += planeWeight;
+    }
+
+    void Add(const Quadric& other){
+        a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+        a11 += other.a11; a12 += other.a12; a13 += other.a13;
+        a22 += other.a22; a23 += other.a23;
+        a33 += other.a33;
+        weight += other.weight;
+    }
+
+    // weighted sum of the squared distances to the planes
+    double Evaluate(const glm::dvec3& p) const{
+        return a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x +
+               a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y +
+               a22 * p.z * p.z + 2.0 * a23 * p.z +
+               a33;
+    }
+};
+
+
+// edge collapse of the position from into the position to
+struct Collapse{
+    GLuint from;
+    GLuint to;
+    double cost;
+};
+
+
+float MeshSimplifier::Simplify(const std::vector<GLfloat>& data, const std::vector<GLuint>& indices,
+                               unsigned int targetIndexCount, std::vector<GLuint>& result){
+
+    unsigned int numberOfVertices = data.size() / stride;
+    unsigned int numberOfTriangles = indices.size() / 3;
+
+    // vertices at the same position share the topology
+    std::vector<GLuint> welded(numberOfVertices);
+    std::vector<glm::dvec3> positions;
+    std::map<std::tuple<float, float, float>, GLuint> positionIDs;
+    for (unsigned int v = 0; v < numberOfVertices; v++){
+        std::tuple<float, float, float> key(data[v * stride], data[v * stride + 1], data[v * stride + 2]);
+        auto inserted = positionIDs.emplace(key, positions.size());
+        if (inserted.second){
+            positions.push_back(glm::dvec3(data[v * stride], data[v * stride + 1], data[v * stride + 2]));
+        }
+        welded[v] = inserted.first->second;
+    }
+    unsigned int numberOfPositions = positions.size();
+
+    std::vector<GLuint> triangles(indices);
+    std::vector<bool> alive(numberOfTriangles, true);
+    unsigned int liveTriangles = numberOfTriangles;
+
+    auto triangleNormal = [&](const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c){
+        return glm::cross(b - a, c - a);
+    };
+
+    // live triangles around every position
+    std::vector<unsigned int> adjacencyOffsets(numberOfPositions + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> fill;
+    auto buildAdjacency = [&](){
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (unsigned int t = 0; t < numberOfTriangles; t++){
+            if (alive[t]){
+                for (int j = 0; j < 3; j++){
+                    adjacencyOffsets[welded[triangles[t * 3 + j]] + 1]++;
+                }
+            }
+        }
+        for (unsigned int p = 0; p < numberOfPositions; p++){
+            adjacencyOffsets[p + 1] += adjacencyOffsets[p];
+        }
+        adjacency.resize(adjacencyOffsets[numberOfPositions]);
+        fill.assign(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (unsigned int t = 0; t < numberOfTriangles; t++){
+            if (alive[t]){
+                for (int j = 0; j < 3; j++){
+                    adjacency[fill[welded[triangles[t * 3 + j]]]++] = t;
+                }
+            }
+        }
+    };
+
+    // the directed edge a -> b without its reverse is a border or a seam
+    auto isOpenEdge = [&](GLuint a, GLuint b){
+        GLuint position = welded[a];
+        for (unsigned int i = adjacencyOffsets[position]; i < adjacencyOffsets[position + 1]; i++){
+            const GLuint* triangle = &triangles[adjacency[i] * 3];
+            for (int j = 0; j < 3; j++){
+                if (triangle[j] == b && triangle[(j + 1) % 3] == a){
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    // surface and border quadrics of the positions
+    std::vector<Quadric> quadrics(numberOfPositions);
+    buildAdjacency();
+
+    for (unsigned int t = 0; t < numberOfTriangles; t++){
+
+        glm::dvec3 p[3];
+        for (int j = 0; j < 3; j++){
+            p[j] = positions[welded[triangles[t * 3 + j]]];
+        }
+
+        glm::dvec3 normal = triangleNormal(p[0], p[1], p[2]);
+        double area = glm::length(normal);
+        if (area == 0.0){
+            continue;
+        }
+        normal /= area;
+
+        for (int j = 0; j < 3; j++){
+            quadrics[welded[triangles[t * 3 + j]]].AddPlane(normal, -glm::dot(normal, p[0]), area);
+        }
+
+        // planes through the open edges perpendicular to the triangle
+        for (int j = 0; j < 3; j++){
+
+            GLuint a = triangles[t * 3 + j];
+            GLuint b = triangles[t * 3 + (j + 1) % 3];
+            if (!isOpenEdge(a, b)){
+                continue;
+            }
+
+            glm::dvec3 edge = positions[welded[b]] - positions[welded[a]];
+            double length = glm::length(edge);
+            if (length == 0.0){
+                continue;
+            }
+
+            glm::dvec3 edgeNormal = glm::normalize(glm::cross(edge / length, normal));
+            double d = -glm::dot(edgeNormal, positions[welded[a]]);
+            quadrics[welded[a]].AddPlane(edgeNormal, d, length * length * kBorderWeight);
+            quadrics[welded[b]].AddPlane(edgeNormal, d, length * length * kBorderWeight);
+        }
+    }
+
+    double maximalCost = 0.0;
+    double maximalWeight = 0.0;
+
+    std::vector<std::vector<GLuint>> openNeighbours(numberOfPositions);
+    std::vector<unsigned int> lockedPass(numberOfPositions, 0);
+    std::vector<Collapse> collapses;
+    std::vector<GLuint> neighbours;
+    unsigned int pass = 0;
+
+    while (liveTriangles * 3 > targetIndexCount){
+
+        pass++;
+        if (pass > 1){
+            buildAdjacency();
+        }
+
+        collapses.clear();
+        for (GLuint p = 0; p < numberOfPositions; p++){
+
+            // positions connected by open edges (more than two = seam junction or corner)
+            openNeighbours[p].clear();
+            neighbours.clear();
+
+            for (unsigned int i = adjacencyOffsets[p]; i < adjacencyOffsets[p + 1]; i++){
+                const GLuint* triangle = &triangles[adjacency[i] * 3];
+                for (int j = 0; j < 3; j++){
+
+                    GLuint a = triangle[j], b = triangle[(j + 1) % 3];
+                    if (welded[a] != p && welded[b] != p){
+                        continue;
+                    }
+
+                    GLuint other = welded[a] == p ? welded[b] : welded[a];
+                    neighbours.push_back(other);
+
+                    if (isOpenEdge(a, b) && std::find(openNeighbours[p].begin(), openNeighbours[p].end(), other) == openNeighbours[p].end()){
+                        openNeighbours[p].push_back(other);
+                    }
+                }
+            }
+
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+            // every edge once, both directions - a border may allow only one of them
+            for (GLuint q : neighbours){
+                if (q > p){
+                    Quadric combined = quadrics[p];
+                    combined.Add(quadrics[q]);
+                    collapses.push_back({p, q, std::max(combined.Evaluate(positions[q]), 0.0)});
+                    collapses.push_back({q, p, std::max(combined.Evaluate(positions[p]), 0.0)});
+                }
+            }
+        }
+
+        if (collapses.empty()){
+            break;
+        }
+
+        // every collapse removes about two triangles
+        unsigned int wanted = (liveTriangles - targetIndexCount / 3) / 2 + 1;
+
+        // only the cheapest part is sorted - most of the others are locked by the neighbourhoods anyway
+        auto cheaper = [](const Collapse& a, const Collapse& b){ return a.cost < b.cost; };
+        size_t considered = std::min<size_t>(collapses.size(), static_cast<size_t>(wanted) * 8);
+        std::nth_element(collapses.begin(), collapses.begin() + (considered - 1), collapses.end(), cheaper);
+        collapses.resize(considered);
+        std::sort(collapses.begin(), collapses.end(), cheaper);
+        unsigned int applied = 0;
+
+        std::vector<std::pair<GLuint, GLuint>> remap;   // vertex of from -> vertex of to
+        std::vector<GLuint> neighboursFrom, neighboursTo;
+
+        for (const Collapse& collapse : collapses){
+
+            if (applied >= wanted){
+                break;
+            }
+
+            GLuint from = collapse.from, to = collapse.to;
+            if (lockedPass[from] == pass || lockedPass[to] == pass){
+                continue;
+            }
+
+            // border and seam positions only slide along their open edges
+            const std::vector<GLuint>& open = openNeighbours[from];
+            if (open.size() > 2 || (!open.empty() && std::find(open.begin(), open.end(), to) == open.end())){
+                continue;
+            }
+
+            // link condition - the positions adjacent to both are the third corners of the shared triangles
+            neighboursFrom.clear();
+            neighboursTo.clear();
+            unsigned int sharedTriangles = 0;
+            for (unsigned int a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++){
+                unsigned int t = adjacency[a];
+                bool hasTo = false;
+                for (int j = 0; j < 3; j++){
+                    GLuint p = welded[triangles[t * 3 + j]];
+                    hasTo = hasTo || p == to;
+                    if (p != from){
+                        neighboursFrom.push_back(p);
+                    }
+                }
+                sharedTriangles += hasTo ? 1 : 0;
+            }
+            for (unsigned int a = adjacencyOffsets[to]; a < adjacencyOffsets[to + 1]; a++){
+                unsigned int t = adjacency[a];
+                for (int j = 0; j < 3; j++){
+                    GLuint p = welded[triangles[t * 3 + j]];
+                    if (p != to && p != from){
+                        neighboursTo.push_back(p);
+                    }
+                }
+            }
+            std::sort(neighboursFrom.begin(), neighboursFrom.end());
+            neighboursFrom.erase(std::unique(neighboursFrom.begin(), neighboursFrom.end()), neighboursFrom.end());
+            std::sort(neighboursTo.begin(), neighboursTo.end());
+            neighboursTo.erase(std::unique(neighboursTo.begin(), neighboursTo.end()), neighboursTo.end());
+
+            unsigned int common = 0;
+            for (GLuint p : neighboursFrom){
+                common += std::binary_search(neighboursTo.begin(), neighboursTo.end(), p) ? 1 : 0;
+            }
+            if (sharedTriangles == 0 || common != sharedTriangles){
+                continue;
+            }
+
+            // every vertex of from needs a vertex of to on the same side of the seams
+            remap.clear();
+            bool valid = true;
+            for (unsigned int a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1] && valid; a++){
+
+                unsigned int t = adjacency[a];
+                GLuint vertex = 0, target = 0;
+                bool hasTarget = false;
+                for (int j = 0; j < 3; j++){
+                    GLuint v = triangles[t * 3 + j];
+                    if (welded[v] == from){
+                        vertex = v;
+                    }
+                    else if (welded[v] == to){
+                        target = v;
+                        hasTarget = true;
+                    }
+                }
+
+                auto found = std::find_if(remap.begin(), remap.end(),
+                                          [&](const std::pair<GLuint, GLuint>& r){ return r.first == vertex; });
+                if (found == remap.end()){
+                    remap.push_back(std::make_pair(vertex, hasTarget ? target : vertex));
+                }
+                else if (found->second == found->first && hasTarget){
+                    found->second = target;
+                }
+            }
+            for (const std::pair<GLuint, GLuint>& r : remap){
+                valid = valid && r.first != r.second;
+            }
+
+            // the remaining triangles must not flip or collapse
+            for (unsigned int a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1] && valid; a++){
+
+                unsigned int t = adjacency[a];
+                glm::dvec3 before[3], after[3];
+                bool shared = false;
+                for (int j = 0; j < 3; j++){
+                    GLuint p = welded[triangles[t * 3 + j]];
+                    shared = shared || p == to;
+                    before[j] = positions[p];
+                    after[j] = p == from ? positions[to] : positions[p];
+                }
+                if (shared){
+                    continue;   // removed by the collapse
+                }
+
+                glm::dvec3 normalBefore = triangleNormal(before[0], before[1], before[2]);
+                glm::dvec3 normalAfter = triangleNormal(after[0], after[1], after[2]);
+                double lengths = glm::length(normalBefore) * glm::length(normalAfter);
+                valid = lengths > 0.0 && glm::dot(normalBefore, normalAfter) >= kMinimalNormalDot * lengths;
+            }
+
+            if (!valid){
+                continue;
+            }
+
+            // apply - the triangles of the edge degenerate, the others use the vertices of to
+            for (unsigned int a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++){
+
+                unsigned int t = adjacency[a];
+                if (!alive[t]){
+                    continue;
+                }
+
+                for (int j = 0; j < 3; j++){
+                    GLuint& v = triangles[t * 3 + j];
+                    if (welded[v] == from){
+                        for (const std::pair<GLuint, GLuint>& r : remap){
+                            if (r.first == v){
+                                v = r.second;
+                                break;
+                            }
+                        }
+                    }
+                }
+
+                GLuint p0 = welded[triangles[t * 3]], p1 = welded[triangles[t * 3 + 1]], p2 = welded[triangles[t * 3 + 2]];
+                if (p0 == p1 || p1 == p2 || p0 == p2){
+                    alive[t] = false;
+                    liveTriangles--;
+                }
+            }
+
+            quadrics[to].Add(quadrics[from]);
+
+            if (collapse.cost > maximalCost){
+                maximalCost = collapse.cost;
+                maximalWeight = quadrics[to].weight;
+            }
+
+            // the neighbourhood changed - no other collapse touches it in this pass
+            lockedPass[from] = pass;
+            lockedPass[to] = pass;
+            for (GLuint p : neighboursFrom){
+                lockedPass[p] = pass;
+            }
+            for (GLuint p : neighboursTo){
+                lockedPass[p] = pass;
+            }
+
+            applied++;
+        }
+
+        if (applied == 0){  // nothing more can be removed
+            break;
+        }
+    }
+
+    result.clear();
+    for (unsigned int t = 0; t < numberOfTriangles; t++){
+        if (alive[t]){
+            result.insert(result.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+        }
+    }
+
+    // mean squared distance of the planes -> distance
+    return maximalWeight > 0.0 ? static_cast<float>(std::sqrt(maximalCost / maximalWeight)) : 0.0f;
+}
+
+
+std::vector<MeshLod> MeshSimplifier::BuildLods(const std::vector<GLfloat>& data, const std::vector<GLuint>& indices,
+                                               unsigned int maxLevels, JobSystem* jobSystem){
+
+    std::vector<MeshLod> levels(maxLevels);
+
+    // the levels do not depend on each other - one job per level
+    JobFunction simplify = [&](unsigned int begin, unsigned int end, unsigned int){
+        for (unsigned int i = begin; i < end; i++){
+            unsigned int target = (indices.size() / 3 >> (i + 1)) * 3;
+            levels[i].error = Simplify(data, indices, target, levels[i].indices);
+            MeshOptimizer::OptimizeVertexCache(levels[i].indices, data.size() / stride);
+        }
+    };
+
+    if (jobSystem != nullptr){
+        jobSystem->ParallelFor(maxLevels, 1, simplify);
+    }
+    else{
+        simplify(0, maxLevels, 0);
+    }
+
+    // keep the levels that remove at least a fifth of the previous one
+    std::vector<MeshLod> chain;
+    size_t previousSize = indices.size();
+    float previousError = 0.0f;
+    for (MeshLod& level : levels){
+
+        if (level.indices.empty() || level.indices.size() * 5 > previousSize * 4){
+            break;
+        }
+
+        level.error = std::max(level.error, previousError);
+        previousSize = level.indices.size();
+        previousError = level.error;
+        chain.push_back(std::move(level));
+    }
+
+    return chain;
+}
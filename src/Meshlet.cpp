@@ -0,0 +1,273 @@
+#include "Meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+
+// sphere around the vertices of the triangles [first, last) and the cone of their normals
+static void ComputeBounds(Meshlet& meshlet, const std::vector<GLfloat>& data, const std::vector<GLuint>& indices,
+                          unsigned int stride){
+
+    unsigned int first = meshlet.firstIndex;
+    unsigned int last = meshlet.firstIndex + meshlet.indexCount;
+
+    // center of the bounding box, radius to the farthest vertex
+    glm::vec3 minimum(data[indices[first] * stride], data[indices[first] * stride + 1], data[indices[first] * stride + 2]);
+    glm::vec3 maximum = minimum;
+    for (unsigned int i = first; i < last; i++){
+        const GLfloat* p = &data[indices[i] * stride];
+        minimum = glm::min(minimum, glm::vec3(p[0], p[1], p[2]));
+        maximum = glm::max(maximum, glm::vec3(p[0], p[1], p[2]));
+    }
+
+    meshlet.center = (minimum + maximum) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (unsigned int i = first; i < last; i++){
+        const GLfloat* p = &data[indices[i] * stride];
+        meshlet.radius = std::max(meshlet.radius, glm::length(glm::vec3(p[0], p[1], p[2]) - meshlet.center));
+    }
+
+    // face normals (the winding decides what is a back face)
+    std::vector<glm::vec3> normals;
+    glm::vec3 axis(0.0f);
+    for (unsigned int i = first; i + 2 < last; i += 3){
+
+        const GLfloat* a = &data[indices[i] * stride];
+        const GLfloat* b = &data[indices[i + 1] * stride];
+        const GLfloat* c = &data[indices[i + 2] * stride];
+
+        glm::vec3 normal = glm::cross(glm::vec3(b[0], b[1], b[2]) - glm::vec3(a[0], a[1], a[2]),
+                                      glm::vec3(c[0], c[1], c[2]) - glm::vec3(a[0], a[1], a[2]));
+        float length = glm::length(normal);
+
+        if (length > 0.0f){     // degenerate triangles are never visible
+            normals.push_back(normal / length);
+            axis += normal / length;
+        }
+    }
+
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength == 0.0f){
+        return;     // keep the default - never culled
+    }
+    meshlet.coneAxis = axis / axisLength;
+
+    float minimumDot = 1.0f;
+    for (const glm::vec3& normal : normals){
+        minimumDot = std::min(minimumDot, glm::dot(meshlet.coneAxis, normal));
+    }
+
+    // wider than ~84 degrees - the test would almost never succeed
+    meshlet.coneCutoff = minimumDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minimumDot * minimumDot);
+
+}
+
+
+// free triangle closest to a vertex among the next free triangles of the cache order
+static void AddNearestTriangle(std::vector<unsigned int>& candidates, const std::vector<bool>& emitted,
+                               unsigned int seed, unsigned int numberOfTriangles, GLuint vertex,
+                               const std::vector<GLfloat>& data, const std::vector<GLuint>& indices, unsigned int stride){
+
+    const unsigned int searchLimit = 256;
+    glm::vec3 position(data[vertex * stride], data[vertex * stride + 1], data[vertex * stride + 2]);
+
+    int nearest = -1;
+    float nearestDistance = 0.0f;
+    unsigned int searched = 0;
+
+    for (unsigned int t = seed; t < numberOfTriangles && searched < searchLimit; t++){
+
+        if (emitted[t]){
+            continue;
+        }
+        searched++;
+
+        const GLfloat* p = &data[indices[t * 3] * stride];
+        glm::vec3 toTriangle = glm::vec3(p[0], p[1], p[2]) - position;
+        float distance = glm::dot(toTriangle, toTriangle);
+
+        if (nearest < 0 || distance < nearestDistance){
+            nearest = t;
+            nearestDistance = distance;
+        }
+    }
+
+    if (nearest >= 0){
+        candidates.push_back(nearest);
+    }
+
+}
+
+
+std::vector<Meshlet> MeshletBuilder::Build(const std::vector<GLfloat>& data, std::vector<GLuint>& indices,
+                                           unsigned int maxVertices, unsigned int maxTriangles){
+
+    std::vector<Meshlet> meshlets;
+    unsigned int numberOfVertices = data.size() / stride;
+    unsigned int numberOfTriangles = indices.size() / 3;
+
+    // unit face normals (zero for degenerate triangles)
+    std::vector<glm::vec3> normals(numberOfTriangles);
+    for (unsigned int t = 0; t < numberOfTriangles; t++){
+        const GLfloat* a = &data[indices[t * 3] * stride];
+        const GLfloat* b = &data[indices[t * 3 + 1] * stride];
+        const GLfloat* c = &data[indices[t * 3 + 2] * stride];
+        glm::vec3 normal = glm::cross(glm::vec3(b[0], b[1], b[2]) - glm::vec3(a[0], a[1], a[2]),
+                                      glm::vec3(c[0], c[1], c[2]) - glm::vec3(a[0], a[1], a[2]));
+        float length = glm::length(normal);
+        normals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
+
+    // vertices at the same position are one vertex for the adjacency (seams split the normals and texture coords)
+    std::vector<unsigned int> welded(numberOfVertices);
+    std::map<std::tuple<float, float, float>, unsigned int> positions;
+    for (unsigned int v = 0; v < numberOfVertices; v++){
+        std::tuple<float, float, float> key(data[v * stride], data[v * stride + 1], data[v * stride + 2]);
+        welded[v] = positions.emplace(key, v).first->second;
+    }
+
+    // triangles of every welded vertex (offsets + list)
+    std::vector<unsigned int> adjacencyOffsets(numberOfVertices + 1, 0);
+    for (GLuint index : indices){
+        adjacencyOffsets[welded[index] + 1]++;
+    }
+    for (unsigned int v = 0; v < numberOfVertices; v++){
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (unsigned int i = 0; i < indices.size(); i++){
+        adjacency[fill[welded[indices[i]]]++] = i / 3;
+    }
+
+    std::vector<bool> emitted(numberOfTriangles, false);
+    std::vector<unsigned int> owner(numberOfVertices, 0);   // meshlet that uses the vertex (+1, 0 = none)
+    std::vector<GLuint> ordered;
+    ordered.reserve(indices.size());
+
+    unsigned int seed = 0;
+    while (ordered.size() < indices.size()){
+
+        // the first free triangle of the cache order starts the meshlet
+        while (emitted[seed]){
+            seed++;
+        }
+
+        Meshlet meshlet;
+        meshlet.firstIndex = ordered.size();
+        unsigned int id = meshlets.size() + 1;
+        unsigned int uniqueVertices = 0;
+        glm::vec3 normalSum(0.0f);
+        std::vector<unsigned int> candidates(1, seed);
+
+        while (meshlet.indexCount / 3 < maxTriangles){
+
+            // neighbour that adds the fewest vertices and bends the normal cone the least
+            int best = -1;
+            float bestScore = 0.0f;
+            unsigned int bestNew = 0;
+            glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+
+            for (unsigned int c = 0; c < candidates.size(); c++){
+
+                unsigned int t = candidates[c];
+                if (emitted[t]){
+                    candidates[c--] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+
+                unsigned int newVertices = 0;
+                for (int j = 0; j < 3; j++){
+                    newVertices += owner[indices[t * 3 + j]] != id ? 1 : 0;
+                }
+                if (uniqueVertices + newVertices > maxVertices){
+                    continue;
+                }
+
+                float score = newVertices + 2.0f * (1.0f - glm::dot(axis, normals[t]));
+                if (best < 0 || score < bestScore){
+                    best = c;
+                    bestScore = score;
+                    bestNew = newVertices;
+                }
+            }
+
+            if (best < 0){
+                break;
+            }
+
+            unsigned int t = candidates[best];
+            emitted[t] = true;
+            normalSum += normals[t];
+            uniqueVertices += bestNew;
+            meshlet.indexCount += 3;
+
+            for (int j = 0; j < 3; j++){
+                GLuint vertex = indices[t * 3 + j];
+                ordered.push_back(vertex);
+
+                if (owner[vertex] != id){
+                    owner[vertex] = id;
+                }
+
+                // triangles touching the vertex become candidates
+                GLuint position = welded[vertex];
+                for (unsigned int a = adjacencyOffsets[position]; a < adjacencyOffsets[position + 1]; a++){
+                    if (!emitted[adjacency[a]]){
+                        candidates.push_back(adjacency[a]);
+                    }
+                }
+            }
+
+            // the emitted triangle (and its duplicates) are no candidates any more
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                            [&](unsigned int c){ return emitted[c]; }), candidates.end());
+
+            // not connected - continue with a close free triangle near the cache order
+            if (candidates.empty() && ordered.size() < indices.size()){
+                AddNearestTriangle(candidates, emitted, seed, normals.size(), ordered.back(), data, indices, stride);
+            }
+        }
+
+        meshlets.push_back(meshlet);
+    }
+
+    // the meshlets are contiguous ranges of the new triangle order
+    indices.swap(ordered);
+    for (Meshlet& meshlet : meshlets){
+        ComputeBounds(meshlet, data, indices, stride);
+    }
+
+    return meshlets;
+}
+
+
+bool MeshletBuilder::IsBackfacing(const glm::vec3& center, float radius, const glm::vec3& coneAxis, float coneCutoff,
+                                  const glm::vec3& cameraPosition){
+
+    glm::vec3 toCenter = center - cameraPosition;
+    return glm::dot(toCenter, coneAxis) >= coneCutoff * glm::length(toCenter) + radius;
+}
+
+
+void MeshletBuilder::Transform(const Meshlet& meshlet, const glm::mat4& model, float maxScale, bool uniformScale,
+                               glm::vec4& sphere, glm::vec4& cone){
+
+    sphere = glm::vec4(glm::vec3(model * glm::vec4(meshlet.center, 1.0f)), meshlet.radius * maxScale);
+
+    // a non-uniform scale changes the angles between the normals
+    if (!uniformScale || meshlet.coneCutoff >= 1.0f){
+        cone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        return;
+    }
+
+    glm::vec3 axis = glm::normalize(glm::mat3(model) * meshlet.coneAxis);
+    if (glm::determinant(glm::mat3(model)) < 0.0f){     // mirrored - the winding flips
+        axis = -axis;
+    }
+
+    cone = glm::vec4(axis, meshlet.coneCutoff);
+}
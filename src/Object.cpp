@@ -1,57 +1,55 @@
 #include "Object.hpp"
 #include "ObjectParser.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshCache.hpp"
+#include "TextureCache.hpp"
+#include "HeightMap.hpp"
+#include "VirtualTexture.hpp"
+#include "TextureStreamer.hpp"
+#include "MaterialTable.hpp"
+#include "MeshSimplifier.hpp"
 #include "Scene.hpp"
 #include "utils.hpp"
 #include "PointLight.hpp"
 #include "ObjectParser.hpp"
 
-// define constructor
-Object::Object(const std::string& vertexShaderPath, const std::string& fragmentShaderPath){
-
-    // create graphics pipeline for the object
-
-    this->shader = new Shader(vertexShaderPath, fragmentShaderPath);
-
-    // generate VAO
-    glGenVertexArrays(1, &this->VertexArrayObject);
-    
-    // generate VBOs and EBOs
-    glGenBuffers(1, &this->VertexBufferObject);
-    glGenBuffers(1, &this->ElementBufferObject);
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
 
-    // connect attributes to VAO and VBO
-    glBindVertexArray(this->VertexArrayObject);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VertexBufferObject);
+// shaders and textures are shared by all objects that load the same files
+static std::map<std::string, std::weak_ptr<Shader>> shaderCache;
+static std::map<std::string, std::weak_ptr<Texture>> textureCache;
 
-    unsigned int stride = 14;
 
-    glEnableVertexAttribArray(0);   // vertex attrib
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride*sizeof(GL_FLOAT), (void *)0);
+// shader of the files and defines - compiled once and shared
+static std::shared_ptr<Shader> GetSharedShader(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+                                               const std::string& defines){
 
-    glEnableVertexAttribArray(1);   // normals attrib
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride*sizeof(GL_FLOAT), (void *) (3*sizeof(GLfloat)));
+    std::string key = vertexShaderPath + "|" + fragmentShaderPath + "|" + defines;
+    std::shared_ptr<Shader> shader = shaderCache[key].lock();
+    if (shader == nullptr){
+        shader = std::make_shared<Shader>(vertexShaderPath, fragmentShaderPath, defines);
+        shaderCache[key] = shader;
+    }
 
-    glEnableVertexAttribArray(2);   // texture attrib
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride*sizeof(GL_FLOAT), (void *) (6*sizeof(GLfloat)));
+    return shader;
+}
 
-    glEnableVertexAttribArray(3);   // tanget attrib
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride*sizeof(GL_FLOAT), (void *) (8*sizeof(GLfloat)));
 
-    glEnableVertexAttribArray(4);   // bitanget attrib
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride*sizeof(GL_FLOAT), (void *) (11*sizeof(GLfloat)));
+// define constructor
+Object::Object(const std::string& vertexShaderPath, const std::string& fragmentShaderPath)
+    : vertexShaderPath(vertexShaderPath), fragmentShaderPath(fragmentShaderPath){
 
-    glBindVertexArray(0);   // unbind for clean code
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-    glDisableVertexAttribArray(2);
-    glDisableVertexAttribArray(3);
-    glDisableVertexAttribArray(4);
+    // create graphics pipeline for the object (or reuse an existing one)
+    this->shader = GetSharedShader(vertexShaderPath, fragmentShaderPath, GetShaderDefines());
 
                         // generate textures
 
-    diffuseTex = new Texture();
-    normalTex = new Texture();
-    heightTex = new Texture();
+    diffuseTex = std::make_shared<Texture>();
+    normalTex = std::make_shared<Texture>();
+    heightTex = std::make_shared<Texture>();
 
     // set object number to null and number of elements of the object to 0
     objectNumber = 0;
@@ -59,122 +57,422 @@ Object::Object(const std::string& vertexShaderPath, const std::string& fragmentS
 
 }
 
-// define destructor
-Object::~Object(){
+// CPU only object - no shader, buffers or textures
+Object::Object(){ }
 
-    // free buffers
-	glDeleteVertexArrays(1, &VertexArrayObject);
-	glDeleteBuffers(1, &VertexBufferObject);
-	glDeleteBuffers(1, &ElementBufferObject);
+// define destructor - shared shaders and textures are freed with their last object
+Object::~Object(){ }
 
-    delete diffuseTex;
-    delete normalTex;
-    delete heightTex;
-    
-    // delete pipeline
-    delete this->shader;
 
+// CPU part of the draw - matrices, culling, sort key and per-draw uniforms
+bool Object::Prepare(const FrameContext& context, DrawCommand& command, bool cull) const{
+
+    if (this->numberOfElements == 0){ // nothing to draw
+        return false;
+    }
+
+    // Model transformation by translating our object into world space
+    glm::mat4 model = GetModelMatrix();
+
+    // frustum culling of the bounding sphere (rotation does not change the radius)
+    glm::vec3 center = glm::vec3(model * glm::vec4(this->boundingCenter, 1.0f));
+    glm::vec3 absScale = glm::abs(this->scale);
+    float radius = this->boundingRadius * std::max(absScale.x, std::max(absScale.y, absScale.z));
+
+    if (cull && !context.IsSphereVisible(center, radius)){
+        return false;
+    }
+
+    // culled later on the GPU
+    command.bounds = glm::vec4(center, radius);
+
+    // levels of the textures by the size on the screen (only in the frustum when the GPU culls)
+    if (gScene.textureStreamer != nullptr && (cull || context.IsSphereVisible(center, radius))){
+        float distance = glm::length(center - context.cameraPosition) - radius;
+        RequestTextures(distance > context.nearPlane ? 2.0f * radius * context.pixelScale / distance
+                                                     : std::numeric_limits<float>::max());
+    }
+
+    // pack the per-draw uniforms
+    PerDrawData& data = command.data;
+    data.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model)))); // based on model matrix
+
+    // dequantization of packed positions (model * translate(offset) * scale(scale))
+    const PositionQuantization& quantization = this->mesh.quantization;
+    data.model[0] = model[0] * quantization.scale.x;
+    data.model[1] = model[1] * quantization.scale.y;
+    data.model[2] = model[2] * quantization.scale.z;
+    data.model[3] = model * glm::vec4(quantization.offset, 1.0f);
+    data.Ka = glm::vec4(this->Ka, static_cast<float>(this->materialLayer));
+    data.Kd = glm::vec4(this->Kd, static_cast<float>(this->materialIndex));
+    data.Ks = glm::vec4(this->Ks, this->shininess);
+    int layerBudget = 0;
+    int method = SelectParallaxMethod(context, command.bounds, layerBudget);
+    data.flags = glm::ivec4(this->usedLight, method, this->continuousTexture, layerBudget);
+
+    // sort by the shader, then by the texture, then front to back
+    uint64_t program = this->shader != nullptr ? this->shader->shaderID & 0xFFFF : 0;
+    uint64_t texture = this->diffuseTex != nullptr ? this->diffuseTex->GetID() & 0xFFFF : 0;
+    if (this->materialArray != nullptr){
+        texture = this->materialArray->diffuse.GetID() & 0xFFFF;
+    }
+    if (this->virtualTexture != nullptr){
+        texture = this->virtualTexture->GetID() & 0xFFFF;
+    }
+    if (UsesBindless()){
+        texture = 0;
+    }
+    glm::vec3 toObject = center - context.cameraPosition;
+    float distance = glm::dot(toObject, toObject);
+    uint32_t depth;
+    std::memcpy(&depth, &distance, sizeof(depth)); // positive floats keep their order as integers
+
+    command.sortKey = (program << 48) | (texture << 32) | depth;
+    command.object = const_cast<Object*>(this);
+
+    return true;
 }
 
 
-// set up graphics pipeline - upload uniform variables to shader pipeline
-void Object::SetUpPipeline(){
+void Object::RequestTextures(float pixels) const{
 
-        // Use our shader
-    this->shader->Bind();
+    TextureStreamer* streamer = gScene.textureStreamer;
+
+    for (const std::shared_ptr<Texture>& texture : {this->diffuseTex, this->normalTex, this->heightTex}){
+        if (texture != nullptr){
+            streamer->Request(texture->GetStreamID(), pixels);
+        }
+    }
+
+    if (this->materialArray != nullptr){
+        streamer->Request(this->materialArray->diffuse.GetStreamID(), pixels);
+        streamer->Request(this->materialArray->normal.GetStreamID(), pixels);
+        streamer->Request(this->materialArray->height.GetStreamID(), pixels);
+    }
+
+}
+
+
+// world bounds of the meshlets (or of the whole mesh) and their visibility
+unsigned int Object::PrepareDraws(const FrameContext& context, const DrawCommand& command,
+                                  CullObject* bounds, uint8_t* visibility, bool cull) const{
+
+    // a coarser level is drawn as a whole, the other commands stay empty
+    unsigned int level = SelectLod(context, command.bounds);
+    if (level > 0){
+        unsigned int lodCommand = GetNumberOfDraws() - this->lods.size() + level - 1;
+        bounds[lodCommand].sphere = command.bounds;
+        visibility[lodCommand] = 1;
+        return 1;
+    }
+
+    if (this->meshlets.empty()){
+        bounds[0].sphere = command.bounds;
+        visibility[0] = 1;
+        return 1;
+    }
+
+    glm::mat4 model = GetModelMatrix();
+    glm::vec3 absScale = glm::abs(this->scale);
+    float maxScale = std::max(absScale.x, std::max(absScale.y, absScale.z));
+    bool uniformScale = absScale.x == absScale.y && absScale.y == absScale.z;
+
+    unsigned int visible = 0;
+    for (unsigned int i = 0; i < this->meshlets.size(); i++){
+
+        MeshletBuilder::Transform(this->meshlets[i], model, maxScale, uniformScale, bounds[i].sphere, bounds[i].cone);
+
+        visibility[i] = !cull || (context.IsSphereVisible(glm::vec3(bounds[i].sphere), bounds[i].sphere.w) &&
+                                  (bounds[i].cone.w >= 1.0f ||
+                                   !MeshletBuilder::IsBackfacing(glm::vec3(bounds[i].sphere), bounds[i].sphere.w,
+                                                                 glm::vec3(bounds[i].cone), bounds[i].cone.w,
+                                                                 context.cameraPosition)));
+        visible += visibility[i];
+    }
+
+    return visible;
+}
 
-    // upload material components
-    this->Upload_Material_Pipeline(this->shader);
 
-    // set texture sampler ID uniform 
-    shader->Upload_Uniform1i_Pipeline("diffuseTexture", 0);
-    shader->Upload_Uniform1i_Pipeline("normalTexture", 1);
-    shader->Upload_Uniform1i_Pipeline("displacementTexture", 2);
+// bind the shader (with the uniforms shared by the frame) and the textures
+void Object::BindMaterial(const FrameContext& context, bool bindPipeline){
 
-    // set used light and used method
-    shader->Upload_Uniform1i_Pipeline("usedLight", this->usedLight);
-    if (this->parallaxMethod != -1){ // if parallax method is set
-        shader->Upload_Uniform1i_Pipeline("parallaxMethod", this->parallaxMethod);
+    // the deferred path writes the G-buffer variant (compiled on its first use)
+    Shader* shader = this->shader.get();
+    if (context.gbufferPass){
+        if (this->gbufferShader == nullptr){
+            this->gbufferShader = GetSharedShader(this->vertexShaderPath, this->fragmentShaderPath,
+                                                  GetShaderDefines() + "#define GBUFFER\n");
+        }
+        shader = this->gbufferShader.get();
+    }
 
-        // set continuous texture to false / true
-        if (continuousTexture == 1){
-            shader->Upload_Uniform1i_Pipeline("continuousTexture", 1);
+    if (bindPipeline){
+
+        // Use our shader
+        shader->Bind();
+
+        // set texture sampler ID uniform (the bindless shaders read the handles of the materials)
+        if (UsesBindless()){
+            gScene.materialTable->Bind();
         }
         else{
-            shader->Upload_Uniform1i_Pipeline("continuousTexture", 0);
+            shader->Upload_Uniform1i_Pipeline("diffuseTexture", 0);
+            shader->Upload_Uniform1i_Pipeline("normalTexture", 1);
+            if (!this->packedMaterial && this->virtualTexture == nullptr){
+                shader->Upload_Uniform1i_Pipeline("displacementTexture", 2);
+            }
         }
 
+        // point lights and their clusters
+        gScene.BindLights();
+
+        // upload camera position
+        shader->Upload_Uniform3f_Pipeline("u_CameraPos", context.cameraPosition.x,
+                                          context.cameraPosition.y, context.cameraPosition.z);
+
+        // Update the View and the Projection Matrix
+        glm::mat4 viewMatrix = context.view;
+        shader->Upload_Uniform_MAT4fv_Pipeline("u_ViewMatrix", viewMatrix);
+
+        glm::mat4 perspective = context.projection;
+        shader->Upload_Uniform_MAT4fv_Pipeline("u_ProjectionMatrix", perspective);
+
+        // distance fade of the parallax shader (ignored by the other shaders)
+        const ParallaxLodSettings& parallaxLod = context.parallaxLod;
+        shader->Upload_Uniform1i_Pipeline("u_ParallaxLod", parallaxLod.enabled ? 1 : 0);
+        shader->Upload_Uniform1f_Pipeline("u_ParallaxFullDistance", parallaxLod.fullDistance);
+        shader->Upload_Uniform1f_Pipeline("u_ParallaxOffsetDistance", parallaxLod.offsetDistance);
+        shader->Upload_Uniform1f_Pipeline("u_ParallaxNormalDistance", parallaxLod.normalDistance);
+        shader->Upload_Uniform1f_Pipeline("u_ParallaxMipLevel", parallaxLod.mipLevel);
     }
 
+    // physical textures and indirection table of the resident pages
+    if (this->virtualTexture != nullptr){
+        this->virtualTexture->Bind(shader, bindPipeline);
+        return;
+    }
 
-    // Model transformation by translating our object into world space
-    glm::mat4 model = glm::mat4(1.0f);
+    // the material is chosen by the per-draw record
+    if (UsesBindless()){
+        return;
+    }
 
-    // translation
-    model = glm::translate(model, glm::vec3(this->translation.x, this->translation.y, this->translation.z));
+    // the layer of the arrays is chosen by the per-draw record
+    if (this->materialArray != nullptr){
+        this->materialArray->diffuse.Bind(0);
+        this->materialArray->normal.Bind(1);
+        if (!this->materialArray->packed){
+            this->materialArray->height.Bind(2);
+        }
+        return;
+    }
 
-    // rotation
-    model = glm::rotate(model, glm::radians(this->rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f)); // x
-    model = glm::rotate(model, glm::radians(this->rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f)); // y
-    model = glm::rotate(model, glm::radians(this->rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f)); // z
-    
-    // scale 
-    model = glm::scale(model, this->scale);
+    // bind textures (a packed material has no height texture)
+    diffuseTex->Bind(0);
+    normalTex->Bind(1);
+    if (heightTex != nullptr){
+        heightTex->Bind(2);
+    }
 
+}
 
-    // Retrieve our location of our Model Matrix
-    shader->Upload_Uniform_MAT4fv_Pipeline("u_ModelMatrix", model);
 
-    // upload normal matrix - based on model matrix
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse( glm::mat3(model)));
-    shader->Upload_Uniform_MAT3fv_Pipeline("u_NormalMatrix", normalMatrix);
+// draw the mesh from the bound mesh buffer
+void Object::Submit(unsigned int drawID, const uint8_t* visibility){
 
-    // upload point lights
-    gScene.UploadLightsToPipeline(shader);
+    // index of the per-draw record (constant attribute of the draw)
+    glVertexAttribI1i(DRAW_ID_LOCATION, drawID);
 
+    size_t indexSize = this->mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
 
-    // upload camera position
-    shader->Upload_Uniform3f_Pipeline("u_CameraPos", gScene.MainCamera.GetEyeXPosition(),
-                         gScene.MainCamera.GetEyeYPosition(), gScene.MainCamera.GetEyeZPosition());
+    // selected coarser level
+    if (visibility != nullptr){
+        unsigned int firstLod = GetNumberOfDraws() - this->lods.size();
+        for (unsigned int i = 0; i < this->lods.size(); i++){
+            if (visibility[firstLod + i]){
+                glDrawElementsBaseVertex(GL_TRIANGLES, this->lods[i].indexCount, this->mesh.indexType,
+                                         (void *) (this->lods[i].firstIndex * indexSize), this->mesh.baseVertex);
+                return;
+            }
+        }
+    }
 
+    if (this->meshlets.empty() || visibility == nullptr){
+        glDrawElementsBaseVertex(GL_TRIANGLES, this->numberOfElements, this->mesh.indexType,
+                                 (void *) (this->mesh.firstIndex * indexSize), this->mesh.baseVertex);
+        return;
+    }
 
-    // Update the View Matrix
-    glm::mat4 viewMatrix = gScene.MainCamera.GetViewMatrix();
-    shader->Upload_Uniform_MAT4fv_Pipeline("u_ViewMatrix", viewMatrix);
+    // only the visible meshlets - one call
+    std::vector<GLsizei> counts;
+    std::vector<void *> offsets;
+    for (unsigned int i = 0; i < this->meshlets.size(); i++){
+        if (visibility[i]){
+            counts.push_back(this->meshlets[i].indexCount);
+            offsets.push_back((void *) ((this->mesh.firstIndex + this->meshlets[i].firstIndex) * indexSize));
+        }
+    }
 
-    // Projection matrix (in perspective) 
-    glm::mat4 perspective = glm::perspective(glm::radians(45.0f),
-                                             (float)gScene.ScreenWidth/(float)gScene.ScreenHeight,
-                                             0.1f,
-                                             40.0f);
+    if (counts.empty()){
+        return;
+    }
 
-    // Retrieve our location of our perspective matrix uniform 
-    shader->Upload_Uniform_MAT4fv_Pipeline("u_ProjectionMatrix", perspective);
+    std::vector<GLint> baseVertices(counts.size(), this->mesh.baseVertex);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), this->mesh.indexType, offsets.data(),
+                                  counts.size(), baseVertices.data());
 
 }
 
-// define draw function
-void Object::Draw(){
 
-    // set up pipeline
-    SetUpPipeline();
+void Object::GetIndirectCommands(unsigned int drawID, std::vector<DrawElementsIndirectCommand>& commands) const{
 
-    // bind textures and VAO
-    diffuseTex->Bind(0);
-    normalTex->Bind(1);
-    heightTex->Bind(2);
+    DrawElementsIndirectCommand command;
+    command.count = this->numberOfElements;
+    command.instanceCount = 1;
+    command.firstIndex = this->mesh.firstIndex;
+    command.baseVertex = this->mesh.baseVertex;
+    command.baseInstance = drawID;  // selects the per-draw record
+
+    if (this->meshlets.empty()){
+        commands.push_back(command);
+    }
+
+    // every meshlet reads the record of the object
+    for (const Meshlet& meshlet : this->meshlets){
+        command.count = meshlet.indexCount;
+        command.firstIndex = this->mesh.firstIndex + meshlet.firstIndex;
+        commands.push_back(command);
+    }
+
+    // the levels of detail follow the full mesh
+    for (const MeshRange& lod : this->lods){
+        command.count = lod.indexCount;
+        command.firstIndex = lod.firstIndex;
+        commands.push_back(command);
+    }
+
+}
+
+
+unsigned int Object::GetNumberOfDraws() const{
+    return (this->meshlets.empty() ? 1 : this->meshlets.size()) + this->lods.size();
+}
+
+
+unsigned int Object::GetNumberOfMeshlets() const{
+    return this->meshlets.size();
+}
+
+
+unsigned int Object::GetNumberOfLods() const{
+    return this->lods.size();
+}
+
+
+unsigned int Object::SelectLod(const FrameContext& context, const glm::vec4& bounds) const{
+
+    if (this->lods.empty() || context.lodPixelError <= 0.0f){
+        return 0;
+    }
+
+    // nearest point of the bounding sphere
+    float distance = glm::length(glm::vec3(bounds) - context.cameraPosition) - bounds.w;
+    if (distance <= 0.0f){
+        return 0;
+    }
+
+    glm::vec3 absScale = glm::abs(this->scale);
+    float maxScale = std::max(absScale.x, std::max(absScale.y, absScale.z));
+
+    // the errors grow with the level
+    unsigned int level = 0;
+    while (level < this->lods.size() &&
+           this->lodErrors[level] * maxScale * context.pixelScale / distance <= context.lodPixelError){
+        level++;
+    }
 
-    glBindVertexArray(this->VertexArrayObject);
+    return level;
+}
+
+
+int Object::SelectParallaxMethod(const FrameContext& context, const glm::vec4& bounds, int& layerBudget) const{
+
+    // height scale of the parallax shader and the fewest layers worth ray marching
+    const float heightScale = 0.08f;
+    const float minLayers = 8.0f;
+
+    layerBudget = 0;
+    if (this->parallaxMethod < 0 || !context.parallaxLod.enabled){
+        return this->parallaxMethod;
+    }
+
+    // the texture spans the object - the displacement is a part of its size, seen from the nearest point
+    float distance = glm::length(glm::vec3(bounds) - context.cameraPosition) - bounds.w;
+    if (distance <= 0.0f){
+        return this->parallaxMethod;
+    }
+    float displacementPixels = heightScale * bounds.w * context.pixelScale / distance;
+
+    if (displacementPixels < context.parallaxLod.normalPixels){
+        return -1;
+    }
+    if (displacementPixels < context.parallaxLod.offsetPixels || this->parallaxMethod == 0){
+        return 0;
+    }
+
+    // about one layer per pixel of the displacement
+    layerBudget = static_cast<int>(std::max(displacementPixels / context.parallaxLod.pixelsPerLayer, minLayers));
+    return this->parallaxMethod;
+}
+
+
+bool Object::SharesPipeline(const Object& other) const{
+    return this->shader == other.shader;
+}
+
+
+GLenum Object::GetIndexType() const{
+    return this->mesh.indexType;
+}
+
+
+uint64_t Object::GetBatchKey() const{
 
-    glDrawElements(GL_TRIANGLES, this->numberOfElements, GL_UNSIGNED_INT, 0);
+    uint64_t program = this->shader != nullptr ? this->shader->shaderID & 0xFFFF : 0;
+    uint64_t diffuse = this->diffuseTex != nullptr ? this->diffuseTex->GetID() & 0xFFFF : 0;
+    uint64_t normal = this->normalTex != nullptr ? this->normalTex->GetID() & 0xFFFF : 0;
+    uint64_t height = this->heightTex != nullptr ? this->heightTex->GetID() & 0xFFFF : 0;
+
+    // all layers of the arrays are one batch
+    if (this->materialArray != nullptr){
+        diffuse = this->materialArray->diffuse.GetID() & 0xFFFF;
+        normal = this->materialArray->normal.GetID() & 0xFFFF;
+        height = this->materialArray->packed ? 0 : this->materialArray->height.GetID() & 0xFFFF;
+    }
+
+    // the pages of all objects are in the same physical textures
+    if (this->virtualTexture != nullptr){
+        diffuse = this->virtualTexture->GetID() & 0xFFFF;
+        normal = 0;
+        height = 0;
+    }
+
+    // the textures come from the material buffer - every material of the shader in one batch
+    if (UsesBindless()){
+        diffuse = 0;
+        normal = 0;
+        height = 0;
+    }
 
-    // unbind VAO and texture
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    return (program << 48) | (diffuse << 32) | (normal << 16) | height;
+}
 
-    // stop using current pipeline
-    this->shader->Unbind();
 
+// set the culling volume in the object space
+void Object::SetBoundingSphere(const glm::vec3& center, float radius){
+    this->boundingCenter = center;
+    this->boundingRadius = radius;
 }
 
 
@@ -185,24 +483,53 @@ void Object::LoadData_WavefrontOBJ(unsigned int objNumber, std::string filePath)
     std::vector<GLfloat> data;
     std::vector<GLuint> indices; 
     std::string MTL_Path = "";
+    std::vector<MeshLod> lodLevels;
+
+
+    // parsed and optimized mesh from the cache, otherwise parse the file
+    if (!gScene.UseMeshCache || !MeshCache::Load(filePath, data, indices, MTL_Path, lodLevels)){
 
+        // parse the file and store the data into data array and indices array
+        ObjectParser::Parse_WavefrontOBJ(data, indices, filePath, MTL_Path);
 
-    // parse the file and store the data into data array and indices array
-    ObjectParser::Parse_WavefrontOBJ(data, indices, filePath, MTL_Path);
+        // triangle and vertex order for the GPU caches
+        VertexCacheStatistics before, after;
+        MeshOptimizer::Optimize(data, indices, &before, &after);
+        std::cout << "Optimized " << filePath << ": ACMR " << before.acmr << " -> " << after.acmr
+                  << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
 
-    // bind VAO
-    glBindVertexArray(this->VertexArrayObject); 
+        // levels of detail - simplified in parallel
+        if (gScene.MeshLods || gScene.UseMeshCache){
+            lodLevels = MeshSimplifier::BuildLods(data, indices, MeshSimplifier::defaultLevels, gScene.jobSystem);
+            std::cout << "Levels of detail of " << filePath << ":";
+            for (const MeshLod& lod : lodLevels){
+                std::cout << " " << lod.indices.size() / 3 << " triangles (error " << lod.error << ")";
+            }
+            std::cout << std::endl;
+        }
 
-    // load data (vertices, normals and textures) to GPU
-    glBindBuffer(GL_ARRAY_BUFFER, this->VertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GL_FLOAT), data.data(), GL_STATIC_DRAW);
+        if (gScene.UseMeshCache){
+            MeshCache::Save(filePath, data, indices, MTL_Path, lodLevels);
+        }
+    }
+
+    // clusters culled separately (reorders the triangles)
+    if (gScene.Meshlets){
+        this->BuildMeshlets(data, indices);
+    }
 
-    // load indices to GPU
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ElementBufferObject);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GL_UNSIGNED_INT), indices.data(), GL_STATIC_DRAW);
+    // add the data to the shared mesh buffer
+    this->mesh = gScene.meshBuffer->AddMesh(data, indices);
 
-    // unbind VAO
-    glBindVertexArray(0);
+    // the levels of detail share the vertices of the mesh
+    this->lods.clear();
+    this->lodErrors.clear();
+    if (gScene.MeshLods){
+        for (const MeshLod& lod : lodLevels){
+            this->lods.push_back(gScene.meshBuffer->AddIndices(this->mesh, lod.indices));
+            this->lodErrors.push_back(lod.error);
+        }
+    }
 
     // load texture if the model has one
     if (MTL_Path != ""){
@@ -228,6 +555,8 @@ void Object::LoadData_WavefrontOBJ(unsigned int objNumber, std::string filePath)
 
     }
 
+    this->ComputeBoundingSphere(data);
+
     // set index of the object
     this->objectNumber = objNumber;
     this->numberOfElements = indices.size();
@@ -239,20 +568,194 @@ void Object::LoadData_WavefrontOBJ(unsigned int objNumber, std::string filePath)
 // upload generated data to GPU
 void Object::UploadVertices(std::vector<GLfloat> data, std::vector<GLuint> indices){
 
-        // bind VAO
-    glBindVertexArray(this->VertexArrayObject); 
+    // add the data to the shared mesh buffer (uploaded before the first draw)
+    this->mesh = gScene.meshBuffer->AddMesh(data, indices);
 
-    // load data (vertices, normals and textures) to GPU
-    glBindBuffer(GL_ARRAY_BUFFER, this->VertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GL_FLOAT), data.data(), GL_STATIC_DRAW);
+    this->ComputeBoundingSphere(data);
+    
+}
 
-    // load indices to GPU
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ElementBufferObject);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GL_UNSIGNED_INT), indices.data(), GL_STATIC_DRAW);
 
-    // unbind VAO
-    glBindVertexArray(0);
-    
+// only meshes large enough to have several meshlets
+void Object::BuildMeshlets(const std::vector<GLfloat>& data, std::vector<GLuint>& indices){
+
+    this->meshlets.clear();
+
+    if (indices.size() / 3 <= 2 * 124){
+        return;
+    }
+
+    this->meshlets = MeshletBuilder::Build(data, indices);
+
+}
+
+
+// bounding box center and the farthest vertex from it
+void Object::ComputeBoundingSphere(const std::vector<GLfloat>& data){
+
+    const unsigned int stride = 14;
+
+    if (data.size() < stride){
+        return;
+    }
+
+    glm::vec3 minimum = glm::vec3(data[0], data[1], data[2]);
+    glm::vec3 maximum = minimum;
+    for (unsigned int i = 0; i + 2 < data.size(); i += stride){
+        glm::vec3 position = glm::vec3(data[i], data[i + 1], data[i + 2]);
+        minimum = glm::min(minimum, position);
+        maximum = glm::max(maximum, position);
+    }
+
+    this->boundingCenter = (minimum + maximum) * 0.5f;
+    this->boundingRadius = 0.0f;
+    for (unsigned int i = 0; i + 2 < data.size(); i += stride){
+        glm::vec3 position = glm::vec3(data[i], data[i + 1], data[i + 2]);
+        this->boundingRadius = std::max(this->boundingRadius, glm::length(position - this->boundingCenter));
+    }
+
+}
+
+
+// size and quality of a texture compressed on its load
+static void PrintCompression(const std::string& cachePath, const CompressedTexture& texture,
+                             const TextureCompressionStatistics& statistics){
+
+    std::printf("Compressed %s: %s, %.2f -> %.2f MB, %.1f dB PSNR, %.0f ms\n", cachePath.c_str(),
+                TextureCompressor::GetFormatName(texture.format), statistics.uncompressedBytes / 1048576.0,
+                statistics.compressedBytes / 1048576.0, statistics.psnr, statistics.miliseconds);
+
+}
+
+
+// levels loaded with the texture - up to the initial size if the finer ones are streamed, 0 = all
+static unsigned int GetLoadedLevelSize(){
+    return gScene.textureStreamer != nullptr ? TextureStreamer::initialLevelSize : 0;
+}
+
+
+// a texture compressed now starts with the same levels as a loaded one
+static void DropStreamedLevels(CompressedTexture& texture){
+
+    unsigned int maxLevelSize = GetLoadedLevelSize();
+    for (CompressedLevel& level : texture.levels){
+        if (maxLevelSize > 0 && std::max(level.width, level.height) > maxLevelSize){
+            std::vector<uint8_t>().swap(level.data);
+        }
+    }
+
+}
+
+
+// normal and height map packed into one image, false if they can not be loaded or differ in size
+static bool LoadPackedMaterialImage(const std::string& normalPath, const std::string& heightPath, bool inverseH,
+                                    TextureImage& image){
+
+    std::vector<std::string> sources = {normalPath, heightPath};
+    std::string cachePath = TextureCache::GetMaterialCachePath(normalPath, inverseH);
+
+    image.compressed = gScene.TextureCompression;
+    image.cachePath = cachePath;
+    if (image.compressed && TextureCache::Load(cachePath, sources, image.blocks, GetLoadedLevelSize())){
+        image.width = image.blocks.width;
+        image.height = image.blocks.height;
+        return true;
+    }
+
+    int normalWidth, normalHeight, normalComponents;
+    int heightWidth, heightHeight, heightComponents;
+    unsigned char* normalData = stbi_load(normalPath.c_str(), &normalWidth, &normalHeight, &normalComponents, 0);
+    unsigned char* heightData = stbi_load(heightPath.c_str(), &heightWidth, &heightHeight, &heightComponents, 0);
+
+    if (normalData == nullptr || heightData == nullptr || normalWidth != heightWidth || normalHeight != heightHeight){
+        std::cout << "Material " << normalPath << " and " << heightPath << " can not be packed" << std::endl;
+        stbi_image_free(normalData);
+        stbi_image_free(heightData);
+        return false;
+    }
+
+    image.width = normalWidth;
+    image.height = normalHeight;
+    image.format = GL_RGBA;
+    image.pixels = TextureCompressor::PackMaterial(normalData, normalComponents, heightData, heightComponents,
+                                                   normalWidth, normalHeight, inverseH);
+    stbi_image_free(normalData);
+    stbi_image_free(heightData);
+
+    if (image.compressed){
+
+        TextureCompressionStatistics statistics;
+        image.blocks = TextureCompressor::Compress(image.pixels.data(), image.width, image.height, 4, TEXTURE_MATERIAL,
+                                                   gScene.jobSystem, &statistics);
+        TextureCache::Save(cachePath, sources, image.blocks);
+        PrintCompression(cachePath, image.blocks, statistics);
+        DropStreamedLevels(image.blocks);
+        image.pixels.clear();
+    }
+
+    return true;
+}
+
+
+// texture of a file ready for the upload - block compressed (from the KTX2 file or compressed now) or its pixels
+static bool LoadTextureImage(const std::string& texturePath, unsigned int textureType, bool inverseH, TextureImage& image){
+
+    // block compressed copy of the file, built on the first load
+    image.compressed = gScene.TextureCompression;
+    image.cachePath = TextureCache::GetCachePath(texturePath, inverseH);
+    if (image.compressed && TextureCache::Load(texturePath, inverseH, image.blocks, GetLoadedLevelSize())){
+        image.width = image.blocks.width;
+        image.height = image.blocks.height;
+        return true;
+    }
+
+    // load the texture
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(texturePath.c_str(), &width, &height, &nrComponents, 0);
+
+    // check if the texture was loaded correctly
+    if (data == nullptr){
+        std::cout << "Texture failed to load at path: " << texturePath << std::endl;
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+
+    // height maps are uploaded as one channel (and inverted on the way)
+    if (textureType == 2){
+        HeightMapOptions options;
+        options.invert = inverseH;
+        image.pixels = HeightMapProcessor::ConvertR8(data, width, height, nrComponents, options, gScene.jobSystem);
+        nrComponents = 1;
+    }
+    else{
+        image.pixels.assign(data, data + static_cast<size_t>(width) * height * nrComponents);
+    }
+    stbi_image_free(data);
+
+    // check what format the texture is
+    if (nrComponents == 1)
+        image.format = GL_RED;
+    else if (nrComponents == 2)
+        image.format = GL_RG;
+    else if (nrComponents == 3)
+        image.format = GL_RGB;
+    else if (nrComponents == 4)
+        image.format = GL_RGBA;
+
+    if (image.compressed){
+
+        TextureCompressionStatistics statistics;
+        image.blocks = TextureCompressor::Compress(image.pixels.data(), width, height, nrComponents,
+                                                   static_cast<TextureUsage>(textureType), gScene.jobSystem, &statistics);
+        TextureCache::Save(texturePath, inverseH, image.blocks);
+        PrintCompression(image.cachePath, image.blocks, statistics);
+        DropStreamedLevels(image.blocks);
+        image.pixels.clear();
+    }
+
+    return true;
 }
 
 
@@ -261,81 +764,197 @@ void Object::UploadVertices(std::vector<GLfloat> data, std::vector<GLuint> indic
  * 
  * @param texturePath path to the texture file
  * @param textureType type of the texture (diffuse=0, normal=1, height=2)
+ * @param inverseH the height map is inverted (255 - height)
  * 
  * @return void
 */
 void Object::LoadTexture(const std::string& texturePath, unsigned int textureType, bool inverseH){
 
-    // load the texture
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(texturePath.c_str(), &width, &height, &nrComponents, 0);
-
     // specify the ID
-    Texture *targetTexture = nullptr;
+    std::shared_ptr<Texture> *targetTexture = nullptr;
     if (textureType == 0)
-        targetTexture = this->diffuseTex;
+        targetTexture = &this->diffuseTex;
     else if (textureType == 1)
-        targetTexture = this->normalTex;
+        targetTexture = &this->normalTex;
     else if (textureType == 2)
-        targetTexture = this->heightTex;
+        targetTexture = &this->heightTex;
+
+    // the same file was already loaded by another object - share it (allows batching)
+    std::string key = texturePath + (inverseH ? "|inverse" : "");
+    std::shared_ptr<Texture> cached = textureCache[key].lock();
+    if (cached != nullptr){
+        *targetTexture = cached;
+        return;
+    }
 
-    // check if the texture was loaded correctly
-    if (data)
-    {
-        // check what format the texture is
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        if (inverseH){ // should inverse the heightmap
-            for (int i = 0; i < width * height * nrComponents; i += nrComponents)
-            {
-                data[i] = 1 - data[i];
+    TextureImage image;
+    if (LoadTextureImage(texturePath, textureType, inverseH, image)){
+        (*targetTexture)->Load(image);
+        textureCache[key] = *targetTexture;
+        if (gScene.textureStreamer != nullptr){
+            gScene.textureStreamer->Register(**targetTexture, image);
+        }
+    }
+
+}
+
+
+/**
+ * Load the normal map and the height map of the object. With PackedMaterials both go into one texture
+ * (normal x and y, height in alpha) read by the PACKED_MATERIAL variant of the shaders
+ *
+ * @param normalPath path to the normal map
+ * @param heightPath path to the height map
+ * @param inverseH the height map is inverted (applied when the material is packed)
+ *
+ * @return void
+*/
+void Object::LoadMaterial(const std::string& normalPath, const std::string& heightPath, bool inverseH){
+
+    std::shared_ptr<Texture> packed = nullptr;
+
+    if (gScene.PackedMaterials){
+
+        // shared with the objects of the same material
+        std::string key = normalPath + "|" + heightPath + (inverseH ? "|inverse" : "");
+        packed = textureCache[key].lock();
+        TextureImage image;
+        if (packed == nullptr && LoadPackedMaterialImage(normalPath, heightPath, inverseH, image)){
+            packed = std::make_shared<Texture>();
+            packed->Load(image);
+            textureCache[key] = packed;
+            if (gScene.textureStreamer != nullptr){
+                gScene.textureStreamer->Register(*packed, image);
             }
-        
         }
+    }
+
+    // separate textures if the material is not packed or can not be
+    if (packed == nullptr){
+        LoadTexture(normalPath, 1, false);
+        LoadTexture(heightPath, 2, inverseH);
+        return;
+    }
+
+    this->normalTex = packed;
+    this->heightTex = nullptr;
+    this->packedMaterial = true;
+
+    // the shaders read the height from the normal map
+    this->shader = GetSharedShader(this->vertexShaderPath, this->fragmentShaderPath, GetShaderDefines());
+    this->gbufferShader = nullptr;
+
+}
+
+
+std::shared_ptr<MaterialArray> Object::LoadMaterialArray(const std::vector<MaterialFiles>& materials){
+
+    std::vector<TextureImage> diffuse(materials.size()), normal(materials.size()), height(materials.size());
+    bool packed = gScene.PackedMaterials;
+
+    for (unsigned int i = 0; i < materials.size(); i++){
+
+        const MaterialFiles& material = materials[i];
+
+        if (!LoadTextureImage(material.diffuse, 0, false, diffuse[i])){
+            return nullptr;
+        }
+
+        // every layer packed or none (one shader for the arrays)
+        if (packed && !LoadPackedMaterialImage(material.normal, material.height, material.inverseH, normal[i])){
+            return nullptr;
+        }
+        if (!packed && (!LoadTextureImage(material.normal, 1, false, normal[i]) ||
+                        !LoadTextureImage(material.height, 2, material.inverseH, height[i]))){
+            return nullptr;
+        }
+    }
 
-        // load data to gpu
-        targetTexture->LoadData(width, height, data, format);
+    std::shared_ptr<MaterialArray> array = std::make_shared<MaterialArray>();
+    array->packed = packed;
 
-        stbi_image_free(data);
+    if (!array->diffuse.Load(diffuse) || !array->normal.Load(normal) || (!packed && !array->height.Load(height))){
+        return nullptr;
     }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << texturePath << std::endl;
-        stbi_image_free(data);
+
+    if (gScene.textureStreamer != nullptr){
+        gScene.textureStreamer->Register(array->diffuse, diffuse);
+        gScene.textureStreamer->Register(array->normal, normal);
+        if (!packed){
+            gScene.textureStreamer->Register(array->height, height);
+        }
     }
 
+    return array;
 }
 
 
+void Object::SetMaterialArray(const std::shared_ptr<MaterialArray>& materials, unsigned int layer){
+
+    this->materialArray = materials;
+    this->materialLayer = layer;
+    this->packedMaterial = materials->packed;
 
-////////////////////////////////////// pipeline uploaders ///////////////////////////////////////
+    // the own textures are not used
+    this->diffuseTex = nullptr;
+    this->normalTex = nullptr;
+    this->heightTex = nullptr;
 
-void Object::Upload_Material_Pipeline(Shader* shader){
+    this->shader = GetSharedShader(this->vertexShaderPath, this->fragmentShaderPath, GetShaderDefines());
+    this->gbufferShader = nullptr;
 
-    // upload ambient, diffusion and specular
-    shader->Upload_Uniform3f_Pipeline("objectMaterial.Ka", this->Ka.x, 
-                                                           this->Ka.y, 
-                                                           this->Ka.z);
+}
 
-    shader->Upload_Uniform3f_Pipeline("objectMaterial.Kd", this->Kd.x, 
-                                                             this->Kd.y, 
-                                                             this->Kd.z);
 
-    shader->Upload_Uniform3f_Pipeline("objectMaterial.Ks", this->Ks.x, 
-                                                             this->Ks.y, 
-                                                             this->Ks.z);
+void Object::SetVirtualTexture(VirtualTexture* virtualTexture){
+
+    this->virtualTexture = virtualTexture;
+    this->materialArray = nullptr;
+    this->materialLayer = 0;
+    this->packedMaterial = false;
+
+    // the own textures are not used
+    this->diffuseTex = nullptr;
+    this->normalTex = nullptr;
+    this->heightTex = nullptr;
+
+    this->shader = GetSharedShader(this->vertexShaderPath, this->fragmentShaderPath, GetShaderDefines());
+    this->gbufferShader = nullptr;
+
+}
+
+
+std::string Object::GetShaderDefines() const{
+    return gScene.meshBuffer->GetShaderDefines() + (this->packedMaterial ? "#define PACKED_MATERIAL\n" : "") +
+           (this->materialArray != nullptr ? "#define MATERIAL_ARRAY\n" : "") +
+           (this->virtualTexture != nullptr ? "#define VIRTUAL_TEXTURE\n" : "") +
+           (UsesBindless() ? "#define BINDLESS\n" : "");
+}
+
+
+bool Object::UsesBindless() const{
+    return gScene.materialTable != nullptr && this->virtualTexture == nullptr;
+}
+
+
+void Object::RegisterMaterial(MaterialTable& table){
+
+    // the virtual texture keeps its bound textures
+    if (this->virtualTexture != nullptr){
+        return;
+    }
+
+    if (this->materialArray != nullptr){
+        this->materialIndex = table.Add(this->materialArray.get());
+        return;
+    }
+
+    this->materialIndex = table.Add(this->diffuseTex.get(), this->normalTex.get(),
+                                    this->packedMaterial ? nullptr : this->heightTex.get());
 
-    // upload shininess
-    shader->Upload_Uniform1f_Pipeline("objectMaterial.shininess", this->shininess);
-    
 }
 
+
 ////////////////////////////////////////////////////// setters //////////////////////////////////////////
 
 void Object::SetTranslation(const glm::vec3 &newTranslation){
@@ -364,6 +983,24 @@ void Object::SetScale(const glm::vec3 &scale){
 }
 
 
+glm::mat4 Object::GetModelMatrix() const{
+
+    // Model transformation by translating our object into world space
+    glm::mat4 model = glm::mat4(1.0f);
+
+    // translation
+    model = glm::translate(model, glm::vec3(this->translation.x, this->translation.y, this->translation.z));
+
+    // rotation
+    model = glm::rotate(model, glm::radians(this->rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f)); // x
+    model = glm::rotate(model, glm::radians(this->rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f)); // y
+    model = glm::rotate(model, glm::radians(this->rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f)); // z
+
+    // scale
+    return glm::scale(model, this->scale);
+}
+
+
 glm::vec3 & Object::GetTranslation(){
 
     return this->translation;
@@ -394,6 +1031,10 @@ void Object::SetParallaxMethod(int parallaxMethod){
 
 }
 
+int Object::GetParallaxMethod() const{
+    return this->parallaxMethod;
+}
+
 void Object::SetContinuousTexture(int continuousTexture){
     this->continuousTexture = continuousTexture;
 }
\ No newline at end of file
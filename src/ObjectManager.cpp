@@ -1,4 +1,6 @@
 #include "ObjectManager.hpp"
+#include "Profiler.hpp"
+#include "Scene.hpp"
 
 ObjectManager::ObjectManager(){ }
 
@@ -13,14 +15,61 @@ ObjectManager::~ObjectManager(){
 
 void ObjectManager::AddObject(Object *object){
 
+    // default name for the profiler
+    if (object->name == ""){
+        object->name = "object " + std::to_string(objects.size());
+    }
+
     objects.push_back(object);
 }
 
-void ObjectManager::RenderAllObjects(){
+void ObjectManager::RenderAllObjects(const FrameContext& context){
+
+    this->renderQueue.cullingMode = gScene.CullingMode;
+    this->renderQueue.occlusionCulling = gScene.OcclusionCulling;
+    this->renderQueue.multiDraw = gScene.MultiDrawIndirect;
+    this->renderQueue.depthPrepass = context.gbufferPass && gScene.DepthPrepass;
+
+    // handles of the bindless materials (a streamed texture gets a new one) - objects are only added during the
+    // initialization, their materials are registered once
+    if (gScene.materialTable != nullptr){
 
-    for (auto &object : objects){   // render all objects
-        object->Draw();
+        if (this->registeredMaterials != this->objects.size()){
+            for (Object* object : this->objects){
+                object->RegisterMaterial(*gScene.materialTable);
+            }
+            this->registeredMaterials = this->objects.size();
+        }
+
+        ProfileScope scope("materials");
+        gScene.materialTable->Update();
+    }
+
+    // culling, sort keys and per-draw uniforms in parallel
+    {
+        ProfileScope scope("prepare");
+        this->renderQueue.Build(this->objects, context, gScene.jobSystem);
     }
 
+    // GL calls on this thread only
+    this->renderQueue.Submit(context, *gScene.meshBuffer);
+
 }
 
+void ObjectManager::EndFrame(){
+    this->renderQueue.EndFrame();
+}
+
+const RenderStatistics& ObjectManager::GetRenderStatistics() const{
+    return this->renderQueue.GetStatistics();
+}
+
+void ObjectManager::OverrideParallaxMethod(int parallaxMethod){
+
+    for (auto &object : objects){
+        if (object->GetParallaxMethod() != -1){ // object is rendered with the parallax shader
+            object->SetParallaxMethod(parallaxMethod);
+        }
+    }
+
+}
@@ -384,3 +384,189 @@ void ObjectParser::Compute_tangents_bitangets(std::vector<GLfloat> &data, std::v
 
 
 
+
+
+// encodes the vertices into 20 bytes:
+//      position    4 x unorm16 - quantized in the bounding box, w = sign of the bitangent
+//      normal      2 x snorm16 - octahedral
+//      tangent     2 x snorm16 - octahedral
+//      uv          2 x half
+// the bitangent is rebuilt in the shader as cross(normal, tangent) * sign
+PositionQuantization ObjectParser::Pack_Vertices(const std::vector<GLfloat> &data, std::vector<PackedVertex> &packed){
+
+    const unsigned int stride = 14;
+    unsigned int numberOfVertices = data.size() / stride;
+
+    PositionQuantization quantization;
+    packed.resize(numberOfVertices);
+
+    if (numberOfVertices == 0){
+        return quantization;
+    }
+
+    // bounding box of the positions
+    glm::vec3 minimum(data[0], data[1], data[2]);
+    glm::vec3 maximum = minimum;
+    for (unsigned int i = 0; i < numberOfVertices; i++){
+        glm::vec3 position(data[i*stride], data[i*stride + 1], data[i*stride + 2]);
+        minimum = glm::min(minimum, position);
+        maximum = glm::max(maximum, position);
+    }
+
+    quantization.offset = minimum;
+    quantization.scale = maximum - minimum;     // flat axes keep scale 0
+
+    for (unsigned int i = 0; i < numberOfVertices; i++){
+
+        const GLfloat* vertex = &data[i*stride];
+        PackedVertex& result = packed[i];
+
+        for (int axis = 0; axis < 3; axis++){
+            float normalized = 0.0f;
+            if (quantization.scale[axis] > 0.0f){
+                normalized = (vertex[axis] - quantization.offset[axis]) / quantization.scale[axis];
+            }
+            result.position[axis] = static_cast<uint16_t>(std::round(glm::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+        }
+
+        glm::vec3 normal(vertex[3], vertex[4], vertex[5]);
+        glm::vec3 tangent(vertex[8], vertex[9], vertex[10]);
+        glm::vec3 bitangent(vertex[11], vertex[12], vertex[13]);
+
+        // handedness of the tangent frame
+        result.position[3] = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? 0 : 65535;
+
+        Encode_Octahedral(normal, result.normal);
+        Encode_Octahedral(tangent, result.tangent);
+
+        result.texCoords[0] = Encode_HalfFloat(vertex[6]);
+        result.texCoords[1] = Encode_HalfFloat(vertex[7]);
+    }
+
+    return quantization;
+}
+
+
+// maps the unit sphere onto the octahedron and unfolds it into a square
+void ObjectParser::Encode_Octahedral(const glm::vec3 &vector, int16_t *encoded){
+
+    float length = std::abs(vector.x) + std::abs(vector.y) + std::abs(vector.z);
+
+    if (length == 0.0f){    // no tangent (mesh without texture coordinates)
+        encoded[0] = 0;
+        encoded[1] = 0;
+        return;
+    }
+
+    glm::vec3 v = vector / length;
+    glm::vec2 e(v.x, v.y);
+
+    // fold the lower hemisphere over the diagonals
+    if (v.z < 0.0f){
+        e.x = (1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f);
+        e.y = (1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    encoded[0] = static_cast<int16_t>(std::round(glm::clamp(e.x, -1.0f, 1.0f) * 32767.0f));
+    encoded[1] = static_cast<int16_t>(std::round(glm::clamp(e.y, -1.0f, 1.0f) * 32767.0f));
+
+}
+
+
+// same as DecodeOctahedral in the vertex shaders
+glm::vec3 ObjectParser::Decode_Octahedral(const int16_t *encoded){
+
+    glm::vec2 e(std::max(encoded[0] / 32767.0f, -1.0f), std::max(encoded[1] / 32767.0f, -1.0f));
+    glm::vec3 v(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+
+    float t = std::max(-v.z, 0.0f);
+    v.x += v.x >= 0.0f ? -t : t;
+    v.y += v.y >= 0.0f ? -t : t;
+
+    return glm::normalize(v);
+}
+
+
+uint16_t ObjectParser::Encode_HalfFloat(float value){
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF){    // inf / nan
+        return sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0);
+    }
+
+    if (exponent >= 31){    // too large - infinity
+        return sign | 0x7C00;
+    }
+
+    if (exponent <= 0){     // denormal or zero
+
+        if (exponent < -10){
+            return sign;
+        }
+
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+
+        // round to nearest even
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))){
+            half++;
+        }
+
+        return sign | half;
+    }
+
+    uint32_t half = (exponent << 10) | (mantissa >> 13);
+
+    // round to nearest even (a carry moves to the exponent, which is correct)
+    uint32_t remainder = mantissa & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))){
+        half++;
+    }
+
+    return sign | static_cast<uint16_t>(half);
+}
+
+
+float ObjectParser::Decode_HalfFloat(uint16_t value){
+
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0){
+
+        if (mantissa == 0){
+            bits = sign;
+        }
+        else{   // denormal - normalize it
+            exponent = 1;
+            while ((mantissa & 0x400) == 0){
+                mantissa <<= 1;
+                exponent--;
+            }
+            mantissa &= 0x3FF;
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+    }
+    else if (exponent == 31){
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else{
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+
+    return result;
+}
@@ -0,0 +1,385 @@
+#include "PageFile.hpp"
+#include "HeightMap.hpp"
+#include "stb_image.h"
+
+// STL
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+
+PageFile::~PageFile(){
+    Close();
+}
+
+
+bool PageFile::Open(const std::string& path){
+
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE){
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr){
+        if (mapping != nullptr){
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+    this->fileHandle = file;
+    this->mappingHandle = mapping;
+    this->fileSize = static_cast<size_t>(size.QuadPart);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0){
+        return false;
+    }
+    struct stat status;
+    void* view = fstat(file, &status) == 0 && status.st_size > 0 ?
+                 mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    if (view == MAP_FAILED){
+        close(file);
+        return false;
+    }
+    // the pages are read in the order they are requested
+    madvise(view, status.st_size, MADV_RANDOM);
+    this->fileDescriptor = file;
+    this->fileSize = static_cast<size_t>(status.st_size);
+#endif
+
+    this->data = static_cast<const uint8_t*>(view);
+
+    // header and size of the page data
+    bool valid = this->fileSize >= sizeof(PageFileHeader);
+    if (valid){
+        std::memcpy(&this->header, this->data, sizeof(PageFileHeader));
+        valid = std::memcmp(this->header.identifier, "VTEX", 4) == 0 && this->header.version == 1 &&
+                this->header.pageSize > 0 && this->header.numberOfLevels > 0 && this->header.numberOfLevels < 32;
+    }
+    if (valid){
+        ComputeLevels();
+        valid = this->firstPages.back() == this->header.numberOfPages &&
+                this->fileSize >= sizeof(PageFileHeader) + this->header.numberOfPages * GetPageBytes();
+    }
+
+    if (!valid){
+        std::cout << "Not a valid page file: " << path << std::endl;
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+
+void PageFile::Close(){
+
+    if (this->data == nullptr){
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(this->data);
+    CloseHandle(static_cast<HANDLE>(this->mappingHandle));
+    CloseHandle(static_cast<HANDLE>(this->fileHandle));
+    this->fileHandle = nullptr;
+    this->mappingHandle = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(this->data), this->fileSize);
+    close(this->fileDescriptor);
+    this->fileDescriptor = -1;
+#endif
+
+    this->data = nullptr;
+    this->fileSize = 0;
+
+}
+
+
+bool PageFile::IsOpen() const{
+    return this->data != nullptr;
+}
+
+
+const uint8_t* PageFile::GetPage(uint32_t pageID) const{
+    return this->data + sizeof(PageFileHeader) + pageID * GetPageBytes();
+}
+
+
+const PageFileHeader& PageFile::GetHeader() const{
+    return this->header;
+}
+
+
+uint32_t PageFile::GetPagesPerSide(uint32_t level) const{
+    return std::max((this->header.size / this->header.pageSize) >> level, 1u);
+}
+
+
+uint32_t PageFile::GetFirstPage(uint32_t level) const{
+    return this->firstPages[level];
+}
+
+
+uint32_t PageFile::GetPageTexels() const{
+    return this->header.pageSize + 2 * this->header.border;
+}
+
+
+size_t PageFile::GetPageBytes() const{
+    return static_cast<size_t>(GetPageTexels()) * GetPageTexels() * 4 * this->header.numberOfLayers;
+}
+
+
+// first page of every level, the last entry is the number of pages
+void PageFile::ComputeLevels(){
+
+    this->firstPages.assign(this->header.numberOfLevels + 1, 0);
+    for (uint32_t level = 0; level < this->header.numberOfLevels; level++){
+        uint32_t pages = GetPagesPerSide(level);
+        this->firstPages[level + 1] = this->firstPages[level] + pages * pages;
+    }
+
+}
+
+
+    ///////////// building /////////////
+
+// mip chain of a source texture (RGBA8, the levels are box filtered)
+struct SourceLevel{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+
+static std::vector<SourceLevel> BuildSourceChain(std::vector<uint8_t> rgba, unsigned int width, unsigned int height){
+
+    std::vector<SourceLevel> chain;
+    chain.push_back({width, height, std::move(rgba)});
+
+    while (chain.back().width > 1 || chain.back().height > 1){
+
+        const SourceLevel& previous = chain.back();
+        SourceLevel next;
+        next.width = std::max(previous.width / 2, 1u);
+        next.height = std::max(previous.height / 2, 1u);
+        next.rgba.resize(static_cast<size_t>(next.width) * next.height * 4);
+
+        for (unsigned int y = 0; y < next.height; y++){
+            for (unsigned int x = 0; x < next.width; x++){
+                for (unsigned int c = 0; c < 4; c++){
+                    unsigned int sum = 0;
+                    for (unsigned int i = 0; i < 4; i++){
+                        unsigned int sx = std::min(2 * x + i % 2, previous.width - 1);
+                        unsigned int sy = std::min(2 * y + i / 2, previous.height - 1);
+                        sum += previous.rgba[(static_cast<size_t>(sy) * previous.width + sx) * 4 + c];
+                    }
+                    next.rgba[(static_cast<size_t>(y) * next.width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+
+        chain.push_back(std::move(next));
+    }
+
+    return chain;
+}
+
+
+// bilinear sample of a level (repeating) at the texture coordinate
+static void SampleLevel(const SourceLevel& level, float u, float v, float result[4]){
+
+    float x = u * level.width - 0.5f;
+    float y = v * level.height - 0.5f;
+    float fx = x - std::floor(x);
+    float fy = y - std::floor(y);
+    int x0 = static_cast<int>(std::floor(x));
+    int y0 = static_cast<int>(std::floor(y));
+
+    for (unsigned int c = 0; c < 4; c++){
+        result[c] = 0.0f;
+    }
+
+    for (unsigned int i = 0; i < 4; i++){
+        int sx = ((x0 + static_cast<int>(i % 2)) % static_cast<int>(level.width) + level.width) % level.width;
+        int sy = ((y0 + static_cast<int>(i / 2)) % static_cast<int>(level.height) + level.height) % level.height;
+        float weight = (i % 2 ? fx : 1.0f - fx) * (i / 2 ? fy : 1.0f - fy);
+        const uint8_t* texel = &level.rgba[(static_cast<size_t>(sy) * level.width + sx) * 4];
+        for (unsigned int c = 0; c < 4; c++){
+            result[c] += weight * texel[c];
+        }
+    }
+
+}
+
+
+// texel of a virtual level with levelSize texels per side - from the source level closest to its size
+static void SampleChain(const std::vector<SourceLevel>& chain, uint32_t levelSize, int x, int y, float result[4]){
+
+    unsigned int level = 0;
+    while (level + 1 < chain.size() && chain[level + 1].width >= levelSize){
+        level++;
+    }
+
+    float u = (x + 0.5f) / levelSize;
+    float v = (y + 0.5f) / levelSize;
+    SampleLevel(chain[level], u, v, result);
+
+}
+
+
+static bool LoadSource(const std::string& path, int desiredChannels, std::vector<uint8_t>& rgba,
+                       unsigned int& width, unsigned int& height){
+
+    int w, h, channels;
+    unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &channels, desiredChannels);
+    if (pixels == nullptr){
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        return false;
+    }
+
+    width = w;
+    height = h;
+    rgba.assign(pixels, pixels + static_cast<size_t>(w) * h * desiredChannels);
+    stbi_image_free(pixels);
+
+    return true;
+}
+
+
+bool PageFile::Build(const std::string& path, const std::string& albedoPath, const std::string& normalPath,
+                     const std::string& heightPath, uint32_t size, bool inverseH, JobSystem* jobSystem){
+
+    // sources as RGBA8 - the height goes into the alpha of the albedo
+    std::vector<uint8_t> albedo, normal, heightPixels;
+    unsigned int albedoWidth, albedoHeight, normalWidth, normalHeight, heightWidth, heightHeight;
+    if (!LoadSource(albedoPath, 4, albedo, albedoWidth, albedoHeight) ||
+        !LoadSource(normalPath, 4, normal, normalWidth, normalHeight) ||
+        !LoadSource(heightPath, 1, heightPixels, heightWidth, heightHeight)){
+        return false;
+    }
+
+    HeightMapOptions options;
+    options.invert = inverseH;
+    std::vector<uint8_t> heights = HeightMapProcessor::ConvertR8(heightPixels.data(), heightWidth, heightHeight, 1,
+                                                                 options, jobSystem);
+
+    // the height map has its own chain (its size may differ from the albedo)
+    std::vector<uint8_t> heightRGBA(heights.size() * 4, 0);
+    for (size_t i = 0; i < heights.size(); i++){
+        heightRGBA[4 * i] = heights[i];
+    }
+
+    std::vector<SourceLevel> albedoChain = BuildSourceChain(std::move(albedo), albedoWidth, albedoHeight);
+    std::vector<SourceLevel> normalChain = BuildSourceChain(std::move(normal), normalWidth, normalHeight);
+    std::vector<SourceLevel> heightChain = BuildSourceChain(std::move(heightRGBA), heightWidth, heightHeight);
+
+    PageFile layout;
+    layout.header.size = size;
+    layout.header.sourceSize = albedoWidth;
+    uint32_t pagesPerSide = size / layout.header.pageSize;
+    if (pagesPerSide == 0 || pagesPerSide * layout.header.pageSize != size || (pagesPerSide & (pagesPerSide - 1)) != 0){
+        std::cout << "The size of a virtual texture has to be " << layout.header.pageSize
+                  << " texels times a power of two" << std::endl;
+        return false;
+    }
+    while ((pagesPerSide >> layout.header.numberOfLevels) > 0){
+        layout.header.numberOfLevels++;
+    }
+    layout.ComputeLevels();
+    layout.header.numberOfPages = layout.firstPages.back();
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file){
+        std::cout << "Can not write " << path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&layout.header), sizeof(PageFileHeader));
+
+    const uint32_t pageSize = layout.header.pageSize;
+    const uint32_t border = layout.header.border;
+    const uint32_t pageTexels = layout.GetPageTexels();
+    const size_t layerBytes = static_cast<size_t>(pageTexels) * pageTexels * 4;
+
+    // pages are sampled in parallel in groups and written in order
+    const uint32_t groupPages = 64;
+    std::vector<uint8_t> group(groupPages * layout.GetPageBytes());
+
+    for (uint32_t level = 0; level < layout.header.numberOfLevels; level++){
+
+        uint32_t levelPages = layout.GetPagesPerSide(level);
+        uint32_t levelSize = levelPages * pageSize;
+        uint32_t numberOfPages = levelPages * levelPages;
+
+        for (uint32_t first = 0; first < numberOfPages; first += groupPages){
+
+            uint32_t count = std::min(groupPages, numberOfPages - first);
+
+            auto pageJob = [&](unsigned int begin, unsigned int end, unsigned int){
+                for (unsigned int i = begin; i < end; i++){
+
+                    uint32_t page = first + i;
+                    int pageX = page % levelPages;
+                    int pageY = page / levelPages;
+                    uint8_t* albedoLayer = &group[i * layout.GetPageBytes()];
+                    uint8_t* normalLayer = albedoLayer + layerBytes;
+
+                    for (uint32_t ty = 0; ty < pageTexels; ty++){
+                        for (uint32_t tx = 0; tx < pageTexels; tx++){
+
+                            // the border repeats the neighbouring pages (the texture wraps)
+                            int x = pageX * static_cast<int>(pageSize) + static_cast<int>(tx) - static_cast<int>(border);
+                            int y = pageY * static_cast<int>(pageSize) + static_cast<int>(ty) - static_cast<int>(border);
+
+                            float color[4], direction[4], height[4];
+                            SampleChain(albedoChain, levelSize, x, y, color);
+                            SampleChain(normalChain, levelSize, x, y, direction);
+                            SampleChain(heightChain, levelSize, x, y, height);
+
+                            size_t texel = (static_cast<size_t>(ty) * pageTexels + tx) * 4;
+                            albedoLayer[texel + 0] = static_cast<uint8_t>(color[0] + 0.5f);
+                            albedoLayer[texel + 1] = static_cast<uint8_t>(color[1] + 0.5f);
+                            albedoLayer[texel + 2] = static_cast<uint8_t>(color[2] + 0.5f);
+                            albedoLayer[texel + 3] = static_cast<uint8_t>(height[0] + 0.5f);
+                            normalLayer[texel + 0] = static_cast<uint8_t>(direction[0] + 0.5f);
+                            normalLayer[texel + 1] = static_cast<uint8_t>(direction[1] + 0.5f);
+                            normalLayer[texel + 2] = static_cast<uint8_t>(direction[2] + 0.5f);
+                            normalLayer[texel + 3] = 255;
+                        }
+                    }
+                }
+            };
+
+            if (jobSystem != nullptr){
+                jobSystem->ParallelFor(count, 1, pageJob);
+            }
+            else{
+                pageJob(0, count, 0);
+            }
+
+            file.write(reinterpret_cast<const char*>(group.data()), count * layout.GetPageBytes());
+        }
+    }
+
+    return static_cast<bool>(file);
+}
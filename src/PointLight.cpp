@@ -2,6 +2,8 @@
 #include "Scene.hpp"
 #include "Shader.hpp"
 
+#include <cmath>
+
 // Constructor
 PointLight::PointLight(glm::vec3 position, glm::vec3 color){
 
@@ -161,6 +163,11 @@ void PointLight::SetUpPipeLine(){
 
 void PointLight::Draw() {
 
+    // lights without a bulb (Initialize_HardCoded was not called)
+    if (this->shader == nullptr){
+        return;
+    }
+
     // setup pipeline 
     SetUpPipeLine();
 
@@ -178,33 +185,17 @@ void PointLight::Draw() {
 }
 
 
-////////////////////////////////////// pipeline uploaders ///////////////////////////////////////
-
-// Uploads point light to a scene
-// @note : only one light is supported for now
-void PointLight::Upload_PointLight_Pipeline(Shader* targetShader, unsigned int lightIndex){
-
-    std::string lightName = std::string("u_Lights[") + std::to_string(lightIndex) +
-                             std::string("].");
+void PointLight::Animate(float deltaTime){
 
-    // upload ambient, diffusion and specular
-    targetShader->Upload_Uniform1f_Pipeline((lightName + std::string(".ambientStrength")).c_str(), this->ambientStrength);
-    targetShader->Upload_Uniform1f_Pipeline((lightName + std::string("diffusionStrengh")).c_str(), this->diffusionStrengh);
-    targetShader->Upload_Uniform1f_Pipeline((lightName + std::string("specularStrengh")).c_str(), this->specularStrengh);
+    if (this->orbitSpeed == 0.0f){
+        return;
+    }
 
-    // // upload attenuation
-    targetShader->Upload_Uniform1f_Pipeline((lightName + std::string("constant")).c_str(), this->constant);
-    targetShader->Upload_Uniform1f_Pipeline((lightName + std::string("linear")).c_str(), this->linear);
-    targetShader->Upload_Uniform1f_Pipeline((lightName + std::string("quadratic")).c_str(), this->quadratic);
+    glm::vec3 offset = this->position - this->orbitCenter;
+    float angle = glm::radians(this->orbitSpeed * deltaTime);
+    float c = std::cos(angle);
+    float s = std::sin(angle);
 
-    // upload position and color
-    targetShader->Upload_Uniform3f_Pipeline((lightName + std::string("position")).c_str(), this->position.x, 
-                                                                this->position.y, 
-                                                                this->position.z);
+    this->position = this->orbitCenter + glm::vec3(c * offset.x + s * offset.z, offset.y, -s * offset.x + c * offset.z);
 
-
-    targetShader->Upload_Uniform3f_Pipeline((lightName + std::string("lightColor")).c_str(), this->color.r, 
-                                                                  this->color.g, 
-                                                                  this->color.b);
-
-}
\ No newline at end of file
+}
@@ -0,0 +1,418 @@
+#include "Profiler.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <utility>
+
+Profiler gProfiler;    // global profiler
+
+
+Profiler::Profiler(){ }
+
+Profiler::~Profiler(){ }
+
+
+void Profiler::BeginFrame(){
+
+    if (!this->enabled){
+        return;
+    }
+
+    // lazy initialization - needs SDL and the GL context
+    if (!this->clockSynchronized){
+
+        this->startCounter = SDL_GetPerformanceCounter();
+
+        // offset between the GPU and the CPU clock
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        this->gpuClockOffset = ToMiliseconds(SDL_GetPerformanceCounter()) - gpuNow / 1.0e6;
+
+        this->clockSynchronized = true;
+    }
+
+    // frames that were not ready when their slot was needed
+    ResolveLateFrames(false);
+
+    // read back the frame that used this slot FRAMES_IN_FLIGHT frames ago
+    FrameRecord& frame = this->frames[this->frameNumber % FRAMES_IN_FLIGHT];
+    if (frame.pending && !ResolveFrame(frame, false)){
+
+        // never wait for the GPU - the frame keeps its queries and is read back at one of the next frames
+        this->skippedFrames++;
+        this->lateFrames.push_back(std::move(frame));
+        frame = FrameRecord();
+    }
+
+    frame.frameNumber = this->frameNumber;
+    frame.pending = true;
+    frame.usedQueries = 0;
+    frame.scopes.clear();
+
+    this->openScopes.clear();
+    this->frameActive = true;
+
+    // the whole frame is the root scope
+    BeginScope("frame");
+
+}
+
+
+void Profiler::EndFrame(){
+
+    if (!this->frameActive){
+        return;
+    }
+
+    // close all scopes that were left open (including the root scope)
+    while (!this->openScopes.empty()){
+        EndScope(this->openScopes.back());
+    }
+
+    this->frameActive = false;
+    this->frameNumber++;
+
+}
+
+
+int Profiler::BeginScope(const char* name){
+
+    if (!this->enabled || !this->frameActive){
+        return -1;
+    }
+
+    FrameRecord& frame = this->frames[this->frameNumber % FRAMES_IN_FLIGHT];
+
+    ScopeRecord record;
+    record.nameIndex = GetNameIndex(name);
+    record.depth = this->openScopes.size();
+    record.queryBegin = GetQuery(frame);
+    record.queryEnd = GetQuery(frame);
+    record.cpuBegin = SDL_GetPerformanceCounter();
+    record.cpuEnd = record.cpuBegin;
+
+    glQueryCounter(record.queryBegin, GL_TIMESTAMP);
+
+    frame.scopes.push_back(record);
+
+    int scope = frame.scopes.size() - 1;
+    this->openScopes.push_back(scope);
+
+    return scope;
+}
+
+
+void Profiler::EndScope(int scope){
+
+    if (scope < 0 || !this->frameActive){
+        return;
+    }
+
+    FrameRecord& frame = this->frames[this->frameNumber % FRAMES_IN_FLIGHT];
+    ScopeRecord& record = frame.scopes[scope];
+
+    glQueryCounter(record.queryEnd, GL_TIMESTAMP);
+    record.cpuEnd = SDL_GetPerformanceCounter();
+
+    // scopes are closed in reverse order
+    if (!this->openScopes.empty() && this->openScopes.back() == scope){
+        this->openScopes.pop_back();
+    }
+
+}
+
+
+GLuint Profiler::GetQuery(FrameRecord& frame){
+
+    // allocate new queries only when the frame needs more than ever before
+    if (frame.usedQueries == frame.queries.size()){
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+
+    return frame.queries[frame.usedQueries++];
+}
+
+
+bool Profiler::ResolveFrame(FrameRecord& frame, bool wait){
+
+    if (frame.scopes.empty()){
+        frame.pending = false;
+        return true;
+    }
+
+    // the end of the root scope is the last query the GPU writes in the frame
+    if (!wait){
+        GLint available = 0;
+        glGetQueryObjectiv(frame.scopes[0].queryEnd, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available){
+            return false;
+        }
+    }
+
+    frame.pending = false;
+
+    ProfileFrame result;
+    result.frameNumber = frame.frameNumber;
+
+    // accumulated times per name (a name can be used by several scopes)
+    std::vector<double> cpuTimes(this->names.size(), 0.0);
+    std::vector<double> gpuTimes(this->names.size(), 0.0);
+    std::vector<int> depths(this->names.size(), -1);
+
+    for (const ScopeRecord& record : frame.scopes){
+
+        GLuint64 gpuBegin = 0, gpuEnd = 0;
+        glGetQueryObjectui64v(record.queryBegin, GL_QUERY_RESULT, &gpuBegin);
+        glGetQueryObjectui64v(record.queryEnd, GL_QUERY_RESULT, &gpuEnd);
+
+        ProfileSample sample;
+        sample.nameIndex = record.nameIndex;
+        sample.depth = record.depth;
+        sample.cpuBegin = ToMiliseconds(record.cpuBegin);
+        sample.cpuTime = ToMiliseconds(record.cpuEnd) - sample.cpuBegin;
+        sample.gpuBegin = gpuBegin / 1.0e6 + this->gpuClockOffset;
+        sample.gpuTime = gpuEnd > gpuBegin ? (gpuEnd - gpuBegin) / 1.0e6 : 0.0;
+
+        cpuTimes[sample.nameIndex] += sample.cpuTime;
+        gpuTimes[sample.nameIndex] += sample.gpuTime;
+        depths[sample.nameIndex] = sample.depth;
+
+        if (this->capturing){
+            this->traceEvents.push_back({ sample.nameIndex, false, sample.cpuBegin, sample.cpuTime });
+            this->traceEvents.push_back({ sample.nameIndex, true, sample.gpuBegin, sample.gpuTime });
+        }
+
+        result.samples.push_back(sample);
+    }
+
+    // update the rolling statistics
+    for (unsigned int i = 0; i < this->names.size(); i++){
+
+        if (depths[i] < 0){ // scope was not used in this frame
+            continue;
+        }
+
+        ScopeHistory& history = this->histories[i];
+        unsigned int slot = history.count % PROFILER_HISTORY;
+        history.cpuTimes[slot] = cpuTimes[i];
+        history.gpuTimes[slot] = gpuTimes[i];
+        history.depth = depths[i];
+        history.count++;
+    }
+
+    if (this->keepFrames){
+        this->resolvedFrames.push_back(result);
+    }
+
+    return true;
+}
+
+
+void Profiler::ResolveLateFrames(bool wait){
+
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < this->lateFrames.size(); i++){
+
+        FrameRecord& frame = this->lateFrames[i];
+        if (!ResolveFrame(frame, wait)){
+            if (kept != i){
+                this->lateFrames[kept] = std::move(frame);
+            }
+            kept++;
+            continue;
+        }
+
+        if (!frame.queries.empty()){
+            glDeleteQueries(frame.queries.size(), frame.queries.data());
+        }
+    }
+    this->lateFrames.resize(kept);
+
+    // the GPU is far behind - give up on the oldest frames instead of collecting queries
+    while (this->lateFrames.size() > FRAMES_IN_FLIGHT){
+
+        FrameRecord& frame = this->lateFrames.front();
+        if (!frame.queries.empty()){
+            glDeleteQueries(frame.queries.size(), frame.queries.data());
+        }
+
+        this->lateFrames.erase(this->lateFrames.begin());
+        this->droppedFrames++;
+    }
+
+}
+
+
+void Profiler::Flush(){
+
+    // resolve the frames in the order they were recorded
+    ResolveLateFrames(true);
+
+    for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++){
+
+        FrameRecord& frame = this->frames[(this->frameNumber + i) % FRAMES_IN_FLIGHT];
+
+        if (frame.pending && !(this->frameActive && frame.frameNumber == this->frameNumber)){
+            ResolveFrame(frame, true);
+        }
+    }
+
+}
+
+
+unsigned int Profiler::GetNameIndex(const char* name){
+
+    auto iter = this->nameToIndex.find(name);
+    if (iter != this->nameToIndex.end()){
+        return iter->second;
+    }
+
+    unsigned int index = this->names.size();
+    this->names.push_back(name);
+    this->nameToIndex.insert({ name, index });
+    this->histories.push_back(ScopeHistory());
+
+    return index;
+}
+
+
+double Profiler::ToMiliseconds(Uint64 counter) const{
+    return (counter - this->startCounter) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+
+ProfileStatistics Profiler::GetStatistics(const std::string& name) const{
+
+    ProfileStatistics stats;
+
+    auto iter = this->nameToIndex.find(name);
+    if (iter == this->nameToIndex.end()){
+        return stats;
+    }
+
+    const ScopeHistory& history = this->histories[iter->second];
+    unsigned int count = std::min(history.count, static_cast<unsigned int>(PROFILER_HISTORY));
+
+    if (count == 0){
+        return stats;
+    }
+
+    stats.depth = history.depth;
+    stats.gpuMinimum = history.gpuTimes[0];
+    stats.gpuLast = history.gpuTimes[(history.count - 1) % PROFILER_HISTORY];
+
+    for (unsigned int i = 0; i < count; i++){
+        stats.cpuAverage += history.cpuTimes[i];
+        stats.gpuAverage += history.gpuTimes[i];
+        stats.cpuMaximum = std::max(stats.cpuMaximum, history.cpuTimes[i]);
+        stats.gpuMaximum = std::max(stats.gpuMaximum, history.gpuTimes[i]);
+        stats.gpuMinimum = std::min(stats.gpuMinimum, history.gpuTimes[i]);
+    }
+
+    stats.cpuAverage /= count;
+    stats.gpuAverage /= count;
+
+    return stats;
+}
+
+
+const std::vector<std::string>& Profiler::GetScopeNames() const{
+    return this->names;
+}
+
+
+void Profiler::PopResolvedFrames(std::vector<ProfileFrame>& frames){
+    frames.swap(this->resolvedFrames);
+    this->resolvedFrames.clear();
+}
+
+
+unsigned int Profiler::GetFrameNumber() const{
+    return this->frameNumber;
+}
+
+
+void Profiler::StartTraceCapture(){
+    this->traceEvents.clear();
+    this->capturing = true;
+}
+
+
+void Profiler::StopTraceCapture(){
+    this->capturing = false;
+}
+
+
+bool Profiler::IsCapturingTrace() const{
+    return this->capturing;
+}
+
+
+// writes the captured events in the Chrome trace event format
+bool Profiler::ExportChromeTrace(const std::string& filePath) const{
+
+    std::ofstream file(filePath);
+
+    if (!file.is_open()){
+        std::cerr << "Error: Trace could not be written to " << filePath << std::endl;
+        return false;
+    }
+
+    file << "{\n\"displayTimeUnit\": \"ms\",\n\"traceEvents\": [\n";
+
+    // thread names - CPU is thread 0, GPU is thread 1
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"CPU\"}},\n";
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 1, \"args\": {\"name\": \"GPU\"}}";
+
+    // timestamps are in microseconds
+    for (const TraceEvent& event : this->traceEvents){
+        file << ",\n{\"name\": \"" << this->names[event.nameIndex] << "\", \"ph\": \"X\", \"pid\": 0, "
+             << "\"tid\": " << (event.gpu ? 1 : 0) << ", "
+             << "\"ts\": " << static_cast<long long>(event.begin * 1000.0) << ", "
+             << "\"dur\": " << static_cast<long long>(event.duration * 1000.0) << "}";
+    }
+
+    file << "\n]\n}\n";
+    file.close();
+
+    std::cout << "Trace with " << this->traceEvents.size() << " events written to " << filePath << std::endl;
+
+    return true;
+}
+
+
+void Profiler::Release(){
+
+    for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++){
+
+        if (!this->frames[i].queries.empty()){
+            glDeleteQueries(this->frames[i].queries.size(), this->frames[i].queries.data());
+        }
+
+        this->frames[i].queries.clear();
+        this->frames[i].scopes.clear();
+        this->frames[i].pending = false;
+    }
+
+    for (FrameRecord& frame : this->lateFrames){
+        if (!frame.queries.empty()){
+            glDeleteQueries(frame.queries.size(), frame.queries.data());
+        }
+    }
+    this->lateFrames.clear();
+
+}
+
+
+////////////////////////////////////////// profile scope //////////////////////////////////////////
+
+ProfileScope::ProfileScope(const char* name){
+    this->scope = gProfiler.BeginScope(name);
+}
+
+ProfileScope::~ProfileScope(){
+    gProfiler.EndScope(this->scope);
+}
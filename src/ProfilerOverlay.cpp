@@ -0,0 +1,174 @@
+#include "ProfilerOverlay.hpp"
+
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+// colors of the bars, cycled by the pass index
+static const glm::vec4 barColors[] = {
+    glm::vec4(0.90f, 0.35f, 0.25f, 0.85f),
+    glm::vec4(0.30f, 0.75f, 0.35f, 0.85f),
+    glm::vec4(0.25f, 0.50f, 0.90f, 0.85f),
+    glm::vec4(0.95f, 0.80f, 0.25f, 0.85f),
+    glm::vec4(0.70f, 0.35f, 0.85f, 0.85f),
+    glm::vec4(0.25f, 0.80f, 0.85f, 0.85f)
+};
+
+ProfilerOverlay::ProfilerOverlay(){
+
+    this->shader = new Shader("./shaders/vert_overlay.glsl", "./shaders/frag_overlay.glsl");
+
+    glGenVertexArrays(1, &this->VAO);
+    glGenBuffers(1, &this->VBO);
+
+    glBindVertexArray(this->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+
+    unsigned int stride = 6;
+
+    glEnableVertexAttribArray(0);   // position attrib
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride*sizeof(GLfloat), (void *)0);
+
+    glEnableVertexAttribArray(1);   // color attrib
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride*sizeof(GLfloat), (void *) (2*sizeof(GLfloat)));
+
+    glBindVertexArray(0);
+    glDisableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+
+}
+
+
+ProfilerOverlay::~ProfilerOverlay(){
+
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->VBO);
+
+    delete this->shader;
+
+}
+
+
+void ProfilerOverlay::AddQuad(std::vector<GLfloat>& data, glm::vec2 min, glm::vec2 max, glm::vec4 color){
+
+    const glm::vec2 corners[6] = {
+        glm::vec2(min.x, min.y), glm::vec2(max.x, min.y), glm::vec2(max.x, max.y),
+        glm::vec2(min.x, min.y), glm::vec2(max.x, max.y), glm::vec2(min.x, max.y)
+    };
+
+    for (const glm::vec2& corner : corners){
+        data.push_back(corner.x); data.push_back(corner.y);
+        data.push_back(color.r); data.push_back(color.g); data.push_back(color.b); data.push_back(color.a);
+    }
+
+}
+
+
+void ProfilerOverlay::Draw(const Profiler& profiler){
+
+    if (!this->visible){
+        return;
+    }
+
+    // layout of the overlay in NDC - bottom left corner
+    const float left = -0.98f;
+    const float width = 0.6f;
+    const float barHeight = 0.025f;
+    const float spacing = 0.01f;
+    float top = -0.6f;
+
+    std::vector<GLfloat> data;
+
+    // frame bar first, then one bar per pass (direct children of the frame)
+    const std::vector<std::string>& names = profiler.GetScopeNames();
+    unsigned int bar = 0;
+
+    for (unsigned int i = 0; i < names.size(); i++){
+
+        ProfileStatistics stats = profiler.GetStatistics(names[i]);
+
+        if (stats.depth > 1){ // only the frame and the passes
+            continue;
+        }
+
+        float length = std::min(static_cast<float>(stats.gpuAverage) / this->maxMiliseconds, 1.0f) * width;
+        glm::vec4 color = stats.depth == 0 ? glm::vec4(0.9f, 0.9f, 0.9f, 0.85f) : barColors[bar % 6];
+
+        // background and the bar itself
+        AddQuad(data, glm::vec2(left, top - barHeight), glm::vec2(left + width, top), glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
+        AddQuad(data, glm::vec2(left, top - barHeight), glm::vec2(left + length, top), color);
+
+        top -= barHeight + spacing;
+        if (stats.depth == 1){
+            bar++;
+        }
+    }
+
+    // 60 FPS and 30 FPS markers
+    float marker60 = left + 16.6f / this->maxMiliseconds * width;
+    float marker30 = left + 33.3f / this->maxMiliseconds * width;
+    float bottom = top + spacing;
+    AddQuad(data, glm::vec2(marker60 - 0.002f, bottom), glm::vec2(marker60 + 0.002f, -0.6f), glm::vec4(0.2f, 1.0f, 0.2f, 1.0f));
+    AddQuad(data, glm::vec2(marker30 - 0.002f, bottom), glm::vec2(marker30 + 0.002f, -0.6f), glm::vec4(1.0f, 0.2f, 0.2f, 1.0f));
+
+    // upload the data
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), data.data(), GL_STREAM_DRAW);
+
+    // draw on top of everything (also in the wireframe mode)
+    GLint polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    this->shader->Bind();
+    glBindVertexArray(this->VAO);
+
+    glDrawArrays(GL_TRIANGLES, 0, data.size() / 6);
+
+    glBindVertexArray(0);
+    this->shader->Unbind();
+
+    // restore the state
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+
+}
+
+
+void ProfilerOverlay::UpdateWindowTitle(const Profiler& profiler, SDL_Window* window){
+
+    // twice per second is enough to be readable
+    Uint32 now = SDL_GetTicks();
+    if (now - this->lastTitleUpdate < 500){
+        return;
+    }
+    this->lastTitleUpdate = now;
+
+    ProfileStatistics frame = profiler.GetStatistics("frame");
+
+    std::ostringstream title;
+    title << std::fixed << std::setprecision(2);
+    title << "Parallax Mapping | frame cpu " << frame.cpuAverage << " ms gpu " << frame.gpuAverage << " ms";
+
+    for (const std::string& name : profiler.GetScopeNames()){
+
+        ProfileStatistics stats = profiler.GetStatistics(name);
+
+        if (stats.depth == 1){
+            title << " | " << name << " " << stats.gpuAverage;
+        }
+    }
+
+    if (this->status != ""){
+        title << " | " << this->status;
+    }
+
+    SDL_SetWindowTitle(window, title.str().c_str());
+
+}
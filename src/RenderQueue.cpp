@@ -0,0 +1,561 @@
+#include "RenderQueue.hpp"
+#include "Object.hpp"
+#include "Profiler.hpp"
+#include "FrameTimer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+FrameContext FrameContext::Create(const Camera& camera, float aspectRatio, int screenHeight){
+
+    FrameContext context;
+
+    float fieldOfView = glm::radians(45.0f);
+    context.view = camera.GetViewMatrix();
+    context.projection = glm::perspective(fieldOfView, aspectRatio, context.nearPlane, context.farPlane);
+    context.pixelScale = screenHeight / (2.0f * std::tan(fieldOfView * 0.5f));
+    context.viewProjection = context.projection * context.view;
+    context.cameraPosition = camera.GetEyePosition();
+
+    // planes from the rows of the view projection matrix (Gribb & Hartmann)
+    const glm::mat4& m = context.viewProjection;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++){
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+
+    context.frustumPlanes[0] = rows[3] + rows[0];
+    context.frustumPlanes[1] = rows[3] - rows[0];
+    context.frustumPlanes[2] = rows[3] + rows[1];
+    context.frustumPlanes[3] = rows[3] - rows[1];
+    context.frustumPlanes[4] = rows[3] + rows[2];
+    context.frustumPlanes[5] = rows[3] - rows[2];
+
+    for (glm::vec4& plane : context.frustumPlanes){
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return context;
+}
+
+
+bool FrameContext::IsSphereVisible(const glm::vec3& center, float radius) const{
+
+    for (const glm::vec4& plane : this->frustumPlanes){
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+RenderQueue::RenderQueue(){ }
+
+RenderQueue::~RenderQueue(){
+
+    if (this->perDrawBuffer != nullptr){
+        delete this->perDrawBuffer;
+    }
+
+    if (this->indirectBuffer != nullptr){
+        delete this->indirectBuffer;
+    }
+
+    if (this->depthShader != nullptr){
+        delete this->depthShader;
+    }
+
+}
+
+
+void RenderQueue::Build(const std::vector<Object *>& objects, const FrameContext& context, JobSystem* jobSystem){
+
+    unsigned int numberOfThreads = jobSystem != nullptr ? jobSystem->GetNumberOfThreads() : 1;
+
+    // objects are only added during the initialization - batches are built once
+    if (this->objectSlots.size() != objects.size()){
+        BuildBatches(objects);
+    }
+
+    // CULLING_GPU culls after the preparation, but only the multi-draw path can use it
+    bool cull = this->cullingMode == CULLING_CPU || (this->cullingMode == CULLING_GPU && !UseMultiDraw());
+
+    // one command list per thread - no locking while recording
+    this->threadCommands.resize(numberOfThreads);
+    this->threadCulled.assign(numberOfThreads, 0);
+    this->threadVisibleDraws.assign(numberOfThreads, 0);
+    for (std::vector<DrawCommand>& list : this->threadCommands){
+        list.clear();
+    }
+
+    // every object writes the bounds and visibility of its own commands
+    this->frameCullObjects = this->cullObjects;
+    this->commandVisibility.assign(this->staticCommands.size(), 0);
+
+    JobFunction prepare = [&](unsigned int begin, unsigned int end, unsigned int threadIndex){
+
+        std::vector<DrawCommand>& list = this->threadCommands[threadIndex];
+
+        for (unsigned int i = begin; i < end; i++){
+
+            DrawCommand command;
+            if (objects[i]->Prepare(context, command, cull)){
+                command.slot = this->objectSlots[i];
+                command.firstCommand = this->objectCommands[i];
+                this->threadVisibleDraws[threadIndex] +=
+                    objects[i]->PrepareDraws(context, command, &this->frameCullObjects[command.firstCommand],
+                                             &this->commandVisibility[command.firstCommand], cull);
+                list.push_back(command);
+            }
+            else{
+                this->threadCulled[threadIndex]++;
+            }
+        }
+    };
+
+    if (jobSystem != nullptr){
+        jobSystem->ParallelFor(objects.size(), this->groupSize, prepare);
+    }
+    else{
+        prepare(0, objects.size(), 0);
+    }
+
+    // merge the lists and sort them to minimize the state changes
+    this->commands.clear();
+    this->culled = 0;
+    this->visibleDraws = 0;
+    for (unsigned int i = 0; i < numberOfThreads; i++){
+        this->commands.insert(this->commands.end(), this->threadCommands[i].begin(), this->threadCommands[i].end());
+        this->culled += this->threadCulled[i];
+        this->visibleDraws += this->threadVisibleDraws[i];
+    }
+
+    std::sort(this->commands.begin(), this->commands.end(),
+              [](const DrawCommand& a, const DrawCommand& b){ return a.sortKey < b.sortKey; });
+
+    // parallax quality chosen for the prepared objects
+    unsigned int layers = 0;
+    this->statistics.parallaxFull = 0;
+    this->statistics.parallaxOffset = 0;
+    this->statistics.parallaxNormal = 0;
+    for (const DrawCommand& command : this->commands){
+
+        if (command.object->GetParallaxMethod() < 0){
+            continue;
+        }
+
+        int method = command.data.flags.y;
+        if (method >= 1){
+            this->statistics.parallaxFull++;
+            layers += command.data.flags.w;
+        }
+        else if (method == 0){
+            this->statistics.parallaxOffset++;
+        }
+        else{
+            this->statistics.parallaxNormal++;
+        }
+    }
+    this->statistics.parallaxLayers = this->statistics.parallaxFull > 0 ?
+                                      static_cast<double>(layers) / this->statistics.parallaxFull : 0.0;
+
+}
+
+
+void RenderQueue::BuildBatches(const std::vector<Object *>& objects){
+
+    // objects with the same shader and textures next to each other
+    std::vector<unsigned int> order(objects.size());
+    for (unsigned int i = 0; i < objects.size(); i++){
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b){
+        if (objects[a]->GetBatchKey() != objects[b]->GetBatchKey()){
+            return objects[a]->GetBatchKey() < objects[b]->GetBatchKey();
+        }
+        return objects[a]->GetIndexType() < objects[b]->GetIndexType();
+    });
+
+    this->objectSlots.assign(objects.size(), 0);
+    this->objectCommands.assign(objects.size(), 0);
+    this->commandBatches.clear();
+    this->staticCommands.clear();
+    this->batches.clear();
+    this->cullObjects.clear();
+
+    for (unsigned int slot = 0; slot < order.size(); slot++){
+
+        Object* object = objects[order[slot]];
+
+        if (this->batches.empty() || this->batches.back().object->GetBatchKey() != object->GetBatchKey() ||
+            this->batches.back().indexType != object->GetIndexType()){
+            DrawBatch batch;
+            batch.object = object;
+            batch.firstCommand = this->staticCommands.size();
+            batch.indexType = object->GetIndexType();
+            this->batches.push_back(batch);
+        }
+
+        this->objectSlots[order[slot]] = slot;
+        this->objectCommands[order[slot]] = this->staticCommands.size();
+
+        // the slot is the index of the per-draw record, read by all commands of the object
+        object->GetIndirectCommands(slot, this->staticCommands);
+
+        CullObject cullObject;
+        cullObject.batch = glm::uvec4(this->batches.size() - 1, this->batches.back().firstCommand, 0, 0);
+
+        while (this->commandBatches.size() < this->staticCommands.size()){
+            this->commandBatches.push_back(this->batches.size() - 1);
+            this->cullObjects.push_back(cullObject);
+            this->batches.back().count++;
+        }
+    }
+
+    this->gpuCulling.SetCommands(this->staticCommands, this->batches.size());
+
+}
+
+
+bool RenderQueue::UseMultiDraw() const{
+
+    // per object profiling needs separate draws
+    return this->multiDraw && gGLCapabilities.multiDrawIndirect && !gProfiler.profileObjects;
+}
+
+
+void RenderQueue::Submit(const FrameContext& context, MeshBuffer& meshBuffer){
+
+    double start = FrameTimer::Now();
+
+    this->statistics.drawCalls = 0;
+    this->statistics.visibleObjects = this->commands.size();
+    this->statistics.culledObjects = this->culled;
+    this->statistics.visibleDraws = this->visibleDraws;
+    this->statistics.culledDraws = this->staticCommands.size() - this->visibleDraws;
+    this->statistics.multiDraw = UseMultiDraw();
+    this->statistics.gpuCulling = false;
+
+    if (this->perDrawBuffer == nullptr){
+        this->perDrawBuffer = new RingBuffer(GL_SHADER_STORAGE_BUFFER, 1024 * sizeof(PerDrawData));
+    }
+
+    if (this->statistics.multiDraw){
+        SubmitMultiDraw(context, meshBuffer);
+    }
+    else{
+        SubmitSingleDraws(context, meshBuffer);
+    }
+
+    // stop using current pipeline
+    meshBuffer.Unbind();
+    glUseProgram(0);
+
+    this->statistics.submitMiliseconds = (FrameTimer::Now() - start) * 1000.0;
+
+}
+
+
+void RenderQueue::EndFrame(){
+
+    // the section is reused once the GPU finished these draws (and the lighting pass that reads them)
+    if (this->perDrawBuffer != nullptr){
+        this->perDrawBuffer->EndFrame();
+    }
+
+}
+
+
+void RenderQueue::BeginDepthPrepass(const FrameContext& context, MeshBuffer& meshBuffer){
+
+    if (this->depthShader == nullptr){
+        this->depthShader = new Shader("./shaders/vert_Depth.glsl", "./shaders/frag_Depth.glsl",
+                                       meshBuffer.GetShaderDefines());
+    }
+
+    this->depthShader->Bind();
+
+    glm::mat4 view = context.view;
+    glm::mat4 projection = context.projection;
+    this->depthShader->Upload_Uniform_MAT4fv_Pipeline("u_ViewMatrix", view);
+    this->depthShader->Upload_Uniform_MAT4fv_Pipeline("u_ProjectionMatrix", projection);
+
+    // surfaces that may discard are clipped by the shader
+    glEnable(GL_CLIP_DISTANCE0);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+}
+
+
+void RenderQueue::EndDepthPrepass(){
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDisable(GL_CLIP_DISTANCE0);
+
+}
+
+
+void RenderQueue::CullSlots(const FrameContext& context, bool onGPU){
+
+    CullParameters parameters;
+    for (int i = 0; i < 6; i++){
+        parameters.frustumPlanes[i] = context.frustumPlanes[i];
+    }
+    parameters.info = glm::uvec4(this->staticCommands.size(), 0, 0, 0);
+    parameters.cameraPosition = glm::vec4(context.cameraPosition, 0.0f);
+    this->gpuCulling.SetOcclusionParameters(parameters, this->occlusionCulling && onGPU);
+
+    // the bounds were written by the prepared objects, the other commands stay culled
+
+    if (onGPU){
+        this->gpuCulling.Dispatch(this->frameCullObjects, parameters);
+        return;
+    }
+
+    // same data on the CPU (no depth pyramid - frustum only)
+    this->frameCounts.resize(this->batches.size());
+    GPUCulling::CullDraws(this->frameCullObjects, this->staticCommands, parameters, DepthLevels(),
+                          this->frameCommands, this->frameCounts);
+
+    for (unsigned int i = 0; i < this->batches.size(); i++){
+        this->batches[i].visible = this->frameCounts[i];
+    }
+
+}
+
+
+void RenderQueue::SubmitMultiDraw(const FrameContext& context, MeshBuffer& meshBuffer){
+
+    unsigned int numberOfSlots = this->objectSlots.size();
+    unsigned int numberOfCommands = this->staticCommands.size();
+    GLsizeiptr recordsSize = numberOfSlots * sizeof(PerDrawData);
+    GLsizeiptr commandsSize = numberOfCommands * sizeof(DrawElementsIndirectCommand);
+
+    // compute shader culling writes the commands, the counts stay on the GPU
+    bool compacted = this->cullingMode == CULLING_GPU;
+    bool onGPU = compacted && gGLCapabilities.computeShader;
+    this->statistics.gpuCulling = onGPU;
+
+    if (this->indirectBuffer == nullptr){
+        this->indirectBuffer = new RingBuffer(GL_DRAW_INDIRECT_BUFFER, 1024 * sizeof(DrawElementsIndirectCommand));
+    }
+
+    // per-draw records at the fixed slots of the objects
+    PerDrawData* records = static_cast<PerDrawData*>(this->perDrawBuffer->BeginFrame(recordsSize));
+    for (const DrawCommand& command : this->commands){
+        records[command.slot] = command.data;
+    }
+    this->perDrawBuffer->Commit();
+    this->perDrawBuffer->BindRange(PER_DRAW_BINDING, recordsSize);
+
+    if (compacted){
+
+        CullSlots(context, onGPU);
+
+        unsigned int visible = 0;
+        for (DrawBatch& batch : this->batches){
+            if (onGPU){
+                batch.visible = batch.count;    // decided by the shader
+            }
+            visible += batch.visible;
+        }
+
+        if (!onGPU){
+
+            // objects with at least one visible command (the baseInstance is the record)
+            std::vector<uint8_t> visibleSlots(numberOfSlots, 0);
+            unsigned int visibleObjects = 0;
+            for (const DrawBatch& batch : this->batches){
+                for (unsigned int c = batch.firstCommand; c < batch.firstCommand + batch.visible; c++){
+                    GLuint record = this->frameCommands[c].baseInstance;
+                    visibleObjects += visibleSlots[record] == 0 ? 1 : 0;
+                    visibleSlots[record] = 1;
+                }
+            }
+
+            this->statistics.culledObjects += this->statistics.visibleObjects - visibleObjects;
+            this->statistics.visibleObjects = visibleObjects;
+            this->statistics.visibleDraws = visible;
+            this->statistics.culledDraws = numberOfCommands - visible;
+        }
+    }
+    else{
+
+        // only the visibility (instance count) changes between the frames
+        this->frameCommands = this->staticCommands;
+        for (DrawElementsIndirectCommand& command : this->frameCommands){
+            command.instanceCount = 0;
+        }
+        for (DrawBatch& batch : this->batches){
+            batch.visible = 0;
+        }
+
+        for (unsigned int c = 0; c < numberOfCommands; c++){
+            this->frameCommands[c].instanceCount = this->commandVisibility[c];
+            this->batches[this->commandBatches[c]].visible += this->commandVisibility[c];
+        }
+    }
+
+    GLuint commandBuffer = 0;
+    GLintptr commandOffset = 0;
+
+    if (onGPU){
+        commandBuffer = this->gpuCulling.GetCommandBuffer();
+        if (gGLCapabilities.indirectCount){
+            glBindBuffer(GL_PARAMETER_BUFFER, this->gpuCulling.GetCountBuffer());
+        }
+    }
+    else{
+        void* indirect = this->indirectBuffer->BeginFrame(commandsSize);
+        std::memcpy(indirect, this->frameCommands.data(), commandsSize);
+        this->indirectBuffer->Commit();
+
+        commandBuffer = this->indirectBuffer->GetID();
+        commandOffset = this->indirectBuffer->GetSectionOffset();
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    meshBuffer.Bind(true, numberOfSlots);
+
+    // the same commands with one shader - depth only
+    if (this->depthPrepass){
+
+        ProfileScope scope("depth prepass");
+        BeginDepthPrepass(context, meshBuffer);
+
+        for (unsigned int i = 0; i < this->batches.size(); i++){
+            if (this->batches[i].visible > 0){
+                SubmitBatch(i, onGPU, compacted, commandOffset);
+            }
+        }
+
+        EndDepthPrepass();
+    }
+
+    // one call per batch
+    Object* previous = nullptr;
+    for (unsigned int i = 0; i < this->batches.size(); i++){
+
+        const DrawBatch& batch = this->batches[i];
+
+        if (batch.visible == 0){
+            continue;
+        }
+
+        bool bindPipeline = previous == nullptr || !batch.object->SharesPipeline(*previous);
+        batch.object->BindMaterial(context, bindPipeline);
+        previous = batch.object;
+
+        SubmitBatch(i, onGPU, compacted, commandOffset);
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    if (onGPU){
+
+        if (gGLCapabilities.indirectCount){
+            glBindBuffer(GL_PARAMETER_BUFFER, 0);
+        }
+
+        // occluders of the next frame
+        if (this->occlusionCulling){
+            meshBuffer.Unbind();
+            ProfileScope scope("hi-z");
+            this->gpuCulling.BuildDepthPyramid(context.viewProjection);
+        }
+    }
+    else{
+        this->indirectBuffer->EndFrame();
+    }
+
+}
+
+
+void RenderQueue::SubmitBatch(unsigned int batchIndex, bool onGPU, bool compacted, GLintptr commandOffset){
+
+    const DrawBatch& batch = this->batches[batchIndex];
+    GLintptr offset = commandOffset + batch.firstCommand * sizeof(DrawElementsIndirectCommand);
+
+    if (onGPU && gGLCapabilities.indirectCount){
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, batch.indexType, (void *) offset,
+                                         batchIndex * sizeof(GLuint), batch.count, 0);
+    }
+    else{
+        // compacted on the CPU: only the visible commands, otherwise the empty ones are skipped by the GPU
+        GLsizei drawCount = compacted && !onGPU ? batch.visible : batch.count;
+        glMultiDrawElementsIndirect(GL_TRIANGLES, batch.indexType, (void *) offset, drawCount, 0);
+    }
+    this->statistics.drawCalls++;
+
+}
+
+
+void RenderQueue::SubmitSingleDraws(const FrameContext& context, MeshBuffer& meshBuffer){
+
+    GLsizeiptr size = this->commands.size() * sizeof(PerDrawData);
+
+    // one tightly packed record per draw, indexed by the draw ID
+    PerDrawData* records = static_cast<PerDrawData*>(this->perDrawBuffer->BeginFrame(size));
+    for (unsigned int i = 0; i < this->commands.size(); i++){
+        records[i] = this->commands[i].data;
+    }
+    this->perDrawBuffer->Commit();
+    this->perDrawBuffer->BindRange(PER_DRAW_BINDING, size);
+
+    meshBuffer.Bind(false, 0);
+
+    // the same draws with one shader - depth only
+    if (this->depthPrepass){
+
+        ProfileScope scope("depth prepass");
+        BeginDepthPrepass(context, meshBuffer);
+
+        for (unsigned int i = 0; i < this->commands.size(); i++){
+            this->commands[i].object->Submit(i, &this->commandVisibility[this->commands[i].firstCommand]);
+            this->statistics.drawCalls++;
+        }
+
+        EndDepthPrepass();
+    }
+
+    Object* previous = nullptr;
+
+    for (unsigned int i = 0; i < this->commands.size(); i++){
+
+        const DrawCommand& command = this->commands[i];
+
+        // profile every object separately
+        int scope = -1;
+        if (gProfiler.profileObjects){
+            scope = gProfiler.BeginScope(command.object->name.c_str());
+        }
+
+        // frame uniforms are uploaded only when the pipeline changes
+        bool bindPipeline = previous == nullptr || !command.object->SharesPipeline(*previous);
+        command.object->BindMaterial(context, bindPipeline);
+        command.object->Submit(i, &this->commandVisibility[command.firstCommand]);
+        previous = command.object;
+        this->statistics.drawCalls++;
+
+        gProfiler.EndScope(scope);
+    }
+
+}
+
+
+const std::vector<DrawCommand>& RenderQueue::GetCommands() const{
+    return this->commands;
+}
+
+
+unsigned int RenderQueue::GetNumberOfCulled() const{
+    return this->culled;
+}
+
+
+const RenderStatistics& RenderQueue::GetStatistics() const{
+    return this->statistics;
+}
@@ -0,0 +1,177 @@
+#include "RingBuffer.hpp"
+
+#if defined(LINUX) || defined(MINGW)
+    #include <SDL2/SDL.h>
+#else // This works for Mac
+    #include <SDL.h>
+#endif
+
+#include <algorithm>
+
+RingBuffer::RingBuffer(GLenum target, GLsizeiptr sectionSize, unsigned int numberOfSections){
+
+    this->target = target;
+    this->numberOfSections = std::max(numberOfSections, 1u);
+
+    Create(sectionSize);
+
+}
+
+
+RingBuffer::~RingBuffer(){
+    Release();
+}
+
+
+void RingBuffer::Create(GLsizeiptr sectionSize){
+
+    // sections start at the offset alignment of indexed bindings
+    GLsizeiptr alignment = std::max(gGLCapabilities.storageBufferAlignment, 256);
+    this->sectionSize = (sectionSize + alignment - 1) / alignment * alignment;
+    GLsizeiptr totalSize = this->sectionSize * this->numberOfSections;
+
+    glGenBuffers(1, &this->bufferID);
+    glBindBuffer(this->target, this->bufferID);
+
+    this->persistent = gGLCapabilities.bufferStorage;
+
+    if (this->persistent){
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(this->target, totalSize, nullptr, flags);
+        this->persistentPointer = static_cast<unsigned char*>(glMapBufferRange(this->target, 0, totalSize, flags));
+    }
+    else{
+        glBufferData(this->target, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(this->target, 0);
+
+    this->fences.assign(this->numberOfSections, nullptr);
+    this->currentSection = 0;
+
+}
+
+
+void RingBuffer::Release(){
+
+    if (this->bufferID == 0){
+        return;
+    }
+
+    for (GLsync& fence : this->fences){
+        if (fence != nullptr){
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (this->persistent || this->mapped){
+        glBindBuffer(this->target, this->bufferID);
+        glUnmapBuffer(this->target);
+        glBindBuffer(this->target, 0);
+    }
+
+    glDeleteBuffers(1, &this->bufferID);
+
+    this->bufferID = 0;
+    this->persistentPointer = nullptr;
+    this->mapped = false;
+
+}
+
+
+void* RingBuffer::BeginFrame(GLsizeiptr requiredSize){
+
+    // too small - wait for the GPU and double the size
+    if (requiredSize > this->sectionSize){
+        glFinish();
+        GLsizeiptr newSize = std::max(requiredSize, this->sectionSize * 2);
+        Release();
+        Create(newSize);
+    }
+
+    this->currentSection = (this->currentSection + 1) % this->numberOfSections;
+
+    // the GPU may still read the section written numberOfSections frames ago
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    GLsync& fence = this->fences[this->currentSection];
+    if (fence != nullptr){
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result == GL_TIMEOUT_EXPIRED){
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    this->waitMiliseconds = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+    if (this->persistent){
+        return this->persistentPointer + GetSectionOffset();
+    }
+
+    // the fence already protects the section - no implicit synchronization needed
+    glBindBuffer(this->target, this->bufferID);
+    void* pointer = glMapBufferRange(this->target, GetSectionOffset(), this->sectionSize,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(this->target, 0);
+
+    this->mapped = true;
+
+    return pointer;
+}
+
+
+void RingBuffer::Commit(){
+
+    // coherent persistent mapping needs nothing
+    if (!this->mapped){
+        return;
+    }
+
+    glBindBuffer(this->target, this->bufferID);
+    glUnmapBuffer(this->target);
+    glBindBuffer(this->target, 0);
+
+    this->mapped = false;
+
+}
+
+
+void RingBuffer::BindRange(GLuint binding, GLsizeiptr size) const{
+
+    if (size == 0){
+        return;
+    }
+
+    glBindBufferRange(this->target, binding, this->bufferID, GetSectionOffset(), size);
+
+}
+
+
+void RingBuffer::EndFrame(){
+
+    this->fences[this->currentSection] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+}
+
+
+GLuint RingBuffer::GetID() const{
+    return this->bufferID;
+}
+
+
+GLintptr RingBuffer::GetSectionOffset() const{
+    return this->currentSection * this->sectionSize;
+}
+
+
+bool RingBuffer::IsPersistent() const{
+    return this->persistent;
+}
+
+
+double RingBuffer::GetWaitMiliseconds() const{
+    return this->waitMiliseconds;
+}
@@ -3,6 +3,9 @@
 #include "Geometry.hpp"
 #include "Skybox.hpp"
 
+#include <algorithm>
+#include <random>
+
 Scene gScene = Scene::GetInstance();    // create singleton global class
 
 
@@ -172,6 +175,9 @@ void Scene::InitializeScene2(){
     GenerateGround(1, 4, -1.25f, diffuseMapPath, normalMapPath, heightMapPath, true,
                     trans, rot, scale);
 
+    // one texture array layer per ground material
+    LoadGroundMaterials();
+
                                 // add house
 	Object* house = new Object("./shaders/vert_NormalMap.glsl", "./shaders/frag_NormalMap.glsl");
 
@@ -183,6 +189,7 @@ void Scene::InitializeScene2(){
     house->LoadData_WavefrontOBJ(0, "./common/objects/house/house_obj.obj");
 
     // add object to the scene
+    house->name = "house";
     this->objManager->AddObject(house);
     house->SetUsedLight(0);
 
@@ -198,6 +205,39 @@ void Scene::InitializeScene2(){
 }
 
 
+// saturated color of a hue in [0, 1)
+static glm::vec3 HueColor(float hue){
+
+    glm::vec3 color = glm::abs(glm::fract(glm::vec3(hue) + glm::vec3(1.0f, 2.0f / 3.0f, 1.0f / 3.0f)) * 6.0f - 3.0f) - 1.0f;
+    return glm::clamp(color, 0.0f, 1.0f);
+}
+
+
+void Scene::AddLocalLights(unsigned int numberOfLights){
+
+    // the same lights in every run (benchmarks)
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    for (unsigned int i = 0; i < numberOfLights; i++){
+
+        // above the ground of both scenes
+        glm::vec3 position = glm::vec3(-11.0f + 16.0f * unit(random), -1.1f + 1.5f * unit(random), -15.0f + 20.0f * unit(random));
+
+        PointLight* light = new PointLight(position, HueColor(unit(random)));
+        light->radius = 1.0f + 1.5f * unit(random);
+        light->intensity = 2.0f;
+
+        // small circles in both directions
+        light->orbitCenter = position + glm::vec3(0.5f + unit(random), 0.0f, 0.0f);
+        light->orbitSpeed = (unit(random) < 0.5f ? -1.0f : 1.0f) * (20.0f + 40.0f * unit(random));
+
+        this->lightsManager->AddLight(light);
+    }
+
+}
+
+
 void Scene::PreDrawBackGround(){
 	
     glEnable(GL_DEPTH_TEST);                    
@@ -209,6 +249,7 @@ void Scene::PreDrawBackGround(){
     glClearColor( 0.1f, 0.1f, 0.1f, 1.f );
 
     //Clear color buffer and Depth Buffer
+    ProfileScope scope("clear");
   	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
 }
@@ -217,24 +258,80 @@ void Scene::Render(){
 
     glDepthFunc(GL_LEQUAL);  // set depth function to less than AND equal for skybox depth trick.
 
-    // render objects
-    this->objManager->RenderAllObjects();
+    // view and projection are computed once per frame
+    FrameContext context = FrameContext::Create(this->MainCamera,
+                                                (float)this->ScreenWidth/(float)this->ScreenHeight,
+                                                this->ScreenHeight);
+    context.lodPixelError = this->MeshLods ? this->LodPixelError : 0.0f;
+    context.parallaxLod = this->ParallaxLod;
+    context.gbufferPass = this->RenderPath == RENDER_DEFERRED;
+
+    // bin the lights into the clusters of the frame
+    {
+        ProfileScope scope("light clusters");
+        this->lightsManager->GetClusters().enabled = this->ClusteredLights;
+        this->lightsManager->Update(context, this->ScreenWidth, this->ScreenHeight, this->jobSystem);
+    }
+
+    // pages requested by older frames and the feedback buffer of this one
+    if (this->virtualTexture != nullptr){
+        ProfileScope scope("virtual texture");
+        this->virtualTexture->Update();
+    }
+
+    // levels of the textures requested by the last frame
+    if (this->textureStreamer != nullptr){
+        ProfileScope scope("texture streaming");
+        this->textureStreamer->Update();
+    }
+
+    // render objects (into the G-buffer in the deferred path)
+    {
+        ProfileScope scope("objects");
+
+        if (context.gbufferPass){
+            this->gbuffer->BeginGeometryPass(this->ScreenWidth, this->ScreenHeight);
+        }
+
+        this->objManager->RenderAllObjects(context);
+
+        if (context.gbufferPass){
+            this->gbuffer->EndGeometryPass();
+        }
+    }
+
+    // every pixel is lit once
+    if (context.gbufferPass){
+        ProfileScope scope("deferred lighting");
+        this->gbuffer->LightingPass(context);
+    }
+
+    // the draws that read the records and lights of the frame were submitted
+    this->objManager->EndFrame();
+    this->lightsManager->EndFrame();
+    if (this->virtualTexture != nullptr){
+        this->virtualTexture->EndFrame();
+    }
 
     // render lights
-    this->lightsManager->RenderAllLights();
+    {
+        ProfileScope scope("lights");
+        this->lightsManager->RenderAllLights();
+    }
 
     // render the skybox last - optimization - early depth test will disregard most of the
     // skybox fragments - since they have depth 1.0f (we hardcoded its .z to w)
     if (this->skybox != nullptr){ 
+        ProfileScope scope("skybox");
         this->skybox->Draw();
     }
 
 }
 
-void Scene::UploadLightsToPipeline(Shader* shaderProgram){
+void Scene::BindLights(){
 
-    // upload all lights to the pipeline
-    this->lightsManager->UploadLightsToPipeline(shaderProgram);
+    // lights and their clusters are read from the storage buffers
+    this->lightsManager->BindLights();
 
 }
 
@@ -244,16 +341,43 @@ void Scene::GenerateGround(int width, int height, float level,
                         const std::string heightMap, bool inverseH,
                         glm::vec3 pos, glm::vec3 rot, glm::vec3 scale){
 
-    const float xShift = scale[0];
-    const float zShift = scale[2];
+    // split every tile into GroundTiles x GroundTiles smaller tiles (same covered area)
+    const int tiles = std::max(this->GroundTiles, 1);
+    const glm::vec3 tileScale = scale / static_cast<float>(tiles);
+
+    const float xShift = tileScale[0];
+    const float zShift = tileScale[2];
+
+    // center of the first tile - the original tile is centered at pos
+    const glm::vec3 start = pos + glm::vec3(xShift - scale[0], level, zShift - scale[2]);
+
+    // layer of the material in the ground texture arrays (the tiles load the height maps inverted)
+    unsigned int layer = 0;
+    while (layer < this->groundMaterials.size() && this->groundMaterials[layer].diffuse != diff){
+        layer++;
+    }
+    if (layer == this->groundMaterials.size()){
+        this->groundMaterials.push_back({diff, normal, heightMap, true});
+    }
+
+    // the materials are assigned once all ground tiles are known
+    const bool deferMaterials = this->GroundTextureArrays || !this->VirtualTexturePath.empty();
 
-    for (unsigned int x = 0; x < width; x++){
-        for (unsigned int z = 0; z < height; z++){
+    for (unsigned int x = 0; x < width * tiles; x++){
+        for (unsigned int z = 0; z < height * tiles; z++){
 
-        
-            Object * plane = CreatePlane("./shaders/vert_NormalMap.glsl", "./shaders/frag_Parallax.glsl", 
-                                            pos + glm::vec3(x*2*xShift, level, z*2*zShift), rot, scale, 
-                                            diff, normal, heightMap, true, 1);
+            // the textures of the arrays are loaded once all ground materials are known
+            Object * plane = nullptr;
+            if (deferMaterials){
+                plane = CreatePlane("./shaders/vert_NormalMap.glsl", "./shaders/frag_Parallax.glsl",
+                                    start + glm::vec3(x*2*xShift, 0.0f, z*2*zShift), rot, tileScale, 1);
+                this->groundTiles.push_back({plane, layer});
+            }
+            else{
+                plane = CreatePlane("./shaders/vert_NormalMap.glsl", "./shaders/frag_Parallax.glsl", 
+                                    start + glm::vec3(x*2*xShift, 0.0f, z*2*zShift), rot, tileScale, 
+                                    diff, normal, heightMap, true, 1);
+            }
 
 
                     // set parallax mapping methods per wall
@@ -270,3 +394,58 @@ void Scene::GenerateGround(int width, int height, float level,
 }
 
 
+void Scene::LoadGroundMaterials(){
+
+    if (this->groundTiles.empty()){
+        return;
+    }
+
+    // one virtual texture over every tile (the materials if the page file can not be read)
+    if (!this->VirtualTexturePath.empty()){
+
+        VirtualTexture* virtualTexture = new VirtualTexture();
+        if (virtualTexture->Open(this->VirtualTexturePath)){
+
+            if (!this->VirtualTextureRecordPath.empty()){
+                virtualTexture->Record(this->VirtualTextureRecordPath);
+            }
+
+            for (const std::pair<Object*, unsigned int>& tile : this->groundTiles){
+                tile.first->SetVirtualTexture(virtualTexture);
+            }
+
+            std::cout << "Ground: virtual texture " << this->VirtualTexturePath << ", "
+                      << this->groundTiles.size() << " tiles" << std::endl;
+
+            this->virtualTexture = virtualTexture;
+            this->groundTiles.clear();
+            return;
+        }
+
+        delete virtualTexture;
+    }
+
+    std::shared_ptr<MaterialArray> materials = this->GroundTextureArrays ?
+                                               Object::LoadMaterialArray(this->groundMaterials) : nullptr;
+
+    for (const std::pair<Object*, unsigned int>& tile : this->groundTiles){
+
+        if (materials != nullptr){
+            tile.first->SetMaterialArray(materials, tile.second);
+        }
+        else{
+            // the materials do not fit one array - textures per material
+            const MaterialFiles& material = this->groundMaterials[tile.second];
+            tile.first->LoadTexture(material.diffuse, 0, false);
+            tile.first->LoadMaterial(material.normal, material.height, material.inverseH);
+        }
+    }
+
+    if (materials != nullptr){
+        std::cout << "Ground: " << this->groundMaterials.size() << " materials in texture arrays, "
+                  << this->groundTiles.size() << " tiles" << std::endl;
+    }
+
+    this->groundTiles.clear();
+
+}
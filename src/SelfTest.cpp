@@ -0,0 +1,715 @@
+#include "SelfTest.hpp"
+#include "MeshBuffer.hpp"
+#include "Geometry.hpp"
+#include "HeightMap.hpp"
+#include "JobSystem.hpp"
+#include "GPUCulling.hpp"
+#include "ObjectParser.hpp"
+#include "TextureCompressor.hpp"
+#include "Meshlet.hpp"
+#include "MeshSimplifier.hpp"
+#include "Object.hpp"
+
+// STL
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <set>
+#include <array>
+
+
+// failed checks of the current group
+static unsigned int gFailures = 0;
+
+
+// print the check if it failed
+static void Check(bool condition, const std::string& name){
+
+    if (!condition){
+        std::cout << "  failed: " << name << "\n";
+        gFailures++;
+    }
+
+}
+
+
+// stride 14 vertices of a fan of triangles (the positions do not matter for the indices)
+static void CreateFan(unsigned int numberOfVertices, std::vector<GLfloat>& data, std::vector<GLuint>& indices){
+
+    data.assign(numberOfVertices * 14, 0.0f);
+    for (unsigned int v = 0; v < numberOfVertices; v++){
+        data[v * 14] = static_cast<GLfloat>(v);
+        data[v * 14 + 5] = 1.0f;    // normal
+        data[v * 14 + 8] = 1.0f;    // tangent
+        data[v * 14 + 12] = 1.0f;   // bitangent
+    }
+
+    indices.clear();
+    for (unsigned int v = 1; v + 1 < numberOfVertices; v++){
+        indices.insert(indices.end(), {0, v, v + 1});
+    }
+
+}
+
+
+// index types, the 4 byte padding between the meshes and the first index in units of the type
+static void CheckMeshBufferIndices(){
+
+    MeshBuffer buffer;
+    std::vector<GLfloat> data;
+    std::vector<GLuint> indices;
+
+    // the plane of the ground tiles: 6 indices of 2 bytes
+    CreatePlaneMesh(data, indices);
+    MeshRange plane = buffer.AddMesh(data, indices);
+    Check(plane.indexType == GL_UNSIGNED_SHORT, "plane has 16 bit indices");
+    Check(plane.firstIndex == 0 && plane.indexCount == 6, "plane starts at index 0");
+    Check(buffer.GetIndexBytes() == 12, "plane indices are 12 bytes");
+
+    // 3 short indices - the buffer ends in the middle of 4 bytes
+    CreateFan(3, data, indices);
+    MeshRange triangle = buffer.AddMesh(data, indices);
+    Check(triangle.indexType == GL_UNSIGNED_SHORT && triangle.firstIndex == 6, "triangle follows the plane");
+    Check(buffer.GetIndexBytes() == 18, "triangle indices are 6 bytes");
+
+    // 65536 vertices still fit into 16 bits
+    CreateFan(65536, data, indices);
+    MeshRange largest = buffer.AddMesh(data, indices);
+    size_t largestBytes = indices.size() * sizeof(GLushort);
+    Check(largest.indexType == GL_UNSIGNED_SHORT, "65536 vertices have 16 bit indices");
+    Check(largest.firstIndex == 10, "16 bit mesh after an odd 16 bit mesh is padded to 4 bytes");
+    Check(buffer.GetIndexBytes() == 20 + largestBytes, "16 bit mesh of 65536 vertices size");
+
+    // one vertex more - 32 bit indices at a 4 byte offset
+    size_t offset = buffer.GetIndexBytes();
+    CreateFan(65537, data, indices);
+    MeshRange wide = buffer.AddMesh(data, indices);
+    size_t paddedOffset = (offset + 3) & ~static_cast<size_t>(3);
+    Check(wide.indexType == GL_UNSIGNED_INT, "65537 vertices fall back to 32 bit indices");
+    Check(wide.firstIndex * sizeof(GLuint) == paddedOffset, "32 bit mesh starts at a 4 byte boundary");
+    Check(buffer.GetIndexBytes() == paddedOffset + indices.size() * sizeof(GLuint), "32 bit mesh size");
+    Check(wide.baseVertex == 4 + 3 + 65536, "base vertex of the 32 bit mesh");
+
+    // the levels of detail keep the type of their mesh
+    offset = buffer.GetIndexBytes();
+    MeshRange level = buffer.AddIndices(wide, {0, 1, 2});
+    Check(level.indexType == GL_UNSIGNED_INT && level.firstIndex * sizeof(GLuint) == offset,
+          "level of detail of the 32 bit mesh");
+
+    // a 16 bit mesh after a 32 bit one needs no padding
+    offset = buffer.GetIndexBytes();
+    CreateFan(3, data, indices);
+    MeshRange last = buffer.AddMesh(data, indices);
+    Check(last.indexType == GL_UNSIGNED_SHORT && last.firstIndex * sizeof(GLushort) == offset,
+          "16 bit mesh after a 32 bit mesh");
+    Check(buffer.GetIndexBytes() == offset + 6, "16 bit mesh after a 32 bit mesh size");
+
+    Check(buffer.GetNumberOfMeshes() == 5 && buffer.GetNumberOfShortIndexMeshes() == 4, "mesh counts");
+
+}
+
+
+// pixels with the heights in the first channel and noise in the others
+static std::vector<uint8_t> CreatePixels(const std::vector<uint8_t>& heights, unsigned int channels){
+
+    std::vector<uint8_t> pixels(heights.size() * channels);
+    for (size_t i = 0; i < heights.size(); i++){
+        pixels[i * channels] = heights[i];
+        for (unsigned int c = 1; c < channels; c++){
+            pixels[i * channels + c] = static_cast<uint8_t>(i * 31 + c * 97);
+        }
+    }
+
+    return pixels;
+}
+
+
+// the SSE2 and AVX2 rows against the scalar code at widths around the vector sizes, known texels of the options
+static void CheckHeightMapConversion(){
+
+    SimdLevel supported = HeightMapProcessor::GetSupportedLevel();
+    const SimdLevel levels[] = {SIMD_SSE2, SIMD_AVX2};
+    for (SimdLevel level : levels){
+        if (level > supported){
+            std::cout << "  " << HeightMapProcessor::GetLevelName(level) << " not supported by the CPU, skipped\n";
+        }
+    }
+
+    HeightMapOptions plain, inverted, normalized, remapped;
+    inverted.invert = true;
+    normalized.normalize = true;
+    remapped.normalize = true;
+    remapped.invert = true;
+    remapped.rangeMin = 0.25f;
+    remapped.rangeMax = 0.75f;
+    const HeightMapOptions optionSets[] = {plain, inverted, normalized, remapped};
+
+    JobSystem jobSystem(4);
+
+    // pseudo random heights in [20, 230] - the normalization stretches them
+    const unsigned int widths[] = {1, 3, 7, 15, 17, 31, 33, 47, 63, 65, 101};
+    const unsigned int height = 37;
+    uint32_t random = 12345;
+    for (unsigned int width : widths){
+
+        std::vector<uint8_t> heights(width * height);
+        for (uint8_t& value : heights){
+            random = random * 1664525u + 1013904223u;
+            value = static_cast<uint8_t>(20 + (random >> 24) % 211);
+        }
+
+        for (unsigned int channels = 1; channels <= 4; channels++){
+
+            std::vector<uint8_t> pixels = CreatePixels(heights, channels);
+            std::string name = "width " + std::to_string(width) + ", " + std::to_string(channels) + " channels";
+
+            for (unsigned int o = 0; o < 4; o++){
+
+                const HeightMapOptions& options = optionSets[o];
+                std::vector<uint8_t> scalar8 = HeightMapProcessor::ConvertR8(pixels.data(), width, height, channels,
+                                                                             options, nullptr, SIMD_SCALAR);
+                std::vector<uint16_t> scalar16 = HeightMapProcessor::ConvertR16(pixels.data(), width, height, channels,
+                                                                                options, nullptr, SIMD_SCALAR);
+
+                for (SimdLevel level : levels){
+                    if (level > supported){
+                        continue;
+                    }
+                    std::string levelName = name + ", " + HeightMapProcessor::GetLevelName(level) + ", options " +
+                                            std::to_string(o);
+                    Check(HeightMapProcessor::ConvertR8(pixels.data(), width, height, channels, options, &jobSystem,
+                                                        level) == scalar8, levelName + ", R8 matches scalar");
+                    Check(HeightMapProcessor::ConvertR16(pixels.data(), width, height, channels, options, &jobSystem,
+                                                         level) == scalar16, levelName + ", R16 matches scalar");
+                }
+
+                // the scalar code against the definition of the options
+                if (o == 0){
+                    Check(scalar8 == heights, name + ", R8 is the first channel");
+                }
+                if (o == 1){
+                    bool match = true;
+                    for (size_t i = 0; i < heights.size(); i++){
+                        match = match && scalar8[i] == 255 - heights[i] && scalar16[i] == 65535 - heights[i] * 257;
+                    }
+                    Check(match, name + ", inverted is 255 - height");
+                }
+            }
+        }
+    }
+
+    // known texels: heights 50..250 stretched to 0..255, inverted, remapped to a quarter .. three quarters
+    const std::vector<uint8_t> known = {50, 90, 130, 250, 90, 50, 250, 130, 130};
+    const std::vector<uint8_t> stretched = {0, 51, 102, 255, 51, 0, 255, 102, 102};
+    for (unsigned int channels = 1; channels <= 4; channels++){
+
+        std::vector<uint8_t> pixels = CreatePixels(known, channels);
+        for (int level = SIMD_SCALAR; level <= supported; level++){
+
+            std::string name = std::to_string(channels) + " channels, " +
+                               HeightMapProcessor::GetLevelName(static_cast<SimdLevel>(level));
+
+            std::vector<uint8_t> texels = HeightMapProcessor::ConvertR8(pixels.data(), 9, 1, channels, normalized,
+                                                                        nullptr, static_cast<SimdLevel>(level));
+            Check(texels == stretched, name + ", normalized R8");
+
+            HeightMapOptions invertedNormalized = normalized;
+            invertedNormalized.invert = true;
+            texels = HeightMapProcessor::ConvertR8(pixels.data(), 9, 1, channels, invertedNormalized, nullptr,
+                                                   static_cast<SimdLevel>(level));
+            bool match = texels.size() == stretched.size();
+            for (size_t i = 0; i < texels.size() && match; i++){
+                match = texels[i] == 255 - stretched[i];
+            }
+            Check(match, name + ", normalized and inverted R8");
+
+            // 0.25 and 0.75 of 65535 (16383.75 and 49151.25) for the lowest and highest height
+            std::vector<uint16_t> wide = HeightMapProcessor::ConvertR16(pixels.data(), 9, 1, channels, remapped,
+                                                                        nullptr, static_cast<SimdLevel>(level));
+            Check(wide.size() == 9 && wide[0] == 49151 && wide[3] == 16384 && wide[5] == 49151 && wide[6] == 16384,
+                  name + ", inverted R16 remapped to [0.25, 0.75]");
+        }
+    }
+
+}
+
+
+// slot of a batch with a bounding sphere and a normal cone
+static CullObject CreateCullObject(unsigned int batch, unsigned int firstSlot, const glm::vec4& sphere,
+                                   const glm::vec4& cone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)){
+
+    CullObject object;
+    object.sphere = sphere;
+    object.cone = cone;
+    object.batch = glm::uvec4(batch, firstSlot, 0, 0);
+
+    return object;
+}
+
+
+// the CPU version of the culling shader: frustum in / out, empty slots, cones, compaction and counts per batch
+static void CheckCulling(){
+
+    // the box [-10, 10]^3 as the frustum (dot(plane.xyz, p) + plane.w >= 0 inside), camera below it
+    CullParameters parameters = {};
+    parameters.frustumPlanes[0] = glm::vec4(1.0f, 0.0f, 0.0f, 10.0f);
+    parameters.frustumPlanes[1] = glm::vec4(-1.0f, 0.0f, 0.0f, 10.0f);
+    parameters.frustumPlanes[2] = glm::vec4(0.0f, 1.0f, 0.0f, 10.0f);
+    parameters.frustumPlanes[3] = glm::vec4(0.0f, -1.0f, 0.0f, 10.0f);
+    parameters.frustumPlanes[4] = glm::vec4(0.0f, 0.0f, 1.0f, 10.0f);
+    parameters.frustumPlanes[5] = glm::vec4(0.0f, 0.0f, -1.0f, 10.0f);
+    parameters.cameraPosition = glm::vec4(0.0f, 0.0f, -20.0f, 1.0f);
+
+    // batch 0 = slots 0-3, batch 1 = slots 4-7
+    std::vector<CullObject> objects = {
+        CreateCullObject(0, 0, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)),      // inside
+        CreateCullObject(0, 0, glm::vec4(50.0f, 0.0f, 0.0f, 1.0f)),     // outside
+        CreateCullObject(0, 0, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f)),     // nothing to draw
+        CreateCullObject(0, 0, glm::vec4(10.5f, 0.0f, 0.0f, 1.0f)),     // crosses a plane
+        CreateCullObject(1, 4, glm::vec4(0.0f, -30.0f, 0.0f, 2.0f)),    // outside
+        CreateCullObject(1, 4, glm::vec4(5.0f, 5.0f, 5.0f, 1.0f)),      // inside
+        CreateCullObject(1, 4, glm::vec4(0.0f, 0.0f, 5.0f, 1.0f), glm::vec4(0.0f, 0.0f, 1.0f, 0.5f)),  // faces away
+        CreateCullObject(1, 4, glm::vec4(0.0f, 0.0f, 5.0f, 1.0f), glm::vec4(0.0f, 0.0f, -1.0f, 0.5f)), // faces the camera
+    };
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    for (unsigned int slot = 0; slot < objects.size(); slot++){
+        commands.push_back({6, 0, slot * 10, static_cast<GLint>(slot), slot});
+    }
+
+    parameters.info = glm::uvec4(objects.size(), 0, 0, 0);
+    std::vector<DrawElementsIndirectCommand> output;
+    std::vector<GLuint> counts(2, 99);
+    GPUCulling::CullDraws(objects, commands, parameters, DepthLevels(), output, counts);
+
+    Check(counts[0] == 2 && counts[1] == 2, "two visible draws per batch");
+    Check(output.size() == commands.size(), "one output command per slot");
+
+    // the visible slots compacted to the start of their batch, the rest empty
+    const int expected[] = {0, 3, -1, -1, 5, 7, -1, -1};
+    bool compacted = output.size() == commands.size();
+    for (unsigned int i = 0; i < output.size() && compacted; i++){
+        if (expected[i] < 0){
+            compacted = output[i].count == 0 && output[i].instanceCount == 0;
+        }
+        else{
+            const DrawElementsIndirectCommand& command = commands[expected[i]];
+            compacted = output[i].count == command.count && output[i].instanceCount == 1 &&
+                        output[i].firstIndex == command.firstIndex && output[i].baseVertex == command.baseVertex &&
+                        output[i].baseInstance == command.baseInstance;
+        }
+    }
+    Check(compacted, "visible commands compacted in slot order");
+
+    // only the first draws of the parameters are culled
+    parameters.info.x = 1;
+    GPUCulling::CullDraws(objects, commands, parameters, DepthLevels(), output, counts);
+    Check(counts[0] == 1 && counts[1] == 0 && output[0].firstIndex == 0, "number of draws limits the slots");
+
+    // occlusion: identity projection, one texel pyramid in front of / behind the sphere (depth 0.7 - 0.8)
+    std::vector<CullObject> occluded = {CreateCullObject(0, 0, glm::vec4(0.0f, 0.0f, 0.5f, 0.1f))};
+    parameters.info = glm::uvec4(1, 1, 0, 0);
+    parameters.occlusionViewProjection = glm::mat4(1.0f);
+    parameters.pyramidSize = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+
+    GPUCulling::CullDraws(occluded, commands, parameters, DepthLevels(1, std::vector<float>(1, 0.5f)), output, counts);
+    Check(counts[0] == 0, "sphere behind the depth pyramid is occluded");
+    GPUCulling::CullDraws(occluded, commands, parameters, DepthLevels(1, std::vector<float>(1, 1.0f)), output, counts);
+    Check(counts[0] == 1, "sphere in front of the depth pyramid is visible");
+    GPUCulling::CullDraws(occluded, commands, parameters, DepthLevels(), output, counts);
+    Check(counts[0] == 1, "no occlusion without a depth pyramid");
+
+}
+
+
+// stride 14 vertex with a tangent frame (position, normal, uv, tangent, bitangent)
+static void AddVertex(std::vector<GLfloat>& data, const glm::vec3& position, const glm::vec3& normal,
+                      const glm::vec3& tangent, const glm::vec3& bitangent){
+
+    data.insert(data.end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z, 0.5f, 0.25f,
+                             tangent.x, tangent.y, tangent.z, bitangent.x, bitangent.y, bitangent.z});
+
+}
+
+
+// half floats at the limits of the format, octahedral normals and the bitangent sign of the packed vertices
+static void CheckVertexFormat(){
+
+    // every half that is not a NaN survives decode and encode
+    bool roundTrip = true;
+    for (uint32_t half = 0; half <= 0xFFFF && roundTrip; half++){
+        if ((half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0){
+            continue;
+        }
+        roundTrip = ObjectParser::Encode_HalfFloat(ObjectParser::Decode_HalfFloat(half)) == half;
+    }
+    Check(roundTrip, "every half round trips");
+
+    Check(ObjectParser::Encode_HalfFloat(0.0f) == 0x0000 && ObjectParser::Encode_HalfFloat(-0.0f) == 0x8000,
+          "zero keeps its sign");
+    Check(ObjectParser::Encode_HalfFloat(std::ldexp(1.0f, -24)) == 0x0001 &&
+          ObjectParser::Decode_HalfFloat(0x0001) == std::ldexp(1.0f, -24), "smallest denormal");
+    Check(ObjectParser::Encode_HalfFloat(std::ldexp(1023.0f, -24)) == 0x03FF, "largest denormal");
+    Check(ObjectParser::Encode_HalfFloat(std::ldexp(1.0f, -25)) == 0x0000 &&
+          ObjectParser::Encode_HalfFloat(std::ldexp(1.001f, -25)) == 0x0001, "half the smallest denormal rounds to even");
+    Check(ObjectParser::Encode_HalfFloat(65504.0f) == 0x7BFF && ObjectParser::Decode_HalfFloat(0x7BFF) == 65504.0f,
+          "largest half");
+    Check(ObjectParser::Encode_HalfFloat(65520.0f) == 0x7C00 && ObjectParser::Encode_HalfFloat(1.0e5f) == 0x7C00 &&
+          ObjectParser::Encode_HalfFloat(-1.0e6f) == 0xFC00, "overflow to infinity");
+    Check(std::isinf(ObjectParser::Decode_HalfFloat(0x7C00)), "infinity decodes to infinity");
+
+    // the axes and vectors of both hemispheres, most of them below the fold (z < 0)
+    std::vector<glm::vec3> vectors = {
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+    };
+    for (int i = 0; i < 200; i++){
+        float angle = i * 0.37f;
+        float z = 0.95f - i * 0.0097f;
+        float radius = std::sqrt(1.0f - z * z);
+        vectors.push_back(glm::vec3(radius * std::cos(angle), radius * std::sin(angle), z));
+    }
+
+    float maximumError = 0.0f;
+    for (const glm::vec3& vector : vectors){
+        int16_t encoded[2];
+        ObjectParser::Encode_Octahedral(vector, encoded);
+        maximumError = std::max(maximumError, glm::length(ObjectParser::Decode_Octahedral(encoded) - vector));
+    }
+    Check(maximumError < 1.0e-3f, "octahedral error below 1e-3 (" + std::to_string(maximumError) + ")");
+
+    // the same normal and tangent with a right handed and a mirrored bitangent
+    std::vector<GLfloat> data;
+    glm::vec3 normal(0.0f, 0.0f, 1.0f);
+    glm::vec3 tangent(1.0f, 0.0f, 0.0f);
+    AddVertex(data, glm::vec3(0.0f), normal, tangent, glm::vec3(0.0f, 1.0f, 0.0f));
+    AddVertex(data, glm::vec3(1.0f), normal, tangent, glm::vec3(0.0f, -1.0f, 0.0f));
+
+    std::vector<PackedVertex> packed;
+    ObjectParser::Pack_Vertices(data, packed);
+    Check(packed.size() == 2 && packed[0].position[3] == 65535 && packed[1].position[3] == 0,
+          "bitangent sign of a mirrored tangent frame");
+
+    // the shader rebuilds the bitangent as cross(normal, tangent) * sign
+    bool rebuilt = packed.size() == 2;
+    for (unsigned int v = 0; v < packed.size() && rebuilt; v++){
+        float sign = packed[v].position[3] == 0 ? -1.0f : 1.0f;
+        glm::vec3 bitangent = glm::cross(ObjectParser::Decode_Octahedral(packed[v].normal),
+                                         ObjectParser::Decode_Octahedral(packed[v].tangent)) * sign;
+        rebuilt = glm::length(bitangent - glm::vec3(data[v * 14 + 11], data[v * 14 + 12], data[v * 14 + 13])) < 1.0e-3f;
+    }
+    Check(rebuilt, "rebuilt bitangents");
+
+}
+
+
+// one 4x4 block of RGBA8 texels - a solid color or a gradient from the first color to the second (transparent alpha)
+static std::vector<uint8_t> CreateBlock(const glm::ivec4& first, const glm::ivec4& second){
+
+    std::vector<uint8_t> pixels(16 * 4);
+    for (unsigned int i = 0; i < 16; i++){
+        glm::ivec4 texel = first + (second - first) * static_cast<int>(i) / 15;
+        for (unsigned int c = 0; c < 4; c++){
+            pixels[i * 4 + c] = static_cast<uint8_t>(texel[c]);
+        }
+    }
+
+    return pixels;
+}
+
+
+// the blocks of every format encoded and decoded: solid colors exactly, gradients above a PSNR floor
+static void CheckBlockCompression(){
+
+    struct Case{
+        TextureUsage usage;
+        BlockFormat format;
+        glm::ivec4 solid;       // representable in the format (565 colors for BC1 and BC3)
+        glm::ivec4 first;       // gradient
+        glm::ivec4 second;
+        double psnrFloor;
+    };
+
+    // 206, 101, 49 = 565 color 25, 25, 6 - the floors are a little below what the palettes of the formats
+    // can reach for a gradient over the whole range (4 colors, 8 values), the BC1 gradient from red to cyan
+    // needs the endpoints swapped for the four color mode
+    const Case cases[] = {
+        {TEXTURE_DIFFUSE, BLOCK_BC1, glm::ivec4(206, 101, 49, 255), glm::ivec4(240, 30, 20, 255),
+         glm::ivec4(20, 200, 230, 255), 23.0},
+        {TEXTURE_DIFFUSE, BLOCK_BC3, glm::ivec4(206, 101, 49, 77), glm::ivec4(10, 40, 90, 0),
+         glm::ivec4(240, 200, 120, 254), 25.0},
+        {TEXTURE_HEIGHT, BLOCK_BC4, glm::ivec4(173, 173, 173, 255), glm::ivec4(0, 0, 0, 255),
+         glm::ivec4(255, 255, 255, 255), 27.0},
+        {TEXTURE_NORMAL, BLOCK_BC5, glm::ivec4(91, 203, 255, 255), glm::ivec4(20, 230, 255, 255),
+         glm::ivec4(235, 15, 255, 255), 28.0},
+    };
+
+    for (const Case& test : cases){
+
+        std::string name = TextureCompressor::GetFormatName(test.format);
+
+        // channels the format keeps
+        unsigned int kept = test.format == BLOCK_BC4 ? 1 : test.format == BLOCK_BC5 ? 2 :
+                            test.format == BLOCK_BC1 ? 3 : 4;
+
+        std::vector<uint8_t> solid = CreateBlock(test.solid, test.solid);
+        CompressedTexture texture = TextureCompressor::Compress(solid.data(), 4, 4, 4, test.usage, nullptr);
+        Check(texture.format == test.format, name + " chosen for the usage");
+
+        std::vector<uint8_t> decoded = TextureCompressor::Decompress(texture, 0);
+        bool exact = decoded.size() == solid.size();
+        for (unsigned int i = 0; i < 16 && exact; i++){
+            for (unsigned int c = 0; c < kept; c++){
+                exact = exact && decoded[i * 4 + c] == solid[i * 4 + c];
+            }
+        }
+        Check(exact, name + " solid block is exact");
+
+        std::vector<uint8_t> gradient = CreateBlock(test.first, test.second);
+        texture = TextureCompressor::Compress(gradient.data(), 4, 4, 4, test.usage, nullptr);
+        double psnr = TextureCompressor::ComputePSNR(gradient.data(), 4, texture, test.usage);
+        Check(texture.format == test.format && psnr >= test.psnrFloor,
+              name + " gradient PSNR " + std::to_string(psnr) + " dB below " + std::to_string(test.psnrFloor));
+    }
+
+}
+
+
+// triangles of the indices with the smallest index first (the winding is kept)
+static std::multiset<std::array<GLuint, 3>> GetTriangles(const std::vector<GLuint>& indices){
+
+    std::multiset<std::array<GLuint, 3>> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3){
+        std::array<GLuint, 3> triangle = {indices[i], indices[i + 1], indices[i + 2]};
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.insert(triangle);
+    }
+
+    return triangles;
+}
+
+
+// the limits of every meshlet and the triangles of the mesh each in exactly one meshlet - also for a mesh of
+// two separate parts (the builder continues with the nearest free triangle)
+static void CheckMeshlets(){
+
+    std::vector<GLfloat> data;
+    std::vector<GLuint> torus;
+    CreateTorusMesh(24, data, torus);
+
+    // a second torus next to the first one
+    std::vector<GLfloat> twoParts = data;
+    std::vector<GLuint> twoPartsIndices = torus;
+    unsigned int numberOfVertices = data.size() / MeshletBuilder::stride;
+    for (unsigned int v = 0; v < numberOfVertices; v++){
+        twoParts.insert(twoParts.end(), data.begin() + v * MeshletBuilder::stride,
+                        data.begin() + (v + 1) * MeshletBuilder::stride);
+        twoParts[(numberOfVertices + v) * MeshletBuilder::stride] += 3.0f;
+    }
+    for (GLuint index : torus){
+        twoPartsIndices.push_back(index + numberOfVertices);
+    }
+
+    struct Limits{
+        unsigned int maxVertices;
+        unsigned int maxTriangles;
+    };
+    const Limits limitSets[] = {{64, 124}, {32, 32}, {16, 40}, {3, 1}};
+
+    for (unsigned int mesh = 0; mesh < 2; mesh++){
+        for (const Limits& limits : limitSets){
+
+            const std::vector<GLfloat>& vertices = mesh == 0 ? data : twoParts;
+            std::vector<GLuint> indices = mesh == 0 ? torus : twoPartsIndices;
+            std::multiset<std::array<GLuint, 3>> triangles = GetTriangles(indices);
+
+            std::vector<Meshlet> meshlets = MeshletBuilder::Build(vertices, indices, limits.maxVertices,
+                                                                  limits.maxTriangles);
+            std::string name = (mesh == 0 ? "torus" : "two tori") + std::string(", ") +
+                               std::to_string(limits.maxVertices) + " vertices / " +
+                               std::to_string(limits.maxTriangles) + " triangles";
+
+            // the meshlets follow each other without gaps and stay in their limits
+            bool contiguous = true;
+            bool withinLimits = true;
+            GLuint next = 0;
+            for (const Meshlet& meshlet : meshlets){
+
+                contiguous = contiguous && meshlet.firstIndex == next && meshlet.indexCount > 0 &&
+                             meshlet.indexCount % 3 == 0;
+                next = meshlet.firstIndex + meshlet.indexCount;
+
+                std::set<GLuint> unique(indices.begin() + std::min<size_t>(meshlet.firstIndex, indices.size()),
+                                        indices.begin() + std::min<size_t>(next, indices.size()));
+                withinLimits = withinLimits && unique.size() <= limits.maxVertices &&
+                               meshlet.indexCount / 3 <= limits.maxTriangles;
+            }
+            Check(contiguous && next == indices.size(), name + ", meshlets cover the index buffer in order");
+            Check(withinLimits, name + ", vertex and triangle limits");
+            Check(GetTriangles(indices) == triangles, name + ", every triangle in exactly one meshlet");
+        }
+    }
+
+}
+
+
+// the levels of detail of a torus: fewer triangles and larger errors with every level, valid triangles,
+// the same levels from the job system
+static void CheckLods(){
+
+    std::vector<GLfloat> data;
+    std::vector<GLuint> indices;
+    CreateTorusMesh(32, data, indices);
+    unsigned int numberOfVertices = data.size() / MeshSimplifier::stride;
+
+    std::vector<MeshLod> lods = MeshSimplifier::BuildLods(data, indices, MeshSimplifier::defaultLevels, nullptr);
+    Check(lods.size() >= 2, "torus has at least two levels (" + std::to_string(lods.size()) + ")");
+
+    size_t previousSize = indices.size();
+    float previousError = 0.0f;
+    for (unsigned int i = 0; i < lods.size(); i++){
+
+        const MeshLod& lod = lods[i];
+        std::string name = "level " + std::to_string(i + 1);
+
+        Check(lod.indices.size() % 3 == 0 && lod.indices.size() < previousSize,
+              name + " has fewer triangles than the level before (" + std::to_string(lod.indices.size() / 3) + ")");
+        Check(lod.indices.size() <= (indices.size() / 3 >> (i + 1)) * 3, name + " reaches its target");
+        Check(lod.error >= previousError, name + " error does not decrease");
+
+        bool valid = true;
+        for (size_t t = 0; t + 2 < lod.indices.size() && valid; t += 3){
+            GLuint a = lod.indices[t], b = lod.indices[t + 1], c = lod.indices[t + 2];
+            valid = a < numberOfVertices && b < numberOfVertices && c < numberOfVertices && a != b && b != c && a != c;
+        }
+        Check(valid, name + " has valid triangles");
+
+        previousSize = lod.indices.size();
+        previousError = lod.error;
+    }
+
+    JobSystem jobSystem(4);
+    std::vector<MeshLod> parallel = MeshSimplifier::BuildLods(data, indices, MeshSimplifier::defaultLevels, &jobSystem);
+    bool same = parallel.size() == lods.size();
+    for (unsigned int i = 0; i < lods.size() && same; i++){
+        same = parallel[i].indices == lods[i].indices && parallel[i].error == lods[i].error;
+    }
+    Check(same, "levels from the job system");
+
+}
+
+
+// parallax method of an object moving away from the camera: the full method, parallax offset and normal
+// mapping in this order, the thresholds at the ratio of their pixels, fewer layers with the distance
+static void CheckParallaxSelection(){
+
+    Object object;
+    object.SetParallaxMethod(2);
+
+    FrameContext context;
+    context.pixelScale = 1000.0f;
+
+    // a unit sphere from 0.01 to 10000 in front of the camera, 0.1 % farther every step
+    std::vector<int> methods;
+    std::vector<float> distances;
+    bool budgets = true;
+    int previousBudget = 1 << 30;
+    for (float distance = 0.01f; distance < 10000.0f; distance *= 1.001f){
+
+        int layerBudget = -1;
+        int method = object.SelectParallaxMethod(context, glm::vec4(0.0f, 0.0f, -1.0f - distance, 1.0f), layerBudget);
+
+        // the budget only for the full method, at least 8 layers and never more with the distance
+        if (method == 2){
+            budgets = budgets && layerBudget >= 8 && layerBudget <= previousBudget;
+            previousBudget = layerBudget;
+        }
+        else{
+            budgets = budgets && layerBudget == 0;
+        }
+
+        if (methods.empty() || methods.back() != method){
+            methods.push_back(method);
+            distances.push_back(distance);
+        }
+    }
+
+    Check(methods == std::vector<int>({2, 0, -1}), "full method, parallax offset and normal mapping in this order");
+    Check(budgets, "layer budgets of the full method");
+
+    if (distances.size() == 3){
+
+        // the displacement falls with the distance - the thresholds are as far apart as their pixels
+        float ratio = distances[2] / distances[1];
+        float expected = context.parallaxLod.offsetPixels / context.parallaxLod.normalPixels;
+        Check(std::abs(ratio / expected - 1.0f) < 0.01f, "normal mapping starts " + std::to_string(expected) +
+              " times farther than parallax offset (" + std::to_string(ratio) + ")");
+
+        // a finer preset keeps the full method farther away, a coarser one switches earlier
+        ParallaxLodSettings settings = context.parallaxLod;
+        glm::vec4 bounds(0.0f, 0.0f, -1.0f - distances[1], 1.0f);
+        int layerBudget = 0;
+
+        context.parallaxLod.offsetPixels = settings.offsetPixels * 2.0f;
+        int coarseMethod = object.SelectParallaxMethod(context, bounds, layerBudget);
+        context.parallaxLod.offsetPixels = settings.offsetPixels * 0.5f;
+        int fineMethod = object.SelectParallaxMethod(context, bounds, layerBudget);
+        Check(coarseMethod == 0 && fineMethod == 2, "offset threshold of the preset moves the switch");
+
+        context.parallaxLod = settings;
+    }
+
+    // no selection without the level of detail, for objects without parallax and inside the sphere
+    int layerBudget = 0;
+    context.parallaxLod.enabled = false;
+    Check(object.SelectParallaxMethod(context, glm::vec4(0.0f, 0.0f, -1000.0f, 1.0f), layerBudget) == 2 &&
+          layerBudget == 0, "disabled level of detail keeps the method");
+    context.parallaxLod.enabled = true;
+    Check(object.SelectParallaxMethod(context, glm::vec4(0.0f, 0.0f, -0.5f, 1.0f), layerBudget) == 2,
+          "camera inside the bounds keeps the method");
+
+    object.SetParallaxMethod(0);
+    Check(object.SelectParallaxMethod(context, glm::vec4(0.0f, 0.0f, -2.0f, 1.0f), layerBudget) == 0 &&
+          layerBudget == 0, "parallax mapping is never raised to a ray marched method");
+    object.SetParallaxMethod(-1);
+    Check(object.SelectParallaxMethod(context, glm::vec4(0.0f, 0.0f, -2.0f, 1.0f), layerBudget) == -1,
+          "objects without parallax stay without");
+
+}
+
+
+bool RunSelfTest(){
+
+    struct Group{
+        const char* name;
+        void (*function)();
+    };
+
+    const Group groups[] = {
+        {"indices", CheckMeshBufferIndices},
+        {"height maps", CheckHeightMapConversion},
+        {"culling", CheckCulling},
+        {"meshlets", CheckMeshlets},
+        {"levels of detail", CheckLods},
+        {"parallax selection", CheckParallaxSelection},
+        {"vertex format", CheckVertexFormat},
+        {"block compression", CheckBlockCompression},
+    };
+
+    unsigned int failedGroups = 0;
+    for (const Group& group : groups){
+
+        gFailures = 0;
+        group.function();
+
+        std::cout << group.name << ": " << (gFailures == 0 ? "ok" : std::to_string(gFailures) + " failed") << "\n";
+        failedGroups += gFailures > 0 ? 1 : 0;
+    }
+
+    std::cout << (failedGroups == 0 ? "All checks passed" : std::to_string(failedGroups) + " groups failed")
+              << std::endl;
+
+    return failedGroups == 0;
+}
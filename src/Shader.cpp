@@ -1,16 +1,25 @@
 #include "Shader.hpp"
+#include "GLExtensions.hpp"
 #include <string>
 #include <fstream>
 #include <iostream>
 
-Shader::Shader(const std::string& vertexShaderSource, const std::string& fragmentShaderSource){
+Shader::Shader(const std::string& vertexShaderSource, const std::string& fragmentShaderSource,
+               const std::string& defines){
     
-    std::string vertexShaderString      = LoadShaderAsString(vertexShaderSource);
-    std::string fragmentShaderString    = LoadShaderAsString(fragmentShaderSource);
+    std::string vertexShaderString      = InsertDefines(LoadShaderAsString(vertexShaderSource), defines);
+    std::string fragmentShaderString    = InsertDefines(LoadShaderAsString(fragmentShaderSource), defines);
     
     this->shaderID = CreateShaderProgram(vertexShaderString, fragmentShaderString);
 }
 
+Shader::Shader(const std::string& computeShaderSource){
+
+    std::string computeShaderString     = LoadShaderAsString(computeShaderSource);
+
+    this->shaderID = CreateComputeProgram(computeShaderString);
+}
+
 Shader::~Shader(){
     // delete pipeline
     glDeleteProgram(this->shaderID);
@@ -52,6 +61,27 @@ std::string Shader::LoadShaderAsString(const std::string& filename){
 }
 
 
+/**
+* Inserts preprocessor defines after the #version line (which has to stay the first line)
+*
+* @param source Shader source code
+* @param defines Lines with the defines
+* @return Source with the defines
+*/
+std::string Shader::InsertDefines(const std::string& source, const std::string& defines){
+
+    if (defines == ""){
+        return source;
+    }
+
+    size_t lineEnd = source.find('\n');
+    if (source.compare(0, 8, "#version") != 0 || lineEnd == std::string::npos){
+        return defines + source;
+    }
+
+    return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
 /**
 * CompileShader will compile any valid vertex, fragment, geometry, tesselation, or compute shader.
 * e.g.
@@ -72,6 +102,8 @@ GLuint Shader::CompileShader(GLuint type, const std::string& source){
 		shaderObject = glCreateShader(GL_VERTEX_SHADER);
 	}else if(type == GL_FRAGMENT_SHADER){
 		shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
+	}else if(type == GL_COMPUTE_SHADER){
+		shaderObject = glCreateShader(GL_COMPUTE_SHADER);
 	}
 
 	const char* src = source.c_str();
@@ -95,6 +127,8 @@ GLuint Shader::CompileShader(GLuint type, const std::string& source){
 			std::cout << "ERROR: GL_VERTEX_SHADER compilation failed!\n" << errorMessages << "\n";
 		}else if(type == GL_FRAGMENT_SHADER){
 			std::cout << "ERROR: GL_FRAGMENT_SHADER compilation failed!\n" << errorMessages << "\n";
+		}else if(type == GL_COMPUTE_SHADER){
+			std::cout << "ERROR: GL_COMPUTE_SHADER compilation failed!\n" << errorMessages << "\n";
 		}
 		// Reclaim our memory
 		delete[] errorMessages;
@@ -145,6 +179,29 @@ GLuint Shader::CreateShaderProgram(const std::string& vertexShaderSource, const
     return programObject;
 }
 
+/**
+* Creates a compute program object with a single Compute Shader
+*
+* @param computeShaderSource Compute shader source code as a string
+* @return id of the program Object
+*/
+GLuint Shader::CreateComputeProgram(const std::string& computeShaderSource){
+
+    GLuint programObject = glCreateProgram();
+
+    GLuint myComputeShader = CompileShader(GL_COMPUTE_SHADER, computeShaderSource);
+
+    glAttachShader(programObject, myComputeShader);
+    glLinkProgram(programObject);
+
+    glValidateProgram(programObject);
+
+    glDetachShader(programObject, myComputeShader);
+    glDeleteShader(myComputeShader);
+
+    return programObject;
+}
+
 void Shader::Upload_Uniform1i_Pipeline(const char * name, int elementValue){
     
     // Upload lights structs 
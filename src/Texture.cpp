@@ -1,5 +1,88 @@
 #include "Texture.hpp"
+#include "TextureStreamer.hpp"
+#include "GLExtensions.hpp"
+#include "FrameTimer.hpp"
+#include "Scene.hpp"
 
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static TextureUploadStatistics uploadStatistics;
+
+// textures with a handle waiting for the draws that may sample them
+struct DeletedTexture{
+    GLuint textureID;
+    GLuint64 handle;
+    GLsync fence;
+};
+
+static std::vector<DeletedTexture> deletedTextures;
+
+
+    ///////////// unpack buffer /////////////
+
+UnpackBuffer::UnpackBuffer(const std::vector<std::pair<const void*, size_t>>& parts){
+
+    size_t size = 0;
+    for (const std::pair<const void*, size_t>& part : parts){
+        size += part.second;
+    }
+
+    // the data is used as it is
+    if (!Texture::UseStorage() || size == 0){
+        for (const std::pair<const void*, size_t>& part : parts){
+            this->pointers.push_back(part.first);
+        }
+        return;
+    }
+
+    glGenBuffers(1, &this->bufferID);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->bufferID);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+
+    uint8_t* mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    size_t offset = 0;
+    for (const std::pair<const void*, size_t>& part : parts){
+        if (mapped != nullptr){
+            std::memcpy(mapped + offset, part.first, part.second);
+        }
+        this->pointers.push_back(reinterpret_cast<const void*>(offset));
+        offset += part.second;
+    }
+
+    // the mapping failed - upload from the client memory
+    if (mapped == nullptr || glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE){
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &this->bufferID);
+        this->bufferID = 0;
+        for (unsigned int i = 0; i < parts.size(); i++){
+            this->pointers[i] = parts[i].first;
+        }
+    }
+
+}
+
+
+UnpackBuffer::~UnpackBuffer(){
+
+    // the driver keeps the data until the texture calls read it
+    if (this->bufferID != 0){
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &this->bufferID);
+    }
+
+}
+
+
+const void* UnpackBuffer::GetPointer(unsigned int part) const{
+    return this->pointers[part];
+}
+
+
+    ///////////// texture /////////////
 
 Texture::Texture(){
 
@@ -7,12 +90,7 @@ Texture::Texture(){
     glGenTextures(1, &this->textureID);
 
     glBindTexture(GL_TEXTURE_2D, this->textureID);
-
-            // set the texture wrapping/filtering options (on the currently bound texture object)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    SetSampling(GL_TEXTURE_2D);
 
 }
 
@@ -20,8 +98,43 @@ Texture::Texture(){
     // delete texture
 Texture::~Texture(){
 
-    glDeleteTextures(1, &this->textureID);
+    if (this->streamer != nullptr){
+        this->streamer->Unregister(this->streamID);
+    }
 
+    DeleteTexture(this->textureID, this->handle);
+
+}
+
+GLuint Texture::GetID() const{
+    return this->textureID;
+}
+
+void Texture::SetStreamer(TextureStreamer* streamer, uint32_t streamID){
+    this->streamer = streamer;
+    this->streamID = streamID;
+}
+
+uint32_t Texture::GetStreamID() const{
+    return this->streamID;
+}
+
+void Texture::ReplaceID(GLuint textureID){
+
+    DeleteTexture(this->textureID, this->handle);
+    this->textureID = textureID;
+    this->immutable = true;
+
+}
+
+GLuint64 Texture::GetHandle(){
+
+    // an incomplete texture has no handle
+    if (this->handle == 0 && this->loaded){
+        this->handle = CreateHandle(this->textureID);
+    }
+
+    return this->handle;
 }
 
 void Texture::Bind(unsigned int slot){
@@ -31,11 +144,238 @@ void Texture::Bind(unsigned int slot){
 
 }
 
+
+void Texture::SetSampling(GLenum target){
+
+    // set the texture wrapping/filtering options (on the currently bound texture object)
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // the ground seen at grazing angles stays sharp
+    if (gGLCapabilities.anisotropicFiltering && gScene.TextureAnisotropy > 1.0f){
+        glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY, std::min(gScene.TextureAnisotropy, gGLCapabilities.maxAnisotropy));
+    }
+
+}
+
+
+bool Texture::UseStorage(){
+    return gScene.ImmutableTextures && gGLCapabilities.textureStorage;
+}
+
+
+GLenum Texture::GetSizedFormat(GLenum format){
+
+    // the sRGB data of the diffuse textures is sampled as it is (the shaders expect sRGB values)
+    switch (format){
+        case GL_RED:  return GL_R8;
+        case GL_RG:   return GL_RG8;
+        case GL_RGB:  return GL_RGB8;
+        case GL_RGBA: return GL_RGBA8;
+    }
+
+    return format;
+}
+
+
+unsigned int Texture::GetNumberOfLevels(unsigned int width, unsigned int height){
+    return static_cast<unsigned int>(std::floor(std::log2(std::max(std::max(width, height), 1u)))) + 1;
+}
+
+
+void Texture::RecordUpload(size_t bytes, double miliseconds){
+
+    uploadStatistics.textures++;
+    uploadStatistics.bytes += bytes;
+    uploadStatistics.miliseconds += miliseconds;
+
+}
+
+
+TextureUploadStatistics Texture::GetUploadStatistics(){
+    return uploadStatistics;
+}
+
+
+GLuint64 Texture::CreateHandle(GLuint textureID){
+
+    // the sampling state is part of the handle - it can not be changed any more
+    GLuint64 handle = glGetTextureHandleARB(textureID);
+    if (handle != 0){
+        glMakeTextureHandleResidentARB(handle);
+    }
+
+    return handle;
+}
+
+
+void Texture::DeleteTexture(GLuint textureID, GLuint64& handle){
+
+    if (handle == 0){
+        glDeleteTextures(1, &textureID);
+        return;
+    }
+
+    deletedTextures.push_back({textureID, handle, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+    handle = 0;
+
+}
+
+
+void Texture::ReleaseDeletedTextures(){
+
+    unsigned int kept = 0;
+    for (DeletedTexture& texture : deletedTextures){
+
+        if (glClientWaitSync(texture.fence, 0, 0) == GL_TIMEOUT_EXPIRED){
+            deletedTextures[kept++] = texture;
+            continue;
+        }
+
+        glDeleteSync(texture.fence);
+        glMakeTextureHandleNonResidentARB(texture.handle);
+        glDeleteTextures(1, &texture.textureID);
+    }
+    deletedTextures.resize(kept);
+
+}
+
+
+void Texture::PrepareStorage(){
+
+    // immutable storage (and a texture with a handle) can not be specified again
+    if (this->immutable || this->handle != 0){
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        SetSampling(GL_TEXTURE_2D);
+        ReplaceID(textureID);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, this->textureID);
+    this->immutable = UseStorage();
+
+}
+
+
 // upload the data to GPU and generate mipmaps
 void Texture::LoadData(GLuint width, GLuint height, unsigned char* data, GLenum format){
-        
-    glBindTexture(GL_TEXTURE_2D, this->textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+
+    double start = FrameTimer::Now();
+    unsigned int channels = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+    size_t size = static_cast<size_t>(width) * height * channels;
+
+    PrepareStorage();
+    // rows of one channel textures are not padded to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (this->immutable){
+        glTexStorage2D(GL_TEXTURE_2D, GetNumberOfLevels(width, height), GetSizedFormat(format), width, height);
+        UnpackBuffer buffer({{data, size}});
+        UpdateRegion(0, 0, 0, width, height, format, buffer.GetPointer(0));
+    }
+    else{
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    }
     glGenerateMipmap(GL_TEXTURE_2D);
+    this->loaded = true;
 
-}
\ No newline at end of file
+    RecordUpload(size, (FrameTimer::Now() - start) * 1000.0);
+
+}
+
+
+void Texture::UpdateRegion(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, const void* data){
+
+    glBindTexture(GL_TEXTURE_2D, this->textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, format, GL_UNSIGNED_BYTE, data);
+
+}
+
+
+// upload the blocks of every level, the mip chain was built when the texture was compressed
+void Texture::LoadCompressed(const CompressedTexture& texture){
+
+    double start = FrameTimer::Now();
+    PrepareStorage();
+
+    bool supported = !TextureCompressor::IsS3TC(texture.format) || gGLCapabilities.textureCompressionS3TC;
+    GLenum format = TextureCompressor::GetGLFormat(texture.format);
+
+    // the levels not loaded yet are streamed later
+    unsigned int baseLevel = 0;
+    while (baseLevel + 1 < texture.levels.size() && texture.levels[baseLevel].data.empty()){
+        baseLevel++;
+    }
+
+    std::vector<std::pair<const void*, size_t>> parts;
+    size_t size = 0;
+    for (unsigned int i = baseLevel; i < texture.levels.size() && supported; i++){
+        parts.push_back({texture.levels[i].data.data(), texture.levels[i].data.size()});
+        size += texture.levels[i].data.size();
+    }
+
+    // the storage holds the levels from the base level on (level 0 of the storage)
+    if (this->immutable && supported){
+
+        const CompressedLevel& base = texture.levels[baseLevel];
+        glTexStorage2D(GL_TEXTURE_2D, texture.levels.size() - baseLevel, format, base.width, base.height);
+
+        UnpackBuffer buffer(parts);
+        for (unsigned int i = baseLevel; i < texture.levels.size(); i++){
+            const CompressedLevel& level = texture.levels[i];
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, i - baseLevel, 0, 0, level.width, level.height, format,
+                                      static_cast<GLsizei>(level.data.size()), buffer.GetPointer(i - baseLevel));
+        }
+    }
+    else if (this->immutable){
+
+        const CompressedLevel& base = texture.levels[baseLevel];
+        glTexStorage2D(GL_TEXTURE_2D, texture.levels.size() - baseLevel, GL_RGBA8, base.width, base.height);
+
+        for (unsigned int i = baseLevel; i < texture.levels.size(); i++){
+            std::vector<uint8_t> rgba = TextureCompressor::Decompress(texture, i);
+            UpdateRegion(i - baseLevel, 0, 0, texture.levels[i].width, texture.levels[i].height, GL_RGBA, rgba.data());
+            size += rgba.size();
+        }
+    }
+    else{
+
+        for (unsigned int i = baseLevel; i < texture.levels.size(); i++){
+
+            const CompressedLevel& level = texture.levels[i];
+
+            if (supported){
+                glCompressedTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0,
+                                       static_cast<GLsizei>(level.data.size()), level.data.data());
+            }
+            else{
+                std::vector<uint8_t> rgba = TextureCompressor::Decompress(texture, i);
+                glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+                size += rgba.size();
+            }
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels.size()) - 1);
+    }
+    this->loaded = true;
+
+    RecordUpload(size, (FrameTimer::Now() - start) * 1000.0);
+
+}
+
+
+void Texture::Load(const TextureImage& image){
+
+    if (image.compressed){
+        LoadCompressed(image.blocks);
+    }
+    else{
+        LoadData(image.width, image.height, const_cast<unsigned char*>(image.pixels.data()), image.format);
+    }
+
+}
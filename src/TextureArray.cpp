@@ -0,0 +1,223 @@
+#include "TextureArray.hpp"
+#include "TextureStreamer.hpp"
+#include "GLExtensions.hpp"
+#include "FrameTimer.hpp"
+
+// STL
+#include <iostream>
+#include <algorithm>
+
+
+TextureArray::TextureArray(){
+
+    glGenTextures(1, &this->textureID);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->textureID);
+
+    // the same sampling as the 2D textures (the ground tiles repeat)
+    Texture::SetSampling(GL_TEXTURE_2D_ARRAY);
+
+}
+
+
+TextureArray::~TextureArray(){
+
+    if (this->streamer != nullptr){
+        this->streamer->Unregister(this->streamID);
+    }
+
+    Texture::DeleteTexture(this->textureID, this->handle);
+
+}
+
+
+void TextureArray::Bind(unsigned int slot){
+
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->textureID);
+
+}
+
+
+bool TextureArray::Load(const std::vector<TextureImage>& layers){
+
+    if (layers.empty()){
+        return false;
+    }
+
+    // every layer has the size, format and levels of the first one
+    const TextureImage& first = layers[0];
+    for (const TextureImage& layer : layers){
+
+        bool same = layer.compressed == first.compressed && layer.width == first.width && layer.height == first.height;
+        if (same && first.compressed){
+            same = layer.blocks.format == first.blocks.format && layer.blocks.levels.size() == first.blocks.levels.size();
+            for (unsigned int i = 0; same && i < first.blocks.levels.size(); i++){
+                same = layer.blocks.levels[i].data.empty() == first.blocks.levels[i].data.empty();
+            }
+        }
+        else if (same){
+            same = layer.format == first.format;
+        }
+
+        if (!same){
+            std::cout << "Texture array: the layers differ in size or format" << std::endl;
+            return false;
+        }
+    }
+
+    double start = FrameTimer::Now();
+    GLsizei depth = static_cast<GLsizei>(layers.size());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, this->textureID);
+
+    // immutable storage (and an array with a handle) can not be specified again
+    if (this->immutable || this->handle != 0){
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+        Texture::SetSampling(GL_TEXTURE_2D_ARRAY);
+        ReplaceID(textureID);
+    }
+    this->immutable = Texture::UseStorage();
+
+    size_t size = 0;
+
+    if (first.compressed){
+
+        bool supported = !TextureCompressor::IsS3TC(first.blocks.format) || gGLCapabilities.textureCompressionS3TC;
+        GLenum format = TextureCompressor::GetGLFormat(first.blocks.format);
+        unsigned int numberOfLevels = first.blocks.levels.size();
+
+        // the levels not loaded yet are streamed later, the storage starts at the base level
+        unsigned int baseLevel = 0;
+        while (baseLevel + 1 < numberOfLevels && first.blocks.levels[baseLevel].data.empty()){
+            baseLevel++;
+        }
+        unsigned int storageLevel = this->immutable ? baseLevel : 0;
+
+        if (this->immutable){
+            const CompressedLevel& base = first.blocks.levels[baseLevel];
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, numberOfLevels - baseLevel, supported ? format : GL_RGBA8,
+                           base.width, base.height, depth);
+        }
+
+        // the layers of a level one after another
+        std::vector<std::vector<uint8_t>> levels(numberOfLevels);
+        std::vector<std::pair<const void*, size_t>> parts;
+        for (unsigned int i = baseLevel; i < numberOfLevels; i++){
+
+            for (const TextureImage& layer : layers){
+                if (supported){
+                    const std::vector<uint8_t>& blocks = layer.blocks.levels[i].data;
+                    levels[i].insert(levels[i].end(), blocks.begin(), blocks.end());
+                }
+                else{
+                    std::vector<uint8_t> rgba = TextureCompressor::Decompress(layer.blocks, i);
+                    levels[i].insert(levels[i].end(), rgba.begin(), rgba.end());
+                }
+            }
+
+            parts.push_back({levels[i].data(), levels[i].size()});
+            size += levels[i].size();
+        }
+
+        UnpackBuffer buffer(parts);
+        for (unsigned int i = baseLevel; i < numberOfLevels; i++){
+
+            const CompressedLevel& level = first.blocks.levels[i];
+            const void* data = buffer.GetPointer(i - baseLevel);
+            GLsizei levelSize = static_cast<GLsizei>(levels[i].size());
+
+            if (this->immutable && supported){
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i - storageLevel, 0, 0, 0, level.width, level.height, depth,
+                                          format, levelSize, data);
+            }
+            else if (this->immutable){
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i - storageLevel, 0, 0, 0, level.width, level.height, depth,
+                                GL_RGBA, GL_UNSIGNED_BYTE, data);
+            }
+            else if (supported){
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, i, format, level.width, level.height, depth, 0,
+                                       levelSize, data);
+            }
+            else{
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGBA8, level.width, level.height, depth, 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, data);
+            }
+        }
+
+        if (!this->immutable){
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, baseLevel);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(numberOfLevels) - 1);
+        }
+    }
+    else{
+
+        std::vector<uint8_t> data;
+        for (const TextureImage& layer : layers){
+            data.insert(data.end(), layer.pixels.begin(), layer.pixels.end());
+        }
+        size = data.size();
+
+        // rows of one channel textures are not padded to 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        UnpackBuffer buffer({{data.data(), data.size()}});
+
+        if (this->immutable){
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, Texture::GetNumberOfLevels(first.width, first.height),
+                           Texture::GetSizedFormat(first.format), first.width, first.height, depth);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, first.width, first.height, depth,
+                            first.format, GL_UNSIGNED_BYTE, buffer.GetPointer(0));
+        }
+        else{
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, first.format, first.width, first.height, depth, 0,
+                         first.format, GL_UNSIGNED_BYTE, data.data());
+        }
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    }
+
+    this->numberOfLayers = layers.size();
+    Texture::RecordUpload(size, (FrameTimer::Now() - start) * 1000.0);
+
+    return true;
+}
+
+
+GLuint TextureArray::GetID() const{
+    return this->textureID;
+}
+
+
+unsigned int TextureArray::GetNumberOfLayers() const{
+    return this->numberOfLayers;
+}
+
+
+void TextureArray::SetStreamer(TextureStreamer* streamer, uint32_t streamID){
+    this->streamer = streamer;
+    this->streamID = streamID;
+}
+
+
+uint32_t TextureArray::GetStreamID() const{
+    return this->streamID;
+}
+
+
+void TextureArray::ReplaceID(GLuint textureID){
+
+    Texture::DeleteTexture(this->textureID, this->handle);
+    this->textureID = textureID;
+    this->immutable = true;
+
+}
+
+
+GLuint64 TextureArray::GetHandle(){
+
+    if (this->handle == 0 && this->numberOfLayers > 0){
+        this->handle = Texture::CreateHandle(this->textureID);
+    }
+
+    return this->handle;
+}
@@ -0,0 +1,391 @@
+#include "TextureCache.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// «KTX 20»\r\n\x1A\n
+static const uint8_t ktxIdentifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// header and index of a KTX 2.0 file
+struct KTX2Header{
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct KTX2Level{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(KTX2Header) == 80, "KTX2Header has to match the file layout");
+static_assert(sizeof(KTX2Level) == 24, "KTX2Level has to match the file layout");
+
+// VkFormat of the blocks
+enum{
+    VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131,
+    VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132,
+    VK_FORMAT_BC3_UNORM_BLOCK = 137,
+    VK_FORMAT_BC3_SRGB_BLOCK = 138,
+    VK_FORMAT_BC4_UNORM_BLOCK = 139,
+    VK_FORMAT_BC5_UNORM_BLOCK = 141
+};
+
+
+// size and modification time of the source file, false if it does not exist
+static bool GetSourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& time){
+
+    std::error_code error;
+
+    size = std::filesystem::file_size(sourcePath, error);
+    if (error){
+        return false;
+    }
+
+    time = std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+    return !error;
+}
+
+
+static uint32_t GetVkFormat(BlockFormat format, bool srgb){
+
+    switch (format){
+        case BLOCK_BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case BLOCK_BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        case BLOCK_BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+        case BLOCK_BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+    }
+
+    return 0;
+}
+
+
+static bool GetBlockFormat(uint32_t vkFormat, BlockFormat& format, bool& srgb){
+
+    srgb = vkFormat == VK_FORMAT_BC1_RGB_SRGB_BLOCK || vkFormat == VK_FORMAT_BC3_SRGB_BLOCK;
+
+    switch (vkFormat){
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:  format = BLOCK_BC1; return true;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:      format = BLOCK_BC3; return true;
+        case VK_FORMAT_BC4_UNORM_BLOCK:     format = BLOCK_BC4; return true;
+        case VK_FORMAT_BC5_UNORM_BLOCK:     format = BLOCK_BC5; return true;
+    }
+
+    return false;
+}
+
+
+static void AppendUint32(std::vector<uint8_t>& data, uint32_t value){
+    data.insert(data.end(), reinterpret_cast<const uint8_t*>(&value), reinterpret_cast<const uint8_t*>(&value) + 4);
+}
+
+
+// basic data format descriptor of the block format (one sample per 64 bit half of the block)
+static std::vector<uint8_t> CreateDataFormatDescriptor(BlockFormat format, bool srgb){
+
+    // color models and channels of the KHR data format specification
+    const uint8_t colorModels[4] = {128, 130, 131, 132};        // BC1A, BC3, BC4, BC5
+    const uint8_t bc3Channels[2] = {15, 0};                     // alpha, color
+    const uint8_t bc5Channels[2] = {0, 1};                      // red, green
+
+    unsigned int numberOfSamples = format == BLOCK_BC3 || format == BLOCK_BC5 ? 2 : 1;
+    uint32_t blockSize = 24 + 16 * numberOfSamples;
+
+    std::vector<uint8_t> descriptor;
+    AppendUint32(descriptor, 4 + blockSize);                    // total size
+    AppendUint32(descriptor, 0);                                // Khronos vendor, basic descriptor type
+    AppendUint32(descriptor, 2 | (blockSize << 16));            // version, block size
+    AppendUint32(descriptor, colorModels[format] | (1 << 8) | ((srgb ? 2 : 1) << 16));     // BT.709 primaries, transfer
+    AppendUint32(descriptor, 3 | (3 << 8));                     // 4x4 texels
+    AppendUint32(descriptor, TextureCompressor::GetBlockBytes(format));
+    AppendUint32(descriptor, 0);
+
+    for (unsigned int i = 0; i < numberOfSamples; i++){
+
+        uint8_t channel = format == BLOCK_BC3 ? bc3Channels[i] : (format == BLOCK_BC5 ? bc5Channels[i] : 0);
+        AppendUint32(descriptor, (64 * i) | (63 << 16) | (channel << 24));     // bit offset, length - 1, channel
+        AppendUint32(descriptor, 0);                                            // sample position
+        AppendUint32(descriptor, 0);                                            // lower
+        AppendUint32(descriptor, 0xFFFFFFFF);                                   // upper
+    }
+
+    return descriptor;
+}
+
+
+// one key/value pair, padded to 4 bytes
+static void AppendKeyValue(std::vector<uint8_t>& data, const std::string& key, const std::string& value){
+
+    AppendUint32(data, static_cast<uint32_t>(key.size() + 1 + value.size() + 1));
+    data.insert(data.end(), key.begin(), key.end());
+    data.push_back(0);
+    data.insert(data.end(), value.begin(), value.end());
+    data.push_back(0);
+
+    while (data.size() % 4 != 0){
+        data.push_back(0);
+    }
+
+}
+
+
+// value of a key, empty if it is missing
+static std::string FindValue(const uint8_t* data, size_t size, const std::string& key){
+
+    size_t offset = 0;
+    while (offset + 4 <= size){
+
+        uint32_t length;
+        std::memcpy(&length, data + offset, 4);
+        if (offset + 4 + length > size){
+            break;
+        }
+
+        const char* pair = reinterpret_cast<const char*>(data + offset + 4);
+        size_t keyLength = strnlen(pair, length);
+        if (std::string(pair, keyLength) == key && keyLength < length){
+            std::string value(pair + keyLength + 1, length - keyLength - 1);
+            return value.substr(0, value.find('\0'));
+        }
+
+        offset += (4 + length + 3) & ~static_cast<size_t>(3);
+    }
+
+    return "";
+}
+
+
+// identifies the sources and the encoder the file was built with, empty if a source is missing
+static std::string GetStampValue(const std::vector<std::string>& sourcePaths, uint32_t version){
+
+    std::string stamp = std::to_string(version);
+
+    for (const std::string& sourcePath : sourcePaths){
+
+        uint64_t size;
+        int64_t time;
+        if (!GetSourceStamp(sourcePath, size, time)){
+            return "";
+        }
+
+        stamp += " " + std::to_string(size) + " " + std::to_string(time);
+    }
+
+    return stamp;
+}
+
+
+std::string TextureCache::GetCachePath(const std::string& sourcePath, bool inverse){
+    return sourcePath + (inverse ? ".inverse.ktx2" : ".ktx2");
+}
+
+
+std::string TextureCache::GetMaterialCachePath(const std::string& normalPath, bool inverse){
+    return normalPath + (inverse ? ".material.inverse.ktx2" : ".material.ktx2");
+}
+
+
+bool TextureCache::Load(const std::string& sourcePath, bool inverse, CompressedTexture& texture, unsigned int maxLevelSize){
+    return Load(GetCachePath(sourcePath, inverse), std::vector<std::string>{sourcePath}, texture, maxLevelSize);
+}
+
+
+bool TextureCache::Save(const std::string& sourcePath, bool inverse, const CompressedTexture& texture){
+    return Save(GetCachePath(sourcePath, inverse), std::vector<std::string>{sourcePath}, texture);
+}
+
+
+// header and level index of the file, false if it is not a KTX2 file of a supported format
+static bool ReadIndex(std::ifstream& file, const std::string& cachePath, KTX2Header& header, std::vector<KTX2Level>& levels,
+                      BlockFormat& format, bool& srgb){
+
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.identifier, ktxIdentifier, sizeof(ktxIdentifier)) != 0){
+        std::cout << "Texture cache " << cachePath << " is not a KTX2 file" << std::endl;
+        return false;
+    }
+
+    if (!GetBlockFormat(header.vkFormat, format, srgb) || header.supercompressionScheme != 0 ||
+        header.levelCount == 0 || header.levelCount > 32){
+        std::cout << "Texture cache " << cachePath << " has an unsupported format" << std::endl;
+        return false;
+    }
+
+    levels.resize(header.levelCount);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(levels.data()), levels.size() * sizeof(KTX2Level)));
+}
+
+
+// bytes of a level by its size, the entry in the index has to match
+static uint64_t GetLevelBytes(const KTX2Header& header, const KTX2Level& levelHeader, BlockFormat format, unsigned int level){
+
+    uint64_t width = std::max(header.pixelWidth >> level, 1u);
+    uint64_t height = std::max(header.pixelHeight >> level, 1u);
+    uint64_t expected = (width + 3) / 4 * ((height + 3) / 4) * TextureCompressor::GetBlockBytes(format);
+
+    return levelHeader.byteLength == expected ? expected : 0;
+}
+
+
+// blocks of a level into size bytes, false if the level has another size
+static bool ReadLevel(std::ifstream& file, const KTX2Header& header, const KTX2Level& levelHeader, BlockFormat format,
+                      unsigned int level, uint8_t* data, size_t size){
+
+    if (GetLevelBytes(header, levelHeader, format, level) != size || size == 0){
+        return false;
+    }
+
+    file.seekg(levelHeader.byteOffset);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(data), size));
+}
+
+
+bool TextureCache::Load(const std::string& cachePath, const std::vector<std::string>& sourcePaths, CompressedTexture& texture,
+                        unsigned int maxLevelSize){
+
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open()){
+        return false;
+    }
+
+    KTX2Header header;
+    std::vector<KTX2Level> levels;
+    if (!ReadIndex(file, cachePath, header, levels, texture.format, texture.srgb)){
+        return false;
+    }
+
+    // stale - compressed again
+    std::vector<uint8_t> keyValues(header.kvdByteLength);
+    file.seekg(header.kvdByteOffset);
+    std::string stamp = GetStampValue(sourcePaths, version);
+    if (stamp == "" || !file.read(reinterpret_cast<char*>(keyValues.data()), keyValues.size()) ||
+        FindValue(keyValues.data(), keyValues.size(), "SourceStamp") != stamp){
+        return false;
+    }
+
+    texture.width = header.pixelWidth;
+    texture.height = header.pixelHeight;
+    texture.levels.resize(header.levelCount);
+
+    for (unsigned int i = 0; i < header.levelCount; i++){
+
+        CompressedLevel& level = texture.levels[i];
+        level.width = std::max(header.pixelWidth >> i, 1u);
+        level.height = std::max(header.pixelHeight >> i, 1u);
+
+        // the finer levels are streamed later
+        if (maxLevelSize > 0 && std::max(level.width, level.height) > maxLevelSize){
+            continue;
+        }
+
+        level.data.resize(GetLevelBytes(header, levels[i], texture.format, i));
+        if (!ReadLevel(file, header, levels[i], texture.format, i, level.data.data(), level.data.size())){
+            std::cout << "Texture cache " << cachePath << " is corrupted" << std::endl;
+            texture.levels.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool TextureCache::LoadLevel(const std::string& cachePath, unsigned int level, uint8_t* data, size_t size){
+
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open()){
+        return false;
+    }
+
+    KTX2Header header;
+    std::vector<KTX2Level> levels;
+    BlockFormat format;
+    bool srgb;
+
+    return ReadIndex(file, cachePath, header, levels, format, srgb) && level < levels.size() &&
+           ReadLevel(file, header, levels[level], format, level, data, size);
+}
+
+
+bool TextureCache::Save(const std::string& cachePath, const std::vector<std::string>& sourcePaths,
+                        const CompressedTexture& texture){
+
+    std::string stamp = GetStampValue(sourcePaths, version);
+    if (stamp == "" || texture.levels.empty()){
+        return false;
+    }
+
+    std::vector<uint8_t> descriptor = CreateDataFormatDescriptor(texture.format, texture.srgb);
+
+    // the keys are sorted
+    std::vector<uint8_t> keyValues;
+    AppendKeyValue(keyValues, "KTXwriter", "Parallax Occlusion Mapping texture compressor");
+    AppendKeyValue(keyValues, "SourceStamp", stamp);
+
+    KTX2Header header = {};
+    std::memcpy(header.identifier, ktxIdentifier, sizeof(ktxIdentifier));
+    header.vkFormat = GetVkFormat(texture.format, texture.srgb);
+    header.typeSize = 1;
+    header.pixelWidth = texture.width;
+    header.pixelHeight = texture.height;
+    header.faceCount = 1;
+    header.levelCount = static_cast<uint32_t>(texture.levels.size());
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(header) + texture.levels.size() * sizeof(KTX2Level));
+    header.dfdByteLength = static_cast<uint32_t>(descriptor.size());
+    header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+    header.kvdByteLength = static_cast<uint32_t>(keyValues.size());
+
+    // the levels follow from the smallest one, each aligned to the block size
+    unsigned int alignment = TextureCompressor::GetBlockBytes(texture.format);
+    uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+    std::vector<KTX2Level> levels(texture.levels.size());
+    for (int i = static_cast<int>(texture.levels.size()) - 1; i >= 0; i--){
+        offset = (offset + alignment - 1) / alignment * alignment;
+        levels[i].byteOffset = offset;
+        levels[i].byteLength = texture.levels[i].data.size();
+        levels[i].uncompressedByteLength = texture.levels[i].data.size();
+        offset += texture.levels[i].data.size();
+    }
+
+    std::ofstream file(cachePath, std::ios::binary);
+    if (!file.is_open()){
+        std::cout << "Could not write the texture cache " << cachePath << std::endl;
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(KTX2Level));
+    file.write(reinterpret_cast<const char*>(descriptor.data()), descriptor.size());
+    file.write(reinterpret_cast<const char*>(keyValues.data()), keyValues.size());
+
+    uint64_t written = header.kvdByteOffset + header.kvdByteLength;
+    const char padding[16] = {};
+    for (int i = static_cast<int>(texture.levels.size()) - 1; i >= 0; i--){
+        file.write(padding, levels[i].byteOffset - written);
+        file.write(reinterpret_cast<const char*>(texture.levels[i].data.data()), texture.levels[i].data.size());
+        written = levels[i].byteOffset + levels[i].byteLength;
+    }
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,794 @@
+#include "TextureCompressor.hpp"
+#include "GLExtensions.hpp"
+#include "FrameTimer.hpp"
+
+// glm lib
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+size_t CompressedTexture::GetSize() const{
+
+    size_t size = 0;
+    for (const CompressedLevel& level : this->levels){
+        size += level.data.size();
+    }
+
+    return size;
+}
+
+
+// split [0, count) over the job system or run it on this thread
+static void RunParallel(JobSystem* jobSystem, unsigned int count, unsigned int groupSize, const JobFunction& function){
+
+    if (jobSystem != nullptr){
+        jobSystem->ParallelFor(count, groupSize, function);
+    }
+    else{
+        function(0, count, 0);
+    }
+
+}
+
+
+    ///////////// color spaces /////////////
+
+static float SRGBToLinear(float color){
+    return color <= 0.04045f ? color / 12.92f : std::pow((color + 0.055f) / 1.055f, 2.4f);
+}
+
+
+static float LinearToSRGB(float color){
+    return color <= 0.0031308f ? color * 12.92f : 1.055f * std::pow(color, 1.0f / 2.4f) - 0.055f;
+}
+
+
+static uint8_t ToByte(float value){
+    return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+
+// 8 bit pixels with 1..4 channels as RGBA8 (grey is copied to all colors)
+static std::vector<uint8_t> ExpandToRGBA(const uint8_t* pixels, size_t numberOfPixels, unsigned int channels){
+
+    std::vector<uint8_t> rgba(numberOfPixels * 4);
+
+    for (size_t i = 0; i < numberOfPixels; i++){
+
+        const uint8_t* source = pixels + i * channels;
+        uint8_t* target = rgba.data() + i * 4;
+
+        if (channels < 3){
+            target[0] = target[1] = target[2] = source[0];
+            target[3] = channels == 2 ? source[1] : 255;
+        }
+        else{
+            target[0] = source[0];
+            target[1] = source[1];
+            target[2] = source[2];
+            target[3] = channels == 4 ? source[3] : 255;
+        }
+    }
+
+    return rgba;
+}
+
+
+    ///////////// mip chain /////////////
+
+// texels in the space they are filtered in: linear color, normal vector or height
+static std::vector<glm::vec4> ToFilterSpace(const std::vector<uint8_t>& rgba, TextureUsage usage){
+
+    float linear[256];
+    for (int i = 0; i < 256; i++){
+        linear[i] = SRGBToLinear(i / 255.0f);
+    }
+
+    std::vector<glm::vec4> texels(rgba.size() / 4);
+
+    for (size_t i = 0; i < texels.size(); i++){
+
+        const uint8_t* texel = rgba.data() + i * 4;
+
+        if (usage == TEXTURE_DIFFUSE){
+            texels[i] = glm::vec4(linear[texel[0]], linear[texel[1]], linear[texel[2]], texel[3] / 255.0f);
+        }
+        else if (usage == TEXTURE_NORMAL){
+            texels[i] = glm::vec4(glm::vec3(texel[0], texel[1], texel[2]) / 255.0f * 2.0f - 1.0f, 1.0f);
+        }
+        else if (usage == TEXTURE_MATERIAL){
+            glm::vec2 xy = glm::vec2(texel[0], texel[1]) / 255.0f * 2.0f - 1.0f;
+            texels[i] = glm::vec4(xy, std::sqrt(std::max(1.0f - glm::dot(xy, xy), 0.0f)), texel[3] / 255.0f);
+        }
+        else{
+            texels[i] = glm::vec4(texel[0] / 255.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    return texels;
+}
+
+
+static std::vector<uint8_t> FromFilterSpace(const std::vector<glm::vec4>& texels, TextureUsage usage){
+
+    std::vector<uint8_t> rgba(texels.size() * 4);
+
+    for (size_t i = 0; i < texels.size(); i++){
+
+        glm::vec4 texel = texels[i];
+        uint8_t* target = rgba.data() + i * 4;
+
+        if (usage == TEXTURE_DIFFUSE){
+            texel = glm::vec4(LinearToSRGB(texel.r), LinearToSRGB(texel.g), LinearToSRGB(texel.b), texel.a);
+        }
+        else if (usage == TEXTURE_NORMAL){
+            texel = glm::vec4(glm::vec3(texel) * 0.5f + 0.5f, 1.0f);
+        }
+        else if (usage == TEXTURE_MATERIAL){
+            texel = glm::vec4(glm::vec2(texel) * 0.5f + 0.5f, 0.0f, texel.a);
+        }
+        else{
+            texel = glm::vec4(texel.r, texel.r, texel.r, 1.0f);
+        }
+
+        target[0] = ToByte(texel.r);
+        target[1] = ToByte(texel.g);
+        target[2] = ToByte(texel.b);
+        target[3] = ToByte(texel.a);
+    }
+
+    return rgba;
+}
+
+
+// 2x2 box filter to the next level (odd sizes drop the last row or column), normals are renormalized
+static std::vector<glm::vec4> Downsample(const std::vector<glm::vec4>& texels, unsigned int width, unsigned int height,
+                                         TextureUsage usage, JobSystem* jobSystem){
+
+    unsigned int nextWidth = std::max(width / 2, 1u);
+    unsigned int nextHeight = std::max(height / 2, 1u);
+    std::vector<glm::vec4> next(static_cast<size_t>(nextWidth) * nextHeight);
+
+    JobFunction rowJob = [&](unsigned int begin, unsigned int end, unsigned int){
+
+        for (unsigned int y = begin; y < end; y++){
+
+            unsigned int y0 = std::min(2 * y, height - 1);
+            unsigned int y1 = std::min(2 * y + 1, height - 1);
+
+            for (unsigned int x = 0; x < nextWidth; x++){
+
+                unsigned int x0 = std::min(2 * x, width - 1);
+                unsigned int x1 = std::min(2 * x + 1, width - 1);
+
+                glm::vec4 sum = texels[static_cast<size_t>(y0) * width + x0] + texels[static_cast<size_t>(y0) * width + x1] +
+                                texels[static_cast<size_t>(y1) * width + x0] + texels[static_cast<size_t>(y1) * width + x1];
+                glm::vec4 texel = sum * 0.25f;
+
+                if (usage == TEXTURE_NORMAL || usage == TEXTURE_MATERIAL){
+                    float length = glm::length(glm::vec3(texel));
+                    texel = glm::vec4(length > 1e-6f ? glm::vec3(texel) / length : glm::vec3(0.0f, 0.0f, 1.0f), texel.a);
+                }
+
+                next[static_cast<size_t>(y) * nextWidth + x] = texel;
+            }
+        }
+    };
+
+    RunParallel(jobSystem, nextHeight, 16, rowJob);
+
+    return next;
+}
+
+
+    ///////////// blocks /////////////
+
+// 4x4 texels of a block, clamped at the edges of the level
+static void LoadBlock(const uint8_t* rgba, unsigned int width, unsigned int height,
+                      unsigned int blockX, unsigned int blockY, uint8_t block[16][4]){
+
+    for (unsigned int y = 0; y < 4; y++){
+        for (unsigned int x = 0; x < 4; x++){
+
+            unsigned int pixelX = std::min(blockX * 4 + x, width - 1);
+            unsigned int pixelY = std::min(blockY * 4 + y, height - 1);
+            std::memcpy(block[y * 4 + x], rgba + (static_cast<size_t>(pixelY) * width + pixelX) * 4, 4);
+        }
+    }
+
+}
+
+
+static uint16_t PackRGB565(const glm::vec3& color){
+
+    int r = std::min(std::max(static_cast<int>(color.r * 31.0f / 255.0f + 0.5f), 0), 31);
+    int g = std::min(std::max(static_cast<int>(color.g * 63.0f / 255.0f + 0.5f), 0), 63);
+    int b = std::min(std::max(static_cast<int>(color.b * 31.0f / 255.0f + 0.5f), 0), 31);
+
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+
+static glm::ivec3 UnpackRGB565(uint16_t color){
+
+    int r = (color >> 11) & 31;
+    int g = (color >> 5) & 63;
+    int b = color & 31;
+
+    return glm::ivec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+
+// the four colors of a BC1 block (three and transparent black if color0 <= color1 and not BC3)
+static void GetColorPalette(uint16_t color0, uint16_t color1, bool fourColors, glm::ivec3 palette[4]){
+
+    palette[0] = UnpackRGB565(color0);
+    palette[1] = UnpackRGB565(color1);
+
+    if (fourColors || color0 > color1){
+        palette[2] = (2 * palette[0] + palette[1] + 1) / 3;
+        palette[3] = (palette[0] + 2 * palette[1] + 1) / 3;
+    }
+    else{
+        palette[2] = (palette[0] + palette[1] + 1) / 2;
+        palette[3] = glm::ivec3(0);
+    }
+
+}
+
+
+// nearest palette color of every texel, returns the squared error
+static int SelectColorIndices(const glm::ivec3 colors[16], uint16_t color0, uint16_t color1, uint32_t& indices){
+
+    glm::ivec3 palette[4];
+    GetColorPalette(color0, color1, true, palette);
+
+    int error = 0;
+    indices = 0;
+
+    for (unsigned int i = 0; i < 16; i++){
+
+        int bestError = 1 << 30;
+        uint32_t best = 0;
+
+        for (uint32_t p = 0; p < 4; p++){
+            glm::ivec3 difference = colors[i] - palette[p];
+            int distance = difference.x * difference.x + difference.y * difference.y + difference.z * difference.z;
+            if (distance < bestError){
+                bestError = distance;
+                best = p;
+            }
+        }
+
+        indices |= best << (2 * i);
+        error += bestError;
+    }
+
+    return error;
+}
+
+
+static void WriteColorBlock(uint16_t color0, uint16_t color1, uint32_t indices, uint8_t* output){
+
+    output[0] = color0 & 0xFF;
+    output[1] = color0 >> 8;
+    output[2] = color1 & 0xFF;
+    output[3] = color1 >> 8;
+    for (unsigned int i = 0; i < 4; i++){
+        output[4 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+
+}
+
+
+// BC1 color block in the four color mode
+static void EncodeColorBlock(const uint8_t block[16][4], uint8_t* output){
+
+    glm::ivec3 colors[16];
+    glm::vec3 mean = glm::vec3(0.0f);
+    for (unsigned int i = 0; i < 16; i++){
+        colors[i] = glm::ivec3(block[i][0], block[i][1], block[i][2]);
+        mean += glm::vec3(colors[i]);
+    }
+    mean /= 16.0f;
+
+    // principal axis of the colors by power iteration on the covariance
+    glm::mat3 covariance = glm::mat3(0.0f);
+    for (unsigned int i = 0; i < 16; i++){
+        glm::vec3 d = glm::vec3(colors[i]) - mean;
+        covariance += glm::outerProduct(d, d);
+    }
+
+    glm::vec3 axis = glm::vec3(covariance[0][0], covariance[1][1], covariance[2][2]);
+    for (unsigned int iteration = 0; iteration < 8; iteration++){
+        axis = covariance * axis;
+        float largest = std::max(std::abs(axis.x), std::max(std::abs(axis.y), std::abs(axis.z)));
+        if (largest < 1e-6f){
+            break;
+        }
+        axis /= largest;
+    }
+
+    glm::vec3 endpoint0 = mean;
+    glm::vec3 endpoint1 = mean;
+    float axisLength = glm::length(axis);
+    if (axisLength > 1e-6f){
+
+        axis /= axisLength;
+        float minimum = 1e30f;
+        float maximum = -1e30f;
+        for (unsigned int i = 0; i < 16; i++){
+            float t = glm::dot(glm::vec3(colors[i]) - mean, axis);
+            minimum = std::min(minimum, t);
+            maximum = std::max(maximum, t);
+        }
+
+        endpoint0 = mean + axis * maximum;
+        endpoint1 = mean + axis * minimum;
+    }
+
+    uint16_t color0 = PackRGB565(endpoint0);
+    uint16_t color1 = PackRGB565(endpoint1);
+    uint32_t indices;
+    int error = SelectColorIndices(colors, color0, color1, indices);
+
+    // least squares endpoints of the chosen indices
+    const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    for (unsigned int iteration = 0; iteration < 2 && error > 0; iteration++){
+
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+        glm::vec3 ax = glm::vec3(0.0f), bx = glm::vec3(0.0f);
+        for (unsigned int i = 0; i < 16; i++){
+            float a = weights[(indices >> (2 * i)) & 3];
+            float b = 1.0f - a;
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+            ax += a * glm::vec3(colors[i]);
+            bx += b * glm::vec3(colors[i]);
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f){
+            break;
+        }
+
+        glm::vec3 fitted0 = glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f);
+        glm::vec3 fitted1 = glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f);
+
+        uint16_t fittedColor0 = PackRGB565(fitted0);
+        uint16_t fittedColor1 = PackRGB565(fitted1);
+        uint32_t fittedIndices;
+        int fittedError = SelectColorIndices(colors, fittedColor0, fittedColor1, fittedIndices);
+        if (fittedError >= error){
+            break;
+        }
+
+        color0 = fittedColor0;
+        color1 = fittedColor1;
+        indices = fittedIndices;
+        error = fittedError;
+    }
+
+    // color0 > color1 selects the four color mode - swapping the endpoints swaps the index pairs 0/1 and 2/3
+    if (color0 < color1){
+        std::swap(color0, color1);
+        indices ^= 0x55555555u;
+    }
+    else if (color0 == color1){
+        indices = 0;
+    }
+
+    WriteColorBlock(color0, color1, indices, output);
+
+}
+
+
+// the eight values of a BC4 block (six, 0 and 255 if value0 <= value1)
+static void GetValuePalette(int value0, int value1, int palette[8]){
+
+    palette[0] = value0;
+    palette[1] = value1;
+
+    if (value0 > value1){
+        for (int k = 1; k <= 6; k++){
+            palette[k + 1] = ((7 - k) * value0 + k * value1 + 3) / 7;
+        }
+    }
+    else{
+        for (int k = 1; k <= 4; k++){
+            palette[k + 1] = ((5 - k) * value0 + k * value1 + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+}
+
+
+// BC4 block of one channel in the eight value mode
+static void EncodeValueBlock(const uint8_t values[16], uint8_t* output){
+
+    int minimum = 255;
+    int maximum = 0;
+    for (unsigned int i = 0; i < 16; i++){
+        minimum = std::min(minimum, static_cast<int>(values[i]));
+        maximum = std::max(maximum, static_cast<int>(values[i]));
+    }
+
+    int palette[8];
+    GetValuePalette(maximum, minimum, palette);
+
+    uint64_t indices = 0;
+    if (maximum > minimum){
+        for (unsigned int i = 0; i < 16; i++){
+
+            int bestError = 1 << 30;
+            uint64_t best = 0;
+            for (uint64_t p = 0; p < 8; p++){
+                int distance = std::abs(static_cast<int>(values[i]) - palette[p]);
+                if (distance < bestError){
+                    bestError = distance;
+                    best = p;
+                }
+            }
+
+            indices |= best << (3 * i);
+        }
+    }
+
+    output[0] = static_cast<uint8_t>(maximum);
+    output[1] = static_cast<uint8_t>(minimum);
+    for (unsigned int i = 0; i < 6; i++){
+        output[2 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+
+}
+
+
+static void DecodeColorBlock(const uint8_t* input, bool fourColors, uint8_t block[16][4]){
+
+    uint16_t color0 = input[0] | (input[1] << 8);
+    uint16_t color1 = input[2] | (input[3] << 8);
+    uint32_t indices = input[4] | (input[5] << 8) | (input[6] << 16) | (static_cast<uint32_t>(input[7]) << 24);
+
+    glm::ivec3 palette[4];
+    GetColorPalette(color0, color1, fourColors, palette);
+    bool transparent = !fourColors && color0 <= color1;
+
+    for (unsigned int i = 0; i < 16; i++){
+        uint32_t index = (indices >> (2 * i)) & 3;
+        block[i][0] = static_cast<uint8_t>(palette[index].x);
+        block[i][1] = static_cast<uint8_t>(palette[index].y);
+        block[i][2] = static_cast<uint8_t>(palette[index].z);
+        block[i][3] = transparent && index == 3 ? 0 : 255;
+    }
+
+}
+
+
+static void DecodeValueBlock(const uint8_t* input, uint8_t values[16]){
+
+    int palette[8];
+    GetValuePalette(input[0], input[1], palette);
+
+    uint64_t indices = 0;
+    for (unsigned int i = 0; i < 6; i++){
+        indices |= static_cast<uint64_t>(input[2 + i]) << (8 * i);
+    }
+
+    for (unsigned int i = 0; i < 16; i++){
+        values[i] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+    }
+
+}
+
+
+// one block of the format from 4x4 RGBA8 texels
+static void EncodeBlock(BlockFormat format, const uint8_t block[16][4], uint8_t* output){
+
+    uint8_t values[16];
+
+    switch (format){
+
+        case BLOCK_BC1:
+            EncodeColorBlock(block, output);
+            break;
+
+        case BLOCK_BC3:
+            for (unsigned int i = 0; i < 16; i++){
+                values[i] = block[i][3];
+            }
+            EncodeValueBlock(values, output);
+            EncodeColorBlock(block, output + 8);
+            break;
+
+        case BLOCK_BC4:
+            for (unsigned int i = 0; i < 16; i++){
+                values[i] = block[i][0];
+            }
+            EncodeValueBlock(values, output);
+            break;
+
+        case BLOCK_BC5:
+            for (unsigned int channel = 0; channel < 2; channel++){
+                for (unsigned int i = 0; i < 16; i++){
+                    values[i] = block[i][channel];
+                }
+                EncodeValueBlock(values, output + 8 * channel);
+            }
+            break;
+    }
+
+}
+
+
+static void DecodeBlock(BlockFormat format, const uint8_t* input, uint8_t block[16][4]){
+
+    uint8_t values[16];
+
+    switch (format){
+
+        case BLOCK_BC1:
+            DecodeColorBlock(input, false, block);
+            break;
+
+        case BLOCK_BC3:
+            DecodeColorBlock(input + 8, true, block);
+            DecodeValueBlock(input, values);
+            for (unsigned int i = 0; i < 16; i++){
+                block[i][3] = values[i];
+            }
+            break;
+
+        case BLOCK_BC4:
+        case BLOCK_BC5:
+            std::memset(block, 0, 16 * 4);
+            for (unsigned int channel = 0; channel < (format == BLOCK_BC5 ? 2u : 1u); channel++){
+                DecodeValueBlock(input + 8 * channel, values);
+                for (unsigned int i = 0; i < 16; i++){
+                    block[i][channel] = values[i];
+                }
+            }
+            for (unsigned int i = 0; i < 16; i++){
+                block[i][3] = 255;
+            }
+            break;
+    }
+
+}
+
+
+// blocks of one level, the block rows are encoded in parallel
+static CompressedLevel EncodeLevel(const std::vector<uint8_t>& rgba, unsigned int width, unsigned int height,
+                                   BlockFormat format, JobSystem* jobSystem){
+
+    CompressedLevel level;
+    level.width = width;
+    level.height = height;
+
+    unsigned int blocksX = (width + 3) / 4;
+    unsigned int blocksY = (height + 3) / 4;
+    unsigned int blockBytes = TextureCompressor::GetBlockBytes(format);
+    level.data.resize(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+
+    JobFunction rowJob = [&](unsigned int begin, unsigned int end, unsigned int){
+
+        uint8_t block[16][4];
+        for (unsigned int blockY = begin; blockY < end; blockY++){
+            for (unsigned int blockX = 0; blockX < blocksX; blockX++){
+                LoadBlock(rgba.data(), width, height, blockX, blockY, block);
+                EncodeBlock(format, block, level.data.data() + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes);
+            }
+        }
+    };
+
+    RunParallel(jobSystem, blocksY, 4, rowJob);
+
+    return level;
+}
+
+
+    ///////////// TextureCompressor /////////////
+
+CompressedTexture TextureCompressor::Compress(const uint8_t* pixels, unsigned int width, unsigned int height,
+                                              unsigned int channels, TextureUsage usage, JobSystem* jobSystem,
+                                              TextureCompressionStatistics* statistics){
+
+    double start = FrameTimer::Now();
+
+    CompressedTexture texture;
+    texture.width = width;
+    texture.height = height;
+    texture.srgb = usage == TEXTURE_DIFFUSE;
+
+    std::vector<uint8_t> rgba = ExpandToRGBA(pixels, static_cast<size_t>(width) * height, channels);
+
+    bool alpha = false;
+    if (usage == TEXTURE_DIFFUSE && (channels == 2 || channels == 4)){
+        for (size_t i = 3; i < rgba.size() && !alpha; i += 4){
+            alpha = rgba[i] < 255;
+        }
+    }
+
+    if (usage == TEXTURE_NORMAL){
+        texture.format = BLOCK_BC5;
+    }
+    else if (usage == TEXTURE_HEIGHT){
+        texture.format = BLOCK_BC4;
+    }
+    else if (usage == TEXTURE_MATERIAL){
+        texture.format = BLOCK_BC3;
+    }
+    else{
+        texture.format = alpha ? BLOCK_BC3 : BLOCK_BC1;
+    }
+
+    size_t uncompressedBytes = 0;
+
+    // level 0 is encoded from the source, the next levels from the filtered ones
+    std::vector<glm::vec4> texels;
+    unsigned int levelWidth = width;
+    unsigned int levelHeight = height;
+
+    while (true){
+
+        texture.levels.push_back(EncodeLevel(rgba, levelWidth, levelHeight, texture.format, jobSystem));
+        uncompressedBytes += static_cast<size_t>(levelWidth) * levelHeight * channels;
+
+        if (levelWidth == 1 && levelHeight == 1){
+            break;
+        }
+
+        if (texels.empty()){
+            texels = ToFilterSpace(rgba, usage);
+        }
+
+        texels = Downsample(texels, levelWidth, levelHeight, usage, jobSystem);
+        levelWidth = std::max(levelWidth / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+        rgba = FromFilterSpace(texels, usage);
+    }
+
+    if (statistics != nullptr){
+        statistics->uncompressedBytes = uncompressedBytes;
+        statistics->compressedBytes = texture.GetSize();
+        statistics->miliseconds = (FrameTimer::Now() - start) * 1000.0;
+        statistics->psnr = ComputePSNR(pixels, channels, texture, usage);
+    }
+
+    return texture;
+}
+
+
+std::vector<uint8_t> TextureCompressor::Decompress(const CompressedTexture& texture, unsigned int level){
+
+    const CompressedLevel& source = texture.levels[level];
+    std::vector<uint8_t> rgba(static_cast<size_t>(source.width) * source.height * 4);
+
+    unsigned int blocksX = (source.width + 3) / 4;
+    unsigned int blocksY = (source.height + 3) / 4;
+    unsigned int blockBytes = GetBlockBytes(texture.format);
+
+    uint8_t block[16][4];
+    for (unsigned int blockY = 0; blockY < blocksY; blockY++){
+        for (unsigned int blockX = 0; blockX < blocksX; blockX++){
+
+            DecodeBlock(texture.format, source.data.data() + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes, block);
+
+            // texels outside of the level are padding
+            for (unsigned int y = 0; y < 4 && blockY * 4 + y < source.height; y++){
+                for (unsigned int x = 0; x < 4 && blockX * 4 + x < source.width; x++){
+                    size_t pixel = static_cast<size_t>(blockY * 4 + y) * source.width + blockX * 4 + x;
+                    std::memcpy(rgba.data() + pixel * 4, block[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+
+    return rgba;
+}
+
+
+double TextureCompressor::ComputePSNR(const uint8_t* pixels, unsigned int channels, const CompressedTexture& texture,
+                                      TextureUsage usage){
+
+    std::vector<uint8_t> source = ExpandToRGBA(pixels, static_cast<size_t>(texture.width) * texture.height, channels);
+    std::vector<uint8_t> decoded = Decompress(texture, 0);
+
+    // channels the usage keeps
+    bool compared[4] = {true, true, true, texture.format == BLOCK_BC3};
+    if (usage == TEXTURE_NORMAL){
+        compared[2] = false;
+    }
+    else if (usage == TEXTURE_HEIGHT){
+        compared[1] = compared[2] = false;
+    }
+    else if (usage == TEXTURE_MATERIAL){
+        compared[2] = false;
+    }
+
+    unsigned int numberOfChannels = compared[0] + compared[1] + compared[2] + compared[3];
+
+    double squaredError = 0.0;
+    for (size_t i = 0; i < source.size(); i += 4){
+        for (unsigned int c = 0; c < 4; c++){
+            if (compared[c]){
+                double difference = static_cast<double>(source[i + c]) - decoded[i + c];
+                squaredError += difference * difference;
+            }
+        }
+    }
+
+    double meanSquaredError = squaredError / (source.size() / 4 * numberOfChannels);
+    if (meanSquaredError <= 0.0){
+        return 99.0;    // lossless
+    }
+
+    return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+
+std::vector<uint8_t> TextureCompressor::PackMaterial(const uint8_t* normalPixels, unsigned int normalChannels,
+                                                    const uint8_t* heightPixels, unsigned int heightChannels,
+                                                    unsigned int width, unsigned int height, bool invertHeight){
+
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; i++){
+
+        uint8_t value = heightPixels[i * heightChannels];
+
+        rgba[4 * i + 0] = normalPixels[i * normalChannels];
+        rgba[4 * i + 1] = normalPixels[i * normalChannels + (normalChannels > 1 ? 1 : 0)];
+        rgba[4 * i + 2] = 0;
+        rgba[4 * i + 3] = invertHeight ? InvertHeight(value) : value;
+    }
+
+    return rgba;
+}
+
+
+uint8_t TextureCompressor::InvertHeight(uint8_t height){
+    return static_cast<uint8_t>(255 - height);
+}
+
+
+unsigned int TextureCompressor::GetBlockBytes(BlockFormat format){
+    return format == BLOCK_BC1 || format == BLOCK_BC4 ? 8 : 16;
+}
+
+
+GLenum TextureCompressor::GetGLFormat(BlockFormat format){
+
+    // the sRGB data of the diffuse textures is sampled as it is (the shaders expect sRGB values)
+    switch (format){
+        case BLOCK_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BLOCK_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BLOCK_BC4: return GL_COMPRESSED_RED_RGTC1;
+        case BLOCK_BC5: return GL_COMPRESSED_RG_RGTC2;
+    }
+
+    return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+
+bool TextureCompressor::IsS3TC(BlockFormat format){
+    return format == BLOCK_BC1 || format == BLOCK_BC3;
+}
+
+
+const char* TextureCompressor::GetFormatName(BlockFormat format){
+
+    switch (format){
+        case BLOCK_BC1: return "BC1";
+        case BLOCK_BC3: return "BC3";
+        case BLOCK_BC4: return "BC4";
+        case BLOCK_BC5: return "BC5";
+    }
+
+    return "?";
+}
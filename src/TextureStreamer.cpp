@@ -0,0 +1,513 @@
+#include "TextureStreamer.hpp"
+#include "TextureCache.hpp"
+#include "GLExtensions.hpp"
+
+// STL
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+TextureStreamer::TextureStreamer(size_t budgetBytes){
+
+    this->budgetBytes = budgetBytes;
+    this->statistics.budgetBytes = budgetBytes;
+    this->curveQuality.assign(this->curveFractions.size(), 0.0);
+
+    this->loader = std::thread(&TextureStreamer::LoaderLoop, this);
+
+}
+
+
+TextureStreamer::~TextureStreamer(){
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+    this->condition.notify_all();
+
+    this->loader.join();
+
+}
+
+
+bool TextureStreamer::Register(Texture& texture, const TextureImage& image){
+
+    if (!image.compressed || image.cachePath.empty() || image.blocks.levels.empty()){
+        return false;
+    }
+
+    StreamedTexture streamed;
+    streamed.target = GL_TEXTURE_2D;
+    streamed.texture = &texture;
+    streamed.format = TextureCompressor::GetGLFormat(image.blocks.format);
+    streamed.width = image.blocks.width;
+    streamed.height = image.blocks.height;
+    streamed.files = {image.cachePath};
+
+    texture.SetStreamer(this, Add(streamed, image.blocks.levels));
+    return true;
+}
+
+
+bool TextureStreamer::Register(TextureArray& array, const std::vector<TextureImage>& layers){
+
+    if (layers.empty()){
+        return false;
+    }
+
+    StreamedTexture streamed;
+    for (const TextureImage& layer : layers){
+        if (!layer.compressed || layer.cachePath.empty() || layer.blocks.levels.empty()){
+            return false;
+        }
+        streamed.files.push_back(layer.cachePath);
+    }
+
+    const CompressedTexture& first = layers[0].blocks;
+    streamed.target = GL_TEXTURE_2D_ARRAY;
+    streamed.array = &array;
+    streamed.format = TextureCompressor::GetGLFormat(first.format);
+    streamed.width = first.width;
+    streamed.height = first.height;
+    streamed.depth = layers.size();
+
+    array.SetStreamer(this, Add(streamed, first.levels));
+    return true;
+}
+
+
+uint32_t TextureStreamer::Add(StreamedTexture texture, const std::vector<CompressedLevel>& levels){
+
+    unsigned int numberOfLevels = levels.size();
+    texture.residentLevel = numberOfLevels - 1;
+    texture.minimumLevel = numberOfLevels - 1;
+
+    for (unsigned int i = numberOfLevels; i-- > 0;){
+
+        const CompressedLevel& level = levels[i];
+        if (!level.data.empty()){
+            texture.residentLevel = i;
+        }
+        if (std::max(level.width, level.height) <= initialLevelSize){
+            texture.minimumLevel = i;
+        }
+    }
+
+    // the layers of a level have the same size
+    unsigned int blockBytes = 0;
+    for (const CompressedLevel& level : levels){
+        if (!level.data.empty()){
+            blockBytes = level.data.size() / (((level.width + 3) / 4) * ((level.height + 3) / 4));
+            break;
+        }
+    }
+
+    for (const CompressedLevel& level : levels){
+        texture.levelBytes.push_back(static_cast<size_t>((level.width + 3) / 4) * ((level.height + 3) / 4) *
+                                     blockBytes * texture.depth);
+    }
+    texture.targetLevel = texture.residentLevel;
+
+    this->statistics.fullBytes += GetBytes(texture, 0);
+    this->statistics.residentBytes += GetBytes(texture, texture.residentLevel);
+    this->statistics.textures++;
+
+    this->textures.push_back(texture);
+    this->requests.emplace_back(0);
+
+    return this->textures.size() - 1;
+}
+
+
+void TextureStreamer::Unregister(uint32_t streamID){
+
+    if (streamID >= this->textures.size() || !this->textures[streamID].active){
+        return;
+    }
+
+    StreamedTexture& texture = this->textures[streamID];
+    texture.active = false;
+
+    this->statistics.fullBytes -= GetBytes(texture, 0);
+    this->statistics.residentBytes -= GetBytes(texture, texture.residentLevel);
+    this->statistics.textures--;
+
+}
+
+
+void TextureStreamer::Request(uint32_t streamID, float pixels){
+
+    if (streamID >= this->requests.size() || !(pixels > 0.0f)){
+        return;
+    }
+
+    // positive floats keep their order as integers
+    uint32_t bits;
+    std::memcpy(&bits, &pixels, sizeof(bits));
+
+    std::atomic<uint32_t>& request = this->requests[streamID];
+    uint32_t current = request.load(std::memory_order_relaxed);
+    while (bits > current && !request.compare_exchange_weak(current, bits, std::memory_order_relaxed)){ }
+
+}
+
+
+size_t TextureStreamer::GetBytes(const StreamedTexture& texture, unsigned int level) const{
+
+    size_t bytes = 0;
+    for (unsigned int i = level; i < texture.levelBytes.size(); i++){
+        bytes += texture.levelBytes[i];
+    }
+
+    return bytes;
+}
+
+
+unsigned int TextureStreamer::GetWantedLevel(const StreamedTexture& texture) const{
+
+    float size = static_cast<float>(std::max(texture.width, texture.height));
+    if (!(texture.pixels > 0.0f)){
+        return texture.minimumLevel;
+    }
+    if (texture.pixels >= size){
+        return 0;
+    }
+
+    unsigned int level = static_cast<unsigned int>(std::floor(std::log2(size / texture.pixels)));
+    return std::min(level, texture.minimumLevel);
+}
+
+
+void TextureStreamer::FitBudget(size_t budgetBytes, std::vector<unsigned int>& levels) const{
+
+    if (budgetBytes == 0){
+        return;
+    }
+
+    size_t total = 0;
+    for (unsigned int i = 0; i < this->textures.size(); i++){
+        if (this->textures[i].active){
+            total += GetBytes(this->textures[i], levels[i]);
+        }
+    }
+
+    // texels of the level per requested pixel
+    auto oversampling = [&](unsigned int i){
+        const StreamedTexture& texture = this->textures[i];
+        float texels = static_cast<float>(std::max(texture.width, texture.height) >> levels[i]);
+        return texels / std::max(texture.pixels, 1e-3f);
+    };
+
+    while (total > budgetBytes){
+
+        // the least recently used texture, then the one with the most texels per pixel
+        int coarsened = -1;
+        for (unsigned int i = 0; i < this->textures.size(); i++){
+
+            const StreamedTexture& texture = this->textures[i];
+            if (!texture.active || levels[i] >= texture.minimumLevel){
+                continue;
+            }
+
+            if (coarsened < 0 || texture.lastUsed < this->textures[coarsened].lastUsed ||
+                (texture.lastUsed == this->textures[coarsened].lastUsed && oversampling(i) > oversampling(coarsened))){
+                coarsened = i;
+            }
+        }
+
+        // the coarsest levels alone are over the budget
+        if (coarsened < 0){
+            break;
+        }
+
+        total -= this->textures[coarsened].levelBytes[levels[coarsened]];
+        levels[coarsened]++;
+    }
+
+}
+
+
+double TextureStreamer::GetQuality(const std::vector<unsigned int>& levels) const{
+
+    // a level coarser than wanted has a quarter of the texels
+    double quality = 0.0, area = 0.0;
+    for (unsigned int i = 0; i < this->textures.size(); i++){
+
+        const StreamedTexture& texture = this->textures[i];
+        if (!texture.active || !texture.requested){
+            continue;
+        }
+
+        unsigned int wanted = GetWantedLevel(texture);
+        double weight = static_cast<double>(texture.pixels) * texture.pixels;
+        quality += weight * std::pow(0.25, levels[i] > wanted ? levels[i] - wanted : 0);
+        area += weight;
+    }
+
+    return area > 0.0 ? quality / area : 1.0;
+}
+
+
+void TextureStreamer::Update(){
+
+    this->frame++;
+    this->statistics.frames++;
+
+    // requests of the last frame
+    for (unsigned int i = 0; i < this->textures.size(); i++){
+
+        StreamedTexture& texture = this->textures[i];
+        uint32_t bits = this->requests[i].exchange(0, std::memory_order_relaxed);
+        if (!texture.active){
+            continue;
+        }
+
+        float pixels;
+        std::memcpy(&pixels, &bits, sizeof(pixels));
+        texture.requested = pixels > 0.0f;
+        if (texture.requested){
+            texture.pixels = pixels;
+            texture.lastUsed = this->frame;
+        }
+    }
+
+    // the textures seen recently want their level, the others keep what they have until the budget needs it
+    std::vector<unsigned int> levels(this->textures.size(), 0);
+    for (unsigned int i = 0; i < this->textures.size(); i++){
+
+        const StreamedTexture& texture = this->textures[i];
+        bool recent = texture.lastUsed > 0 && this->frame - texture.lastUsed <= this->keepFrames;
+        levels[i] = recent ? GetWantedLevel(texture) : texture.residentLevel;
+        if (texture.failed){
+            levels[i] = std::max(levels[i], texture.residentLevel);
+        }
+    }
+    FitBudget(this->budgetBytes, levels);
+
+    for (unsigned int i = 0; i < this->textures.size(); i++){
+
+        StreamedTexture& texture = this->textures[i];
+        texture.targetLevel = levels[i];
+        if (texture.active && texture.residentLevel < texture.targetLevel){
+            Reallocate(texture, texture.targetLevel, nullptr);
+        }
+    }
+
+    // upload the loaded levels that are still wanted, a few megabytes per frame
+    std::vector<LevelLoad> finished, waiting;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        finished.swap(this->loaded);
+    }
+
+    this->uploader.BeginFrame();
+    for (LevelLoad& load : finished){
+
+        // the texture was deleted
+        StreamedTexture& texture = this->textures[load.streamID];
+        if (!texture.active){
+            this->uploader.Release(load.staging);
+            continue;
+        }
+
+        if (!load.loaded){
+            std::cout << "Texture streaming: level " << load.level << " of " << texture.files[0]
+                      << " can not be read" << std::endl;
+            this->uploader.Release(load.staging);
+            texture.loading = false;
+            texture.failed = true;
+            continue;
+        }
+
+        // evicted or no longer wanted since it was queued
+        if (load.level + 1 != texture.residentLevel || load.level < texture.targetLevel){
+            this->uploader.Release(load.staging);
+            texture.loading = false;
+            continue;
+        }
+
+        if (!this->uploader.HasBudget(load.staging.size)){
+            waiting.push_back(std::move(load));
+            continue;
+        }
+
+        this->statistics.bytesRead += load.staging.size;
+        Reallocate(texture, load.level, &load.staging);
+        texture.loading = false;
+    }
+
+    // the next finer level of the textures under their target
+    unsigned int loading = 0;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        for (LevelLoad& load : waiting){
+            this->loaded.push_back(std::move(load));
+        }
+
+        for (unsigned int i = 0; i < this->textures.size(); i++){
+
+            StreamedTexture& texture = this->textures[i];
+            if (texture.active && !texture.loading && !texture.failed && texture.residentLevel > texture.targetLevel){
+
+                // the loader writes into the staging buffer, no buffer is free - queued in a later frame
+                LevelLoad load;
+                load.level = texture.residentLevel - 1;
+                if (!this->uploader.Acquire(texture.levelBytes[load.level], load.staging)){
+                    this->statistics.stagingWaits++;
+                    continue;
+                }
+
+                load.streamID = i;
+                load.files = texture.files;
+                load.layerBytes = texture.levelBytes[load.level] / texture.depth;
+                this->queue.push_back(std::move(load));
+                texture.loading = true;
+            }
+
+            loading += texture.active && texture.loading;
+        }
+    }
+    this->condition.notify_one();
+    this->statistics.loadingLevels = loading;
+
+    TextureUploaderStatistics uploads = this->uploader.GetStatistics();
+    this->statistics.deferredUploads = uploads.deferred;
+    this->statistics.uploadMiliseconds = uploads.frameMiliseconds;
+    this->statistics.maxUploadMiliseconds = uploads.maxFrameMiliseconds;
+
+    // quality of the resident levels and of the targets of the other budgets
+    std::vector<unsigned int> resident(this->textures.size(), 0);
+    for (unsigned int i = 0; i < this->textures.size(); i++){
+        resident[i] = this->textures[i].residentLevel;
+    }
+    this->statistics.quality = GetQuality(resident);
+
+    for (unsigned int i = 0; i < this->curveFractions.size(); i++){
+
+        std::vector<unsigned int> targets(this->textures.size(), 0);
+        for (unsigned int j = 0; j < this->textures.size(); j++){
+            const StreamedTexture& texture = this->textures[j];
+            targets[j] = texture.requested ? GetWantedLevel(texture) : texture.minimumLevel;
+        }
+
+        FitBudget(static_cast<size_t>(this->curveFractions[i] * this->statistics.fullBytes), targets);
+        this->curveQuality[i] += GetQuality(targets);
+    }
+    this->curveFrames++;
+
+}
+
+
+void TextureStreamer::Reallocate(StreamedTexture& texture, unsigned int level, StagingBlock* staging){
+
+    unsigned int numberOfLevels = texture.levelBytes.size();
+    GLsizei width = std::max(texture.width >> level, 1u);
+    GLsizei height = std::max(texture.height >> level, 1u);
+    GLuint oldID = texture.texture != nullptr ? texture.texture->GetID() : texture.array->GetID();
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(texture.target, textureID);
+    Texture::SetSampling(texture.target);
+
+    if (texture.target == GL_TEXTURE_2D_ARRAY){
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, numberOfLevels - level, texture.format, width, height, texture.depth);
+    }
+    else{
+        glTexStorage2D(GL_TEXTURE_2D, numberOfLevels - level, texture.format, width, height);
+    }
+
+    // the levels both storages have (level 0 of a storage is its finest level)
+    for (unsigned int i = std::max(level, texture.residentLevel); i < numberOfLevels; i++){
+        glCopyImageSubData(oldID, texture.target, i - texture.residentLevel, 0, 0, 0,
+                           textureID, texture.target, i - level, 0, 0, 0,
+                           std::max(texture.width >> i, 1u), std::max(texture.height >> i, 1u), texture.depth);
+    }
+
+    // copied from the staging buffer by the driver, the call does not wait for it
+    if (staging != nullptr){
+        GLsizei size = static_cast<GLsizei>(staging->size);
+        this->uploader.Upload(*staging, [&](const void* data){
+            if (texture.target == GL_TEXTURE_2D_ARRAY){
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, width, height, texture.depth, texture.format,
+                                          size, data);
+            }
+            else{
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, texture.format, size, data);
+            }
+        });
+    }
+
+    if (texture.texture != nullptr){
+        texture.texture->ReplaceID(textureID);
+    }
+    else{
+        texture.array->ReplaceID(textureID);
+    }
+
+    if (level < texture.residentLevel){
+        this->statistics.residentBytes += GetBytes(texture, level) - GetBytes(texture, texture.residentLevel);
+        this->statistics.uploads += texture.residentLevel - level;
+    }
+    else{
+        this->statistics.residentBytes -= GetBytes(texture, texture.residentLevel) - GetBytes(texture, level);
+        this->statistics.evictions += level - texture.residentLevel;
+    }
+    texture.residentLevel = level;
+
+}
+
+
+void TextureStreamer::LoaderLoop(){
+
+    while (true){
+
+        LevelLoad load;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this]{ return this->stop || !this->queue.empty(); });
+            if (this->stop){
+                return;
+            }
+
+            load = std::move(this->queue.front());
+            this->queue.pop_front();
+        }
+
+        // the level of every layer into the staging buffer, one after another
+        load.loaded = true;
+        for (unsigned int i = 0; i < load.files.size() && load.loaded; i++){
+            load.loaded = TextureCache::LoadLevel(load.files[i], load.level, load.staging.data + i * load.layerBytes,
+                                                  load.layerBytes);
+        }
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->loaded.push_back(std::move(load));
+    }
+
+}
+
+
+TextureStreamingStatistics TextureStreamer::GetStatistics() const{
+    return this->statistics;
+}
+
+
+std::vector<BudgetQuality> TextureStreamer::GetBudgetCurve() const{
+
+    std::vector<BudgetQuality> curve;
+    for (unsigned int i = 0; i < this->curveFractions.size(); i++){
+
+        BudgetQuality point;
+        point.fraction = this->curveFractions[i];
+        point.budgetBytes = static_cast<size_t>(this->curveFractions[i] * this->statistics.fullBytes);
+        point.quality = this->curveFrames > 0 ? this->curveQuality[i] / this->curveFrames : 1.0;
+        curve.push_back(point);
+    }
+
+    return curve;
+}
@@ -0,0 +1,231 @@
+#include "TextureUploader.hpp"
+#include "GLExtensions.hpp"
+#include "FrameTimer.hpp"
+
+// STL
+#include <algorithm>
+
+
+TextureUploader::TextureUploader(size_t bufferSize, unsigned int numberOfBuffers, size_t maxBytesPerFrame){
+
+    this->persistent = gGLCapabilities.bufferStorage;
+    this->maxBytesPerFrame = maxBytesPerFrame;
+
+    this->buffers.resize(std::max(numberOfBuffers, 1u));
+    for (StagingBuffer& buffer : this->buffers){
+        Create(buffer, bufferSize);
+    }
+
+}
+
+
+TextureUploader::~TextureUploader(){
+
+    for (StagingBuffer& buffer : this->buffers){
+        Destroy(buffer);
+    }
+
+}
+
+
+void TextureUploader::Create(StagingBuffer& buffer, size_t size){
+
+    buffer.size = size;
+    buffer.state = BUFFER_FREE;
+
+    glGenBuffers(1, &buffer.bufferID);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferID);
+
+    if (this->persistent){
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+        buffer.pointer = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+    }
+    else{
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+}
+
+
+void TextureUploader::Destroy(StagingBuffer& buffer){
+
+    if (buffer.bufferID == 0){
+        return;
+    }
+
+    if (buffer.fence != nullptr){
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+
+    if (buffer.pointer != nullptr || buffer.mapped){
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferID);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    glDeleteBuffers(1, &buffer.bufferID);
+
+    buffer.bufferID = 0;
+    buffer.pointer = nullptr;
+    buffer.mapped = false;
+
+}
+
+
+bool TextureUploader::IsFree(StagingBuffer& buffer){
+
+    if (buffer.state == BUFFER_IN_FLIGHT && glClientWaitSync(buffer.fence, 0, 0) != GL_TIMEOUT_EXPIRED){
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+        buffer.state = BUFFER_FREE;
+    }
+
+    return buffer.state == BUFFER_FREE;
+}
+
+
+bool TextureUploader::Acquire(size_t size, StagingBlock& block){
+
+    // the next buffer of the ring the GPU is done with (no wait)
+    int found = -1;
+    for (unsigned int i = 0; i < this->buffers.size() && found < 0; i++){
+        unsigned int index = (this->nextBuffer + i) % this->buffers.size();
+        if (IsFree(this->buffers[index])){
+            found = index;
+        }
+    }
+
+    if (found < 0){
+        this->statistics.starved++;
+        return false;
+    }
+
+    this->nextBuffer = (found + 1) % this->buffers.size();
+    StagingBuffer& buffer = this->buffers[found];
+
+    // too small - the free buffer is not used by the GPU, replace it with a larger one
+    if (size > buffer.size){
+        Destroy(buffer);
+        Create(buffer, std::max(size, buffer.size * 2));
+    }
+
+    uint8_t* pointer = buffer.pointer;
+    if (!this->persistent){
+        // the fence already protects the buffer - no implicit synchronization needed
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferID);
+        pointer = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+                                                         GL_MAP_UNSYNCHRONIZED_BIT));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        buffer.mapped = pointer != nullptr;
+    }
+
+    if (pointer == nullptr){
+        return false;
+    }
+
+    buffer.state = BUFFER_WRITING;
+    block.buffer = found;
+    block.data = pointer;
+    block.size = size;
+
+    return true;
+}
+
+
+void TextureUploader::Unmap(StagingBuffer& buffer){
+
+    if (!buffer.mapped){
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferID);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    buffer.mapped = false;
+
+}
+
+
+void TextureUploader::Release(StagingBlock& block){
+
+    if (block.buffer < 0){
+        return;
+    }
+
+    StagingBuffer& buffer = this->buffers[block.buffer];
+    Unmap(buffer);
+    buffer.state = BUFFER_FREE;
+
+    block = StagingBlock();
+
+}
+
+
+void TextureUploader::BeginFrame(){
+
+    if (this->frameMiliseconds > 0.0){
+        this->statistics.frameMiliseconds = this->frameMiliseconds;
+        this->statistics.maxFrameMiliseconds = std::max(this->statistics.maxFrameMiliseconds, this->frameMiliseconds);
+    }
+
+    this->frameBytes = 0;
+    this->frameMiliseconds = 0.0;
+
+}
+
+
+bool TextureUploader::HasBudget(size_t size){
+
+    if (this->frameBytes > 0 && this->frameBytes + size > this->maxBytesPerFrame){
+        this->statistics.deferred++;
+        return false;
+    }
+
+    return true;
+}
+
+
+void TextureUploader::Upload(StagingBlock& block, const std::function<void(const void*)>& upload){
+
+    if (block.buffer < 0){
+        return;
+    }
+
+    double start = FrameTimer::Now();
+    StagingBuffer& buffer = this->buffers[block.buffer];
+    Unmap(buffer);
+
+    // the data is read from the bound buffer at the offset
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferID);
+    upload(nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    buffer.state = BUFFER_IN_FLIGHT;
+
+    double miliseconds = (FrameTimer::Now() - start) * 1000.0;
+    this->frameBytes += block.size;
+    this->frameMiliseconds += miliseconds;
+    this->statistics.uploads++;
+    this->statistics.bytes += block.size;
+    this->statistics.miliseconds += miliseconds;
+
+    block = StagingBlock();
+
+}
+
+
+bool TextureUploader::IsPersistent() const{
+    return this->persistent;
+}
+
+
+TextureUploaderStatistics TextureUploader::GetStatistics() const{
+    return this->statistics;
+}
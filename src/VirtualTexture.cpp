@@ -0,0 +1,566 @@
+#include "VirtualTexture.hpp"
+#include "GLExtensions.hpp"
+
+// STL
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+
+
+    ///////////// cache /////////////
+
+VirtualTextureCache::VirtualTextureCache(const PageFile* pageFile, unsigned int slotsPerSide, unsigned int loaders){
+
+    this->pageFile = pageFile;
+    this->slotsPerSide = std::max(slotsPerSide, 1u);
+
+    const PageFileHeader& header = pageFile->GetHeader();
+    this->numberOfLevels = header.numberOfLevels;
+    this->pages.resize(header.numberOfPages);
+    this->slotPages.assign(this->slotsPerSide * this->slotsPerSide, UINT32_MAX);
+
+    this->indirection.resize(this->numberOfLevels);
+    for (uint32_t level = 0; level < this->numberOfLevels; level++){
+        uint32_t pagesPerSide = pageFile->GetPagesPerSide(level);
+        this->indirection[level].assign(static_cast<size_t>(pagesPerSide) * pagesPerSide * 4, 0);
+    }
+
+    // the only page of the coarsest level stays in the first slot
+    this->pinnedPage = header.numberOfPages - 1;
+    this->pages[this->pinnedPage].state = PAGE_RESIDENT;
+    this->pages[this->pinnedPage].slot = 0;
+    this->slotPages[0] = this->pinnedPage;
+    this->statistics.bytesRead += pageFile->GetPageBytes();
+    this->statistics.residentPages = 1;
+
+    for (unsigned int i = 0; i < loaders; i++){
+        this->loaders.emplace_back(&VirtualTextureCache::LoaderLoop, this);
+    }
+
+}
+
+
+VirtualTextureCache::~VirtualTextureCache(){
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+    this->condition.notify_all();
+
+    for (std::thread& loader : this->loaders){
+        loader.join();
+    }
+
+}
+
+
+uint32_t VirtualTextureCache::GetPageLevel(uint32_t pageID) const{
+
+    uint32_t level = 0;
+    while (level + 1 < this->numberOfLevels && pageID >= this->pageFile->GetFirstPage(level + 1)){
+        level++;
+    }
+
+    return level;
+}
+
+
+uint32_t VirtualTextureCache::GetPageID(uint32_t level, uint32_t x, uint32_t y) const{
+    return this->pageFile->GetFirstPage(level) + y * this->pageFile->GetPagesPerSide(level) + x;
+}
+
+
+void VirtualTextureCache::ProcessFeedback(const std::vector<uint32_t>& pageIDs){
+
+    std::vector<uint32_t> requested;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->frame++;
+        this->statistics.frames++;
+
+        for (uint32_t pageID : pageIDs){
+
+            if (pageID >= this->pages.size()){
+                continue;
+            }
+
+            this->statistics.requests++;
+            if (this->pages[pageID].state == PAGE_RESIDENT){
+                this->statistics.hits++;
+            }
+            else{
+                this->statistics.misses++;
+            }
+
+            // the page and its ancestors (the fallback until it is loaded) are used by the frame
+            uint32_t level = GetPageLevel(pageID);
+            uint32_t pagesPerSide = this->pageFile->GetPagesPerSide(level);
+            uint32_t x = (pageID - this->pageFile->GetFirstPage(level)) % pagesPerSide;
+            uint32_t y = (pageID - this->pageFile->GetFirstPage(level)) / pagesPerSide;
+            uint32_t page = pageID;
+
+            while (this->pages[page].lastUsed != this->frame){
+
+                PageEntry& entry = this->pages[page];
+                entry.lastUsed = this->frame;
+                if (entry.state == PAGE_NONE){
+                    entry.state = PAGE_QUEUED;
+                    requested.push_back(page);
+                }
+
+                if (level + 1 >= this->numberOfLevels){
+                    break;
+                }
+                level++;
+                x /= 2;
+                y /= 2;
+                page = GetPageID(level, x, y);
+            }
+        }
+
+        // coarse pages first - the levels are stored from the finest one
+        std::sort(requested.begin(), requested.end(), std::greater<uint32_t>());
+        this->queue.insert(this->queue.end(), requested.begin(), requested.end());
+        this->statistics.queuedPages = this->queue.size() + this->loaded.size();
+    }
+
+    if (!requested.empty()){
+        this->condition.notify_all();
+    }
+
+}
+
+
+bool VirtualTextureCache::IsStale(uint32_t pageID) const{
+
+    // a page not requested by the last frames is not worth its slot any more
+    return this->frame - this->pages[pageID].lastUsed > 4;
+}
+
+
+VirtualTextureCache::LoadedPage VirtualTextureCache::LoadPage(uint32_t pageID) const{
+
+    // the first access reads the page from the disk
+    const uint8_t* data = this->pageFile->GetPage(pageID);
+
+    return {pageID, std::vector<uint8_t>(data, data + this->pageFile->GetPageBytes())};
+}
+
+
+void VirtualTextureCache::LoaderLoop(){
+
+    while (true){
+
+        uint32_t pageID;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this]{ return this->stop || !this->queue.empty(); });
+            if (this->stop){
+                return;
+            }
+
+            pageID = this->queue.front();
+            this->queue.pop_front();
+
+            if (IsStale(pageID)){
+                this->pages[pageID].state = PAGE_NONE;
+                this->statistics.dropped++;
+                continue;
+            }
+        }
+
+        LoadedPage page = LoadPage(pageID);
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->statistics.bytesRead += page.data.size();
+        this->pages[pageID].state = PAGE_LOADED;
+        this->loaded.push_back(std::move(page));
+    }
+
+}
+
+
+bool VirtualTextureCache::AcquireSlot(uint32_t& slot){
+
+    uint32_t oldest = UINT32_MAX;
+    uint64_t oldestFrame = this->frame;
+
+    for (uint32_t i = 0; i < this->slotPages.size(); i++){
+
+        uint32_t page = this->slotPages[i];
+        if (page == UINT32_MAX){
+            slot = i;
+            return true;
+        }
+
+        if (page != this->pinnedPage && this->pages[page].lastUsed < oldestFrame){
+            oldest = i;
+            oldestFrame = this->pages[page].lastUsed;
+        }
+    }
+
+    // every slot holds a page of this frame - the cache is too small for the view
+    if (oldest == UINT32_MAX){
+        return false;
+    }
+
+    PageEntry& evicted = this->pages[this->slotPages[oldest]];
+    evicted.state = PAGE_NONE;
+    this->slotPages[oldest] = UINT32_MAX;
+    this->statistics.evictions++;
+    this->statistics.residentPages--;
+
+    slot = oldest;
+    return true;
+}
+
+
+std::vector<PageUpload> VirtualTextureCache::CollectLoaded(unsigned int maxUploads){
+
+    std::vector<PageUpload> uploads;
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    // without loader threads the queue is serviced here
+    if (this->loaders.empty()){
+        while (this->loaded.size() < maxUploads && !this->queue.empty()){
+
+            uint32_t pageID = this->queue.front();
+            this->queue.pop_front();
+
+            if (IsStale(pageID)){
+                this->pages[pageID].state = PAGE_NONE;
+                this->statistics.dropped++;
+                continue;
+            }
+
+            this->loaded.push_back(LoadPage(pageID));
+            this->statistics.bytesRead += this->loaded.back().data.size();
+            this->pages[pageID].state = PAGE_LOADED;
+        }
+    }
+
+    size_t collected = 0;
+    for (; collected < this->loaded.size() && uploads.size() < maxUploads; collected++){
+
+        LoadedPage& page = this->loaded[collected];
+        PageEntry& entry = this->pages[page.pageID];
+
+        if (IsStale(page.pageID)){
+            entry.state = PAGE_NONE;
+            this->statistics.dropped++;
+            continue;
+        }
+
+        // the rest waits for slots freed by the next frames
+        uint32_t slot;
+        if (!AcquireSlot(slot)){
+            break;
+        }
+
+        entry.state = PAGE_RESIDENT;
+        entry.slot = slot;
+        this->slotPages[slot] = page.pageID;
+        uploads.push_back({page.pageID, slot, std::move(page.data)});
+
+        this->statistics.uploads++;
+        this->statistics.residentPages++;
+        this->indirectionDirty = true;
+    }
+
+    this->loaded.erase(this->loaded.begin(), this->loaded.begin() + collected);
+    this->statistics.queuedPages = this->queue.size() + this->loaded.size();
+
+    return uploads;
+}
+
+
+bool VirtualTextureCache::UpdateIndirection(){
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (!this->indirectionDirty){
+        return false;
+    }
+
+    // from the coarsest level - a page that is not resident uses the entry of its parent
+    for (int level = static_cast<int>(this->numberOfLevels) - 1; level >= 0; level--){
+
+        uint32_t pagesPerSide = this->pageFile->GetPagesPerSide(level);
+        uint32_t parentPagesPerSide = this->pageFile->GetPagesPerSide(std::min<uint32_t>(level + 1, this->numberOfLevels - 1));
+        std::vector<uint8_t>& entries = this->indirection[level];
+
+        for (uint32_t y = 0; y < pagesPerSide; y++){
+            for (uint32_t x = 0; x < pagesPerSide; x++){
+
+                uint8_t* entry = &entries[(static_cast<size_t>(y) * pagesPerSide + x) * 4];
+                const PageEntry& page = this->pages[GetPageID(level, x, y)];
+
+                if (page.state == PAGE_RESIDENT){
+                    entry[0] = static_cast<uint8_t>(page.slot % this->slotsPerSide);
+                    entry[1] = static_cast<uint8_t>(page.slot / this->slotsPerSide);
+                    entry[2] = static_cast<uint8_t>(level);
+                    entry[3] = 1;
+                }
+                else{
+                    const uint8_t* parent = &this->indirection[level + 1][(static_cast<size_t>(y / 2) * parentPagesPerSide + x / 2) * 4];
+                    std::copy(parent, parent + 4, entry);
+                }
+            }
+        }
+    }
+
+    this->indirectionDirty = false;
+
+    return true;
+}
+
+
+const std::vector<uint8_t>& VirtualTextureCache::GetIndirection(uint32_t level) const{
+    return this->indirection[level];
+}
+
+
+PageUpload VirtualTextureCache::GetPinnedPage() const{
+
+    LoadedPage page = LoadPage(this->pinnedPage);
+
+    return {this->pinnedPage, 0, std::move(page.data)};
+}
+
+
+unsigned int VirtualTextureCache::GetSlotsPerSide() const{
+    return this->slotsPerSide;
+}
+
+
+VirtualTextureStatistics VirtualTextureCache::GetStatistics() const{
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    return this->statistics;
+}
+
+
+    ///////////// GL textures /////////////
+
+VirtualTexture::VirtualTexture(){
+}
+
+
+VirtualTexture::~VirtualTexture(){
+
+    // stop the loaders before the file is unmapped
+    this->cache = nullptr;
+
+    if (this->physicalTextures[0] != 0){
+        glDeleteTextures(2, this->physicalTextures);
+        glDeleteTextures(1, &this->indirectionTexture);
+        glDeleteBuffers(numberOfFeedbackBuffers, this->feedbackBuffers);
+    }
+
+    for (GLsync& fence : this->feedbackFences){
+        if (fence != nullptr){
+            glDeleteSync(fence);
+        }
+    }
+
+}
+
+
+bool VirtualTexture::Open(const std::string& path, unsigned int slotsPerSide, unsigned int loaders){
+
+    // the shaders write the feedback into a storage buffer cleared every frame
+    if (!gGLCapabilities.shaderStorageBuffer || !gGLCapabilities.computeShader){
+        std::cout << "Virtual texture: the feedback needs shader storage buffers" << std::endl;
+        return false;
+    }
+
+    if (!this->pageFile.Open(path)){
+        return false;
+    }
+
+    this->cache = std::make_unique<VirtualTextureCache>(&this->pageFile, slotsPerSide, loaders);
+    const PageFileHeader& header = this->pageFile.GetHeader();
+
+    // slots of whole pages with their borders, filtered only inside a page
+    GLsizei physicalSize = this->cache->GetSlotsPerSide() * this->pageFile.GetPageTexels();
+    glGenTextures(2, this->physicalTextures);
+    for (GLuint texture : this->physicalTextures){
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, physicalSize, physicalSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+
+    // one texel per page, a mip level per level of the virtual texture
+    glGenTextures(1, &this->indirectionTexture);
+    glBindTexture(GL_TEXTURE_2D, this->indirectionTexture);
+    for (uint32_t level = 0; level < header.numberOfLevels; level++){
+        GLsizei pages = this->pageFile.GetPagesPerSide(level);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8UI, pages, pages, 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.numberOfLevels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    UploadPage(this->cache->GetPinnedPage());
+
+    // bit per page
+    this->feedbackWords = (header.numberOfPages + 31) / 32;
+    this->feedbackBits.assign(this->feedbackWords, 0);
+    glGenBuffers(numberOfFeedbackBuffers, this->feedbackBuffers);
+    for (GLuint buffer : this->feedbackBuffers){
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, this->feedbackWords * sizeof(uint32_t), this->feedbackBits.data(), GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    std::cout << "Virtual texture: " << header.size << "x" << header.size << ", " << header.numberOfLevels << " levels, "
+              << header.numberOfPages << " pages, " << this->cache->GetSlotsPerSide() * this->cache->GetSlotsPerSide()
+              << " slots (" << 2.0 * physicalSize * physicalSize * 4 / 1048576.0 << " MB)" << std::endl;
+
+    return true;
+}
+
+
+bool VirtualTexture::Record(const std::string& path){
+
+    this->recordFile.open(path, std::ios::binary);
+    if (!this->recordFile){
+        std::cout << "Can not write " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+void VirtualTexture::UploadPage(const PageUpload& upload){
+
+    GLsizei pageTexels = this->pageFile.GetPageTexels();
+    size_t layerBytes = static_cast<size_t>(pageTexels) * pageTexels * 4;
+    GLint x = upload.slot % this->cache->GetSlotsPerSide() * pageTexels;
+    GLint y = upload.slot / this->cache->GetSlotsPerSide() * pageTexels;
+
+    for (unsigned int layer = 0; layer < 2; layer++){
+        glBindTexture(GL_TEXTURE_2D, this->physicalTextures[layer]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, pageTexels, pageTexels, GL_RGBA, GL_UNSIGNED_BYTE,
+                        upload.data.data() + layer * layerBytes);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+}
+
+
+void VirtualTexture::Update(){
+
+    this->frame++;
+    this->currentFeedback = (this->currentFeedback + 1) % numberOfFeedbackBuffers;
+
+    GLuint buffer = this->feedbackBuffers[this->currentFeedback];
+    GLsync& fence = this->feedbackFences[this->currentFeedback];
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+
+    // written numberOfFeedbackBuffers frames ago - the GPU is usually done with it
+    if (fence != nullptr){
+
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result == GL_TIMEOUT_EXPIRED){
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, this->feedbackWords * sizeof(uint32_t), this->feedbackBits.data());
+
+        std::vector<uint32_t> pageIDs;
+        for (uint32_t word = 0; word < this->feedbackWords; word++){
+            for (uint32_t bits = this->feedbackBits[word]; bits != 0; bits &= bits - 1){
+                pageIDs.push_back(word * 32 + __builtin_ctz(bits));
+            }
+        }
+
+        if (this->recordFile){
+            uint32_t count = pageIDs.size();
+            this->recordFile.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            this->recordFile.write(reinterpret_cast<const char*>(pageIDs.data()), count * sizeof(uint32_t));
+        }
+
+        this->cache->ProcessFeedback(pageIDs);
+    }
+
+    // the pages of this frame
+    uint32_t zero = 0;
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, feedbackBinding, buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    for (const PageUpload& upload : this->cache->CollectLoaded(this->maxUploadsPerFrame)){
+        UploadPage(upload);
+    }
+
+    if (this->cache->UpdateIndirection()){
+
+        glBindTexture(GL_TEXTURE_2D, this->indirectionTexture);
+        for (uint32_t level = 0; level < this->pageFile.GetHeader().numberOfLevels; level++){
+            GLsizei pages = this->pageFile.GetPagesPerSide(level);
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, pages, pages, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,
+                            this->cache->GetIndirection(level).data());
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+}
+
+
+void VirtualTexture::EndFrame(){
+
+    // the shader writes are read back by glGetBufferSubData
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    this->feedbackFences[this->currentFeedback] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+}
+
+
+void VirtualTexture::Bind(Shader* shader, bool bindPipeline){
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, this->physicalTextures[0]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, this->physicalTextures[1]);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, this->indirectionTexture);
+
+    if (!bindPipeline){
+        return;
+    }
+
+    const PageFileHeader& header = this->pageFile.GetHeader();
+    shader->Upload_Uniform1i_Pipeline("u_VirtualPageTable", 3);
+    shader->Upload_Uniform1i_Pipeline("u_VirtualPages", this->pageFile.GetPagesPerSide(0));
+    shader->Upload_Uniform1i_Pipeline("u_VirtualLevels", header.numberOfLevels);
+    shader->Upload_Uniform1i_Pipeline("u_VirtualPageSize", header.pageSize);
+    shader->Upload_Uniform1i_Pipeline("u_VirtualBorder", header.border);
+    shader->Upload_Uniform1i_Pipeline("u_VirtualSlots", this->cache->GetSlotsPerSide());
+    shader->Upload_Uniform1f_Pipeline("u_VirtualSourceLevel", std::log2(static_cast<float>(header.size) / header.sourceSize));
+    shader->Upload_Uniform1i_Pipeline("u_VirtualFeedbackFrame", this->frame);
+
+}
+
+
+GLuint VirtualTexture::GetID() const{
+    return this->physicalTextures[0];
+}
+
+
+VirtualTextureStatistics VirtualTexture::GetStatistics() const{
+    return this->cache->GetStatistics();
+}
@@ -18,9 +18,21 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
 
 // Our libraries
 #include "Camera.hpp"
+#include "CameraPath.hpp"
+#include "Benchmark.hpp"
+#include "FrameTimer.hpp"
+#include "FrameCapture.hpp"
+#include "GLExtensions.hpp"
+#include "Profiler.hpp"
+#include "SelfTest.hpp"
+#include "ProfilerOverlay.hpp"
 #include "Object.hpp"
 #include "PointLight.hpp"
 
@@ -30,6 +42,478 @@
 // Import singleton scene class
 #include "Scene.hpp"
 
+// command line options that are not part of the scene
+std::string gBenchmarkPathFile = "";                        // camera path replayed by the benchmark
+std::string gBenchmarkOutputFile = "benchmark_results.json";
+unsigned int gBenchmarkWarmupFrames = 60;
+std::string gRecordPathFile = "";                           // camera path recorded in the interactive mode
+std::string gTraceFile = "";                                // chrome trace of the whole run
+unsigned int gNumberOfThreads = 0;                          // threads of the job system, 0 = all cores
+unsigned int gScalingBenchmarkObjects = 0;                  // objects of the CPU scaling benchmark
+std::string gMeshStatisticsFile = "";                       // .obj file of the mesh statistics
+bool gSelfTest = false;                                     // run the checks without a window
+int gPackedMaterials = -1;                                  // 1 / 0 = --packed-materials / --no-packed-materials, -1 = by the compression
+std::string gMeshletStatisticsFile = "";                    // .obj file of the meshlet statistics
+std::string gMeshletStatisticsPath = "";                    // camera path of the meshlet statistics (empty = orbit)
+unsigned int gSimplifyBenchmarkResolution = 0;              // quads per side of the simplification benchmark mesh
+unsigned int gLightBenchmarkLights = 0;                     // lights of the light clustering benchmark
+std::string gBakeTexturesDirectory = "";                    // textures compressed into KTX2 files
+unsigned int gHeightMapBenchmarkSize = 0;                   // texels per side of the height map benchmark image
+std::string gVirtualTextureBuildDirectory = "";             // material directory of the page file built
+unsigned int gVirtualTextureBuildSize = 0;                  // texels per side of the virtual texture built
+std::string gVirtualTextureBuildFile = "";
+std::string gVirtualTextureSimulationFile = "";             // page file of the cache simulation
+std::string gVirtualTextureFeedbackFile = "";               // recorded feedback of the simulation (empty = pan and zoom)
+std::string gCapturePrefix = "";                            // frames saved as <prefix>_<frame>.ppm
+unsigned int gCaptureInterval = 0;                          // every n-th frame is captured, 0 = none
+bool gScreenshot = false;                                   // capture the next frame (F10)
+FrameCapture* gFrameCapture = nullptr;                      // created with the first capture
+double gStartTime = 0.0;                                    // FrameTimer::Now() when the program started
+bool gParallaxSweep = false;                                // replay the benchmark once per parallax quality preset
+
+// parallax quality presets, in the order of the sweep
+const std::vector<std::string> gParallaxPresets = {"off", "high", "medium", "low"};
+unsigned int gParallaxSweepIndex = 0;
+std::vector<std::string> gParallaxSweepSummary;             // one line per finished preset
+
+/**
+* Tunables of a parallax quality preset (medium = the defaults)
+*
+* @return the settings of the preset
+*/
+ParallaxLodSettings GetParallaxPreset(const std::string& name){
+
+	ParallaxLodSettings settings;
+
+	if (name == "off"){
+		settings.enabled = false;
+	}
+	else if (name == "high"){
+		settings.normalPixels = 0.5f;
+		settings.offsetPixels = 2.0f;
+		settings.pixelsPerLayer = 0.5f;
+		settings.fullDistance = 12.0f;
+		settings.offsetDistance = 25.0f;
+		settings.normalDistance = 50.0f;
+		settings.mipLevel = 4.0f;
+	}
+	else if (name == "low"){
+		settings.normalPixels = 2.0f;
+		settings.offsetPixels = 8.0f;
+		settings.pixelsPerLayer = 2.0f;
+		settings.fullDistance = 3.0f;
+		settings.offsetDistance = 8.0f;
+		settings.normalDistance = 16.0f;
+		settings.mipLevel = 2.0f;
+	}
+	else if (name != "medium"){
+		std::cout << "Parallax quality has to be off, low, medium or high\n";
+		exit(1);
+	}
+
+	return settings;
+}
+
+/**
+* Short description of the parallax tunables for the benchmark report
+*
+* @return the description
+*/
+std::string DescribeParallaxLod(const ParallaxLodSettings& settings){
+
+	if (!settings.enabled){
+		return "parallax lod off";
+	}
+
+	std::ostringstream description;
+	description << "parallax lod " << settings.normalPixels << "/" << settings.offsetPixels << " px, "
+	            << settings.pixelsPerLayer << " px per layer, fade " << settings.fullDistance << "/"
+	            << settings.offsetDistance << "/" << settings.normalDistance << ", mip " << settings.mipLevel;
+	return description.str();
+}
+
+/**
+* Creates the benchmark of the current settings
+*
+* @return the benchmark, null if the camera path could not be loaded
+*/
+Benchmark* CreateBenchmark(const std::string& outputFile){
+
+	Benchmark* benchmark = new Benchmark(gBenchmarkPathFile, outputFile);
+	benchmark->warmupFrames = gBenchmarkWarmupFrames;
+	benchmark->description = "scene " + std::to_string(gScene.SceneNumber) +
+	                         ", parallax " + std::to_string(gScene.ParallaxMethodOverride) +
+	                         ", tiles " + std::to_string(gScene.GroundTiles) +
+	                         ", vertices " + (gScene.PackedVertices ? "packed" : "float") +
+	                         ", " + DescribeParallaxLod(gScene.ParallaxLod) +
+	                         ", lights " + std::to_string(gScene.LocalLights) +
+	                         (gScene.ClusteredLights ? " clustered" : " unclustered") +
+	                         ", path " + (gScene.RenderPath == RENDER_DEFERRED ?
+	                                      (gScene.DepthPrepass ? "deferred" : "deferred without prepass") : "forward") +
+	                         ", textures " + (gScene.TextureCompression ? "BC" : "uncompressed") +
+	                         (gScene.PackedMaterials ? " packed" : "") + (gScene.GroundTextureArrays ? " arrays" : "") +
+	                         (gScene.textureStreamer != nullptr ? ", streamed " + std::to_string(gScene.TextureBudgetMB) + " MB"
+	                                                            : "");
+	benchmark->textureStreamer = gScene.textureStreamer;
+
+	if (!benchmark->IsValid()){
+		delete benchmark;
+		return nullptr;
+	}
+
+	return benchmark;
+}
+
+/**
+* Output file of a preset of the parallax sweep (<output>_<preset>.json)
+*
+* @return the file name
+*/
+std::string GetSweepOutputFile(const std::string& preset){
+
+	std::string base = gBenchmarkOutputFile;
+	if (base.size() > 5 && base.substr(base.size() - 5) == ".json"){
+		base = base.substr(0, base.size() - 5);
+	}
+
+	return base + "_" + preset + ".json";
+}
+
+/**
+* Stores the result of the finished preset and starts the benchmark of the next one
+*
+* @return true if another preset is measured
+*/
+bool AdvanceParallaxSweep(){
+
+	if (!gParallaxSweep){
+		return false;
+	}
+
+	// frame time against quality of the finished preset
+	Benchmark* benchmark = gScene.benchmark;
+	std::ostringstream line;
+	line << "  " << gParallaxPresets[gParallaxSweepIndex] << ": frame avg " << benchmark->GetFrameStatistics().average
+	     << " ms, p95 " << benchmark->GetFrameStatistics().p95 << " ms, gpu avg " << benchmark->GetGpuStatistics().average
+	     << " ms, ray marched " << static_cast<int>(benchmark->GetParallaxFullShare() * 100.0 + 0.5)
+	     << " % of the parallax objects, layer budget " << benchmark->GetParallaxLayers();
+	gParallaxSweepSummary.push_back(line.str());
+
+	delete benchmark;
+	gScene.benchmark = nullptr;
+	gParallaxSweepIndex++;
+
+	if (gParallaxSweepIndex == gParallaxPresets.size()){
+		std::cout << "Parallax quality sweep:\n";
+		for (const std::string& summary : gParallaxSweepSummary){
+			std::cout << summary << "\n";
+		}
+		std::cout << std::flush;
+		return false;
+	}
+
+	const std::string& preset = gParallaxPresets[gParallaxSweepIndex];
+	gScene.ParallaxLod = GetParallaxPreset(preset);
+	gScene.benchmark = CreateBenchmark(GetSweepOutputFile(preset));
+
+	// every preset replays the path with the lights from their start
+	gScene.lightsManager->ResetAnimation();
+
+	return gScene.benchmark != nullptr;
+}
+
+/**
+* Prints the command line options
+*
+* @return void
+*/
+void PrintUsage(){
+	std::cout << "Usage: ./prog [options]\n"
+	          << "  --scene <1|2|3>        scene to render (1 = brick walls, 2 = Parallax at Dawn, 3 = 2 with 1024 lights)\n"
+	          << "  --parallax <0-3>       parallax method of all parallax objects\n"
+	          << "  --tiles <n>            split every ground tile into n x n tiles\n"
+	          << "  --record <file>        record the camera path of the session\n"
+	          << "  --benchmark <file>     replay a camera path and measure frame times\n"
+	          << "  --output <file>        benchmark results (default benchmark_results.json)\n"
+	          << "  --warmup <frames>      frames rendered before measuring (default 60)\n"
+	          << "  --trace <file>         capture a chrome trace of the whole run\n"
+	          << "  --capture <prefix> <n> save every n-th frame as <prefix>_<frame>.ppm\n"
+	          << "  --fps <n>              frame rate limit, 0 = unlimited (default 60)\n"
+	          << "  --vsync <off|on|adaptive>  swap interval (default off)\n"
+	          << "  --tick-rate <n>        simulation updates per second (default 60)\n"
+	          << "  --threads <n>          threads preparing the draws, 0 = all cores (default 0)\n"
+	          << "  --scale-bench <n>      CPU scaling benchmark with n objects, then exit\n"
+	          << "  --no-mdi               draw every object separately instead of multi draw indirect\n"
+	          << "  --culling <off|cpu|gpu> where the objects are culled (default gpu)\n"
+	          << "  --no-occlusion         GPU culling without the Hi-Z occlusion test\n"
+	          << "  --vertex-format <packed|float> 20 byte packed vertices or 14 floats (default packed)\n"
+	          << "  --no-mesh-cache        always parse and optimize the .obj files\n"
+	          << "  --mesh-stats <file>    vertex cache statistics of an .obj file per optimization pass, then exit\n"
+	          << "  --self-test            checks of the CPU code against known results, then exit (1 if any failed)\n"
+	          << "  --no-meshlets          draw large meshes as a whole instead of culled clusters\n"
+	          << "  --no-lod               always draw the full meshes\n"
+	          << "  --lod-error <px>       allowed screen space error of a level of detail (default 1)\n"
+	          << "  --lights <n>           add n animated local lights to the scene\n"
+	          << "  --no-light-clusters    every fragment loops over all local lights\n"
+	          << "  --render-path <forward|deferred>  lit while drawn or G-buffer and one lighting pass (default forward)\n"
+	          << "  --no-depth-prepass     deferred path without the depth prepass\n"
+	          << "  --no-texture-compression  upload the textures uncompressed instead of BC1/BC4/BC5\n"
+	          << "  --packed-materials     normal and height in one texture (BC3 when compressed, default with --no-texture-compression)\n"
+	          << "  --no-packed-materials  separate normal and height textures also when they are uncompressed\n"
+	          << "  --no-texture-arrays    ground tiles with textures per material instead of texture array layers\n"
+	          << "  --virtual-texture <file.vtex>  stream the pages of a virtual texture onto the ground tiles\n"
+	          << "  --vt-record <file>     write the virtual texture feedback of every frame into a file\n"
+	          << "  --no-texture-streaming load every mip level with the textures instead of by their screen size\n"
+	          << "  --texture-budget <MB>  memory of the streamed textures (default 128, 0 = unlimited)\n"
+	          << "  --no-texture-storage   mutable textures specified level by level instead of immutable storage\n"
+	          << "  --anisotropy <n>       maximal anisotropy of the texture filtering (default 8, 1 = off)\n"
+	          << "  --no-bindless          bind the textures of every batch instead of reading bindless handles\n"
+	          << "  --parallax-lod <off|low|medium|high>  parallax quality by the distance (default medium)\n"
+	          << "  --parallax-fade <full> <offset> <normal>  distances where the parallax quality fades\n"
+	          << "  --parallax-mip <level> height map mip level where the parallax fades out (default 3)\n"
+	          << "  --parallax-layer-px <px>  pixels of the displacement per ray marching layer (default 1)\n"
+	          << "  --parallax-sweep       replay the --benchmark path once per parallax quality preset\n"
+	          << "  --simplify-bench <n>   level of detail generation of a n x n quad mesh per thread count, then exit\n"
+	          << "  --light-bench <n>      binning of n lights into the light clusters per thread count, then exit\n"
+	          << "  --bake-textures <dir>  compress the textures of a directory into KTX2 files with a PSNR report, then exit\n"
+	          << "  --height-bench <n>     height map conversion of a n x n image per instruction set and thread count, then exit\n"
+	          << "  --vt-build <dir> <size> <file.vtex>  page file of the material of a directory at size x size texels, then exit\n"
+	          << "  --vt-simulate <file.vtex> [feedback]  page cache replaying recorded or pan and zoom feedback, then exit\n"
+	          << "  --meshlet-stats <file> [path]  meshlets of an .obj file and the part culled along a camera path, then exit\n";
+}
+
+/**
+* Parses the command line arguments into the scene settings
+*
+* @return void
+*/
+void ParseArguments(int argc, char** argv){
+
+	gScene.NumArgs = argc;
+	gScene.ArgsPointer = argv;
+
+	for (int i = 1; i < argc; i++){
+
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--help" || arg == "-h"){
+			PrintUsage();
+			exit(0);
+		}
+		else if (arg == "--scene" && hasValue){
+			gScene.SceneNumber = std::stoi(argv[++i]);
+		}
+		else if (arg == "--parallax" && hasValue){
+			gScene.ParallaxMethodOverride = std::stoi(argv[++i]);
+			if (gScene.ParallaxMethodOverride < 0 || gScene.ParallaxMethodOverride > 3){
+				std::cout << "Parallax method has to be in the range 0-3\n";
+				exit(1);
+			}
+		}
+		else if (arg == "--tiles" && hasValue){
+			gScene.GroundTiles = std::stoi(argv[++i]);
+		}
+		else if (arg == "--record" && hasValue){
+			gRecordPathFile = argv[++i];
+		}
+		else if (arg == "--benchmark" && hasValue){
+			gBenchmarkPathFile = argv[++i];
+		}
+		else if (arg == "--output" && hasValue){
+			gBenchmarkOutputFile = argv[++i];
+		}
+		else if (arg == "--warmup" && hasValue){
+			gBenchmarkWarmupFrames = std::stoi(argv[++i]);
+		}
+		else if (arg == "--trace" && hasValue){
+			gTraceFile = argv[++i];
+		}
+		else if (arg == "--capture" && i + 2 < argc){
+			gCapturePrefix = argv[++i];
+			gCaptureInterval = std::stoi(argv[++i]);
+		}
+		else if (arg == "--fps" && hasValue){
+			gScene.FrameLimit = std::stoi(argv[++i]);
+		}
+		else if (arg == "--vsync" && hasValue){
+			std::string mode = argv[++i];
+			if (mode == "off"){
+				gScene.SwapInterval = 0;
+			}
+			else if (mode == "on"){
+				gScene.SwapInterval = 1;
+			}
+			else if (mode == "adaptive"){
+				gScene.SwapInterval = -1;
+			}
+			else{
+				std::cout << "Vsync mode has to be off, on or adaptive\n";
+				exit(1);
+			}
+		}
+		else if (arg == "--no-mdi"){
+			gScene.MultiDrawIndirect = false;
+		}
+		else if (arg == "--culling" && hasValue){
+			std::string mode = argv[++i];
+			gScene.CullingMode = mode == "off" ? CULLING_OFF : (mode == "cpu" ? CULLING_CPU : CULLING_GPU);
+		}
+		else if (arg == "--no-occlusion"){
+			gScene.OcclusionCulling = false;
+		}
+		else if (arg == "--no-mesh-cache"){
+			gScene.UseMeshCache = false;
+		}
+		else if (arg == "--mesh-stats" && hasValue){
+			gMeshStatisticsFile = argv[++i];
+		}
+		else if (arg == "--self-test"){
+			gSelfTest = true;
+		}
+		else if (arg == "--no-meshlets"){
+			gScene.Meshlets = false;
+		}
+		else if (arg == "--no-lod"){
+			gScene.MeshLods = false;
+		}
+		else if (arg == "--lod-error" && hasValue){
+			gScene.LodPixelError = std::stof(argv[++i]);
+		}
+		else if (arg == "--lights" && hasValue){
+			gScene.LocalLights = std::stoi(argv[++i]);
+		}
+		else if (arg == "--no-light-clusters"){
+			gScene.ClusteredLights = false;
+		}
+		else if (arg == "--render-path" && hasValue){
+			std::string path = argv[++i];
+			if (path == "forward"){
+				gScene.RenderPath = RENDER_FORWARD;
+			}
+			else if (path == "deferred"){
+				gScene.RenderPath = RENDER_DEFERRED;
+			}
+			else{
+				std::cout << "Unknown render path: " << path << "\n";
+				exit(1);
+			}
+		}
+		else if (arg == "--no-depth-prepass"){
+			gScene.DepthPrepass = false;
+		}
+		else if (arg == "--no-texture-compression"){
+			gScene.TextureCompression = false;
+		}
+		else if (arg == "--packed-materials"){
+			gPackedMaterials = 1;
+		}
+		else if (arg == "--no-packed-materials"){
+			gPackedMaterials = 0;
+		}
+		else if (arg == "--no-texture-arrays"){
+			gScene.GroundTextureArrays = false;
+		}
+		else if (arg == "--virtual-texture" && hasValue){
+			gScene.VirtualTexturePath = argv[++i];
+		}
+		else if (arg == "--vt-record" && hasValue){
+			gScene.VirtualTextureRecordPath = argv[++i];
+		}
+		else if (arg == "--no-texture-streaming"){
+			gScene.TextureStreaming = false;
+		}
+		else if (arg == "--texture-budget" && hasValue){
+			gScene.TextureBudgetMB = std::stoi(argv[++i]);
+		}
+		else if (arg == "--no-texture-storage"){
+			gScene.ImmutableTextures = false;
+		}
+		else if (arg == "--anisotropy" && hasValue){
+			gScene.TextureAnisotropy = std::max(std::stof(argv[++i]), 1.0f);
+		}
+		else if (arg == "--no-bindless"){
+			gScene.BindlessTextures = false;
+		}
+		else if (arg == "--vt-build" && i + 3 < argc){
+			gVirtualTextureBuildDirectory = argv[++i];
+			gVirtualTextureBuildSize = std::stoi(argv[++i]);
+			gVirtualTextureBuildFile = argv[++i];
+		}
+		else if (arg == "--vt-simulate" && hasValue){
+			gVirtualTextureSimulationFile = argv[++i];
+			if (i + 1 < argc && argv[i + 1][0] != '-'){
+				gVirtualTextureFeedbackFile = argv[++i];
+			}
+		}
+		else if (arg == "--parallax-lod" && hasValue){
+			gScene.ParallaxLod = GetParallaxPreset(argv[++i]);
+		}
+		else if (arg == "--parallax-fade" && i + 3 < argc){
+			gScene.ParallaxLod.fullDistance = std::stof(argv[++i]);
+			gScene.ParallaxLod.offsetDistance = std::stof(argv[++i]);
+			gScene.ParallaxLod.normalDistance = std::stof(argv[++i]);
+			if (gScene.ParallaxLod.fullDistance > gScene.ParallaxLod.offsetDistance ||
+			    gScene.ParallaxLod.offsetDistance > gScene.ParallaxLod.normalDistance){
+				std::cout << "Parallax fade distances have to be increasing\n";
+				exit(1);
+			}
+		}
+		else if (arg == "--parallax-mip" && hasValue){
+			gScene.ParallaxLod.mipLevel = std::stof(argv[++i]);
+		}
+		else if (arg == "--parallax-layer-px" && hasValue){
+			gScene.ParallaxLod.pixelsPerLayer = std::stof(argv[++i]);
+			if (gScene.ParallaxLod.pixelsPerLayer <= 0.0f){
+				std::cout << "Pixels per layer have to be positive\n";
+				exit(1);
+			}
+		}
+		else if (arg == "--parallax-sweep"){
+			gParallaxSweep = true;
+		}
+		else if (arg == "--simplify-bench" && hasValue){
+			gSimplifyBenchmarkResolution = std::stoi(argv[++i]);
+		}
+		else if (arg == "--height-bench" && hasValue){
+			gHeightMapBenchmarkSize = std::stoi(argv[++i]);
+		}
+		else if (arg == "--light-bench" && hasValue){
+			gLightBenchmarkLights = std::stoi(argv[++i]);
+		}
+		else if (arg == "--bake-textures" && hasValue){
+			gBakeTexturesDirectory = argv[++i];
+		}
+		else if (arg == "--meshlet-stats" && hasValue){
+			gMeshletStatisticsFile = argv[++i];
+			if (i + 1 < argc && argv[i + 1][0] != '-'){
+				gMeshletStatisticsPath = argv[++i];
+			}
+		}
+		else if (arg == "--vertex-format" && hasValue){
+			gScene.PackedVertices = std::string(argv[++i]) != "float";
+		}
+		else if (arg == "--threads" && hasValue){
+			gNumberOfThreads = std::stoi(argv[++i]);
+		}
+		else if (arg == "--scale-bench" && hasValue){
+			gScalingBenchmarkObjects = std::stoi(argv[++i]);
+		}
+		else if (arg == "--tick-rate" && hasValue){
+			gScene.TickRate = std::stod(argv[++i]);
+			if (gScene.TickRate <= 0.0){
+				std::cout << "Tick rate has to be positive\n";
+				exit(1);
+			}
+		}
+		else{
+			std::cout << "Unknown argument: " << arg << "\n";
+			PrintUsage();
+			exit(1);
+		}
+	}
+}
+
 /**
 * Initialization of the graphics application. Typically this will involve setting up a window
 * and the OpenGL Context (with the appropriate version)
@@ -78,6 +562,24 @@ void InitializeProgram(){
 		std::cout << "glad did not initialize" << std::endl;
 		exit(1);
 	}
+
+	// functions that are not part of the generated glad (OpenGL 4.x)
+	LoadGLExtensions();
+	if (!gGLCapabilities.shaderStorageBuffer){
+		std::cout << "Shader storage buffers (OpenGL 4.3) are required for the per-draw data" << std::endl;
+		exit(1);
+	}
+
+	if (gScene.CullingMode == CULLING_GPU && !gGLCapabilities.computeShader){
+		std::cout << "Compute shaders are not supported, the GPU culling runs on the CPU (frustum only)" << std::endl;
+	}
+
+	// adaptive vsync is not supported everywhere - fall back to the normal one
+	if (SDL_GL_SetSwapInterval(gScene.SwapInterval) < 0 && gScene.SwapInterval == -1){
+		std::cout << "Adaptive vsync is not supported, using vsync" << std::endl;
+		gScene.SwapInterval = 1;
+		SDL_GL_SetSwapInterval(1);
+	}
 	
 
 }
@@ -97,7 +599,8 @@ void getOpenGLVersionInfo(){
 
 
 /**
-* Function called in the Main application loop to handle user input
+* Function called in the Main application loop to handle user input events.
+* Mouse look is applied immediately, movement is done in UpdateSimulation
 *
 * @return void
 */
@@ -139,6 +642,70 @@ void Input(){
 			if(e.key.keysym.sym == SDLK_q){	// quit on q	
 				gScene.Quit = true;
 			}
+
+			// profiler overlay
+			if(e.key.keysym.sym == SDLK_F1 && gScene.profilerOverlay != nullptr){
+				gScene.profilerOverlay->visible = !gScene.profilerOverlay->visible;
+			}
+
+			// start / stop capturing a chrome trace
+			if(e.key.keysym.sym == SDLK_F2){
+				if (gProfiler.IsCapturingTrace()){
+					gProfiler.StopTraceCapture();
+					gProfiler.ExportChromeTrace("trace.json");
+				}
+				else{
+					std::cout << "Capturing trace, press F2 again to stop" << std::endl;
+					gProfiler.StartTraceCapture();
+				}
+			}
+
+			// profile every object separately
+			if(e.key.keysym.sym == SDLK_F3){
+				gProfiler.profileObjects = !gProfiler.profileObjects;
+			}
+
+			// multi draw indirect / one draw per object
+			if(e.key.keysym.sym == SDLK_F4){
+				gScene.MultiDrawIndirect = !gScene.MultiDrawIndirect;
+				std::cout << "Multi draw indirect: " << (gScene.MultiDrawIndirect ? "on" : "off") << std::endl;
+			}
+
+			// culling off / CPU / GPU
+			if(e.key.keysym.sym == SDLK_F5){
+				gScene.CullingMode = (gScene.CullingMode + 1) % 3;
+				const char* modes[] = {"off", "cpu", "gpu"};
+				std::cout << "Culling: " << modes[gScene.CullingMode] << std::endl;
+			}
+
+			// Hi-Z occlusion culling
+			if(e.key.keysym.sym == SDLK_F6){
+				gScene.OcclusionCulling = !gScene.OcclusionCulling;
+				std::cout << "Occlusion culling: " << (gScene.OcclusionCulling ? "on" : "off") << std::endl;
+			}
+
+			// distance based parallax quality
+			if(e.key.keysym.sym == SDLK_F7){
+				gScene.ParallaxLod.enabled = !gScene.ParallaxLod.enabled;
+				std::cout << "Parallax LOD: " << (gScene.ParallaxLod.enabled ? "on" : "off") << std::endl;
+			}
+
+			// clustered / plain forward lighting
+			if(e.key.keysym.sym == SDLK_F8){
+				gScene.ClusteredLights = !gScene.ClusteredLights;
+				std::cout << "Light clusters: " << (gScene.ClusteredLights ? "on" : "off") << std::endl;
+			}
+
+			// forward / deferred render path
+			if(e.key.keysym.sym == SDLK_F9){
+				gScene.RenderPath = gScene.RenderPath == RENDER_FORWARD ? RENDER_DEFERRED : RENDER_FORWARD;
+				std::cout << "Render path: " << (gScene.RenderPath == RENDER_DEFERRED ? "deferred" : "forward") << std::endl;
+			}
+
+			// screenshot of the next frame
+			if(e.key.keysym.sym == SDLK_F10){
+				gScreenshot = true;
+			}
 			
 
         }
@@ -150,9 +717,21 @@ void Input(){
         }
 	}
 
+}
+
+
+/**
+* Advances the simulation by one fixed time step
+*
+* @param deltaTime length of the step in seconds
+* @param animateLights move the lights (the benchmark moves them once per replayed frame instead)
+* @return void
+*/
+void UpdateSimulation(float deltaTime, bool animateLights){
+
     // Retrieve keyboard state
     const Uint8 *state = SDL_GetKeyboardState(NULL);
-	float cameraSpeed = 0.1f / 2;	
+	float cameraSpeed = gScene.CameraSpeed * deltaTime;	
     if (state[SDL_SCANCODE_W]) {
         gScene.MainCamera.MoveForward(cameraSpeed);
     }
@@ -172,6 +751,11 @@ void Input(){
         gScene.MainCamera.MoveDown(cameraSpeed);
     }
 
+	// animated lights
+	if (animateLights){
+		gScene.lightsManager->Animate(deltaTime);
+	}
+
 }
 
 
@@ -187,16 +771,67 @@ void MainLoop(){
     SDL_SetRelativeMouseMode(SDL_TRUE);
 
 
-	unsigned int milisecondsPerFrame = 16; // results in 60 frames per second
+	// simulation runs in fixed steps, rendering as fast as the frame limit allows
+	FrameTimer timer(gScene.TickRate);
+
+	// camera position of the previous simulation step (for interpolation)
+	glm::vec3 previousPosition = gScene.MainCamera.GetEyePosition();
+
+	// camera path recording of the interactive session
+	CameraPath recordedPath;
+	double recordStart = FrameTimer::Now();
+
+	Benchmark* benchmark = gScene.benchmark;
+	double timeToFirstFrame = 0.0;
+	uint64_t frame = 0;
+
+	if (gTraceFile != ""){
+		gProfiler.StartTraceCapture();
+	}
 
 	// While application is running
 	while(!gScene.Quit){
 		
-		// Type of start of frame
-		Uint32 start = SDL_GetTicks();
+		timer.BeginFrame();
+		gProfiler.BeginFrame();
 
 		// Handle Input
 		Input();
+
+		// fixed time step simulation - movement does not depend on the frame rate
+		while (timer.ConsumeTick()){
+			previousPosition = gScene.MainCamera.GetEyePosition();
+			UpdateSimulation(timer.GetTickTime(), benchmark == nullptr);
+		}
+
+		// the benchmark overrides the camera and does not wait for the next frame
+		glm::vec3 simulatedPosition = gScene.MainCamera.GetEyePosition();
+		if (benchmark != nullptr){
+			benchmark->BeginFrame(gScene.MainCamera);
+
+			if (benchmark->IsFinished()){
+				benchmark->WriteResults();
+
+				// the sweep continues with the next parallax quality
+				if (!AdvanceParallaxSweep()){
+					break;
+				}
+				benchmark = gScene.benchmark;
+				benchmark->BeginFrame(gScene.MainCamera);
+			}
+
+			// the lights move by the time step of the path - the same positions in every run
+			gScene.lightsManager->Animate(benchmark->timeStep);
+		}
+		else{
+			if (gRecordPathFile != ""){
+				recordedPath.Record(static_cast<float>(FrameTimer::Now() - recordStart), gScene.MainCamera);
+			}
+
+			// render between the last two simulation steps
+			glm::vec3 position = glm::mix(previousPosition, simulatedPosition, timer.GetAlpha());
+			gScene.MainCamera.SetCameraEyePosition(position.x, position.y, position.z);
+		}
 		
 		// render background
 		gScene.PreDrawBackGround();
@@ -204,13 +839,102 @@ void MainLoop(){
 		// render objects
 		gScene.Render();
 
-		Uint32 elapsedTime = SDL_GetTicks() - start;
-		if(elapsedTime < milisecondsPerFrame){
-			SDL_Delay(milisecondsPerFrame - elapsedTime); // fast computers should wait
+		// the simulation continues from its own state
+		if (benchmark == nullptr){
+			gScene.MainCamera.SetCameraEyePosition(simulatedPosition.x, simulatedPosition.y, simulatedPosition.z);
+		}
+
+		const RenderStatistics& renderStatistics = gScene.objManager->GetRenderStatistics();
+		const LightClusterStatistics& lightStatistics = gScene.lightsManager->GetStatistics();
+		if (benchmark != nullptr){
+			benchmark->RecordSubmit(renderStatistics.drawCalls, renderStatistics.submitMiliseconds);
+			benchmark->RecordParallax(renderStatistics.parallaxFull, renderStatistics.parallaxOffset,
+			                          renderStatistics.parallaxNormal, renderStatistics.parallaxLayers);
+			if (gScene.textureStreamer != nullptr){
+				TextureStreamingStatistics streaming = gScene.textureStreamer->GetStatistics();
+				benchmark->RecordTextureStreaming(streaming.residentBytes / 1048576.0, streaming.quality);
+			}
+			benchmark->EndFrame();
+		}
+
+		gProfiler.EndFrame();
+
+		// read back the frame before the overlay is drawn over it, written by the capture thread
+		bool captureFrame = gCaptureInterval > 0 && frame % gCaptureInterval == 0;
+		if (captureFrame || gScreenshot){
+			if (gFrameCapture == nullptr){
+				gFrameCapture = new FrameCapture();
+			}
+
+			char number[16];
+			std::snprintf(number, sizeof(number), "%06llu", static_cast<unsigned long long>(frame));
+			std::string fileName = captureFrame ? gCapturePrefix + "_" + number + ".ppm"
+			                                    : std::string("screenshot_") + number + ".ppm";
+			if (gFrameCapture->Capture(fileName, gScene.ScreenWidth, gScene.ScreenHeight) && gScreenshot){
+				std::cout << "Saving screenshot to " << fileName << std::endl;
+			}
+			gScreenshot = false;
+		}
+		if (gFrameCapture != nullptr){
+			gFrameCapture->Update();
+		}
+		frame++;
+
+		// profiler results are not part of the measured frame
+		if (gScene.profilerOverlay != nullptr){
+			gScene.profilerOverlay->Draw(gProfiler);
+			gScene.profilerOverlay->status = std::to_string(renderStatistics.drawCalls) +
+			                                 (renderStatistics.multiDraw ? " multi-draws" : " draws") +
+			                                 ", submit " + std::to_string(renderStatistics.submitMiliseconds) + " ms" +
+			                                 (renderStatistics.gpuCulling ? ", GPU culling"
+			                                                              : ", culled " + std::to_string(renderStatistics.culledObjects) +
+			                                                                " objects, " + std::to_string(renderStatistics.culledDraws) + " draws") +
+			                                 ", " + std::to_string(lightStatistics.visibleLights) + " lights, max " +
+			                                 std::to_string(lightStatistics.maxLights) + " per cluster (" +
+			                                 std::to_string(lightStatistics.buildMiliseconds) + " ms)" +
+			                                 (gScene.RenderPath == RENDER_DEFERRED ? ", deferred" : ", forward") +
+			                                 (gScene.textureStreamer != nullptr ?
+			                                  ", textures " + std::to_string(gScene.textureStreamer->GetStatistics().residentBytes / 1048576) +
+			                                  " MB" : "");
+			gScene.profilerOverlay->UpdateWindowTitle(gProfiler, gScene.GraphicsApplicationWindow);
+		}
+
+		// fast computers should wait (the benchmark is never limited)
+		if (benchmark == nullptr){
+			timer.LimitFrameRate(gScene.FrameLimit);
 		}
 
 		//Update screen of our specified window
 		SDL_GL_SwapWindow(gScene.GraphicsApplicationWindow);
+
+		// loading and the first frame (the streamed textures with their coarse levels only)
+		if (timeToFirstFrame == 0.0){
+			glFinish();
+			timeToFirstFrame = (FrameTimer::Now() - gStartTime) * 1000.0;
+			std::cout << "First frame after " << static_cast<int>(timeToFirstFrame) << " ms";
+			if (gScene.textureStreamer != nullptr){
+				TextureStreamingStatistics streaming = gScene.textureStreamer->GetStatistics();
+				std::cout << ", textures " << streaming.residentBytes / 1048576.0 << " of "
+				          << streaming.fullBytes / 1048576.0 << " MB resident";
+			}
+			std::cout << std::endl;
+			if (benchmark != nullptr){
+				benchmark->timeToFirstFrameMs = timeToFirstFrame;
+			}
+		}
+	}
+
+	// save the recorded path
+	if (gRecordPathFile != "" && recordedPath.SaveToFile(gRecordPathFile)){
+		std::cout << "Camera path with " << recordedPath.GetNumberOfKeyframes()
+		          << " keyframes saved to " << gRecordPathFile << std::endl;
+	}
+
+	// save the trace
+	if (gTraceFile != ""){
+		gProfiler.Flush();
+		gProfiler.StopTraceCapture();
+		gProfiler.ExportChromeTrace(gTraceFile);
 	}
 }
 
@@ -224,6 +948,20 @@ void MainLoop(){
 * @return void
 */
 void CleanUp(){
+	// free the profiler queries
+	gProfiler.Release();
+
+	// the captured frames still in flight are written before the context is gone
+	if (gFrameCapture != nullptr){
+		gFrameCapture->Flush();
+		FrameCaptureStatistics capture = gFrameCapture->GetStatistics();
+		std::cout << "Frames captured: " << capture.written << " written, " << capture.dropped << " dropped, "
+		          << capture.failed << " failed, read back " << capture.maxReadMiliseconds << " ms max, written in "
+		          << capture.writeMiliseconds << " ms" << std::endl;
+		delete gFrameCapture;
+		gFrameCapture = nullptr;
+	}
+
 	//Destroy our SDL2 Window
 	SDL_DestroyWindow(gScene.GraphicsApplicationWindow );
 
@@ -239,15 +977,143 @@ void CleanUp(){
 * @return program status
 */
 int main( int argc, char** argv ){
+    gStartTime = FrameTimer::Now();
     std::cout << "Mouse to rotate, WASD to move around, tab for wireframe, q/ESC to exit\n";
+    std::cout << "F1 profiler overlay, F2 start/stop trace capture, F3 profile objects separately, F4 multi draw indirect,\n"
+              << "F5 culling off/cpu/gpu, F6 occlusion culling, F7 parallax quality by distance, F8 light clusters,\n"
+              << "F9 forward/deferred render path, F10 screenshot\n";
+
+	// 0. Read the settings
+	ParseArguments(argc, argv);
+	gScene.meshBuffer->SetPacked(gScene.PackedVertices);
+
+	// packed RGBA8 is lossless, packed BC3 loses normal precision against BC5 - only packed when asked for
+	gScene.PackedMaterials = gPackedMaterials >= 0 ? gPackedMaterials == 1 : !gScene.TextureCompression;
+
+	// CPU only benchmark - no window
+	if (gScalingBenchmarkObjects > 0){
+		RunScalingBenchmark(gScalingBenchmarkObjects, gNumberOfThreads);
+		return 0;
+	}
+
+	if (gMeshStatisticsFile != ""){
+		RunMeshStatistics(gMeshStatisticsFile);
+		return 0;
+	}
+
+	if (gSelfTest){
+		return RunSelfTest() ? 0 : 1;
+	}
+
+	if (gSimplifyBenchmarkResolution > 0){
+		RunSimplifyBenchmark(gSimplifyBenchmarkResolution, gNumberOfThreads);
+		return 0;
+	}
+
+	if (gLightBenchmarkLights > 0){
+		RunLightBenchmark(gLightBenchmarkLights, gNumberOfThreads);
+		return 0;
+	}
+
+	if (gMeshletStatisticsFile != ""){
+		RunMeshletStatistics(gMeshletStatisticsFile, gMeshletStatisticsPath);
+		return 0;
+	}
+
+	if (gHeightMapBenchmarkSize > 0){
+		RunHeightMapBenchmark(gHeightMapBenchmarkSize, gNumberOfThreads);
+		return 0;
+	}
+
+	if (gBakeTexturesDirectory != ""){
+		RunTextureBake(gBakeTexturesDirectory, gNumberOfThreads);
+		return 0;
+	}
+
+	if (gVirtualTextureBuildDirectory != ""){
+		RunVirtualTextureBuild(gVirtualTextureBuildDirectory, gVirtualTextureBuildSize, gVirtualTextureBuildFile,
+		                       gNumberOfThreads);
+		return 0;
+	}
+
+	if (gVirtualTextureSimulationFile != ""){
+		RunVirtualTextureSimulation(gVirtualTextureSimulationFile, gVirtualTextureFeedbackFile);
+		return 0;
+	}
 
 	// 1. Setup the graphics program
 	InitializeProgram();
 
+	// worker threads for the preparation of the draws
+	gScene.jobSystem = new JobSystem(gNumberOfThreads);
+
+	// the finer levels of the KTX2 files are loaded by the screen size (BC4/BC5 are core, BC1/BC3 need S3TC),
+	// the streamed textures are reallocated with their resident levels
+	if (gScene.TextureStreaming && gScene.TextureCompression && gGLCapabilities.textureCompressionS3TC &&
+	    Texture::UseStorage() && gGLCapabilities.copyImage){
+		gScene.textureStreamer = new TextureStreamer(static_cast<size_t>(gScene.TextureBudgetMB) * 1048576);
+	}
+
+	// the shaders of the objects are compiled with BINDLESS - the table exists before the scene is loaded
+	if (MaterialTable::IsSupported()){
+		gScene.materialTable = new MaterialTable();
+	}
+
 	// 2. setup the scene
-	// gScene.InitializeScene();	// uncomment this line to see wall scene
-	gScene.InitializeScene2();	// uncomment this line to see Parallax at Dawn
-	
+	if (gScene.SceneNumber == 1){
+		gScene.InitializeScene();	// wall scene
+	}
+	else{
+		gScene.InitializeScene2();	// Parallax at Dawn
+	}
+
+	// light stress test - scene 3 is the Parallax at Dawn with many local lights
+	if (gScene.SceneNumber == 3 && gScene.LocalLights == 0){
+		gScene.LocalLights = 1024;
+	}
+	gScene.AddLocalLights(gScene.LocalLights);
+
+	if (gScene.ParallaxMethodOverride != -2){
+		gScene.objManager->OverrideParallaxMethod(gScene.ParallaxMethodOverride);
+	}
+
+	std::cout << "Vertex buffer: " << gScene.meshBuffer->GetNumberOfVertices() << " vertices, "
+	          << gScene.meshBuffer->GetVertexBytes() / 1024 << " KB ("
+	          << (gScene.meshBuffer->IsPacked() ? "packed" : "float") << " format)" << std::endl;
+	std::cout << "Index buffer: " << gScene.meshBuffer->GetNumberOfIndices() << " indices, "
+	          << gScene.meshBuffer->GetIndexBytes() / 1024 << " KB (" << gScene.meshBuffer->GetNumberOfShortIndexMeshes()
+	          << " of " << gScene.meshBuffer->GetNumberOfMeshes() << " meshes with 16 bit indices)" << std::endl;
+	TextureUploadStatistics uploads = Texture::GetUploadStatistics();
+	std::cout << "Textures: " << uploads.textures << " uploads, " << uploads.bytes / 1048576.0 << " MB in "
+	          << uploads.miliseconds << " ms (" << (Texture::UseStorage() ? "immutable storage, unpack buffers" : "mutable")
+	          << ")" << std::endl;
+
+	// benchmark mode - vsync and the frame limit are disabled so the frame rate is not capped
+	if (gBenchmarkPathFile != ""){
+
+		// the sweep measures every quality preset into its own file
+		std::string outputFile = gBenchmarkOutputFile;
+		if (gParallaxSweep){
+			gScene.ParallaxLod = GetParallaxPreset(gParallaxPresets[0]);
+			outputFile = GetSweepOutputFile(gParallaxPresets[0]);
+		}
+
+		gScene.benchmark = CreateBenchmark(outputFile);
+		if (gScene.benchmark == nullptr){
+			CleanUp();
+			return 1;
+		}
+
+		// the benchmark reads the GPU timings from the profiler
+		gProfiler.keepFrames = true;
+
+		SDL_GL_SetSwapInterval(0);
+	}
+
+	// profiler overlay (hidden until F1 is pressed)
+	gScene.profilerOverlay = new ProfilerOverlay();
+	gScene.profilerOverlay->visible = false;
+		
 	// 3. Call the main application loop
 	MainLoop();	
 
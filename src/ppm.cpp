@@ -6,6 +6,7 @@
 #include <cmath>
 #include <cstdint>
 #include <cstring>
+#include <algorithm>
 
 // Constructor loads a filename with the .ppm extension
 PPM::PPM(std::string fileName){
@@ -17,7 +18,7 @@ PPM::PPM(std::string fileName){
     }
 
     // Open file
-    std::ifstream ppmFile(fileName);
+    std::ifstream ppmFile(fileName, std::ios::binary);
 
     // Check if file is open
     if (!ppmFile.is_open()){
@@ -28,10 +29,14 @@ PPM::PPM(std::string fileName){
     // read first line
     std::string line;
 
-    // Check if file is P3
+    // Check if file is P3 or P6
     std::getline(ppmFile, line);
+    if (line == "P6"){
+        readPixelData_P6(ppmFile);
+        return;
+    }
     if (line != "P3"){
-        std::cerr << "Error: File is not P3!" << std::endl;
+        std::cerr << "Error: File is not P3 or P6!" << std::endl;
         return;
     }
 
@@ -64,33 +69,32 @@ void PPM::savePPM(std::string outputFileName) const {
         outputFileName += ".ppm";
     }
 
-    // open file
-    std::ofstream ppmFile(outputFileName);
-
-    // Check if file is open
-    if (!ppmFile.is_open()){
+    // the values of a P6 file have one byte
+    if (!Write(outputFileName, m_width, m_height, m_PixelData.data(), std::min(std::max(m_maxColorValue, 1u), 255u))){
         std::cerr << "Error: File could not be opened!" << std::endl;
-        return;
     }
 
-    // write header
-    ppmFile << "P3" << std::endl;
+}
 
-    // write comment
-    ppmFile << "# Created by: Adam's PPM Library" << std::endl;
 
-    // write width and height
-    ppmFile << m_width << " " << m_height << std::endl;
+// Writes the pixels as a binary P6 file
+bool PPM::Write(const std::string& fileName, unsigned int width, unsigned int height, const uint8_t* data,
+                unsigned int maxValue){
 
-    // write max color value
-    ppmFile << m_maxColorValue << std::endl;
+    std::ofstream ppmFile(fileName, std::ios::binary);
+    if (!ppmFile.is_open()){
+        return false;
+    }
 
-    // write pixel data 
-    writePixelData(ppmFile);
+    // header with comment, width and height and max color value - no flush per line
+    std::string header = "P6\n# Created by: Adam's PPM Library\n" + std::to_string(width) + " " +
+                         std::to_string(height) + "\n" + std::to_string(maxValue) + "\n";
+    ppmFile.write(header.data(), header.size());
 
-    // close file
-    ppmFile.close();
+    // all pixels at once
+    ppmFile.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(width) * height * 3);
 
+    return static_cast<bool>(ppmFile);
 }
 
 // Darken halves (integer division by 2) each of the red, green
@@ -173,20 +177,44 @@ void PPM::flipLR(){
 
 ///////////////////////////////////////// helper functions ///////////////////////////////////////
 
-// write the data of the ppm file
-void PPM::writePixelData(std::ofstream &outputFile) const{
+// read the data of a binary ppm file
+void PPM::readPixelData_P6(std::ifstream &ppmFile){
 
-    unsigned int numberOfPixels = m_PixelData.size() / 3;
+    // width, height and max value separated by white spaces, comments run to the end of the line
+    unsigned int values[3] = {0, 0, 0};
+    for (unsigned int i = 0; i < 3; i++){
 
-    // write each rgb values on 1 line
-    for (unsigned int i = 0; i < numberOfPixels; i++){
+        ppmFile >> std::ws;
+        while (ppmFile.peek() == '#'){
+            std::string comment;
+            std::getline(ppmFile, comment);
+            ppmFile >> std::ws;
+        }
 
-        outputFile << static_cast<unsigned int>(m_PixelData[i * 3]) << " ";
-        outputFile << static_cast<unsigned int>(m_PixelData[i * 3 + 1]) << " ";
-        outputFile << static_cast<unsigned int>(m_PixelData[i * 3 + 2]) << std::endl;
-        
+        if (!(ppmFile >> values[i])){
+            std::cerr << "Error: P6 header could not be read!" << std::endl;
+            return;
+        }
+    }
+
+    // one white space before the pixels, values up to 255 have one byte
+    ppmFile.get();
+    if (values[2] == 0 || values[2] > 255){
+        std::cerr << "Error: P6 with 16 bit values is not supported!" << std::endl;
+        return;
     }
 
+    m_PixelData.resize(static_cast<size_t>(values[0]) * values[1] * 3);
+    if (!ppmFile.read(reinterpret_cast<char*>(m_PixelData.data()), m_PixelData.size())){
+        std::cerr << "Error: P6 pixel data is incomplete!" << std::endl;
+        m_PixelData.clear();
+        return;
+    }
+
+    m_width = values[0];
+    m_height = values[1];
+    m_maxColorValue = values[2];
+
 }
 
 // Pushes a number in a string to a vector of unsigned chars